@@ -24,6 +24,7 @@ int main(int argc, char* argv[]) {
         // Define command-line options
         options.add_options()
             ("a,add", "Add a new book", cxxopts::value<std::string>())
+            ("i,isbn", "ISBN-10 or ISBN-13 of the book to add", cxxopts::value<std::string>())
             ("b,borrow", "Borrow a book", cxxopts::value<std::string>())
             ("r,return", "Return a borrowed book", cxxopts::value<std::string>())
             ("s,search", "Search for books", cxxopts::value<std::string>());
@@ -38,7 +39,8 @@ int main(int argc, char* argv[]) {
         if (result.count("add")) {
             std::string title = result["add"].as<std::string>();
             // Call the addBook function from library_system.hpp
-            bool added = library.addBook(title, "Unknown Author", "Unknown ISBN");
+            std::string isbn = result.count("isbn") ? result["isbn"].as<std::string>() : "";
+            bool added = library.addBook(title, "Unknown Author", isbn);
             if (added) {
                 std::cout << "Book '" << title << "' added successfully." << std::endl;
             } else {
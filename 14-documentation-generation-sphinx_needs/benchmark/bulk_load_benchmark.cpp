@@ -0,0 +1,95 @@
+//!
+//! @file bulk_load_benchmark.cpp
+//! @brief Catalog load time of the parallel importCatalog() by thread count
+//!
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "library_system/flat_format.hpp"
+#include "library_system/library_system.hpp"
+
+namespace {
+
+const char* const kWords[] = {"great", "night", "war",    "peace",  "time",  "sea",   "house", "river",
+                              "stone", "glass", "garden", "winter", "light", "dark",  "king",  "queen",
+                              "city",  "song",  "letter", "island", "storm", "years", "road",  "fire"};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string makeIsbn(int serial) {
+    std::string digits = "978" + std::to_string(1000000000 + serial).substr(1);
+    int sum = 0;
+    for (std::size_t i = 0; i < digits.size(); ++i) {
+        sum += (digits[i] - '0') * (i % 2 == 0 ? 1 : 3);
+    }
+    return digits + static_cast<char>('0' + (10 - sum % 10) % 10);
+}
+
+} // namespace
+
+/**
+ * @brief Export a generated catalog, then load it with 1, 2, 4, ... threads.
+ * @return The exit code of the benchmark.
+ */
+int main() {
+    const int kBooks = 1000000;
+    const std::size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+    std::mt19937 random(42);
+    FlatWriter writer(FLAT_BOOK);
+    for (int i = 0; i < kBooks; ++i) {
+        const std::string title = std::string(kWords[random() % kWordCount]) + " " + kWords[random() % kWordCount] +
+                                  " " + std::to_string(i % 10000);
+        const std::string author = std::string("Author ") + kWords[i % kWordCount] + " " + std::to_string(i % 5000);
+        writer.addBook(title, author, parseIsbn(makeIsbn(i)), random() % 50);
+    }
+    std::vector<char> buffer;
+    writer.finish(buffer);
+    std::printf("%d books, %zu bytes\n", kBooks, buffer.size());
+
+    // The one-by-one insert path copies the version's chunk table per book,
+    // so it only gets a prefix of the records.
+    {
+        const std::size_t kSerialBooks = 100000;
+        FlatReader reader(buffer.data(), buffer.size());
+        LibrarySystem library;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < kSerialBooks; ++i) {
+            const BookView book = reader.book(i);
+            const MutationRecord record = {MUTATION_ADD_BOOK, book.isbn(), static_cast<int32_t>(book.loans()),
+                                           book.title().str(), book.author().str()};
+            library.applyMutation(record);
+        }
+        std::printf("  serial insert:       %7.3f s for %zu books, %8.0f books/s\n", secondsSince(start), kSerialBooks,
+                    kSerialBooks / secondsSince(start));
+    }
+
+    const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < cores; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(cores);
+    double single = 0;
+    for (std::size_t t = 0; t < threadCounts.size(); ++t) {
+        LibrarySystem library;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const std::size_t added = library.importCatalog(buffer.data(), buffer.size(), threadCounts[t]);
+        const double seconds = secondsSince(start);
+        if (t == 0) {
+            single = seconds;
+        }
+        std::printf("  import, %2u threads: %7.3f s for %zu books, %8.0f books/s, %.2fx (%zu hits)\n",
+                    threadCounts[t], seconds, added, added / seconds, single / seconds,
+                    library.searchBooks("great night").size());
+    }
+    return 0;
+}
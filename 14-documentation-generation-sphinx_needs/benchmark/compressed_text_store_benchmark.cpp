@@ -0,0 +1,96 @@
+//!
+//! @file compressed_text_store_benchmark.cpp
+//! @brief Memory saved versus access latency of the CompressedTextStore
+//!
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "library_system/compressed_text_store.hpp"
+
+namespace {
+
+const char *kActors[] = {"librarian", "borrower", "administrator", "auditor"};
+const char *kActions[] = {"renew a loan", "reserve a book", "report a damaged copy", "export the catalog"};
+const char *kOutcomes[] = {"the request is confirmed by e-mail", "the change is recorded in the audit log",
+                           "the dashboard shows the new state", "the borrower is notified"};
+
+/**
+ * @brief Generate a requirement description in the usual user-story boilerplate.
+ * @param serial The requirement number.
+ * @param random The random source.
+ * @return The description.
+ */
+std::string makeDescription(int serial, std::mt19937 &random) {
+    return std::string("As a ") + kActors[random() % 4] + " I want to " + kActions[random() % 4] +
+           " (REQ-" + std::to_string(serial) + ") so that " + kOutcomes[random() % 4] +
+           ". Acceptance: the operation completes within " + std::to_string(1 + random() % 5) +
+           " seconds, is logged with the user id, and fails with a clear message when the catalog is "
+           "unavailable.";
+}
+
+/**
+ * @brief Heap bytes held by a vector of strings, including heap-allocated characters.
+ */
+std::size_t stringVectorBytes(const std::vector<std::string> &texts) {
+    std::size_t bytes = texts.capacity() * sizeof(std::string);
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        // Short strings live inside the std::string object itself.
+        if (texts[i].capacity() > 15) {
+            bytes += texts[i].capacity() + 1;
+        }
+    }
+    return bytes;
+}
+
+} // namespace
+
+/**
+ * @brief Store generated descriptions both raw and compressed, then time random reads.
+ * @return The exit code of the benchmark.
+ */
+int main() {
+    const int kTexts = 200000;
+    const int kReads = 1000000;
+
+    std::mt19937 random(42);
+    std::vector<std::string> plain;
+    CompressedTextStore store;
+    for (int i = 0; i < kTexts; ++i) {
+        plain.push_back(makeDescription(i, random));
+        store.append(plain.back());
+    }
+
+    std::vector<uint32_t> order(kReads);
+    for (int i = 0; i < kReads; ++i) {
+        order[i] = static_cast<uint32_t>(random() % kTexts);
+    }
+
+    char buffer[1024];
+    std::size_t checksum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kReads; ++i) {
+        const std::string &text = plain[order[i]];
+        text.copy(buffer, text.size());
+        checksum += static_cast<unsigned char>(buffer[text.size() / 2]);
+    }
+    const double plainNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kReads; ++i) {
+        const std::size_t length = store.read(order[i], buffer, sizeof(buffer));
+        checksum += static_cast<unsigned char>(buffer[length / 2]);
+    }
+    const double compressedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    const std::size_t plainBytes = stringVectorBytes(plain);
+    const std::size_t compressedBytes = store.memoryUsage();
+    std::printf("texts:            %d (%zu raw bytes)\n", kTexts, store.rawBytes());
+    std::printf("std::string:      %10zu bytes  %6.1f ns/read\n", plainBytes, plainNs / kReads);
+    std::printf("compressed store: %10zu bytes  %6.1f ns/read\n", compressedBytes, compressedNs / kReads);
+    std::printf("memory saved:     %.1fx (checksum %zu)\n", static_cast<double>(plainBytes) / compressedBytes, checksum);
+    return 0;
+}
@@ -0,0 +1,214 @@
+//!
+//! @file flat_format_benchmark.cpp
+//! @brief Read throughput of the flat record format against a JSON baseline
+//!
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "library_system/flat_format.hpp"
+
+namespace {
+
+/**
+ * @brief Append a JSON string literal.
+ */
+void writeJsonString(std::string &out, const std::string &text) {
+    out.push_back('"');
+    for (std::string::size_type i = 0; i < text.size(); ++i) {
+        if (text[i] == '"' || text[i] == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(text[i]);
+    }
+    out.push_back('"');
+}
+
+/**
+ * @brief Serialize requirements as a JSON array of objects.
+ */
+std::string writeJson(const std::vector<Requirement> &requirements) {
+    std::string out = "[";
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        const Requirement &r = requirements[i];
+        out += i == 0 ? "{\"id\":" : ",{\"id\":";
+        out += std::to_string(r.getID());
+        out += ",\"title\":";
+        writeJsonString(out, r.getTitle());
+        out += ",\"description\":";
+        writeJsonString(out, r.getDescription());
+        out += ",\"priority\":" + std::to_string(r.getPriority());
+        out += ",\"status\":" + std::to_string(r.getStatus());
+        out += ",\"testCases\":" + std::to_string(r.getTestCases());
+        out += ",\"owner\":";
+        writeJsonString(out, r.getOwner());
+        out += ",\"createdDate\":";
+        writeJsonString(out, r.getCreatedDate());
+        out += "}";
+    }
+    out += "]";
+    return out;
+}
+
+/**
+ * @brief Minimal parser for the JSON written by writeJson(), the text baseline.
+ */
+class JsonParser
+{
+public:
+    explicit JsonParser(const std::string &text) : text_(text), position_(0) {}
+
+    std::vector<Requirement> parse() {
+        std::vector<Requirement> requirements;
+        expect('[');
+        while (peek() == '{' || peek() == ',') {
+            if (peek() == ',') {
+                ++position_;
+            }
+            expect('{');
+            int id = 0, priority = 0, status = 0, testCases = 0;
+            std::string title, description, owner, createdDate;
+            while (peek() != '}') {
+                if (peek() == ',') {
+                    ++position_;
+                }
+                const std::string key = string();
+                expect(':');
+                if (key == "id") {
+                    id = number();
+                } else if (key == "priority") {
+                    priority = number();
+                } else if (key == "status") {
+                    status = number();
+                } else if (key == "testCases") {
+                    testCases = number();
+                } else if (key == "title") {
+                    title = string();
+                } else if (key == "description") {
+                    description = string();
+                } else if (key == "owner") {
+                    owner = string();
+                } else {
+                    createdDate = string();
+                }
+            }
+            expect('}');
+            requirements.push_back(Requirement(id, title, description, priority, static_cast<RequirementStatus>(status),
+                                               testCases, owner, createdDate));
+        }
+        expect(']');
+        return requirements;
+    }
+
+private:
+    char peek() const {
+        return text_[position_];
+    }
+
+    void expect(char c) {
+        if (text_[position_++] != c) {
+            std::fprintf(stderr, "JSON: expected '%c' at %zu\n", c, position_ - 1);
+            std::exit(1);
+        }
+    }
+
+    std::string string() {
+        expect('"');
+        std::string value;
+        while (text_[position_] != '"') {
+            if (text_[position_] == '\\') {
+                ++position_;
+            }
+            value.push_back(text_[position_++]);
+        }
+        ++position_;
+        return value;
+    }
+
+    int number() {
+        char *end = 0;
+        const long value = std::strtol(text_.c_str() + position_, &end, 10);
+        position_ = static_cast<std::size_t>(end - text_.c_str());
+        return static_cast<int>(value);
+    }
+
+    const std::string &text_;
+    std::size_t position_;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+/**
+ * @brief Encode generated requirements both ways and time reading them back.
+ * @return The exit code of the benchmark.
+ */
+int main() {
+    const int kRequirements = 200000;
+    const char *owners[] = {"Catalog Team", "Circulation Team", "Platform Team"};
+    std::vector<Requirement> requirements;
+    for (int i = 0; i < kRequirements; ++i) {
+        requirements.push_back(Requirement(i, "Requirement " + std::to_string(i),
+                                           "The system shall process request " + std::to_string(i) +
+                                               " within two seconds and record it in the audit log.",
+                                           i % 5, static_cast<RequirementStatus>(i % 3), i % 11, owners[i % 3],
+                                           "2024-03-" + std::to_string(10 + i % 20)));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::string json = writeJson(requirements);
+    const double jsonWrite = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    FlatWriter writer(FLAT_REQUIREMENT);
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        writer.addRequirement(requirements[i]);
+    }
+    std::vector<char> flat;
+    writer.finish(flat);
+    const double flatWrite = secondsSince(start);
+
+    // Every reader computes the same aggregate so that no field access is optimized away.
+    start = std::chrono::steady_clock::now();
+    std::vector<Requirement> parsed = JsonParser(json).parse();
+    long long jsonSum = 0;
+    for (std::size_t i = 0; i < parsed.size(); ++i) {
+        jsonSum += parsed[i].getTestCases() + static_cast<long long>(parsed[i].getDescription().size());
+    }
+    const double jsonRead = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    FlatReader reader(flat.data(), flat.size());
+    long long flatSum = 0;
+    for (std::size_t i = 0; i < reader.size(); ++i) {
+        const RequirementView view = reader.requirement(i);
+        flatSum += view.testCases() + static_cast<long long>(view.description().size);
+    }
+    const double flatRead = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    long long materializedSum = 0;
+    for (std::size_t i = 0; i < reader.size(); ++i) {
+        const Requirement requirement = reader.requirement(i).toRequirement();
+        materializedSum += requirement.getTestCases() + static_cast<long long>(requirement.getDescription().size());
+    }
+    const double flatMaterialize = secondsSince(start);
+
+    if (!reader.valid() || jsonSum != flatSum || flatSum != materializedSum) {
+        std::fprintf(stderr, "mismatch between JSON and flat results\n");
+        return 1;
+    }
+    std::printf("records:                %d\n", kRequirements);
+    std::printf("JSON:      %9zu bytes  write %7.1f MB/s  read %7.1f MB/s\n", json.size(),
+                json.size() / jsonWrite / 1e6, json.size() / jsonRead / 1e6);
+    std::printf("flat:      %9zu bytes  write %7.1f MB/s  read %7.1f MB/s (validated, zero-copy)\n", flat.size(),
+                flat.size() / flatWrite / 1e6, flat.size() / flatRead / 1e6);
+    std::printf("flat -> Requirement objects:        read %7.1f MB/s\n", flat.size() / flatMaterialize / 1e6);
+    return 0;
+}
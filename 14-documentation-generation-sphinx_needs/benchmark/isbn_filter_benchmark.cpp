@@ -0,0 +1,86 @@
+//!
+//! @file isbn_filter_benchmark.cpp
+//! @brief Cost of borrowBook() for unknown ISBNs with the Bloom filters and of each filter probe
+//!
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "library_system/blocked_bloom_filter.hpp"
+#include "library_system/flat_format.hpp"
+#include "library_system/library_system.hpp"
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string makeIsbn(int serial) {
+    std::string digits = "978" + std::to_string(1000000000 + serial).substr(1);
+    int sum = 0;
+    for (std::size_t i = 0; i < digits.size(); ++i) {
+        sum += (digits[i] - '0') * (i % 2 == 0 ? 1 : 3);
+    }
+    return digits + static_cast<char>('0' + (10 - sum % 10) % 10);
+}
+
+} // namespace
+
+/**
+ * @brief Look up unknown ISBNs in a catalog at several filter rates, then time the raw probes.
+ * @return The exit code of the benchmark.
+ */
+int main() {
+    const int kBooks = 200000;
+    const int kLookups = 1000000;
+
+    // Even serials are in the catalog, odd ones are not.
+    FlatWriter writer(FLAT_BOOK);
+    for (int i = 0; i < kBooks; ++i) {
+        writer.addBook("Volume " + std::to_string(i), "Serial Author", parseIsbn(makeIsbn(2 * i)), 0);
+    }
+    std::vector<char> buffer;
+    writer.finish(buffer);
+    LibrarySystem library;
+    library.importCatalog(buffer.data(), buffer.size());
+    std::vector<std::string> unknown;
+    for (int i = 0; i < kLookups; ++i) {
+        unknown.push_back(makeIsbn(2 * (i % (4 * kBooks)) + 1));
+    }
+    std::printf("%d books, %d lookups of unknown ISBNs\n", kBooks, kLookups);
+
+    const double rates[] = {0.1, 0.01, 0.001};
+    for (std::size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r) {
+        library.setIsbnFilterFalsePositiveRate(rates[r]);
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kLookups; ++i) {
+            library.borrowBook(unknown[i], 1);
+        }
+        const double seconds = secondsSince(start);
+        const LibrarySystem::IsbnFilterStats stats = library.isbnFilterStats();
+        std::printf("  target %.3f: %6.1f ns per lookup, observed rate %.4f, filters %zu bytes\n", rates[r],
+                    seconds * 1e9 / kLookups, stats.falsePositiveRate(), library.memoryUsage().isbnFilters);
+    }
+
+    BlockedBloomFilter filter(kBooks, 0.01);
+    for (int i = 0; i < kBooks; ++i) {
+        filter.add(parseIsbn(makeIsbn(2 * i)));
+    }
+    const char* const names[] = {"scalar", "avx2"};
+    const BloomProbe probes[] = {BLOOM_PROBE_SCALAR, BLOOM_PROBE_AVX2};
+    for (std::size_t p = 0; p < 2; ++p) {
+        std::size_t hits = 0;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int round = 0; round < 10; ++round) {
+            for (uint64_t key = 9780000000000ULL; key < 9780000000000ULL + kLookups; ++key) {
+                hits += filter.mayContain(key, probes[p]);
+            }
+        }
+        std::printf("  %-6s probe: %5.2f ns per probe (%zu hits)\n", names[p],
+                    secondsSince(start) * 1e9 / (10.0 * kLookups), hits);
+    }
+    return 0;
+}
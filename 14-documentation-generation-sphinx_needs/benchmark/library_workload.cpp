@@ -0,0 +1,124 @@
+//!
+//! @file library_workload.cpp
+//! @brief Representative catalog workload, the training run of the profile-guided build
+//!
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "library_system/boolean_query.hpp"
+#include "library_system/flat_format.hpp"
+#include "library_system/library_system.hpp"
+
+namespace {
+
+const char* const kWords[] = {"great", "night", "war",    "peace",  "time",  "sea",   "house", "river",
+                              "stone", "glass", "garden", "winter", "light", "dark",  "king",  "queen",
+                              "city",  "song",  "letter", "island", "storm", "years", "road",  "fire"};
+const std::size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string makeIsbn(int serial) {
+    std::string digits = "978" + std::to_string(1000000000 + serial).substr(1);
+    int sum = 0;
+    for (std::size_t i = 0; i < digits.size(); ++i) {
+        sum += (digits[i] - '0') * (i % 2 == 0 ? 1 : 3);
+    }
+    return digits + static_cast<char>('0' + (10 - sum % 10) % 10);
+}
+
+// Popular words are asked for far more often than rare ones.
+std::string skewedWord(std::mt19937& random) {
+    const double u = std::uniform_real_distribution<double>(0, 1)(random);
+    return kWords[static_cast<std::size_t>(u * u * kWordCount)];
+}
+
+std::string makeTitle(std::mt19937& random, int serial) {
+    return std::string(kWords[random() % kWordCount]) + " " + kWords[random() % kWordCount] + " " +
+           std::to_string(serial % 1000);
+}
+
+std::string makeAuthor(int serial) {
+    return std::string("Author ") + kWords[serial % kWordCount] + " " + std::to_string(serial % 2000);
+}
+
+} // namespace
+
+/**
+ * @brief Load a catalog, then run a fixed mix of catalog operations against it.
+ *
+ * Per 1000 operations: 10 books added, 100 borrowed and 90 returned, 150
+ * borrows of ISBNs not in the catalog, 50 ISBN lookups, 450 keyword
+ * searches, 50 prefix suggestions, 50 boolean queries and 50 ranked
+ * searches. Searches pick popular words more often and are about as
+ * selective as a title typed into a search box; suggestions complete the
+ * first letters of such a word. The random stream is seeded, so every run
+ * does the same work.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv Optionally the number of operations and the number of books loaded first.
+ * @return The exit code of the workload.
+ */
+int main(int argc, char* argv[]) {
+    const int operations = argc > 1 ? std::atoi(argv[1]) : 50000;
+    const int books = argc > 2 ? std::atoi(argv[2]) : 100000;
+
+    std::mt19937 random(2024);
+    FlatWriter writer(FLAT_BOOK);
+    for (int i = 0; i < books; ++i) {
+        writer.addBook(makeTitle(random, i), makeAuthor(i), parseIsbn(makeIsbn(2 * i)), random() % 50);
+    }
+    std::vector<char> buffer;
+    writer.finish(buffer);
+
+    LibrarySystem library;
+    library.enableQueryCache(4096);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    library.importCatalog(buffer.data(), buffer.size());
+    std::printf("loaded %d books in %.3f s\n", books, secondsSince(start));
+
+    int added = books;
+    std::size_t checksum = 0;
+    LibrarySystem::SearchHit book;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < operations; ++i) {
+        const unsigned kind = random() % 1000;
+        // Owned books have even serials, the scanners' strays odd ones.
+        const int owned = static_cast<int>(random() % static_cast<unsigned>(added));
+        if (kind < 10) {
+            library.addBook(makeTitle(random, added), makeAuthor(added), makeIsbn(2 * added));
+            ++added;
+        } else if (kind < 110) {
+            checksum += library.borrowBook(makeIsbn(2 * owned), i);
+        } else if (kind < 200) {
+            checksum += library.returnBook(makeIsbn(2 * owned), i);
+        } else if (kind < 350) {
+            checksum += library.borrowBook(makeIsbn(2 * owned + 1), i);
+        } else if (kind < 400) {
+            checksum += library.findBook(makeIsbn(2 * owned), book) ? book.loans : 0;
+        } else if (kind < 850) {
+            const std::string keyword = skewedWord(random) + " " +
+                                        (kind % 2 == 0 ? skewedWord(random) : std::to_string(random() % 1000));
+            checksum += library.searchBooks(keyword).size();
+        } else if (kind < 900) {
+            checksum += library.suggest(skewedWord(random).substr(0, 1 + random() % 4), 5).size();
+        } else if (kind < 950) {
+            const BooleanQuery query("(" + skewedWord(random) + " OR " + skewedWord(random) + ") AND " +
+                                     std::to_string(random() % 1000) + " NOT " + skewedWord(random));
+            checksum += library.searchBooks(query).size();
+        } else {
+            checksum += library.searchTopBooks(skewedWord(random), 10).size();
+        }
+    }
+    const double seconds = secondsSince(start);
+    std::printf("%d operations in %.3f s, %.0f ops/s (checksum %zu)\n", operations, seconds, operations / seconds,
+                checksum);
+    return 0;
+}
@@ -0,0 +1,80 @@
+//!
+//! @file loan_event_store_benchmark.cpp
+//! @brief Memory and group-by speed of the columnar LoanEventStore against plain rows
+//!
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "library_system/loan_event_store.hpp"
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+/**
+ * @brief Log a year of generated loans both ways and time "most borrowed this month".
+ * @return The exit code of the benchmark.
+ */
+int main() {
+    const int kEvents = 5000000;
+    const int kBooks = 20000;
+    const int kUsers = 50000;
+    const int64_t kStart = 1704067200; // 2024-01-01.
+    const int64_t kMonth = 30 * 86400;
+
+    // Popular books and active users dominate, as in real circulation data.
+    std::mt19937 random(42);
+    std::geometric_distribution<int> book(0.001);
+    std::geometric_distribution<int> user(0.0002);
+    std::vector<LoanEvent> rows;
+    rows.reserve(kEvents);
+    LoanEventStore store;
+    int64_t now = kStart;
+    for (int i = 0; i < kEvents; ++i) {
+        now += random() % 13;
+        LoanEvent event = {now, 9780000000000ULL + book(random) % kBooks, user(random) % kUsers, random() % 2 == 0};
+        rows.push_back(event);
+        store.append(event);
+    }
+
+    const int64_t from = kStart + 5 * kMonth;
+    const int64_t to = from + kMonth;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::unordered_map<IsbnKey, uint64_t> rowCounts;
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        if (rows[i].timestamp >= from && rows[i].timestamp < to && !rows[i].returned) {
+            ++rowCounts[rows[i].isbn];
+        }
+    }
+    const double rowSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<LoanEventStore::BookCount> top = store.countByBook(from, to, LOAN_EVENTS_BORROWS, 10);
+    const double columnSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    const std::size_t users = store.countByUser(0, INT64_MAX, LOAN_EVENTS_BORROWS, 0).size();
+    const double userSeconds = secondsSince(start);
+
+    if (top.empty() || rowCounts[top[0].isbn] != top[0].count) {
+        std::fprintf(stderr, "mismatch between row and column results\n");
+        return 1;
+    }
+    std::printf("events:                 %d in %zu chunks\n", kEvents, store.chunkCount());
+    std::printf("rows:                   %9zu bytes (%.1f bytes/event)\n", store.rawBytes(),
+                static_cast<double>(store.rawBytes()) / kEvents);
+    std::printf("columns:                %9zu bytes (%.1f bytes/event, %.1fx smaller)\n", store.memoryUsage(),
+                static_cast<double>(store.memoryUsage()) / kEvents,
+                static_cast<double>(store.rawBytes()) / store.memoryUsage());
+    std::printf("top books of one month: rows %.2f ms, columns %.2f ms\n", rowSeconds * 1e3, columnSeconds * 1e3);
+    std::printf("borrows per user, all:  %.2f ms for %zu users\n", userSeconds * 1e3, users);
+    return 0;
+}
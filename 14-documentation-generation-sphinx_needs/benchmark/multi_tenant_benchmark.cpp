@@ -0,0 +1,100 @@
+//!
+//! @file multi_tenant_benchmark.cpp
+//! @brief Memory of many small tenants in one MultiTenantCatalog against a LibrarySystem each
+//!
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "library_system/library_system.hpp"
+#include "library_system/multi_tenant_catalog.hpp"
+
+namespace {
+
+const char* const kWords[] = {"great", "night", "war",    "peace",  "time",  "sea",   "house", "river",
+                              "stone", "glass", "garden", "winter", "light", "dark",  "king",  "queen",
+                              "city",  "song",  "letter", "island", "storm", "years", "road",  "fire"};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string makeIsbn(int serial) {
+    std::string digits = "978" + std::to_string(1000000000 + serial).substr(1);
+    int sum = 0;
+    for (std::size_t i = 0; i < digits.size(); ++i) {
+        sum += (digits[i] - '0') * (i % 2 == 0 ? 1 : 3);
+    }
+    return digits + static_cast<char>('0' + (10 - sum % 10) % 10);
+}
+
+} // namespace
+
+/**
+ * @brief Load the same tenants both ways, compare their footprint and search, then evict.
+ * @return The exit code of the benchmark.
+ */
+int main() {
+    const int kTenants = 200;
+    const int kBooksPerTenant = 50;
+    const std::size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+    std::mt19937 random(42);
+    std::vector<std::string> titles;
+    for (int i = 0; i < kTenants * kBooksPerTenant; ++i) {
+        titles.push_back(std::string(kWords[random() % kWordCount]) + " " + kWords[random() % kWordCount] + " " +
+                         std::to_string(i % 500));
+    }
+
+    std::vector<std::unique_ptr<LibrarySystem> > libraries;
+    MultiTenantCatalog catalog("/tmp");
+    for (int t = 0; t < kTenants; ++t) {
+        libraries.push_back(std::unique_ptr<LibrarySystem>(new LibrarySystem()));
+        const std::string tenant = "tenant-" + std::to_string(t);
+        for (int b = 0; b < kBooksPerTenant; ++b) {
+            const int serial = t * kBooksPerTenant + b;
+            const std::string author = std::string("Author ") + kWords[serial % kWordCount];
+            libraries.back()->addBook(titles[serial], author, makeIsbn(serial));
+            catalog.addBook(tenant, titles[serial], author, makeIsbn(serial));
+        }
+    }
+
+    std::size_t separate = 0;
+    for (std::size_t t = 0; t < libraries.size(); ++t) {
+        separate += libraries[t]->memoryUsage().total();
+    }
+    std::size_t tenantBytes = 0;
+    for (int t = 0; t < kTenants; ++t) {
+        tenantBytes += catalog.tenantMemoryUsage("tenant-" + std::to_string(t));
+    }
+    const std::size_t shared = catalog.sharedMemoryUsage();
+    std::printf("%d tenants x %d books\n", kTenants, kBooksPerTenant);
+    std::printf("  LibrarySystem per tenant: %8zu bytes, %6zu per tenant\n", separate, separate / kTenants);
+    std::printf("  MultiTenantCatalog:       %8zu bytes shared, %6zu per tenant\n", shared, tenantBytes / kTenants);
+
+    std::size_t hits = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int q = 0; q < 100000; ++q) {
+        hits += libraries[q % kTenants]->searchBooks(kWords[q % kWordCount]).size();
+    }
+    std::printf("  search, separate: %6.2f us (%zu hits)\n", secondsSince(start) * 10, hits);
+    hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < 100000; ++q) {
+        hits += catalog.searchBooks("tenant-" + std::to_string(q % kTenants), kWords[q % kWordCount]).size();
+    }
+    std::printf("  search, shared:   %6.2f us (%zu hits)\n", secondsSince(start) * 10, hits);
+
+    start = std::chrono::steady_clock::now();
+    const std::size_t evicted = catalog.evictIdleTenants(std::chrono::seconds(0));
+    std::printf("  evicted %zu tenants in %.1f ms, shared now %zu bytes\n", evicted, secondsSince(start) * 1e3,
+                catalog.sharedMemoryUsage());
+    start = std::chrono::steady_clock::now();
+    hits = catalog.searchBooks("tenant-0", kWords[0]).size();
+    std::printf("  reloaded tenant-0 in %.1f us (%zu hits)\n", secondsSince(start) * 1e6, hits);
+    return 0;
+}
@@ -0,0 +1,110 @@
+//!
+//! @file shared_memory_lookup_benchmark.cpp
+//! @brief Round trip of ISBN lookups and searches through shared memory against a Unix socket
+//!
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "library_system/library_system.hpp"
+#include "library_system/shared_memory_lookup.hpp"
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string makeIsbn(int serial) {
+    std::string digits = "978" + std::to_string(1000000000 + serial).substr(1);
+    int sum = 0;
+    for (std::size_t i = 0; i < digits.size(); ++i) {
+        sum += (digits[i] - '0') * (i % 2 == 0 ? 1 : 3);
+    }
+    return digits + static_cast<char>('0' + (10 - sum % 10) % 10);
+}
+
+// The same lookup over a socket: 13 ISBN digits there, the loan count back.
+void serveSocket(LibrarySystem& library, int fd) {
+    char isbn[13];
+    while (::recv(fd, isbn, sizeof(isbn), MSG_WAITALL) == static_cast<ssize_t>(sizeof(isbn))) {
+        LibrarySystem::SearchHit book;
+        const uint32_t loans = library.findBook(std::string(isbn, sizeof(isbn)), book) ? book.loans : 0;
+        if (::send(fd, &loans, sizeof(loans), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(loans))) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Time lookups called directly, over a socket pair and through a shared-memory client.
+ * @return The exit code of the benchmark.
+ */
+int main() {
+    const int kBooks = 10000;
+    const int kLookups = 200000;
+
+    LibrarySystem library;
+    for (int i = 0; i < kBooks; ++i) {
+        library.addBook("Volume " + std::to_string(i), i % 100 == 0 ? "Rare Author" : "Common Author", makeIsbn(i));
+    }
+    std::vector<std::string> isbns;
+    for (int i = 0; i < kLookups; ++i) {
+        isbns.push_back(makeIsbn(i % kBooks));
+    }
+    std::printf("%d books, %d lookups, %u cores\n", kBooks, kLookups, std::thread::hardware_concurrency());
+
+    LibrarySystem::SearchHit book;
+    std::size_t found = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kLookups; ++i) {
+        found += library.findBook(isbns[i], book);
+    }
+    std::printf("  direct call:   %7.2f us per lookup (%zu found)\n", secondsSince(start) * 1e6 / kLookups, found);
+
+    int sockets[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        return 1;
+    }
+    std::thread socketServer(serveSocket, std::ref(library), sockets[1]);
+    found = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kLookups; ++i) {
+        uint32_t loans = 0;
+        ::send(sockets[0], isbns[i].data(), isbns[i].size(), MSG_NOSIGNAL);
+        found += ::recv(sockets[0], &loans, sizeof(loans), MSG_WAITALL) == static_cast<ssize_t>(sizeof(loans));
+    }
+    std::printf("  unix socket:   %7.2f us per lookup (%zu answered)\n", secondsSince(start) * 1e6 / kLookups, found);
+    ::shutdown(sockets[0], SHUT_RDWR);
+    socketServer.join();
+    ::close(sockets[0]);
+    ::close(sockets[1]);
+
+    const std::string path = "/tmp/shared_memory_lookup_benchmark.sock";
+    SharedMemoryLookupServer server(library, path);
+    SharedMemoryLookupClient client(path);
+    if (!client.connected()) {
+        return 1;
+    }
+    found = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kLookups; ++i) {
+        found += client.findBook(isbns[i], book);
+    }
+    std::printf("  shared memory: %7.2f us per lookup (%zu found)\n", secondsSince(start) * 1e6 / kLookups, found);
+    std::size_t hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kLookups / 100; ++i) {
+        hits += client.searchBooks("rare author").size();
+    }
+    std::printf("  shared memory: %7.2f us per search (%zu hits)\n", secondsSince(start) * 1e8 / kLookups, hits);
+    return 0;
+}
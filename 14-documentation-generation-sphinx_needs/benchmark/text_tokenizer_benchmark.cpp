@@ -0,0 +1,146 @@
+//!
+//! @file text_tokenizer_benchmark.cpp
+//! @brief Normalization throughput of the tokenizer kernels on book titles
+//!
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "library_system/text_tokenizer.hpp"
+
+namespace {
+
+// Titles and authors as they appear in catalog records, including
+// non-ASCII names and typographic punctuation.
+const char* const kTitles[] = {
+    "The Great Gatsby", "F. Scott Fitzgerald", "Tender Is the Night", "This Side of Paradise",
+    "Pride and Prejudice", "Jane Austen", "Sense and Sensibility", "Nineteen Eighty-Four", "George Orwell",
+    "To Kill a Mockingbird", "Harper Lee", "One Hundred Years of Solitude", "Gabriel Garc\xC3\xAD" "a M\xC3\xA1rquez",
+    "Crime and Punishment", "Fyodor Dostoevsky", "\xD0\x9F\xD1\x80\xD0\xB5\xD1\x81\xD1\x82\xD1\x83\xD0\xBF\xD0\xBB"
+    "\xD0\xB5\xD0\xBD\xD0\xB8\xD0\xB5 \xD0\xB8 \xD0\xBD\xD0\xB0\xD0\xBA\xD0\xB0\xD0\xB7\xD0\xB0\xD0\xBD\xD0\xB8\xD0\xB5",
+    "The Brothers Karamazov", "War and Peace", "Leo Tolstoy", "Anna Karenina", "Madame Bovary",
+    "Gustave Flaubert", "Les Mis\xC3\xA9rables", "Victor Hugo", "Notre-Dame de Paris", "In Search of Lost Time",
+    "Marcel Proust", "\xC3\x80 la recherche du temps perdu", "Ulysses", "James Joyce",
+    "A Portrait of the Artist as a Young Man", "Moby-Dick; or, The Whale", "Herman Melville",
+    "The Adventures of Huckleberry Finn", "Mark Twain", "Wuthering Heights", "Emily Bront\xC3\xAB", "Jane Eyre",
+    "Charlotte Bront\xC3\xAB", "Middlemarch", "George Eliot", "Great Expectations", "Charles Dickens",
+    "A Tale of Two Cities", "The Catcher in the Rye", "J. D. Salinger", "Brave New World", "Aldous Huxley",
+    "The Sound and the Fury", "William Faulkner", "Don Quixote", "Miguel de Cervantes Saavedra",
+    "The Divine Comedy", "Dante Alighieri", "The Odyssey", "Homer", "\xCE\x9F\xCE\xB4\xCF\x8D\xCF\x83\xCF\x83\xCE\xB5\xCE\xB9\xCE\xB1",
+    "Hamlet, Prince of Denmark", "William Shakespeare", "Frankenstein; or, The Modern Prometheus", "Mary Shelley",
+    "Dracula", "Bram Stoker", "The Picture of Dorian Gray", "Oscar Wilde", "Heart of Darkness", "Joseph Conrad",
+    "Things Fall Apart", "Chinua Achebe", "Invisible Man", "Ralph Ellison", "Beloved", "Toni Morrison",
+    "The Trial", "Franz Kafka", "Der Proze\xC3\x9F", "The Master and Margarita", "Mikhail Bulgakov",
+    "Lolita", "Vladimir Nabokov", "Catch-22", "Joseph Heller", "Slaughterhouse-Five", "Kurt Vonnegut",
+    "The Name of the Rose", "Umberto Eco", "The Old Man and the Sea", "Ernest Hemingway",
+    "Of Mice and Men", "John Steinbeck", "The Grapes of Wrath", "Mrs Dalloway", "Virginia Woolf",
+    "To the Lighthouse", "Their Eyes Were Watching God", "Zora Neale Hurston", "Lord of the Flies",
+    "William Golding", "The Hobbit, or There and Back Again", "J. R. R. Tolkien", "Fahrenheit 451",
+    "Ray Bradbury", "The Handmaid\xE2\x80\x99s Tale", "Margaret Atwood", "Midnight\xE2\x80\x99s Children",
+    "Salman Rushdie", "The Stranger", "Albert Camus", "L\xE2\x80\x99\xC3\x89tranger", "Ficciones",
+    "Jorge Luis Borges", "Pedro P\xC3\xA1ramo", "Juan Rulfo", "Siddhartha", "Hermann Hesse",
+    "The Tin Drum", "G\xC3\xBCnter Grass", "Solaris", "Stanis\xC5\x82\x61w Lem", "THE COLLECTED WORKS: VOLUME IV"};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Byte-at-a-time baseline with std::tolower and std::isalnum.
+ */
+std::string normalizeBaseline(const std::string& text) {
+    std::string normalized;
+    normalized.reserve(text.size());
+    bool pendingSeparator = false;
+    for (std::string::size_type i = 0; i < text.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80 && !std::isalnum(c)) {
+            pendingSeparator = !normalized.empty();
+            continue;
+        }
+        if (pendingSeparator) {
+            normalized.push_back(' ');
+            pendingSeparator = false;
+        }
+        normalized.push_back(static_cast<char>(c < 0x80 ? std::tolower(c) : c));
+    }
+    return normalized;
+}
+
+/**
+ * @brief Normalize every record a number of times and report the throughput.
+ */
+template <typename Normalize>
+void measure(const char* name, const std::vector<std::string>& records, std::size_t bytes, int passes,
+             Normalize normalize) {
+    std::size_t checksum = 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass) {
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            checksum += normalize(records[i]).size();
+        }
+    }
+    const double seconds = secondsSince(start);
+    bytes *= passes;
+    std::printf("%-24s %6.2f GB/s (%zu bytes out)\n", name, bytes / seconds / 1e9, checksum);
+}
+
+} // namespace
+
+/**
+ * @brief Normalize a corpus of catalog records and long descriptions with every kernel.
+ * @return The exit code of the benchmark.
+ */
+int main() {
+    const std::size_t kTitleCount = sizeof(kTitles) / sizeof(kTitles[0]);
+    const std::size_t kCorpusBytes = 16u << 20;
+    const int kPasses = 8;
+
+    // Short records, as indexed per book, and long ones, as in descriptions.
+    std::mt19937 random(42);
+    std::vector<std::string> titles;
+    std::vector<std::string> descriptions;
+    std::size_t titleBytes = 0;
+    std::size_t descriptionBytes = 0;
+    while (titleBytes < kCorpusBytes) {
+        titles.push_back(kTitles[random() % kTitleCount]);
+        titleBytes += titles.back().size();
+    }
+    while (descriptionBytes < kCorpusBytes) {
+        std::string description;
+        while (description.size() < 4096) {
+            description += kTitles[random() % kTitleCount];
+            description += ". ";
+        }
+        descriptionBytes += description.size();
+        descriptions.push_back(description);
+    }
+
+    for (std::size_t i = 0; i < titles.size() && i < 1000; ++i) {
+        if (normalizeText(titles[i], TEXT_KERNEL_SCALAR) != normalizeText(titles[i])) {
+            std::fprintf(stderr, "kernel mismatch on \"%s\"\n", titles[i].c_str());
+            return 1;
+        }
+    }
+
+    const char* kernelNames[] = {"scalar", "sse2", "avx2"};
+    std::printf("best kernel: %s\n", kernelNames[bestTextKernel()]);
+    const std::vector<std::string>* corpora[] = {&titles, &descriptions};
+    const std::size_t corpusBytes[] = {titleBytes, descriptionBytes};
+    const char* corpusNames[] = {"titles", "descriptions"};
+    for (int c = 0; c < 2; ++c) {
+        std::printf("%s: %zu records, %zu bytes\n", corpusNames[c], corpora[c]->size(), corpusBytes[c]);
+        measure("  tolower baseline", *corpora[c], corpusBytes[c], kPasses, normalizeBaseline);
+        for (int k = TEXT_KERNEL_SCALAR; k <= bestTextKernel(); ++k) {
+            const TextKernel kernel = static_cast<TextKernel>(k);
+            const std::string name = std::string("  ") + kernelNames[k];
+            measure(name.c_str(), *corpora[c], corpusBytes[c], kPasses,
+                    [kernel](const std::string& text) { return normalizeText(text, kernel); });
+        }
+    }
+    return 0;
+}
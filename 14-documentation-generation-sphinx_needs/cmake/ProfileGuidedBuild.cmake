@@ -0,0 +1,98 @@
+# Profile-guided build of the library, run by the pgo target or directly with
+#   cmake -DSOURCE_DIR=<source dir> -DBINARY_DIR=<build dir>/pgo -P cmake/ProfileGuidedBuild.cmake
+#
+# 1. Build library_workload with instrumentation and run it to record profiles.
+# 2. Rebuild everything in the same directory with the profiles and LTO; GCC
+#    finds the profile of an object file by its path, so both stages share it.
+# 3. Build library_workload as a plain Release build and compare both builds.
+#
+# Optional: GENERATOR, CXX_COMPILER, WORKLOAD_OPERATIONS (operations per run,
+# default 50000) and RUNS (timed runs per build, the best one counts, default 3).
+
+if(NOT SOURCE_DIR OR NOT BINARY_DIR)
+    message(FATAL_ERROR "SOURCE_DIR and BINARY_DIR must be set")
+endif()
+if(NOT WORKLOAD_OPERATIONS)
+    set(WORKLOAD_OPERATIONS 50000)
+endif()
+if(NOT RUNS)
+    set(RUNS 3)
+endif()
+
+set(OPTIMIZED_DIR "${BINARY_DIR}/optimized")
+set(BASELINE_DIR "${BINARY_DIR}/baseline")
+set(PROFILE_DIR "${BINARY_DIR}/profiles")
+set(CONFIGURE_ARGS -DCMAKE_BUILD_TYPE=Release)
+if(GENERATOR)
+    list(APPEND CONFIGURE_ARGS -G ${GENERATOR})
+endif()
+if(CXX_COMPILER)
+    list(APPEND CONFIGURE_ARGS -DCMAKE_CXX_COMPILER=${CXX_COMPILER})
+endif()
+
+# Run a command and stop the build if it fails
+function(run_step)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE RESULT)
+    if(NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "Failed (${RESULT}): ${ARGN}")
+    endif()
+endfunction()
+
+# Run the workload of a build RUNS times and return its best throughput in ops/s
+function(measure_workload BUILD_DIR OUTPUT)
+    set(BEST 0)
+    foreach(RUN RANGE 1 ${RUNS})
+        execute_process(COMMAND ${BUILD_DIR}/benchmark/library_workload ${WORKLOAD_OPERATIONS}
+            OUTPUT_VARIABLE WORKLOAD_OUTPUT
+            RESULT_VARIABLE RESULT)
+        string(REGEX MATCH "([0-9]+) ops/s" MATCH "${WORKLOAD_OUTPUT}")
+        if(NOT RESULT EQUAL 0 OR NOT MATCH)
+            message(FATAL_ERROR "The workload of ${BUILD_DIR} failed:\n${WORKLOAD_OUTPUT}")
+        endif()
+        if(CMAKE_MATCH_1 GREATER BEST)
+            set(BEST ${CMAKE_MATCH_1})
+        endif()
+    endforeach()
+    set(${OUTPUT} ${BEST} PARENT_SCOPE)
+endfunction()
+
+message(STATUS "PGO 1/3: instrumented build and training run")
+file(REMOVE_RECURSE "${PROFILE_DIR}")
+run_step(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${OPTIMIZED_DIR} ${CONFIGURE_ARGS}
+    -DLIBRARY_PGO=GENERATE -DLIBRARY_LTO=OFF -DLIBRARY_PGO_DIR=${PROFILE_DIR})
+run_step(${CMAKE_COMMAND} --build ${OPTIMIZED_DIR} --target library_workload)
+run_step(${OPTIMIZED_DIR}/benchmark/library_workload ${WORKLOAD_OPERATIONS})
+
+# Clang writes raw profiles that llvm-profdata merges; GCC's are used as they are
+file(GLOB RAW_PROFILES "${PROFILE_DIR}/*.profraw")
+if(RAW_PROFILES)
+    find_program(LLVM_PROFDATA NAMES llvm-profdata)
+    if(NOT LLVM_PROFDATA)
+        message(FATAL_ERROR "llvm-profdata is needed to merge Clang profiles")
+    endif()
+    run_step(${LLVM_PROFDATA} merge -output=${PROFILE_DIR}/library.profdata ${RAW_PROFILES})
+endif()
+
+message(STATUS "PGO 2/3: optimized build with the profiles and LTO")
+run_step(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${OPTIMIZED_DIR} ${CONFIGURE_ARGS}
+    -DLIBRARY_PGO=USE -DLIBRARY_LTO=ON -DLIBRARY_PGO_DIR=${PROFILE_DIR})
+run_step(${CMAKE_COMMAND} --build ${OPTIMIZED_DIR})
+
+message(STATUS "PGO 3/3: baseline build and comparison")
+run_step(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BASELINE_DIR} ${CONFIGURE_ARGS} -DLIBRARY_PGO=OFF -DLIBRARY_LTO=OFF)
+run_step(${CMAKE_COMMAND} --build ${BASELINE_DIR} --target library_workload)
+measure_workload(${BASELINE_DIR} BASELINE)
+measure_workload(${OPTIMIZED_DIR} OPTIMIZED)
+
+math(EXPR PERMILLE "(${OPTIMIZED} - ${BASELINE}) * 1000 / ${BASELINE}")
+set(SIGN "+")
+if(PERMILLE LESS 0)
+    set(SIGN "-")
+    math(EXPR PERMILLE "-${PERMILLE}")
+endif()
+math(EXPR PERCENT "${PERMILLE} / 10")
+math(EXPR TENTHS "${PERMILLE} % 10")
+message(STATUS "library_workload, best of ${RUNS} runs of ${WORKLOAD_OPERATIONS} operations:")
+message(STATUS "  Release:          ${BASELINE} ops/s")
+message(STATUS "  Release, PGO+LTO: ${OPTIMIZED} ops/s (${SIGN}${PERCENT}.${TENTHS}%)")
+message(STATUS "Optimized binaries are in ${OPTIMIZED_DIR}")
@@ -0,0 +1,110 @@
+//!
+//! @file blocked_bloom_filter.hpp
+//! @brief Definition of the BlockedBloomFilter cache-line blocked membership filter
+//!
+
+#ifndef BLOCKED_BLOOM_FILTER_H
+#define BLOCKED_BLOOM_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief Enum selecting the implementation of BlockedBloomFilter::mayContain().
+ */
+enum BloomProbe
+{
+    BLOOM_PROBE_SCALAR, ///< One word of the block at a time.
+    BLOOM_PROBE_AVX2    ///< All eight masks computed and tested in two 256-bit registers.
+};
+
+/**
+ * @brief Get the fastest probe the running CPU supports.
+ * @return The probe mayContain() uses by default.
+ */
+BloomProbe bestBloomProbe();
+
+/**
+ * @brief Bloom filter over 64-bit keys whose probes touch a single cache line.
+ *
+ * The filter is an array of 64-byte blocks of eight 64-bit words. A key
+ * hashes to one block and sets one bit in each of its words, so a lookup
+ * is one cache line load and, with AVX2, one multiply, two variable shifts
+ * and two tests. The number of blocks is chosen so that the expected false
+ * positive rate at the given number of keys, accounting for the uneven
+ * load of blocks, stays below the target.
+ *
+ * add() may run concurrently with other add() and mayContain() calls:
+ * bits are only ever set, with atomic operations, so a lookup never misses
+ * a key whose add() completed before it started.
+ */
+class BlockedBloomFilter
+{
+public:
+    /**
+     * @brief Size of a block in bytes, one cache line.
+     */
+    static const std::size_t kBlockBytes = 64;
+
+    /**
+     * @brief Constructor to create an empty filter.
+     * @param capacity The number of keys the filter is sized for, at least 1.
+     * @param falsePositiveRate The target false positive rate at capacity, in (0, 1).
+     */
+    BlockedBloomFilter(std::size_t capacity, double falsePositiveRate);
+
+    /**
+     * @brief Add a key.
+     * @param key The key.
+     */
+    void add(uint64_t key);
+
+    /**
+     * @brief Check whether a key may have been added.
+     * @param key The key.
+     * @return False if the key was certainly never added.
+     */
+    bool mayContain(uint64_t key) const;
+
+    /**
+     * @brief Check a key with a given probe, e.g. to compare probes.
+     * @param key The key.
+     * @param probe The probe; probes the CPU lacks fall back to bestBloomProbe().
+     * @return The same result as mayContain(key).
+     */
+    bool mayContain(uint64_t key, BloomProbe probe) const;
+
+    /**
+     * @brief Get the number of keys the filter is sized for.
+     * @return The capacity.
+     */
+    std::size_t capacity() const;
+
+    /**
+     * @brief Get the target false positive rate at capacity.
+     * @return The rate.
+     */
+    double falsePositiveRate() const;
+
+    /**
+     * @brief Get the heap memory used by the filter.
+     * @return The size in bytes.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    BlockedBloomFilter(const BlockedBloomFilter &);
+    BlockedBloomFilter &operator=(const BlockedBloomFilter &);
+
+    static double expectedFalsePositiveRate(double keysPerBlock);
+    const uint64_t *block(uint64_t hash) const;
+
+    std::size_t capacity_;
+    double falsePositiveRate_;
+    std::size_t blockCount_;
+    std::unique_ptr<uint64_t[]> storage_; ///< The blocks, plus slack to align them to a cache line.
+    uint64_t *words_;
+};
+
+#endif // BLOCKED_BLOOM_FILTER_H
@@ -0,0 +1,132 @@
+//!
+//! @file boolean_query.hpp
+//! @brief Definition of the BooleanQuery parser and posting-list plan
+//!
+
+#ifndef BOOLEAN_QUERY_H
+#define BOOLEAN_QUERY_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "library_system/search_segment.hpp"
+
+/**
+ * @brief Parsed boolean search query, e.g. author:fitzgerald AND (gatsby OR paradise) NOT tender.
+ *
+ * Grammar, with operators in upper case and AND implied between adjacent
+ * operands:
+ *
+ *     query   := and ("OR" and)*
+ *     and     := unary (["AND"] unary)*
+ *     unary   := "NOT" unary | "(" query ")" | [field ":"] word
+ *
+ * A word is normalized like searchBooks() input and may hold several terms,
+ * which must all match; double quotes let a word span spaces, parentheses
+ * and operator names, e.g. title:"the and". Fields are "title" and "author"; an unqualified word
+ * matches either. NOT may only narrow a conjunction: a query, an OR operand
+ * or a parenthesized group matching only by absence is rejected.
+ *
+ * Against a segment the query is compiled into a tree of posting-list
+ * cursors evaluated lazily, one document at a time. Conjunctions visit
+ * their operands by ascending posting-list length and leapfrog: the
+ * shortest list proposes a document and the others gallop forward to it,
+ * so the long lists are only probed, never scanned. Excluded terms are
+ * probed the same way for each candidate only.
+ */
+class BooleanQuery
+{
+public:
+    /**
+     * @brief Constructor to parse a query.
+     * @param text The query text.
+     */
+    explicit BooleanQuery(const std::string &text);
+
+    /**
+     * @brief Build the index term of a word restricted to a field.
+     * @param field The field, "title" or "author".
+     * @param term The normalized word.
+     * @return The term indexed for the word in that field.
+     */
+    static std::string fieldTerm(const std::string &field, const std::string &term);
+
+    /**
+     * @brief Check whether the query was parsed successfully.
+     * @return True if the query is valid.
+     */
+    bool valid() const;
+
+    /**
+     * @brief Get the reason the query is invalid.
+     * @return A description of the syntax error, empty for a valid query.
+     */
+    const std::string &error() const;
+
+    /**
+     * @brief Get the canonical form of the query, e.g. as a cache key.
+     * @return The query with normalized terms, explicit operators and parentheses.
+     */
+    std::string str() const;
+
+    /**
+     * @brief Get every index term the query refers to, negated or not.
+     * @return The distinct terms, sorted.
+     */
+    std::vector<std::string> terms() const;
+
+    /**
+     * @brief Describe the plan chosen for a segment.
+     * @param segment The segment.
+     * @return The plan with operands in evaluation order and their estimated costs.
+     */
+    std::string explain(const SearchSegment &segment) const;
+
+    /**
+     * @brief Find the documents of a segment matching the query.
+     * @param segment The segment.
+     * @param matches Receives the matching document ids in ascending order.
+     */
+    void match(const SearchSegment &segment, std::vector<SearchSegment::DocId> &matches) const;
+
+    /**
+     * @brief Check whether a document with the given terms matches the query.
+     * @param terms The sorted index terms of the document.
+     * @return True if the document matches.
+     */
+    bool matches(const std::vector<std::string> &terms) const;
+
+private:
+    struct Node
+    {
+        enum Kind
+        {
+            TERM,
+            AND,
+            OR
+        };
+
+        Kind kind;
+        bool negated;
+        std::string term;            ///< The index term of a TERM node.
+        std::vector<Node> children;  ///< The operands of an AND or OR node.
+    };
+
+    class Parser;
+    class Cursor;
+    class TermCursor;
+    class AndCursor;
+    class OrCursor;
+
+    static std::unique_ptr<Cursor> compile(const Node &node, const SearchSegment &segment);
+    static bool matches(const Node &node, const std::vector<std::string> &terms);
+    static void collectTerms(const Node &node, std::vector<std::string> &terms);
+    static std::string str(const Node &node);
+
+    Node root_;
+    std::string error_;
+};
+
+#endif // BOOLEAN_QUERY_H
@@ -0,0 +1,154 @@
+//!
+//! @file compressed_text_store.hpp
+//! @brief Definition of the CompressedTextStore shared-dictionary text store
+//!
+
+#ifndef COMPRESSED_TEXT_STORE_H
+#define COMPRESSED_TEXT_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Append-only store of repetitive texts compressed against a shared dictionary.
+ *
+ * Texts are compressed with a small LZ77 variant whose matches may reach back
+ * into a dictionary trained on the corpus, so even short texts that are
+ * mostly boilerplate shrink to a few bytes. Until kTrainingSamples texts have
+ * been stored they are kept raw; the dictionary is then trained on them and
+ * every stored text is recompressed. Texts are decompressed on access into a
+ * caller-provided buffer.
+ */
+class CompressedTextStore
+{
+public:
+    /**
+     * @brief Identifier of a stored text.
+     */
+    typedef uint32_t Id;
+
+    /**
+     * @brief Number of texts after which the dictionary is trained automatically.
+     */
+    static const std::size_t kTrainingSamples = 256;
+
+    /**
+     * @brief Default dictionary capacity in bytes.
+     */
+    static const std::size_t kDictionaryCapacity = 16 * 1024;
+
+    /**
+     * @brief Constructor to initialize an empty, untrained store.
+     * @param dictionaryCapacity The maximum dictionary size in bytes (at most 64 KiB).
+     */
+    explicit CompressedTextStore(std::size_t dictionaryCapacity = kDictionaryCapacity);
+
+    /**
+     * @brief Train the dictionary on sample texts and recompress all stored texts.
+     *
+     * Picks the fixed-size segments of the samples that cover the most
+     * frequent 8-byte sequences, in the spirit of zstd's COVER trainer.
+     *
+     * @param samples Representative texts.
+     */
+    void train(const std::vector<std::string> &samples);
+
+    /**
+     * @brief Store a text.
+     * @param text The text to store.
+     * @return The id of the stored text.
+     */
+    Id append(const std::string &text);
+
+    /**
+     * @brief Replace a stored text.
+     *
+     * The new text overwrites the old bytes when its encoding fits in them;
+     * otherwise it is appended and the old bytes become dead. The store is
+     * compacted once dead bytes make up half of it.
+     *
+     * @param id The id returned by append().
+     * @param text The new text.
+     */
+    void replace(Id id, const std::string &text);
+
+    /**
+     * @brief Get the uncompressed length of a stored text.
+     * @param id The id returned by append().
+     * @return The length in bytes.
+     */
+    std::size_t length(Id id) const;
+
+    /**
+     * @brief Decompress a stored text into a caller-provided buffer.
+     * @param id The id returned by append().
+     * @param buffer The destination, not null-terminated.
+     * @param capacity The size of the destination.
+     * @return The length of the text; nothing is written if it exceeds capacity.
+     */
+    std::size_t read(Id id, char *buffer, std::size_t capacity) const;
+
+    /**
+     * @brief Decompress a stored text into a string.
+     * @param id The id returned by append().
+     * @return The text.
+     */
+    std::string str(Id id) const;
+
+    /**
+     * @brief Get the number of stored texts.
+     * @return The number of texts.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Check whether the dictionary has been trained.
+     * @return True once train() ran, explicitly or automatically.
+     */
+    bool trained() const;
+
+    /**
+     * @brief Get the total uncompressed size of the stored texts.
+     * @return The size in bytes.
+     */
+    std::size_t rawBytes() const;
+
+    /**
+     * @brief Get the number of heap bytes held by the store, dictionary included.
+     * @return The approximate memory footprint in bytes.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    struct Slot
+    {
+        uint32_t offset;     ///< First byte in data_.
+        uint32_t size;       ///< Number of bytes in data_.
+        uint32_t textLength; ///< Uncompressed length.
+    };
+
+    struct MatchEntry
+    {
+        uint32_t generation; ///< The entry is empty unless this is tableGeneration_.
+        int32_t position;
+    };
+
+    void encode(const std::string &text, Slot &slot);
+    void indexDictionary();
+    void compact();
+
+    std::size_t dictionaryCapacity_;
+    std::string dictionary_;
+    std::vector<int32_t> dictionaryTable_; ///< Hash of 4 bytes to last dictionary position, or -1.
+    bool trained_;
+    std::vector<char> data_;
+    std::size_t deadBytes_; ///< Bytes of data_ no slot refers to.
+    std::vector<Slot> slots_;
+    std::size_t rawBytes_;
+    std::vector<MatchEntry> table_; ///< Hash of 4 bytes to last position in the text being encoded.
+    uint32_t tableGeneration_;      ///< Bumped for every encoded text.
+};
+
+#endif // COMPRESSED_TEXT_STORE_H
@@ -0,0 +1,31 @@
+//!
+//! @file epoch_day.hpp
+//! @brief Conversion between calendar dates and days since the Unix epoch
+//!
+
+#ifndef EPOCH_DAY_H
+#define EPOCH_DAY_H
+
+#include <climits>
+#include <string>
+
+/**
+ * @brief Day number returned for strings that are not a valid date.
+ */
+const int kInvalidEpochDay = INT_MIN;
+
+/**
+ * @brief Parse an ISO 8601 calendar date into a day number.
+ * @param date The date as "YYYY-MM-DD".
+ * @return The number of days since 1970-01-01, or kInvalidEpochDay.
+ */
+int parseEpochDay(const std::string &date);
+
+/**
+ * @brief Format a day number as an ISO 8601 calendar date.
+ * @param day The number of days since 1970-01-01.
+ * @return The date as "YYYY-MM-DD", or an empty string for kInvalidEpochDay.
+ */
+std::string formatEpochDay(int day);
+
+#endif // EPOCH_DAY_H
@@ -0,0 +1,105 @@
+//!
+//! @file epoch_manager.hpp
+//! @brief Definition of the EpochManager epoch-based memory reclamation
+//!
+
+#ifndef EPOCH_MANAGER_H
+#define EPOCH_MANAGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Epoch-based reclamation of data shared with lock-free readers.
+ *
+ * Readers pin the current epoch for the duration of a read with a Guard.
+ * Writers publish a replacement and retire the old object together with the
+ * epoch it was retired in; the object is destroyed once every pinned reader
+ * has moved past that epoch, so readers never take a lock and never see a
+ * destroyed object.
+ */
+class EpochManager
+{
+public:
+    /**
+     * @brief Maximum number of simultaneously pinned readers.
+     */
+    static const std::size_t kMaxReaders = 128;
+
+    /**
+     * @brief Scoped pin of the current epoch.
+     */
+    class Guard
+    {
+    public:
+        /**
+         * @brief Constructor pinning the current epoch.
+         * @param manager The epoch manager to pin.
+         */
+        explicit Guard(EpochManager &manager);
+
+        /**
+         * @brief Destructor releasing the pin.
+         */
+        ~Guard();
+
+    private:
+        Guard(const Guard &);
+        Guard &operator=(const Guard &);
+
+        EpochManager &manager_;
+        std::size_t slot_;
+    };
+
+    /**
+     * @brief Constructor to initialize the epoch manager.
+     */
+    EpochManager();
+
+    /**
+     * @brief Destructor running the deleters of all retired objects.
+     *
+     * No reader may be pinned when the manager is destroyed.
+     */
+    ~EpochManager();
+
+    /**
+     * @brief Retire an object that readers may still be using.
+     *
+     * Must be called after the replacement has been published.
+     *
+     * @param deleter The function destroying the object.
+     */
+    void retire(std::function<void()> deleter);
+
+    /**
+     * @brief Destroy the retired objects no pinned reader can reach anymore.
+     * @return The number of objects destroyed.
+     */
+    std::size_t reclaim();
+
+    /**
+     * @brief Get the number of retired objects not destroyed yet.
+     * @return The number of pending objects.
+     */
+    std::size_t pendingCount() const;
+
+private:
+    EpochManager(const EpochManager &);
+    EpochManager &operator=(const EpochManager &);
+
+    std::size_t pin();
+    void unpin(std::size_t slot);
+
+    std::atomic<uint64_t> globalEpoch_;
+    std::atomic<uint64_t> slots_[kMaxReaders];
+    mutable std::mutex retiredMutex_;
+    std::vector<std::pair<uint64_t, std::function<void()> > > retired_;
+};
+
+#endif // EPOCH_MANAGER_H
@@ -0,0 +1,478 @@
+//!
+//! @file flat_format.hpp
+//! @brief Definition of the flat, offset-based binary record format
+//!
+
+#ifndef FLAT_FORMAT_H
+#define FLAT_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "library_system/isbn.hpp"
+#include "library_system/library_system.hpp"
+
+/**
+ * @brief Schema version written by FlatWriter.
+ *
+ * Fields are only ever appended to a schema, so readers of any version can
+ * read buffers of any other: unknown fields are skipped and missing ones
+ * read as their default.
+ */
+const uint16_t kFlatSchemaVersion = 1;
+
+/**
+ * @brief Enum representing the record type stored in a flat buffer.
+ */
+enum FlatRecordKind
+{
+    FLAT_BOOK = 1,       ///< Catalog book records, see BookField.
+    FLAT_REQUIREMENT = 2, ///< Requirement records, see RequirementField.
+    FLAT_MUTATION = 3     ///< Catalog mutation records, see MutationField.
+};
+
+/**
+ * @brief Fields of a book record, in schema order.
+ */
+enum BookField
+{
+    BOOK_TITLE,  ///< String.
+    BOOK_AUTHOR, ///< String.
+    BOOK_ISBN,   ///< Unsigned 64-bit ISBN key.
+    BOOK_LOANS,  ///< 32-bit loan count.
+    BOOK_FIELD_COUNT
+};
+
+/**
+ * @brief Fields of a requirement record, in schema order.
+ */
+enum RequirementField
+{
+    REQUIREMENT_ID,           ///< 32-bit integer.
+    REQUIREMENT_TITLE,        ///< String.
+    REQUIREMENT_DESCRIPTION,  ///< String.
+    REQUIREMENT_PRIORITY,     ///< 32-bit integer.
+    REQUIREMENT_STATUS,       ///< 32-bit RequirementStatus.
+    REQUIREMENT_TEST_CASES,   ///< 32-bit integer.
+    REQUIREMENT_OWNER,        ///< String.
+    REQUIREMENT_CREATED_DATE, ///< String, "YYYY-MM-DD".
+    REQUIREMENT_FIELD_COUNT
+};
+
+/**
+ * @brief Fields of a mutation record, in schema order.
+ */
+enum MutationField
+{
+    MUTATION_SEQUENCE, ///< Unsigned 64-bit position in the mutation log.
+    MUTATION_TYPE,     ///< 32-bit MutationType.
+    MUTATION_ISBN,     ///< Unsigned 64-bit ISBN key.
+    MUTATION_VALUE,    ///< 32-bit loan count or user ID.
+    MUTATION_TITLE,    ///< String.
+    MUTATION_AUTHOR,   ///< String.
+    MUTATION_FIELD_COUNT
+};
+
+/**
+ * @brief Non-owning view of a string inside a flat buffer.
+ */
+struct FlatString
+{
+    const char *data; ///< First character, not null-terminated.
+    uint32_t size;    ///< Number of characters.
+
+    /**
+     * @brief Copy the viewed characters into a string.
+     * @return The string.
+     */
+    std::string str() const;
+};
+
+/**
+ * @brief Builder of a flat buffer of records of one kind.
+ *
+ * A buffer is a 16-byte header ("LSFB", schema version, record kind, record
+ * count), a table of record offsets and the records. Each record starts
+ * with its field count and a table of field offsets relative to the record
+ * (0 for absent fields), followed by 4-byte aligned field payloads: scalars
+ * in host (little-endian) byte order, strings as a 32-bit length and the
+ * characters.
+ *
+ * Records are normally kept in memory until finish(buffer). After
+ * streamTo() they are written to a file as they are added instead, so only
+ * the offset table and kStreamFlushBytes of records stay in memory.
+ */
+class FlatWriter
+{
+public:
+    /**
+     * @brief Number of buffered record bytes that triggers a write while streaming.
+     */
+    static const std::size_t kStreamFlushBytes = 64 * 1024;
+
+    /**
+     * @brief Constructor to start an empty buffer.
+     * @param kind The kind of the records to write.
+     * @param schemaVersion The schema version to stamp into the header.
+     */
+    explicit FlatWriter(FlatRecordKind kind, uint16_t schemaVersion = kFlatSchemaVersion);
+
+    /**
+     * @brief Start a record; all fields are absent until set.
+     *
+     * Fields at or past fieldCount are silently dropped.
+     * @param fieldCount The number of fields in the writer's schema.
+     */
+    void beginRecord(uint16_t fieldCount);
+
+    /**
+     * @brief Set a 32-bit integer field of the current record.
+     * @param field The field index.
+     * @param value The value.
+     */
+    void setInt32(uint16_t field, int32_t value);
+
+    /**
+     * @brief Set an unsigned 64-bit integer field of the current record.
+     * @param field The field index.
+     * @param value The value.
+     */
+    void setUint64(uint16_t field, uint64_t value);
+
+    /**
+     * @brief Set a string field of the current record.
+     * @param field The field index.
+     * @param text The value.
+     */
+    void setString(uint16_t field, const std::string &text);
+
+    /**
+     * @brief Finish the current record.
+     */
+    void endRecord();
+
+    /**
+     * @brief Append a book record.
+     * @param title The title of the book.
+     * @param author The author of the book.
+     * @param isbn The ISBN key of the book.
+     * @param loans The number of times the book was borrowed.
+     */
+    void addBook(const std::string &title, const std::string &author, IsbnKey isbn, uint32_t loans);
+
+    /**
+     * @brief Append a requirement record.
+     * @param requirement The requirement.
+     */
+    void addRequirement(const Requirement &requirement);
+
+    /**
+     * @brief Append a mutation record.
+     * @param sequence The position of the mutation in its log.
+     * @param record The mutation.
+     */
+    void addMutation(uint64_t sequence, const MutationRecord &record);
+
+    /**
+     * @brief Get the number of finished records.
+     * @return The number of records.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Assemble the buffer.
+     * @param buffer Receives the header, offset table and records.
+     */
+    void finish(std::vector<char> &buffer) const;
+
+    /**
+     * @brief Stream records to a file as they are added.
+     *
+     * Space for the header and the offset table is reserved at the current
+     * position, which must be the start of the file; finish(file) fills it in.
+     * Must be called before the first record.
+     *
+     * @param file The file, open for writing and seeking.
+     * @param count The exact number of records that will be added.
+     * @return False if the file could not be written.
+     */
+    bool streamTo(std::FILE *file, std::size_t count);
+
+    /**
+     * @brief Write the remaining records, the header and the offset table.
+     * @param file The file passed to streamTo().
+     * @return False if the file could not be written or the record count differs.
+     */
+    bool finish(std::FILE *file);
+
+private:
+    void align();
+    bool setField(uint16_t field);
+    bool flush();
+    std::size_t recordsStart(std::size_t count) const;
+
+    FlatRecordKind kind_;
+    uint16_t schemaVersion_;
+    std::vector<char> records_;
+    std::vector<uint32_t> recordOffsets_;
+    std::size_t recordStart_;
+    uint16_t fieldCount_;
+    std::FILE *file_;           ///< Streaming target, 0 when building in memory.
+    std::size_t streamCount_;   ///< Records announced to streamTo().
+    std::size_t flushedBytes_;  ///< Record bytes already written to file_.
+    bool streamFailed_;
+};
+
+/**
+ * @brief Accessor for the fields of one record, reading straight from the buffer.
+ */
+class FlatRecord
+{
+public:
+    /**
+     * @brief Constructor to view a validated record.
+     * @param record The first byte of the record.
+     */
+    explicit FlatRecord(const char *record);
+
+    /**
+     * @brief Check whether a field is present.
+     * @param field The field index.
+     * @return True if the record has a value for the field.
+     */
+    bool has(uint16_t field) const;
+
+    /**
+     * @brief Read a 32-bit integer field.
+     * @param field The field index.
+     * @param fallback The value returned if the field is absent.
+     * @return The value.
+     */
+    int32_t int32(uint16_t field, int32_t fallback = 0) const;
+
+    /**
+     * @brief Read an unsigned 64-bit integer field.
+     * @param field The field index.
+     * @param fallback The value returned if the field is absent.
+     * @return The value.
+     */
+    uint64_t uint64(uint16_t field, uint64_t fallback = 0) const;
+
+    /**
+     * @brief Read a string field.
+     * @param field The field index.
+     * @return The string, empty if the field is absent.
+     */
+    FlatString string(uint16_t field) const;
+
+private:
+    uint32_t fieldOffset(uint16_t field) const;
+
+    const char *record_;
+};
+
+/**
+ * @brief Zero-copy view of a book record.
+ */
+class BookView : public FlatRecord
+{
+public:
+    /**
+     * @brief Constructor to view a validated book record.
+     * @param record The first byte of the record.
+     */
+    explicit BookView(const char *record);
+
+    /**
+     * @brief Get the title field.
+     * @return The title of the book.
+     */
+    FlatString title() const;
+
+    /**
+     * @brief Get the author field.
+     * @return The author of the book.
+     */
+    FlatString author() const;
+
+    /**
+     * @brief Get the ISBN field.
+     * @return The ISBN key, kInvalidIsbn if absent.
+     */
+    IsbnKey isbn() const;
+
+    /**
+     * @brief Get the loans field.
+     * @return The number of times the book was borrowed.
+     */
+    uint32_t loans() const;
+};
+
+/**
+ * @brief Zero-copy view of a requirement record.
+ */
+class RequirementView : public FlatRecord
+{
+public:
+    /**
+     * @brief Constructor to view a validated requirement record.
+     * @param record The first byte of the record.
+     */
+    explicit RequirementView(const char *record);
+
+    /**
+     * @brief Get the ID field.
+     * @return The ID of the requirement.
+     */
+    int id() const;
+
+    /**
+     * @brief Get the title field.
+     * @return The title of the requirement.
+     */
+    FlatString title() const;
+
+    /**
+     * @brief Get the description field.
+     * @return The description of the requirement.
+     */
+    FlatString description() const;
+
+    /**
+     * @brief Get the priority field.
+     * @return The priority of the requirement.
+     */
+    int priority() const;
+
+    /**
+     * @brief Get the status field.
+     * @return The status, OPEN if absent.
+     */
+    RequirementStatus status() const;
+
+    /**
+     * @brief Get the test cases field.
+     * @return The number of test cases.
+     */
+    int testCases() const;
+
+    /**
+     * @brief Get the owner field.
+     * @return The owner or team.
+     */
+    FlatString owner() const;
+
+    /**
+     * @brief Get the created date field.
+     * @return The creation date, "YYYY-MM-DD".
+     */
+    FlatString createdDate() const;
+
+    /**
+     * @brief Materialize the record.
+     * @return The requirement.
+     */
+    Requirement toRequirement() const;
+};
+
+/**
+ * @brief Zero-copy view of a mutation record.
+ */
+class MutationView : public FlatRecord
+{
+public:
+    /**
+     * @brief Constructor to view a validated mutation record.
+     * @param record The first byte of the record.
+     */
+    explicit MutationView(const char *record);
+
+    /**
+     * @brief Get the sequence field.
+     * @return The position of the mutation in its log.
+     */
+    uint64_t sequence() const;
+
+    /**
+     * @brief Materialize the record.
+     * @param record Receives the mutation.
+     * @return False if the record holds an unknown mutation type or an invalid ISBN.
+     */
+    bool toMutation(MutationRecord &record) const;
+};
+
+/**
+ * @brief Validating reader of a flat buffer, e.g. a mapped file.
+ *
+ * The constructor checks that every offset and length stays inside the
+ * buffer; afterwards views read fields in place without copying.
+ */
+class FlatReader
+{
+public:
+    /**
+     * @brief Constructor to validate a buffer.
+     * @param data The buffer, which must outlive the reader and its views.
+     * @param size The size of the buffer in bytes.
+     */
+    FlatReader(const char *data, std::size_t size);
+
+    /**
+     * @brief Check whether the buffer passed validation.
+     * @return True if the buffer is well-formed.
+     */
+    bool valid() const;
+
+    /**
+     * @brief Get the kind of the records.
+     * @return The record kind; meaningful only for valid buffers.
+     */
+    FlatRecordKind kind() const;
+
+    /**
+     * @brief Get the schema version the buffer was written with.
+     * @return The schema version; meaningful only for valid buffers.
+     */
+    uint16_t schemaVersion() const;
+
+    /**
+     * @brief Get the number of records.
+     * @return The number of records, 0 for invalid buffers.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief View a book record.
+     * @param index The record index; the buffer must hold books.
+     * @return The view.
+     */
+    BookView book(std::size_t index) const;
+
+    /**
+     * @brief View a requirement record.
+     * @param index The record index; the buffer must hold requirements.
+     * @return The view.
+     */
+    RequirementView requirement(std::size_t index) const;
+
+    /**
+     * @brief View a mutation record.
+     * @param index The record index; the buffer must hold mutations.
+     * @return The view.
+     */
+    MutationView mutation(std::size_t index) const;
+
+private:
+    bool validate() const;
+    bool validateRecord(uint32_t begin, uint32_t end) const;
+    const char *record(std::size_t index) const;
+
+    const char *data_;
+    std::size_t size_;
+    bool valid_;
+};
+
+#endif // FLAT_FORMAT_H
@@ -0,0 +1,64 @@
+//!
+//! @file isbn.hpp
+//! @brief Parsing of ISBN-10/ISBN-13 strings into compact integer keys
+//!
+
+#ifndef ISBN_H
+#define ISBN_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Compact ISBN key: the ISBN-13 number stored as an integer.
+ *
+ * ISBN-10 values are converted to their ISBN-13 (978 prefixed) form, so both
+ * spellings of the same book map to the same key.
+ */
+typedef uint64_t IsbnKey;
+
+/**
+ * @brief Key returned for strings that are not a valid ISBN.
+ */
+const IsbnKey kInvalidIsbn = 0;
+
+/**
+ * @brief Parse and validate an ISBN-10 or ISBN-13 string.
+ *
+ * Hyphens and spaces are accepted as separators. The digits are validated and
+ * the checksum is verified with an SSE2 kernel when available, falling back
+ * to a scalar loop otherwise.
+ *
+ * @param isbn The ISBN as entered, e.g. "978-0743273565" or "0-7432-7356-7".
+ * @return The ISBN key, or kInvalidIsbn if the string is not a valid ISBN.
+ */
+IsbnKey parseIsbn(const std::string &isbn);
+
+/**
+ * @brief Format an ISBN key as a 13 digit string without separators.
+ * @param key The ISBN key.
+ * @return The ISBN-13 digits, or an empty string for kInvalidIsbn.
+ */
+std::string formatIsbn(IsbnKey key);
+
+/**
+ * @brief Scramble an ISBN key for hashing.
+ *
+ * ISBN keys of one publisher differ mostly in their low digits, so tables
+ * and filters indexed by key bits mix it first, with the MurmurHash3
+ * finalizer.
+ *
+ * @param key The ISBN key.
+ * @return The mixed key; every bit depends on every key bit.
+ */
+inline uint64_t mixIsbnKey(IsbnKey key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+#endif // ISBN_H
@@ -0,0 +1,118 @@
+//!
+//! @file isbn_hash_index.hpp
+//! @brief Definition of the IsbnHashIndex insert-only, lock-free readable hash table
+//!
+
+#ifndef ISBN_HASH_INDEX_H
+#define ISBN_HASH_INDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "library_system/isbn.hpp"
+#include "library_system/memory_tracker.hpp"
+
+/**
+ * @brief Open-addressing hash table from ISBN keys to catalog positions.
+ *
+ * Keys are never removed and a table never moves its slots, so lookups
+ * need no lock: find() may run concurrently with insert() and
+ * setPosition(). A key becomes visible with the position stored before
+ * it; setPosition() may later replace that position, e.g. a placeholder
+ * that lookups must skip. Writers must be serialized by the caller, except
+ * that setPosition() calls for different keys may run concurrently.
+ *
+ * A table holds at most capacity() keys, at a load factor of at most one
+ * half; a full table is replaced by a larger copy from grown().
+ */
+class IsbnHashIndex
+{
+public:
+    /**
+     * @brief Constructor to create an empty table.
+     * @param capacity The number of keys the table must hold.
+     * @param tracker Receives the size of the slots; may be null. Must outlive the table.
+     */
+    explicit IsbnHashIndex(std::size_t capacity, MemoryTracker *tracker = 0);
+
+    /**
+     * @brief Destructor releasing the slots.
+     */
+    ~IsbnHashIndex();
+
+    /**
+     * @brief Look a key up.
+     * @param key The ISBN key.
+     * @param position Receives the position of the key if found.
+     * @return True if the key is in the table.
+     */
+    bool find(IsbnKey key, std::size_t &position) const;
+
+    /**
+     * @brief Insert a key that is not in the table yet.
+     * @param key The ISBN key, not kInvalidIsbn.
+     * @param position The position of the key.
+     * @return False if the key was already present or the table is full.
+     */
+    bool insert(IsbnKey key, std::size_t position);
+
+    /**
+     * @brief Replace the position of a key in the table.
+     * @param key The ISBN key.
+     * @param position The new position.
+     */
+    void setPosition(IsbnKey key, std::size_t position);
+
+    /**
+     * @brief Copy the table into a larger one.
+     * @param capacity The number of keys the copy must hold, at least size().
+     * @return The copy, reporting to the same tracker.
+     */
+    std::shared_ptr<IsbnHashIndex> grown(std::size_t capacity) const;
+
+    /**
+     * @brief Collect the keys of the table.
+     * @param keys Receives the keys, in no particular order.
+     */
+    void keys(std::vector<IsbnKey> &keys) const;
+
+    /**
+     * @brief Get the number of keys in the table.
+     * @return The number of keys.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Get the number of keys the table can hold.
+     * @return The capacity.
+     */
+    std::size_t capacity() const;
+
+    /**
+     * @brief Get the heap memory used by the table.
+     * @return The size in bytes.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    IsbnHashIndex(const IsbnHashIndex &);
+    IsbnHashIndex &operator=(const IsbnHashIndex &);
+
+    struct Slot
+    {
+        std::atomic<IsbnKey> key;          ///< kInvalidIsbn while the slot is free.
+        std::atomic<std::size_t> position; ///< Stored before the key is published.
+    };
+
+    std::size_t slotOf(IsbnKey key) const;
+
+    std::size_t mask_;
+    std::size_t size_;
+    MemoryTracker *tracker_;
+    std::unique_ptr<Slot[]> slots_;
+};
+
+#endif // ISBN_HASH_INDEX_H
@@ -6,9 +6,30 @@
 #ifndef LIBRARY_SYSTEM_H
 #define LIBRARY_SYSTEM_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "library_system/blocked_bloom_filter.hpp"
+#include "library_system/boolean_query.hpp"
+#include "library_system/epoch_day.hpp"
+#include "library_system/epoch_manager.hpp"
+#include "library_system/isbn.hpp"
+#include "library_system/isbn_hash_index.hpp"
+#include "library_system/memory_tracker.hpp"
+#include "library_system/query_cache.hpp"
+#include "library_system/search_segment.hpp"
+#include "library_system/string_pool.hpp"
+#include "library_system/suggest_trie.hpp"
+
 /**
  * @brief Enum representing the status of a requirement.
  */
@@ -34,7 +55,7 @@ public:
      * @param status The status of the requirement.
      * @param testCases The number of test cases for the requirement.
      * @param owner The owner or team responsible for the requirement.
-     * @param createdDate The date when the requirement was created.
+     * @param createdDate The date when the requirement was created, as "YYYY-MM-DD".
      */
     Requirement(int id, const std::string &title, const std::string &description,
                 int priority, RequirementStatus status, int testCases,
@@ -82,12 +103,24 @@ public:
      */
     std::string getOwner() const;
 
+    /**
+     * @brief Get the interned owner, equal for requirements with equal owners.
+     * @return The id of the owner in StringPool::global().
+     */
+    StringPool::Id getOwnerId() const;
+
     /**
      * @brief Get the date when the requirement was created.
      * @return The date when the requirement was created.
      */
     std::string getCreatedDate() const;
 
+    /**
+     * @brief Get the creation date as a day number, parsed once on construction.
+     * @return The days since 1970-01-01, or kInvalidEpochDay if the date is not "YYYY-MM-DD".
+     */
+    int getCreatedDay() const;
+
 private:
     int id_;
     std::string title_;
@@ -95,20 +128,133 @@ private:
     int priority_;
     RequirementStatus status_;
     int testCases_;
-    std::string owner_;
+    StringPool::Id ownerId_;
     std::string createdDate_;
+    int createdDay_;
+};
+
+/**
+ * @brief Enum representing the kind of a catalog mutation.
+ */
+enum MutationType
+{
+    MUTATION_ADD_BOOK = 1, ///< A book was added; value holds its loan count.
+    MUTATION_BORROW = 2,   ///< A book was borrowed; value holds the user ID.
+    MUTATION_RETURN = 3    ///< A book was returned; value holds the user ID.
+};
+
+/**
+ * @brief A committed change to a LibrarySystem catalog, e.g. for replication.
+ */
+struct MutationRecord
+{
+    MutationType type;  ///< The kind of the mutation.
+    IsbnKey isbn;       ///< The ISBN key of the book.
+    int32_t value;      ///< Loan count or user ID, see MutationType.
+    std::string title;  ///< The title of an added book, empty otherwise.
+    std::string author; ///< The author of an added book, empty otherwise.
 };
 
 /**
  * @brief Class representing a library system.
+ *
+ * Reads (searchBooks, suggest) run against an immutable catalog version and
+ * never take the writer lock. Writers (addBook, borrowBook) serialize among
+ * themselves, publish a new version that shares all unchanged pages and
+ * chunks with the previous one, and retire the old version through an
+ * EpochManager. A write copies at most one page of chunk pointers, one loan
+ * chunk and the page directory, so its cost does not grow with the chunks.
+ *
+ * The search index is log-structured: the newest books form an unsealed
+ * tail that is scanned directly, full tails are sealed into immutable
+ * SearchSegment objects and a background thread merges segments of similar
+ * size, so both adding and searching stay cheap as the catalog grows. An
+ * owner that wants no extra thread runs this maintenance itself through
+ * runMaintenance().
+ *
+ * Under a memory budget the same thread also sheds memory when the budget
+ * is exceeded: it trims the query cache, drops the suggestion trie until
+ * the next suggest() and finally spills the least recently searched
+ * segments to mapped files.
+ *
+ * Suggestions are kept current without rebuilding on every write: a borrow
+ * raises the popularity of the book's title and author in the trie, books
+ * added since the trie was built are scanned from a short tail, and the
+ * background thread rebuilds the trie once the tail fills up while the
+ * previous trie keeps serving.
  */
 class LibrarySystem
 {
 public:
+    /**
+     * @brief Callback receiving every committed mutation, in commit order.
+     *
+     * Listeners run while the catalog's write lock is held: they must be
+     * cheap and must not call back into the LibrarySystem.
+     */
+    typedef std::function<void(const MutationRecord &record)> MutationListener;
+
+    /**
+     * @brief A ranked search result.
+     */
+    struct SearchHit
+    {
+        std::string title; ///< The title of the book.
+        unsigned loans;    ///< The number of times the book was borrowed.
+    };
+
+    /**
+     * @brief Order search hits by rank: most borrowed first, then by title.
+     * @param a The first hit.
+     * @param b The second hit.
+     * @return True if a ranks before b.
+     */
+    static bool ranksBefore(const SearchHit &a, const SearchHit &b);
+
+    /**
+     * @brief Memory used by the structures of a catalog, in bytes.
+     */
+    struct MemoryUsage
+    {
+        std::size_t catalog;        ///< Book records and loan counts.
+        std::size_t isbnIndex;      ///< The ISBN to catalog position index.
+        std::size_t isbnFilters;    ///< The Bloom filters in front of the ISBN index.
+        std::size_t postings;       ///< Search index segments on the heap.
+        std::size_t mappedPostings; ///< Spilled search index segments, mapped from files.
+        std::size_t suggestTrie;    ///< The suggestion trie.
+        std::size_t queryCache;     ///< The search result cache.
+
+        /**
+         * @brief Get the heap memory counted against the budget.
+         * @return The sum of all structures except the mapped postings.
+         */
+        std::size_t total() const;
+    };
+
+    /**
+     * @brief Counters of the Bloom filters guarding ISBN lookups.
+     */
+    struct IsbnFilterStats
+    {
+        uint64_t lookups;        ///< Valid ISBNs checked by borrowBook(), returnBook() and findBook().
+        uint64_t rejected;       ///< Lookups answered by a filter without probing the index.
+        uint64_t falsePositives; ///< Lookups that passed a filter but missed the index.
+        double targetRate;       ///< The configured false positive rate.
+
+        /**
+         * @brief Get the observed false positive rate.
+         * @return The share of lookups for absent ISBNs that passed a filter, 0 before any.
+         */
+        double falsePositiveRate() const;
+    };
+
     /**
      * @brief Constructor to initialize the library system.
+     * @param backgroundMaintenance Whether a background thread merges segments, enforces the
+     *        memory budget and rebuilds the suggestion trie; otherwise the owner calls
+     *        runMaintenance().
      */
-    LibrarySystem();
+    explicit LibrarySystem(bool backgroundMaintenance = true);
 
     /**
      * @brief Destructor to clean up resources.
@@ -119,16 +265,22 @@ public:
      * @brief Add a new book to the library catalog.
      * @param title The title of the book.
      * @param author The author of the book.
-     * @param isbn The ISBN of the book.
-     * @return True if the book was successfully added, false otherwise.
+     * @param isbn The ISBN-10 or ISBN-13 of the book, with or without separators.
+     * @return True if the book was successfully added, false if the ISBN is
+     *         invalid or already in the catalog.
      */
     bool addBook(const std::string &title, const std::string &author, const std::string &isbn);
 
     /**
      * @brief Borrow a book from the library.
+     *
+     * ISBNs the catalog does not hold are mostly rejected by a Bloom filter
+     * before the write lock is taken or the ISBN index probed.
+     *
      * @param isbn The ISBN of the book to borrow.
      * @param userId The ID of the user borrowing the book.
-     * @return True if the book was successfully borrowed, false otherwise.
+     * @return True if the book was successfully borrowed, false if the ISBN
+     *         is invalid or not in the catalog.
      */
     bool borrowBook(const std::string &isbn, int userId);
 
@@ -136,19 +288,387 @@ public:
      * @brief Return a borrowed book to the library.
      * @param isbn The ISBN of the book to return.
      * @param userId The ID of the user returning the book.
-     * @return True if the book was successfully returned, false otherwise.
+     * @return True if the book was successfully returned, false if the ISBN
+     *         is invalid or not in the catalog.
      */
     bool returnBook(const std::string &isbn, int userId);
 
+    /**
+     * @brief Look a book up by ISBN.
+     *
+     * Like searches, lookups read the current catalog version and never take the writer lock.
+     *
+     * @param isbn The ISBN-10 or ISBN-13 of the book, with or without separators.
+     * @param book Receives the title and loan count of the book.
+     * @return True if the book is in the catalog, false if the ISBN is invalid or unknown.
+     */
+    bool findBook(const std::string &isbn, SearchHit &book);
+
     /**
      * @brief Search for books in the library catalog.
+     *
+     * The keyword is split into normalized terms; a book matches when every
+     * term appears in its title or author.
+     *
      * @param keyword The keyword to search for in book titles and authors.
      * @return A vector of book titles matching the search keyword.
      */
     std::vector<std::string> searchBooks(const std::string &keyword);
 
+    /**
+     * @brief Search for books matching a boolean query.
+     * @param query The parsed query, e.g. BooleanQuery("author:fitzgerald AND (gatsby OR paradise) NOT tender").
+     * @return The titles of the matching books in catalog order; empty if the query is invalid.
+     */
+    std::vector<std::string> searchBooks(const BooleanQuery &query);
+
+    /**
+     * @brief Search for the most borrowed books matching a keyword.
+     * @param keyword The keyword to search for in book titles and authors.
+     * @param k The maximum number of results.
+     * @return Up to k matching books, ordered by ranksBefore().
+     */
+    std::vector<SearchHit> searchTopBooks(const std::string &keyword, std::size_t k);
+
+    /**
+     * @brief Put a result cache in front of searchBooks.
+     *
+     * Adding a book only drops the cached queries sharing a term with it.
+     * Calling this again replaces the cache and resets its counters.
+     *
+     * @param capacity The maximum number of cached queries, 0 disables the cache.
+     */
+    void enableQueryCache(std::size_t capacity);
+
+    /**
+     * @brief Get the hit/miss counters of the search result cache.
+     * @return The cache counters, all zero when the cache is disabled.
+     */
+    QueryCache::Stats queryCacheStats() const;
+
+    /**
+     * @brief Get the number of sealed search index segments.
+     * @return The number of segments a search currently fans out to.
+     */
+    std::size_t indexSegmentCount();
+
+    /**
+     * @brief Suggest book titles and authors completing a typed prefix.
+     *
+     * Titles and authors are matched case-insensitively on their normalized
+     * form and ranked by how often the corresponding books were borrowed.
+     * The first call builds the suggestion trie; later ones see borrows at
+     * once and added books once they fit in the tail or the trie is rebuilt.
+     *
+     * @param prefix The text typed so far.
+     * @param k The maximum number of suggestions (at most SuggestTrie::kMaxSuggestions).
+     * @return Titles and authors starting with the prefix, most popular first.
+     */
+    std::vector<std::string> suggest(const std::string &prefix, std::size_t k);
+
+    /**
+     * @brief Serialize the catalog into a flat buffer of book records (see FlatWriter).
+     * @param buffer Receives the serialized catalog, including loan counts.
+     */
+    void exportCatalog(std::vector<char> &buffer);
+
+    /**
+     * @brief Add the books of a flat buffer of book records to the catalog.
+     *
+     * The import is a parallel bulk load published as one new version.
+     * Records are split into contiguous slices that worker threads parse
+     * and tokenize. ISBNs are radix-partitioned by hash over the partitions
+     * of the ISBN index, so every partition is deduplicated and filled by
+     * one thread without locking. Term occurrences are radix-partitioned by
+     * term hash the same way, and the partitions are sorted concurrently
+     * into a single new search segment.
+     *
+     * @param data The buffer, e.g. a mapped file written by exportCatalog().
+     * @param size The size of the buffer in bytes.
+     * @param threads The number of worker threads, 0 for one per core; small buffers use fewer.
+     * @return The number of books added; 0 if the buffer is invalid or holds no books.
+     *         Books whose ISBN is already in the catalog, or earlier in the buffer, are skipped.
+     */
+    std::size_t importCatalog(const char *data, std::size_t size, std::size_t threads = 0);
+
+    /**
+     * @brief Write a consistent snapshot of the catalog to a file in the background.
+     *
+     * The view is taken before this returns; mutations made afterwards are
+     * not part of the snapshot and never wait for it. The file has the
+     * exportCatalog() format and is written under a temporary name, synced
+     * to disk, then renamed and its directory synced, so readers never see
+     * a partial snapshot and a completed one survives a crash.
+     *
+     * While the snapshot is written it keeps the catalog chunks of its view
+     * alive: borrows copy a loan chunk on write as always, so the extra
+     * memory is bounded by one copy of the loan counts plus the writer's
+     * buffer.
+     *
+     * @param path The path of the snapshot file.
+     * @return A future yielding true once the file is complete and durable; its
+     *         destructor waits for the snapshot to finish.
+     */
+    std::future<bool> snapshot(const std::string &path);
+
+    /**
+     * @brief Register a listener for committed mutations.
+     *
+     * The listener first receives one MUTATION_ADD_BOOK record per book
+     * already in the catalog, carrying its loan count, so that replaying
+     * everything it receives rebuilds the catalog.
+     *
+     * @param listener The listener.
+     * @return A handle for removeMutationListener().
+     */
+    std::size_t addMutationListener(const MutationListener &listener);
+
+    /**
+     * @brief Unregister a mutation listener; it is not called after this returns.
+     * @param handle The handle returned by addMutationListener().
+     */
+    void removeMutationListener(std::size_t handle);
+
+    /**
+     * @brief Replay a mutation received from another catalog.
+     * @param record The mutation.
+     * @return True if the mutation changed the catalog.
+     */
+    bool applyMutation(const MutationRecord &record);
+
+    /**
+     * @brief Get the memory used by each structure of the catalog.
+     *
+     * The ISBN index and the search segments are counted by tracking
+     * allocators; the other structures report their computed sizes.
+     *
+     * @return The memory breakdown.
+     */
+    MemoryUsage memoryUsage();
+
+    /**
+     * @brief Bound the heap memory of the catalog's derived structures.
+     *
+     * The budget is enforced in the background after segments are sealed or
+     * merged. When MemoryUsage::total() exceeds it, the query cache evicts
+     * its least recently used entries, then the suggestion trie is dropped,
+     * then the least recently searched segments are written to spill files
+     * in the directory and mapped back read-only. The files are unlinked
+     * once mapped, so nothing is left behind. Book records and the ISBN
+     * index are never evicted.
+     *
+     * @param bytes The budget in bytes, 0 to disable it.
+     * @param spillDirectory An existing directory for spill files.
+     */
+    void setMemoryBudget(std::size_t bytes, const std::string &spillDirectory);
+
+    /**
+     * @brief Run one unit of pending maintenance on the calling thread.
+     *
+     * Only for a LibrarySystem constructed without background maintenance,
+     * whose owner calls this from a single thread, e.g. whenever it is idle.
+     * A unit is one segment merge, one memory budget check or one rebuild of
+     * the suggestion trie.
+     *
+     * @return True if a unit was run, false if nothing is pending or a background thread maintains the catalog.
+     */
+    bool runMaintenance();
+
+    /**
+     * @brief Wait until no maintenance is pending, e.g. until all due segment merges are done.
+     *
+     * Without background maintenance the pending units run on the calling
+     * thread, which must then be the owner calling runMaintenance().
+     */
+    void waitForMaintenance();
+
+    /**
+     * @brief Get the counters of the ISBN Bloom filters.
+     * @return The counters since construction or the last change of the rate.
+     */
+    IsbnFilterStats isbnFilterStats();
+
+    /**
+     * @brief Set the false positive rate of the ISBN Bloom filters.
+     *
+     * Lower rates send fewer lookups for unknown ISBNs to the index at the
+     * cost of larger filters. The filters are rebuilt from the index and
+     * the counters of isbnFilterStats() are reset.
+     *
+     * @param rate The target rate, e.g. 0.01; clamped to (0, 0.5].
+     */
+    void setIsbnFilterFalsePositiveRate(double rate);
+
 private:
-    // Private data members and methods can be added as needed.
+    LibrarySystem(const LibrarySystem &);
+    LibrarySystem &operator=(const LibrarySystem &);
+
+    /**
+     * @brief Immutable catalog record of a single book.
+     */
+    struct Book
+    {
+        std::string title;              ///< The title of the book.
+        StringPool::Id author;          ///< The interned author of the book.
+        IsbnKey isbn;                   ///< The ISBN key of the book.
+        std::vector<std::string> terms; ///< Sorted normalized title and author terms, plus their field terms.
+    };
+
+    /**
+     * @brief Number of books per catalog chunk.
+     */
+    static const std::size_t kChunkSize = 64;
+
+    /**
+     * @brief Number of chunks per catalog page.
+     */
+    static const std::size_t kPageSize = 64;
+
+    /**
+     * @brief Number of unsealed books that triggers sealing a new segment.
+     */
+    static const std::size_t kSealThreshold = 256;
+
+    /**
+     * @brief Number of segments of one size tier merged together.
+     */
+    static const std::size_t kMergeFactor = 4;
+
+    /**
+     * @brief Number of independently filled partitions of the ISBN index.
+     */
+    static const std::size_t kIsbnPartitions = 64;
+
+    /**
+     * @brief Minimum number of records per importCatalog() worker thread.
+     */
+    static const std::size_t kImportSliceSize = 4096;
+
+    /**
+     * @brief Number of keys a new ISBN filter is sized for; filters double as their partition grows.
+     */
+    static const std::size_t kIsbnFilterCapacity = 64;
+
+    /**
+     * @brief Maximum number of books added since the last suggestion trie build that suggest() scans.
+     *
+     * A rebuild is requested once the tail is half full, so it keeps taking books while the rebuild runs.
+     */
+    static const std::size_t kSuggestTailSize = 256;
+
+    /**
+     * @brief Default false positive rate of the ISBN filters.
+     */
+    static const double kDefaultIsbnFilterRate;
+
+    typedef std::vector<std::shared_ptr<const SearchSegment> > SegmentList;
+    typedef std::vector<std::shared_ptr<IsbnHashIndex> > IsbnIndexList;
+    typedef std::vector<std::shared_ptr<BlockedBloomFilter> > IsbnFilterList;
+    typedef std::vector<Book> BookChunk;
+    typedef std::vector<unsigned> LoanChunk;
+    typedef std::vector<std::shared_ptr<BookChunk> > BookPage;
+    typedef std::vector<std::shared_ptr<LoanChunk> > LoanPage;
+    typedef std::vector<std::shared_ptr<BookPage> > BookDirectory;
+    typedef std::vector<std::shared_ptr<LoanPage> > LoanDirectory;
+
+    /**
+     * @brief Consistent view of the catalog published to readers.
+     *
+     * Chunks are reached through a two-level directory of pages holding
+     * kPageSize chunk pointers each. Book chunks and pages are append-only:
+     * a writer may append past bookCount to a chunk or page shared with
+     * older versions, which never read that far. Loan chunks, and the page
+     * and directory pointing to them, are copied on write, so a version's
+     * loan counts never change. Directories are only copied, never changed.
+     * ISBN filters are shared with older versions too and only gain bits;
+     * a filter is replaced by a larger one when its partition outgrows it.
+     * ISBN index tables likewise only gain keys, at positions past the
+     * bookCount of older versions until a newer version is published, and
+     * are replaced by larger copies when full.
+     */
+    struct CatalogVersion
+    {
+        std::shared_ptr<const BookDirectory> books;        ///< Book records by page and chunk.
+        std::shared_ptr<const LoanDirectory> loans;        ///< Loan counts by page and chunk.
+        std::size_t chunkCount;                            ///< Number of allocated chunks.
+        std::size_t bookCount;                             ///< Number of visible books.
+        uint64_t generation;                               ///< Bumped by every mutation.
+        SegmentList segments;                              ///< Sealed index segments.
+        std::size_t sealedCount;                           ///< Books covered by segments.
+        std::shared_ptr<const IsbnFilterList> isbnFilters; ///< One filter per ISBN index partition.
+        std::shared_ptr<const IsbnIndexList> isbnIndex;    ///< One table per ISBN index partition.
+    };
+
+    struct ImportSlice;
+
+    static Book makeBook(const std::string &title, const std::string &author, IsbnKey key);
+    static std::size_t isbnPartition(IsbnKey key);
+    static bool findIsbn(const CatalogVersion &version, IsbnKey key, std::size_t &position);
+    static const Book &bookAt(const CatalogVersion &version, std::size_t index);
+    static unsigned loansAt(const CatalogVersion &version, std::size_t index);
+    static BookChunk &bookChunk(const CatalogVersion &version, std::size_t chunk);
+    static LoanChunk &loanChunk(const CatalogVersion &version, std::size_t chunk);
+    static void setLoanChunk(CatalogVersion &version, std::size_t chunk, const std::shared_ptr<LoanChunk> &loans);
+    static void addSuggestEntries(const Book &book, unsigned loans, std::vector<SuggestTrie::Entry> &entries);
+
+    static bool pickMerge(const SegmentList &segments, SegmentList &picked);
+    static bool writeSnapshot(const CatalogVersion &view, const std::string &path);
+
+    void matchBooks(const CatalogVersion &version, const std::vector<std::string> &terms,
+                    std::vector<SearchSegment::DocId> &matches) const;
+    void cacheResults(QueryCache &cache, const std::string &key, const std::vector<std::string> &terms,
+                      const std::vector<std::string> &results, uint64_t generation);
+    std::shared_ptr<BlockedBloomFilter> buildIsbnFilter(const IsbnHashIndex &index) const;
+    bool mayHaveIsbn(IsbnKey key);
+    bool insertBook(const std::string &title, const std::string &author, IsbnKey key, unsigned loans);
+    void publish(CatalogVersion *next);
+    void appendChunk(CatalogVersion &next);
+    void notifyListeners(const MutationRecord &record) const;
+    void sealTail(CatalogVersion &next);
+    void mergeSegments();
+    bool maintain(std::unique_lock<std::mutex> &lock);
+    void rebuildSuggestTrie(bool enable);
+    void updateSuggestTail(const CatalogVersion &version);
+    void raiseSuggestion(const Book &book, std::size_t index);
+    void enforceBudget();
+
+    // Declared before epochs_: retired versions still report to them when it is destroyed.
+    MemoryTracker indexTracker_;
+    MemoryTracker postingsTracker_;
+
+    EpochManager epochs_;
+    std::atomic<const CatalogVersion *> current_;
+
+    std::mutex writeMutex_; ///< Serializes writers and guards isbnFilterRate_, listeners_ and the budget.
+    double isbnFilterRate_;
+    std::vector<std::pair<std::size_t, MutationListener> > listeners_;
+    std::size_t nextListener_;
+
+    std::atomic<std::size_t> catalogBytes_;
+    std::atomic<std::size_t> memoryBudget_;
+    std::string spillDirectory_;
+    bool budgetCheck_; ///< Asks the merge thread to enforce the budget.
+    uint64_t spillCount_;
+
+    std::condition_variable mergeCondition_; ///< Signals sealed segments, uses writeMutex_.
+    bool stopMerging_;
+    std::thread mergeThread_; ///< Not started without background maintenance.
+    bool maintenanceIdle_;    ///< The merge thread waits for work, uses writeMutex_.
+    std::condition_variable idleCondition_; ///< Signals maintenanceIdle_, uses writeMutex_.
+
+    std::mutex suggestBuildMutex_; ///< Serializes suggestion trie rebuilds, taken before writeMutex_.
+    std::mutex suggestMutex_;      ///< Guards the suggestion state below, taken after writeMutex_.
+    SuggestTrie suggestTrie_;      ///< Titles and authors of the first suggestBooks_ books.
+    std::size_t suggestBooks_;
+    std::vector<SuggestTrie::Entry> suggestTail_; ///< Title and author of each following book, in order.
+    bool suggestEnabled_;          ///< Set by the first suggest(), cleared when the budget drops the trie.
+    bool suggestRebuild_;          ///< Asks the merge thread to rebuild the trie, uses writeMutex_.
+
+    std::shared_ptr<QueryCache> queryCache_; ///< Accessed with std::atomic_load/store.
+
+    std::atomic<uint64_t> filterLookups_;
+    std::atomic<uint64_t> filterRejections_;
+    std::atomic<uint64_t> filterFalsePositives_;
 };
 
 #endif // LIBRARY_SYSTEM_H
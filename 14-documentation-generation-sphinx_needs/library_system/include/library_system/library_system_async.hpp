@@ -0,0 +1,279 @@
+//!
+//! @file library_system_async.hpp
+//! @brief Definition of the C++20 coroutine front end of LibrarySystem
+//!
+
+#ifndef LIBRARY_SYSTEM_ASYNC_H
+#define LIBRARY_SYSTEM_ASYNC_H
+
+#if __cplusplus < 202002L
+#error "library_system_async.hpp requires C++20 coroutines"
+#endif
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "library_system/library_system.hpp"
+
+/**
+ * @brief Executor applying queued operations in groups and resuming their coroutines.
+ *
+ * Operations submitted while a group is being applied form the next group.
+ * After a group has been applied the commit hook runs once for the whole
+ * group (the durability point, e.g. a WAL flush), and only then are the
+ * waiting coroutines resumed, on the executor thread. Suspended coroutines
+ * hold no thread, so one executor serves thousands of in-flight operations.
+ */
+class CommitExecutor
+{
+public:
+    /**
+     * @brief Hook run once per group, after it was applied and before it is resumed.
+     */
+    typedef std::function<void(std::size_t operations)> CommitHook;
+
+    /**
+     * @brief Constructor to start the executor thread.
+     * @param commit The durability hook; may be empty.
+     */
+    explicit CommitExecutor(CommitHook commit = CommitHook())
+        : commit_(std::move(commit)), stopping_(false), groups_(0), operations_(0)
+    {
+        worker_ = std::thread(&CommitExecutor::run, this);
+    }
+
+    /**
+     * @brief Destructor completing all queued operations, then stopping the thread.
+     */
+    ~CommitExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wakeup_.notify_one();
+        worker_.join();
+    }
+
+    CommitExecutor(const CommitExecutor &) = delete;
+    CommitExecutor &operator=(const CommitExecutor &) = delete;
+
+    /**
+     * @brief Queue an operation; the coroutine is resumed after its group commits.
+     * @param operation The operation to apply.
+     * @param waiter The suspended coroutine.
+     */
+    void submit(std::function<void()> operation, std::coroutine_handle<> waiter)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.push_back(Pending{std::move(operation), waiter});
+        }
+        wakeup_.notify_one();
+    }
+
+    /**
+     * @brief Get the number of groups committed so far.
+     * @return The number of commit hook invocations.
+     */
+    std::uint64_t groupCount() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return groups_;
+    }
+
+    /**
+     * @brief Get the number of operations committed so far.
+     * @return The number of operations.
+     */
+    std::uint64_t operationCount() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return operations_;
+    }
+
+private:
+    struct Pending
+    {
+        std::function<void()> operation;
+        std::coroutine_handle<> waiter;
+    };
+
+    void run()
+    {
+        std::vector<Pending> group;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            wakeup_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+            if (pending_.empty())
+            {
+                return;
+            }
+            group.swap(pending_);
+            lock.unlock();
+
+            for (std::size_t i = 0; i < group.size(); ++i)
+            {
+                group[i].operation();
+            }
+            if (commit_)
+            {
+                commit_(group.size());
+            }
+            // Resumed coroutines may submit again; that lands in the next group.
+            for (std::size_t i = 0; i < group.size(); ++i)
+            {
+                group[i].waiter.resume();
+            }
+
+            lock.lock();
+            ++groups_;
+            operations_ += group.size();
+            group.clear();
+        }
+    }
+
+    CommitHook commit_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::vector<Pending> pending_;
+    bool stopping_;
+    std::uint64_t groups_;
+    std::uint64_t operations_;
+    std::thread worker_;
+};
+
+/**
+ * @brief Awaitable running one operation on a CommitExecutor.
+ * @tparam T The result type of the operation.
+ */
+template <typename T>
+class CommitAwaiter
+{
+public:
+    /**
+     * @brief Constructor to wrap an operation.
+     * @param executor The executor to run on.
+     * @param operation The operation producing the result.
+     */
+    CommitAwaiter(CommitExecutor &executor, std::function<T()> operation)
+        : executor_(executor), operation_(std::move(operation)), result_()
+    {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> waiter)
+    {
+        // The awaiter lives in the suspended coroutine frame until resumed.
+        executor_.submit([this]() { result_ = operation_(); }, waiter);
+    }
+
+    T await_resume() { return std::move(result_); }
+
+private:
+    CommitExecutor &executor_;
+    std::function<T()> operation_;
+    T result_;
+};
+
+/**
+ * @brief Coroutine front end of a LibrarySystem.
+ *
+ * Mutations are applied on the executor and their coroutines resumed after
+ * the group commit, so co_await borrowBookAsync() returns once the loan is
+ * durable. Searches never block and run inline.
+ */
+class AsyncLibrarySystem
+{
+public:
+    /**
+     * @brief Constructor to wrap a library.
+     * @param library The library, which must outlive this object.
+     * @param executor The executor applying mutations, which must outlive this object.
+     */
+    AsyncLibrarySystem(LibrarySystem &library, CommitExecutor &executor)
+        : library_(library), executor_(executor)
+    {
+    }
+
+    /**
+     * @brief Add a book, resuming after the group commit.
+     * @param title The title of the book.
+     * @param author The author of the book.
+     * @param isbn The ISBN of the book.
+     * @return An awaitable yielding the result of LibrarySystem::addBook().
+     */
+    CommitAwaiter<bool> addBookAsync(std::string title, std::string author, std::string isbn)
+    {
+        LibrarySystem &library = library_;
+        return CommitAwaiter<bool>(executor_, [&library, title, author, isbn]() {
+            return library.addBook(title, author, isbn);
+        });
+    }
+
+    /**
+     * @brief Borrow a book, resuming after the group commit.
+     * @param isbn The ISBN of the book to borrow.
+     * @param userId The ID of the user borrowing the book.
+     * @return An awaitable yielding the result of LibrarySystem::borrowBook().
+     */
+    CommitAwaiter<bool> borrowBookAsync(std::string isbn, int userId)
+    {
+        LibrarySystem &library = library_;
+        return CommitAwaiter<bool>(executor_, [&library, isbn, userId]() { return library.borrowBook(isbn, userId); });
+    }
+
+    /**
+     * @brief Return a book, resuming after the group commit.
+     * @param isbn The ISBN of the book to return.
+     * @param userId The ID of the user returning the book.
+     * @return An awaitable yielding the result of LibrarySystem::returnBook().
+     */
+    CommitAwaiter<bool> returnBookAsync(std::string isbn, int userId)
+    {
+        LibrarySystem &library = library_;
+        return CommitAwaiter<bool>(executor_, [&library, isbn, userId]() { return library.returnBook(isbn, userId); });
+    }
+
+    /**
+     * @brief Search the catalog; never suspends.
+     * @param keyword The keyword to search for.
+     * @return The titles of the matching books.
+     */
+    std::vector<std::string> searchBooks(const std::string &keyword) { return library_.searchBooks(keyword); }
+
+private:
+    LibrarySystem &library_;
+    CommitExecutor &executor_;
+};
+
+/**
+ * @brief Fire-and-forget coroutine type for request handlers.
+ *
+ * The coroutine starts eagerly and frees itself when it finishes; an
+ * exception escaping it terminates the program.
+ */
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() { return DetachedTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+#endif // LIBRARY_SYSTEM_ASYNC_H
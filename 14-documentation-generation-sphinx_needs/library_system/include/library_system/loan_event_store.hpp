@@ -0,0 +1,176 @@
+//!
+//! @file loan_event_store.hpp
+//! @brief Definition of the append-only, columnar borrow/return event store
+//!
+
+#ifndef LOAN_EVENT_STORE_H
+#define LOAN_EVENT_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "library_system/isbn.hpp"
+#include "library_system/library_system.hpp"
+
+/**
+ * @brief A single borrow or return of a book.
+ */
+struct LoanEvent
+{
+    int64_t timestamp; ///< Seconds since 1970-01-01 UTC.
+    IsbnKey isbn;      ///< The ISBN key of the book.
+    int32_t userId;    ///< The ID of the user.
+    bool returned;     ///< True for a return, false for a borrow.
+};
+
+/**
+ * @brief Enum selecting which events a LoanEventStore query counts.
+ */
+enum LoanEventFilter
+{
+    LOAN_EVENTS_ALL,     ///< Borrows and returns.
+    LOAN_EVENTS_BORROWS, ///< Borrows only.
+    LOAN_EVENTS_RETURNS  ///< Returns only.
+};
+
+/**
+ * @brief Append-only log of loan events stored as immutable column chunks.
+ *
+ * Events are buffered row-wise until kChunkEvents have accumulated and then
+ * sealed into a chunk holding one compressed column per field: timestamps
+ * as zigzag varint delta-of-deltas, ISBN keys as codes into a per-chunk
+ * dictionary (itself stored as varint deltas of the sorted keys), user IDs
+ * as offsets from the chunk minimum and the event kinds as a bitset, the
+ * codes and offsets bit-packed at the narrowest width. Each chunk also keeps its time range, so queries skip chunks
+ * outside the requested window and do not decode timestamps of chunks
+ * entirely inside it.
+ *
+ * Group-by queries decode columns in batches into plain arrays and count by
+ * dictionary code or user ID into dense arrays, so the inner loops are
+ * branch-free; hashing only happens once per distinct key and chunk.
+ *
+ * To record a catalog's loans, register a listener that forwards its
+ * mutations to record() with the current time.
+ */
+class LoanEventStore
+{
+public:
+    /**
+     * @brief Number of events per sealed chunk.
+     */
+    static const std::size_t kChunkEvents = 4096;
+
+    /**
+     * @brief Number of events a book was borrowed or returned.
+     */
+    struct BookCount
+    {
+        IsbnKey isbn;   ///< The ISBN key of the book.
+        uint64_t count; ///< The number of matching events.
+    };
+
+    /**
+     * @brief Number of events of a user.
+     */
+    struct UserCount
+    {
+        int32_t userId; ///< The ID of the user.
+        uint64_t count; ///< The number of matching events.
+    };
+
+    /**
+     * @brief Constructor to initialize an empty store.
+     */
+    LoanEventStore();
+
+    /**
+     * @brief Destructor to clean up resources.
+     */
+    ~LoanEventStore();
+
+    /**
+     * @brief Append an event.
+     * @param event The event; timestamps should be roughly increasing to compress well.
+     */
+    void append(const LoanEvent &event);
+
+    /**
+     * @brief Append the event described by a catalog mutation.
+     * @param record The mutation; only MUTATION_BORROW and MUTATION_RETURN are recorded.
+     * @param timestamp The time of the mutation in seconds since 1970-01-01 UTC.
+     * @return True if an event was appended.
+     */
+    bool record(const MutationRecord &record, int64_t timestamp);
+
+    /**
+     * @brief Count events per book, e.g. the most borrowed books of a month.
+     * @param from The start of the time window, inclusive.
+     * @param to The end of the time window, exclusive.
+     * @param filter The kind of events to count.
+     * @param limit The maximum number of books, 0 for all.
+     * @return Books with at least one matching event, most events first, then by ISBN.
+     */
+    std::vector<BookCount> countByBook(int64_t from, int64_t to, LoanEventFilter filter, std::size_t limit) const;
+
+    /**
+     * @brief Count events per user, e.g. loans per user.
+     * @param from The start of the time window, inclusive.
+     * @param to The end of the time window, exclusive.
+     * @param filter The kind of events to count.
+     * @param limit The maximum number of users, 0 for all.
+     * @return Users with at least one matching event, most events first, then by ID.
+     */
+    std::vector<UserCount> countByUser(int64_t from, int64_t to, LoanEventFilter filter, std::size_t limit) const;
+
+    /**
+     * @brief Count events in a time window.
+     * @param from The start of the time window, inclusive.
+     * @param to The end of the time window, exclusive.
+     * @param filter The kind of events to count.
+     * @return The number of matching events.
+     */
+    uint64_t count(int64_t from, int64_t to, LoanEventFilter filter) const;
+
+    /**
+     * @brief Get the number of events appended so far.
+     * @return The number of events.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Get the number of sealed chunks.
+     * @return The number of chunks.
+     */
+    std::size_t chunkCount() const;
+
+    /**
+     * @brief Get the size of the events as an array of LoanEvent rows.
+     * @return The uncompressed size in bytes.
+     */
+    std::size_t rawBytes() const;
+
+    /**
+     * @brief Get the memory used by the sealed chunks and the row buffer.
+     * @return The approximate size in bytes.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    struct Chunk;
+    typedef std::vector<std::shared_ptr<const Chunk> > ChunkList;
+
+    LoanEventStore(const LoanEventStore &);
+    LoanEventStore &operator=(const LoanEventStore &);
+
+    void snapshot(ChunkList &chunks, std::vector<LoanEvent> &open) const;
+    static Chunk *seal(const std::vector<LoanEvent> &events);
+
+    mutable std::mutex mutex_; ///< Guards chunks_ and open_; chunks themselves are immutable.
+    ChunkList chunks_;
+    std::vector<LoanEvent> open_;
+};
+
+#endif // LOAN_EVENT_STORE_H
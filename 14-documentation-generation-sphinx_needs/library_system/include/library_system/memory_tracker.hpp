@@ -0,0 +1,152 @@
+//!
+//! @file memory_tracker.hpp
+//! @brief Definition of the MemoryTracker byte counter, its tracking allocator and the heapBytes() helpers
+//!
+
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Thread-safe count of the bytes currently allocated for one structure.
+ */
+class MemoryTracker
+{
+public:
+    /**
+     * @brief Constructor to start counting from zero.
+     */
+    MemoryTracker();
+
+    /**
+     * @brief Record an allocation.
+     * @param bytes The size of the allocation.
+     */
+    void allocated(std::size_t bytes);
+
+    /**
+     * @brief Record a deallocation.
+     * @param bytes The size of the released allocation.
+     */
+    void released(std::size_t bytes);
+
+    /**
+     * @brief Get the number of bytes currently allocated.
+     * @return The live bytes.
+     */
+    std::size_t bytes() const;
+
+    /**
+     * @brief Get the highest number of bytes allocated at any time.
+     * @return The peak bytes.
+     */
+    std::size_t peakBytes() const;
+
+private:
+    MemoryTracker(const MemoryTracker &);
+    MemoryTracker &operator=(const MemoryTracker &);
+
+    std::atomic<std::size_t> bytes_;
+    std::atomic<std::size_t> peak_;
+};
+
+/**
+ * @brief Standard allocator reporting every allocation to a MemoryTracker.
+ *
+ * The allocator is stateful: containers must be constructed with it, e.g.
+ * std::vector<T, TrackingAllocator<T> > v(TrackingAllocator<T>(&tracker)).
+ * A null tracker allocates without counting.
+ * @tparam T The element type.
+ */
+template <typename T>
+class TrackingAllocator
+{
+public:
+    typedef T value_type;
+
+    /**
+     * @brief Constructor to report to a tracker.
+     * @param tracker The tracker, which must outlive all allocations; may be null.
+     */
+    explicit TrackingAllocator(MemoryTracker *tracker = 0) : tracker_(tracker) {}
+
+    /**
+     * @brief Converting constructor used when containers rebind the allocator.
+     * @param other The allocator to share the tracker with.
+     */
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U> &other) : tracker_(other.tracker())
+    {
+    }
+
+    /**
+     * @brief Allocate uninitialized storage.
+     * @param count The number of elements.
+     * @return The storage.
+     */
+    T *allocate(std::size_t count)
+    {
+        T *storage = std::allocator<T>().allocate(count);
+        if (tracker_ != 0)
+        {
+            tracker_->allocated(count * sizeof(T));
+        }
+        return storage;
+    }
+
+    /**
+     * @brief Release storage obtained from allocate().
+     * @param storage The storage.
+     * @param count The number of elements it was allocated for.
+     */
+    void deallocate(T *storage, std::size_t count)
+    {
+        if (tracker_ != 0)
+        {
+            tracker_->released(count * sizeof(T));
+        }
+        std::allocator<T>().deallocate(storage, count);
+    }
+
+    /**
+     * @brief Get the tracker.
+     * @return The tracker, or a null pointer.
+     */
+    MemoryTracker *tracker() const { return tracker_; }
+
+private:
+    MemoryTracker *tracker_;
+};
+
+template <typename T, typename U>
+bool operator==(const TrackingAllocator<T> &lhs, const TrackingAllocator<U> &rhs)
+{
+    return lhs.tracker() == rhs.tracker();
+}
+
+template <typename T, typename U>
+bool operator!=(const TrackingAllocator<T> &lhs, const TrackingAllocator<U> &rhs)
+{
+    return lhs.tracker() != rhs.tracker();
+}
+
+/**
+ * @brief Get the heap bytes a string holds beyond the object itself.
+ * @param text The string.
+ * @return The size of its buffer, 0 for short strings stored inline.
+ */
+std::size_t heapBytes(const std::string &text);
+
+/**
+ * @brief Get the heap bytes of a vector of strings, their buffers included.
+ * @param texts The strings.
+ * @return The size of the array and of every string's buffer.
+ */
+std::size_t heapBytes(const std::vector<std::string> &texts);
+
+#endif // MEMORY_TRACKER_H
@@ -0,0 +1,214 @@
+//!
+//! @file multi_tenant_catalog.hpp
+//! @brief Definition of the MultiTenantCatalog shared-index catalog of many tenants
+//!
+
+#ifndef MULTI_TENANT_CATALOG_H
+#define MULTI_TENANT_CATALOG_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "library_system/isbn.hpp"
+#include "library_system/memory_tracker.hpp"
+#include "library_system/roaring_bitmap.hpp"
+
+/**
+ * @brief Catalog of many small tenants sharing one set of index structures.
+ *
+ * A LibrarySystem per tenant pays for its own segments, trie, caches and
+ * merge thread however few books it holds. Here all tenants share the book
+ * arena and one term dictionary whose posting lists are RoaringBitmaps over
+ * global document ids; every tenant only owns a bitmap of its documents,
+ * its ISBN index and an arena with the titles and authors of its books. A
+ * search intersects the
+ * posting lists of its terms with the tenant's bitmap, smallest first, so
+ * one tenant never sees another's books.
+ *
+ * What a tenant costs is thus roughly its own data: its records, its texts,
+ * its ISBN index, its bitmap and its entries in the shared posting lists.
+ * An idle tenant can be evicted: its books are written to a flat file in
+ * the spill directory, its texts are freed and its books are removed from
+ * the shared structures, and the tenant is reloaded transparently the next
+ * time it is used. Freed document ids are reused and terms no resident book
+ * contains leave the dictionary, so evicting and reloading does not grow
+ * the shared structures.
+ *
+ * All operations are serialized by one mutex.
+ */
+class MultiTenantCatalog
+{
+public:
+    /**
+     * @brief Clock used for idle times.
+     */
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief Constructor to initialize an empty catalog.
+     * @param spillDirectory The directory evicted tenants are written to.
+     */
+    explicit MultiTenantCatalog(const std::string &spillDirectory);
+
+    /**
+     * @brief Destructor removing the files of evicted tenants.
+     */
+    ~MultiTenantCatalog();
+
+    /**
+     * @brief Add a book to a tenant, creating the tenant on first use.
+     * @param tenant The name of the tenant.
+     * @param title The title of the book.
+     * @param author The author of the book.
+     * @param isbn The ISBN of the book.
+     * @return True if added, false for invalid ISBNs or ISBNs the tenant already has.
+     */
+    bool addBook(const std::string &tenant, const std::string &title, const std::string &author,
+                 const std::string &isbn);
+
+    /**
+     * @brief Borrow a book of a tenant.
+     * @param tenant The name of the tenant.
+     * @param isbn The ISBN of the book to borrow.
+     * @return True if the tenant has the book.
+     */
+    bool borrowBook(const std::string &tenant, const std::string &isbn);
+
+    /**
+     * @brief Get the number of times a book of a tenant was borrowed.
+     * @param tenant The name of the tenant.
+     * @param isbn The ISBN of the book.
+     * @return The loan count, 0 if the tenant does not have the book.
+     */
+    unsigned loans(const std::string &tenant, const std::string &isbn);
+
+    /**
+     * @brief Search the books of one tenant.
+     * @param tenant The name of the tenant.
+     * @param keyword The keyword to search for in book titles and authors.
+     * @return The titles of the tenant's books containing every term of the keyword.
+     */
+    std::vector<std::string> searchBooks(const std::string &tenant, const std::string &keyword);
+
+    /**
+     * @brief Get the number of books of a tenant.
+     * @param tenant The name of the tenant.
+     * @return The number of books, also counting those of an evicted tenant.
+     */
+    std::size_t bookCount(const std::string &tenant) const;
+
+    /**
+     * @brief Get the number of known tenants.
+     * @return The number of tenants, resident or evicted.
+     */
+    std::size_t tenantCount() const;
+
+    /**
+     * @brief Check whether a tenant is loaded.
+     * @param tenant The name of the tenant.
+     * @return True if the tenant exists and is not evicted.
+     */
+    bool resident(const std::string &tenant) const;
+
+    /**
+     * @brief Evict a tenant to disk.
+     * @param tenant The name of the tenant.
+     * @return True if evicted, false if the tenant is unknown, already evicted or could not be written.
+     */
+    bool evictTenant(const std::string &tenant);
+
+    /**
+     * @brief Evict every resident tenant unused for a while.
+     * @param idle The minimum time since the last use of an evicted tenant.
+     * @return The number of tenants evicted.
+     */
+    std::size_t evictIdleTenants(Clock::duration idle);
+
+    /**
+     * @brief Get the heap bytes held for one tenant.
+     * @param tenant The name of the tenant.
+     * @return Its records, texts, ISBN index, document bitmap and posting entries; 0 when evicted.
+     */
+    std::size_t tenantMemoryUsage(const std::string &tenant) const;
+
+    /**
+     * @brief Get the heap bytes of the structures shared by all tenants.
+     * @return The book arena, term dictionary and posting lists.
+     */
+    std::size_t sharedMemoryUsage() const;
+
+private:
+    typedef uint32_t DocId;
+
+    struct Doc
+    {
+        uint32_t tenant; ///< Index into tenants_, kNoTenant for a free slot.
+        uint32_t title;  ///< Offset in the text arena of the tenant.
+        uint32_t author; ///< Offset in the text arena of the tenant.
+        IsbnKey isbn;
+        uint32_t loans;
+    };
+
+    typedef std::unordered_map<IsbnKey, DocId, std::hash<IsbnKey>, std::equal_to<IsbnKey>,
+                               TrackingAllocator<std::pair<const IsbnKey, DocId> > >
+        IsbnIndex;
+
+    typedef std::unordered_map<std::string, uint32_t, std::hash<std::string>, std::equal_to<std::string>,
+                               TrackingAllocator<std::pair<const std::string, uint32_t> > >
+        TermIndex;
+
+    struct Tenant
+    {
+        Tenant();
+
+        std::string name;
+        RoaringBitmap docs;
+        std::string texts;          ///< Length-prefixed titles and authors of the resident books.
+        MemoryTracker indexTracker;
+        std::unique_ptr<IsbnIndex> isbns;
+        std::size_t postingEntries; ///< Entries of the tenant's documents in posting lists.
+        std::size_t bookCount;
+        Clock::time_point lastUsed;
+        std::string spillPath;      ///< Non-empty while evicted.
+    };
+
+    MultiTenantCatalog(const MultiTenantCatalog &);
+    MultiTenantCatalog &operator=(const MultiTenantCatalog &);
+
+    static std::vector<std::string> documentTerms(const std::string &title, const std::string &author);
+
+    Tenant *findTenant(const std::string &name) const;
+    Tenant &useTenant(const std::string &name);
+    bool load(Tenant &tenant);
+    bool evict(Tenant &tenant);
+    Doc &doc(DocId id) const;
+    DocId allocateDoc();
+    void insert(uint32_t tenantIndex, DocId id, const std::string &title, const std::string &author, IsbnKey isbn,
+                uint32_t loans);
+    void unindex(Tenant &tenant, DocId id);
+
+    static const std::size_t kDocsPerChunk = 1024;
+    static const uint32_t kNoTenant = 0xFFFFFFFFu;
+
+    mutable std::mutex mutex_;
+    std::string spillDirectory_;
+    std::size_t spillCount_;
+    std::vector<std::unique_ptr<Tenant> > tenants_;
+    std::unordered_map<std::string, uint32_t> tenantIndex_;
+    std::vector<std::unique_ptr<Doc[]> > docChunks_; ///< The shared book arena.
+    DocId docCount_;                                  ///< Document ids handed out, free or not.
+    std::vector<DocId> freeDocs_;
+    MemoryTracker termTracker_;
+    TermIndex termIds_;                               ///< The shared term dictionary.
+    std::vector<RoaringBitmap> postings_;             ///< Global document ids per term id.
+    std::vector<uint32_t> freeTerms_;                 ///< Term ids with empty posting lists.
+};
+
+#endif // MULTI_TENANT_CATALOG_H
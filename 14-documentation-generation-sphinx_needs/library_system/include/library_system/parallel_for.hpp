@@ -0,0 +1,39 @@
+//!
+//! @file parallel_for.hpp
+//! @brief Fork-join helper running one task per thread
+//!
+
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Run task(0) .. task(count - 1) concurrently, one thread each, and wait for all of them.
+ *
+ * Task 0 runs on the calling thread, so a count of 1 starts no thread.
+ * @tparam Task A callable taking the task index.
+ * @param count The number of tasks.
+ * @param task The task.
+ */
+template <typename Task>
+void parallelFor(std::size_t count, Task task)
+{
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        threads.push_back(std::thread(task, i));
+    }
+    if (count != 0)
+    {
+        task(0);
+    }
+    for (std::size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i].join();
+    }
+}
+
+#endif // PARALLEL_FOR_H
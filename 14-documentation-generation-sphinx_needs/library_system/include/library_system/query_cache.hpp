@@ -0,0 +1,140 @@
+//!
+//! @file query_cache.hpp
+//! @brief Definition of the QueryCache search result cache
+//!
+
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Sharded LRU cache of search results keyed by normalized query.
+ *
+ * Every entry remembers the terms of its query, so a catalog change only
+ * drops the entries whose terms intersect the terms of the changed book.
+ * Each shard has its own lock and LRU list; a key always maps to one shard.
+ */
+class QueryCache
+{
+public:
+    /**
+     * @brief Cache effectiveness counters.
+     */
+    struct Stats
+    {
+        uint64_t hits;          ///< Lookups answered from the cache.
+        uint64_t misses;        ///< Lookups that were not cached.
+        uint64_t invalidations; ///< Entries dropped because the catalog changed.
+        uint64_t evictions;     ///< Entries dropped to stay within capacity.
+    };
+
+    /**
+     * @brief Constructor to initialize an empty cache.
+     * @param capacity The maximum number of cached queries.
+     * @param shardCount The number of independently locked shards.
+     */
+    explicit QueryCache(std::size_t capacity, std::size_t shardCount = 8);
+
+    /**
+     * @brief Build the cache key of a query.
+     * @param terms The normalized query terms.
+     * @return The terms sorted, deduplicated and joined by spaces.
+     */
+    static std::string makeKey(std::vector<std::string> terms);
+
+    /**
+     * @brief Look a query up and mark it as recently used.
+     * @param key The cache key of the query.
+     * @param results Receives the cached results on a hit.
+     * @return True on a cache hit, false otherwise.
+     */
+    bool lookup(const std::string &key, std::vector<std::string> &results);
+
+    /**
+     * @brief Cache the results of a query.
+     *
+     * Results computed before the latest invalidation of the shard are
+     * stale and silently discarded.
+     *
+     * @param key The cache key of the query.
+     * @param terms The normalized query terms.
+     * @param results The search results.
+     * @param generation The catalog generation the results were computed at.
+     */
+    void insert(const std::string &key, const std::vector<std::string> &terms,
+                const std::vector<std::string> &results, uint64_t generation);
+
+    /**
+     * @brief Drop every entry whose query shares a term with a changed book.
+     * @param terms The normalized terms of the changed book.
+     * @param generation The catalog generation after the change.
+     */
+    void invalidate(const std::vector<std::string> &terms, uint64_t generation);
+
+    /**
+     * @brief Drop every entry, e.g. after a change touching too many terms to invalidate one by one.
+     * @param generation The catalog generation after the change.
+     */
+    void invalidateAll(uint64_t generation);
+
+    /**
+     * @brief Get the cache counters.
+     * @return A copy of the counters.
+     */
+    Stats stats() const;
+
+    /**
+     * @brief Get the memory held by the cached entries.
+     * @return The estimated size in bytes of the entries and their index nodes.
+     */
+    std::size_t memoryUsage() const;
+
+    /**
+     * @brief Evict least recently used entries until the cache fits a budget.
+     * @param maxBytes The memory the entries may use afterwards.
+     */
+    void trim(std::size_t maxBytes);
+
+private:
+    struct Entry
+    {
+        std::string key;
+        std::vector<std::string> terms;
+        std::vector<std::string> results;
+        uint64_t generation;
+        std::size_t bytes; ///< Estimated memory of the entry, see entryBytes().
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::list<Entry> lru; ///< Most recently used entry first.
+        std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+        std::unordered_map<std::string, std::unordered_set<std::string> > termKeys;
+        uint64_t invalidatedGeneration;
+    };
+
+    Shard &shardFor(const std::string &key);
+    void erase(Shard &shard, std::list<Entry>::iterator entry);
+    static std::size_t entryBytes(const Entry &entry);
+
+    std::size_t shardCapacity_;
+    std::vector<std::unique_ptr<Shard> > shards_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> invalidations_;
+    std::atomic<uint64_t> evictions_;
+    std::atomic<std::size_t> bytes_;
+};
+
+#endif // QUERY_CACHE_H
@@ -0,0 +1,205 @@
+//!
+//! @file replication.hpp
+//! @brief Definition of leader/follower log-shipping replication of a LibrarySystem
+//!
+
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "library_system/library_system.hpp"
+
+/**
+ * @brief Leader side of log-shipping replication over a Unix domain socket.
+ *
+ * The leader registers a mutation listener on its catalog and keeps the
+ * resulting log in memory; because the listener first receives the
+ * existing catalog, a follower connecting at any time replays from
+ * sequence 1. Each follower gets a sender thread that ships the log in
+ * batches of up to kMaxBatchRecords mutations, one FLAT_MUTATION buffer
+ * (see FlatWriter) per batch. Followers acknowledge every applied batch,
+ * which is what lag() reports.
+ *
+ * Wire format, in host byte order since both ends share a machine: leader
+ * to follower, u32 buffer size, u64 newest logged sequence, flat buffer;
+ * follower to leader, u64 applied sequence. The log is never truncated,
+ * so the leader's memory grows with its mutation history.
+ */
+class ReplicationLeader
+{
+public:
+    /**
+     * @brief Maximum number of mutations shipped in one batch.
+     */
+    static const std::size_t kMaxBatchRecords = 512;
+
+    /**
+     * @brief Constructor to start listening for followers.
+     * @param library The catalog to replicate, which must outlive this object.
+     * @param socketPath The path of the Unix domain socket; an existing file is replaced.
+     */
+    ReplicationLeader(LibrarySystem &library, const std::string &socketPath);
+
+    /**
+     * @brief Destructor disconnecting all followers and removing the socket file.
+     */
+    ~ReplicationLeader();
+
+    /**
+     * @brief Check whether the socket could be created.
+     * @return True if followers can connect.
+     */
+    bool listening() const;
+
+    /**
+     * @brief Get the sequence of the newest logged mutation.
+     * @return The sequence, 0 if the log is empty.
+     */
+    uint64_t lastSequence() const;
+
+    /**
+     * @brief Get the number of connected followers.
+     * @return The number of followers.
+     */
+    std::size_t followerCount() const;
+
+    /**
+     * @brief Get the replication lag of the slowest connected follower.
+     * @return The number of logged mutations it has not acknowledged yet.
+     */
+    uint64_t lag() const;
+
+private:
+    struct Follower
+    {
+        int fd;
+        std::atomic<uint64_t> acknowledged;
+        std::atomic<bool> connected; ///< Cleared under logMutex_, waking the sender.
+        std::atomic<int> running;    ///< Threads still serving the follower; reaped at 0.
+        std::thread sender;
+        std::thread acknowledger;
+    };
+
+    ReplicationLeader(const ReplicationLeader &);
+    ReplicationLeader &operator=(const ReplicationLeader &);
+
+    void append(const MutationRecord &record);
+    void accept();
+    void send(Follower *follower);
+    void receiveAcknowledgements(Follower *follower);
+
+    LibrarySystem &library_;
+    std::string socketPath_;
+    int listenFd_;
+    std::size_t listener_;
+
+    mutable std::mutex logMutex_; ///< Guards log_, followers_ and stopping_.
+    std::condition_variable logCondition_;
+    std::vector<MutationRecord> log_; ///< Mutation with sequence n is at index n - 1.
+    std::vector<std::unique_ptr<Follower> > followers_;
+    bool stopping_;
+    std::thread acceptor_;
+};
+
+/**
+ * @brief Follower side of log-shipping replication: a read-only warm standby.
+ *
+ * A receiver thread reads batches off the socket while an applier thread
+ * replays the previous ones into the follower's own catalog, so network
+ * transfer and apply overlap. At most kPipelineDepth received batches wait
+ * to be applied; beyond that the receiver stops reading and the socket
+ * pushes back on the leader.
+ */
+class ReplicationFollower
+{
+public:
+    /**
+     * @brief Maximum number of received batches waiting to be applied.
+     */
+    static const std::size_t kPipelineDepth = 8;
+
+    /**
+     * @brief Constructor to connect to a leader and start replaying its log.
+     * @param socketPath The path of the leader's Unix domain socket.
+     */
+    explicit ReplicationFollower(const std::string &socketPath);
+
+    /**
+     * @brief Destructor disconnecting from the leader.
+     */
+    ~ReplicationFollower();
+
+    /**
+     * @brief Check whether the follower is connected to its leader.
+     * @return False if connecting failed or the leader went away.
+     */
+    bool connected() const;
+
+    /**
+     * @brief Search the replicated catalog, see LibrarySystem::searchBooks().
+     * @param keyword The keyword to search for in book titles and authors.
+     * @return A vector of book titles matching the search keyword.
+     */
+    std::vector<std::string> searchBooks(const std::string &keyword);
+
+    /**
+     * @brief Search the replicated catalog, see LibrarySystem::searchTopBooks().
+     * @param keyword The keyword to search for in book titles and authors.
+     * @param k The maximum number of results.
+     * @return Up to k matching books, most borrowed first.
+     */
+    std::vector<LibrarySystem::SearchHit> searchTopBooks(const std::string &keyword, std::size_t k);
+
+    /**
+     * @brief Get the sequence of the newest applied mutation.
+     * @return The sequence, 0 before the first batch was applied.
+     */
+    uint64_t appliedSequence() const;
+
+    /**
+     * @brief Get how far the follower trails the leader, as last reported by the leader.
+     * @return The number of mutations logged by the leader but not applied here.
+     */
+    uint64_t lag() const;
+
+    /**
+     * @brief Wait until a mutation has been applied.
+     * @param sequence The sequence to wait for.
+     * @param timeoutMs The maximum time to wait, in milliseconds.
+     * @return True if the mutation was applied in time.
+     */
+    bool waitForSequence(uint64_t sequence, unsigned timeoutMs);
+
+private:
+    ReplicationFollower(const ReplicationFollower &);
+    ReplicationFollower &operator=(const ReplicationFollower &);
+
+    void receive();
+    void apply();
+
+    LibrarySystem library_;
+    int fd_;
+    std::atomic<bool> connected_;
+    std::atomic<uint64_t> leaderSequence_;
+
+    mutable std::mutex mutex_; ///< Guards pending_, receiving_ and applied_.
+    std::condition_variable pendingCondition_;
+    std::condition_variable appliedCondition_;
+    std::deque<std::vector<char> > pending_; ///< Received flat buffers, oldest first.
+    bool receiving_;
+    uint64_t applied_;
+    std::thread receiver_;
+    std::thread applier_;
+};
+
+#endif // REPLICATION_H
@@ -0,0 +1,143 @@
+//!
+//! @file requirement_repository.hpp
+//! @brief Definition of the RequirementRepository indexed requirement store
+//!
+
+#ifndef REQUIREMENT_REPOSITORY_H
+#define REQUIREMENT_REPOSITORY_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "library_system/requirement_table.hpp"
+#include "library_system/roaring_bitmap.hpp"
+
+/**
+ * @brief Requirement store with bitmap secondary indexes.
+ *
+ * Requirements are kept in a RequirementTable and addressed by their ID.
+ * Every status, owner and priority bucket has a RoaringBitmap of table rows,
+ * maintained on insert and update, so compound predicates are answered by
+ * combining bitmaps with &, | and andNot instead of scanning the table.
+ * Creation days are kept in a sorted index, so a date range is a binary
+ * search followed by a contiguous slice. Rows arriving in creation order are
+ * appended to it; out-of-order inserts and updates are buffered and merged in
+ * one pass before the next date query or once the buffer grows large.
+ */
+class RequirementRepository
+{
+public:
+    /**
+     * @brief Number of priority buckets; priorities outside are clamped.
+     */
+    static const int kPriorityBuckets = 8;
+
+    /**
+     * @brief Insert a new requirement.
+     * @param requirement The requirement to insert.
+     * @return True if inserted, false if a requirement with the same ID exists.
+     */
+    bool insert(const Requirement &requirement);
+
+    /**
+     * @brief Replace a stored requirement with a new version.
+     * @param requirement The new version, matched by ID.
+     * @return True if updated, false if no requirement has that ID.
+     */
+    bool update(const Requirement &requirement);
+
+    /**
+     * @brief Get the number of stored requirements.
+     * @return The number of requirements.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Get the rows of the requirements with a status.
+     * @param status The status to match.
+     * @return The matching rows.
+     */
+    const RoaringBitmap &withStatus(RequirementStatus status) const;
+
+    /**
+     * @brief Get the rows of the requirements of an owner.
+     * @param owner The owner or team to match.
+     * @return The matching rows.
+     */
+    RoaringBitmap ownedBy(const std::string &owner) const;
+
+    /**
+     * @brief Get the rows of the requirements within a priority range.
+     *
+     * Whole buckets are combined with OR; only the rows of clamped edge
+     * buckets are checked against the priority column.
+     *
+     * @param minPriority The lowest accepted priority.
+     * @param maxPriority The highest accepted priority.
+     * @return The matching rows.
+     */
+    RoaringBitmap withPriority(int minPriority, int maxPriority) const;
+
+    /**
+     * @brief Get the rows of the requirements created within a date range.
+     * @param from The first day of the range, as "YYYY-MM-DD".
+     * @param to The last day of the range (inclusive), as "YYYY-MM-DD".
+     * @return The matching rows; empty if either bound is not a valid date.
+     */
+    RoaringBitmap createdBetween(const std::string &from, const std::string &to) const;
+
+    /**
+     * @brief Get the rows of the requirements created within a day range.
+     *
+     * The slice is ordered by day; when rows were created in order it is
+     * also ordered by row and becomes a bitmap in linear time, otherwise
+     * its k rows are sorted first in O(k log k).
+     *
+     * @param fromDay The first day of the range, in days since 1970-01-01.
+     * @param toDay The last day of the range (inclusive).
+     * @return The matching rows.
+     */
+    RoaringBitmap createdBetween(int fromDay, int toDay) const;
+
+    /**
+     * @brief Materialize the requirements of a set of rows.
+     * @param rows The rows, typically the result of combined index lookups.
+     * @return The requirements in row order.
+     */
+    std::vector<Requirement> fetch(const RoaringBitmap &rows) const;
+
+    /**
+     * @brief Get the underlying columnar table.
+     * @return The table holding the requirements.
+     */
+    const RequirementTable &table() const;
+
+private:
+    static int priorityBucket(int priority);
+
+    typedef std::pair<int32_t, RequirementTable::Row> DateEntry;
+
+    /**
+     * @brief Smallest number of buffered date changes merged eagerly.
+     */
+    static const std::size_t kMinDateBatch = 256;
+
+    void indexRow(RequirementTable::Row row);
+    void unindexRow(RequirementTable::Row row);
+    void mergeDateChanges() const;
+    void maybeMergeDateChanges();
+
+    RequirementTable table_;
+    std::unordered_map<int, RequirementTable::Row> rowsById_;
+    RoaringBitmap statusIndex_[CLOSED + 1];
+    std::vector<RoaringBitmap> ownerIndex_; ///< Indexed by owner dictionary code.
+    RoaringBitmap priorityIndex_[kPriorityBuckets];
+    mutable std::vector<DateEntry> dateIndex_; ///< Sorted by (day, row); invalid dates excluded.
+    mutable std::vector<DateEntry> dateAdds_;     ///< Out-of-order entries awaiting a merge.
+    mutable std::vector<DateEntry> dateRemovals_; ///< Removed entries awaiting a merge.
+};
+
+#endif // REQUIREMENT_REPOSITORY_H
@@ -0,0 +1,167 @@
+//!
+//! @file requirement_table.hpp
+//! @brief Definition of the RequirementTable columnar requirement store
+//!
+
+#ifndef REQUIREMENT_TABLE_H
+#define REQUIREMENT_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "library_system/compressed_text_store.hpp"
+#include "library_system/library_system.hpp"
+#include "library_system/string_pool.hpp"
+
+/**
+ * @brief Struct-of-arrays store for many Requirement records.
+ *
+ * Numeric fields live in int32 columns, the status in a uint8 column and the
+ * owner in a dictionary-encoded uint32 column, so filters and aggregates scan
+ * contiguous memory without touching strings. Filters run as SSE2 kernels
+ * processing 16 rows per iteration when SSE2 is available. Descriptions are
+ * compressed against a dictionary shared by all rows.
+ */
+class RequirementTable
+{
+public:
+    /**
+     * @brief Row number of a requirement in the table.
+     */
+    typedef uint32_t Row;
+
+    /**
+     * @brief Append a requirement.
+     * @param requirement The requirement to store.
+     * @return The row of the stored requirement.
+     */
+    Row append(const Requirement &requirement);
+
+    /**
+     * @brief Overwrite a row with a new version of a requirement.
+     * @param row The row to overwrite.
+     * @param requirement The new field values.
+     */
+    void update(Row row, const Requirement &requirement);
+
+    /**
+     * @brief Get the number of rows.
+     * @return The number of stored requirements.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Materialize a row as a Requirement.
+     * @param row The row to read.
+     * @return The requirement stored in the row.
+     */
+    Requirement at(Row row) const;
+
+    /**
+     * @brief Get the ID stored in a row.
+     * @param row The row to read.
+     * @return The requirement ID.
+     */
+    int id(Row row) const;
+
+    /**
+     * @brief Get the priority stored in a row.
+     * @param row The row to read.
+     * @return The requirement priority.
+     */
+    int priority(Row row) const;
+
+    /**
+     * @brief Get the status stored in a row.
+     * @param row The row to read.
+     * @return The requirement status.
+     */
+    RequirementStatus status(Row row) const;
+
+    /**
+     * @brief Decompress the description of a row into a caller-provided buffer.
+     * @param row The row to read.
+     * @param buffer The destination, not null-terminated.
+     * @param capacity The size of the destination.
+     * @return The length of the description; nothing is written if it exceeds capacity.
+     */
+    std::size_t description(Row row, char *buffer, std::size_t capacity) const;
+
+    /**
+     * @brief Get the creation day stored in a row.
+     * @param row The row to read.
+     * @return The days since 1970-01-01, or kInvalidEpochDay.
+     */
+    int createdDay(Row row) const;
+
+    /**
+     * @brief Get the owner code stored in a row.
+     * @param row The row to read.
+     * @return The dictionary code of the owner.
+     */
+    uint32_t owner(Row row) const;
+
+    /**
+     * @brief Find the rows with a given status and a minimum priority.
+     * @param status The required status.
+     * @param minPriority The lowest accepted priority.
+     * @param rows Receives the matching rows in ascending order.
+     */
+    void filter(RequirementStatus status, int minPriority, std::vector<Row> &rows) const;
+
+    /**
+     * @brief Sum the test cases of the rows with a given status and a minimum priority.
+     * @param status The required status.
+     * @param minPriority The lowest accepted priority.
+     * @return The total number of test cases of the matching rows.
+     */
+    int64_t sumTestCases(RequirementStatus status, int minPriority) const;
+
+    /**
+     * @brief Sum the test cases of all rows per owner.
+     * @return The totals indexed by owner code (see ownerName()).
+     */
+    std::vector<int64_t> sumTestCasesByOwner() const;
+
+    /**
+     * @brief Get the number of distinct owners.
+     * @return The size of the owner dictionary.
+     */
+    std::size_t ownerCount() const;
+
+    /**
+     * @brief Get the owner with a dictionary code.
+     * @param code The owner code.
+     * @return The owner name, backed by StringPool::global().
+     */
+    StringPool::View ownerName(uint32_t code) const;
+
+    /**
+     * @brief Look up the dictionary code of an owner.
+     * @param owner The owner name.
+     * @param code Receives the owner code if present.
+     * @return True if the owner is in the dictionary.
+     */
+    bool ownerCode(const std::string &owner, uint32_t &code) const;
+
+private:
+    uint32_t encodeOwner(StringPool::Id owner);
+
+    std::vector<int32_t> ids_;
+    std::vector<int32_t> priorities_;
+    std::vector<uint8_t> statuses_;
+    std::vector<int32_t> testCases_;
+    std::vector<uint32_t> owners_;
+    std::vector<std::string> titles_;
+    CompressedTextStore descriptions_; ///< Indexed by row.
+    std::vector<std::string> createdDates_;
+    std::vector<int32_t> createdDays_;
+
+    std::vector<StringPool::Id> ownerIds_; ///< Interned owner of each code.
+    std::unordered_map<StringPool::Id, uint32_t> ownerCodes_;
+};
+
+#endif // REQUIREMENT_TABLE_H
@@ -0,0 +1,131 @@
+//!
+//! @file roaring_bitmap.hpp
+//! @brief Definition of the RoaringBitmap compressed integer set
+//!
+
+#ifndef ROARING_BITMAP_H
+#define ROARING_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Compressed set of 32-bit integers (roaring bitmap).
+ *
+ * Values are partitioned by their high 16 bits into containers. A container
+ * holding at most kArrayLimit values is a sorted array of the low 16 bits;
+ * a denser one is a 65536-bit bitmap. Set operations work container by
+ * container and pick the cheapest algorithm for each pair of representations.
+ */
+class RoaringBitmap
+{
+public:
+    /**
+     * @brief Largest cardinality stored as a sorted array.
+     */
+    static const std::size_t kArrayLimit = 4096;
+
+    /**
+     * @brief Build a set from sorted values in one pass, without per-value inserts.
+     * @param values The values in ascending order; duplicates are stored once.
+     * @return The set of the values.
+     */
+    static RoaringBitmap fromSorted(const std::vector<uint32_t> &values);
+
+    /**
+     * @brief Add a value to the set.
+     * @param value The value to add.
+     */
+    void add(uint32_t value);
+
+    /**
+     * @brief Remove a value from the set.
+     * @param value The value to remove.
+     */
+    void remove(uint32_t value);
+
+    /**
+     * @brief Check whether a value is in the set.
+     * @param value The value to look for.
+     * @return True if the value is present.
+     */
+    bool contains(uint32_t value) const;
+
+    /**
+     * @brief Get the number of values in the set.
+     * @return The cardinality.
+     */
+    std::size_t cardinality() const;
+
+    /**
+     * @brief Check whether the set is empty.
+     * @return True if the set holds no value.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Intersect two sets.
+     * @param other The other set.
+     * @return The values present in both sets.
+     */
+    RoaringBitmap operator&(const RoaringBitmap &other) const;
+
+    /**
+     * @brief Unite two sets.
+     * @param other The other set.
+     * @return The values present in either set.
+     */
+    RoaringBitmap operator|(const RoaringBitmap &other) const;
+
+    /**
+     * @brief Subtract a set.
+     * @param other The set to subtract.
+     * @return The values present in this set but not in the other.
+     */
+    RoaringBitmap andNot(const RoaringBitmap &other) const;
+
+    /**
+     * @brief Compare two sets.
+     * @param other The other set.
+     * @return True if both sets hold the same values.
+     */
+    bool operator==(const RoaringBitmap &other) const;
+
+    /**
+     * @brief List the values of the set.
+     * @return The values in ascending order.
+     */
+    std::vector<uint32_t> toVector() const;
+
+    /**
+     * @brief Get the number of heap bytes held by the set.
+     * @return The approximate memory footprint in bytes.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    struct Container
+    {
+        uint16_t key;                ///< High 16 bits shared by the values.
+        uint32_t cardinality;        ///< Number of values in the container.
+        std::vector<uint16_t> array; ///< Sorted low bits while sparse.
+        std::vector<uint64_t> words; ///< 1024 words of bits while dense.
+
+        bool isBitmap() const { return !words.empty(); }
+    };
+
+    static void toBitmap(Container &container);
+    static void normalize(Container &container);
+    static bool containerContains(const Container &container, uint16_t low);
+    static Container intersect(const Container &lhs, const Container &rhs);
+    static Container unite(const Container &lhs, const Container &rhs);
+    static Container subtract(const Container &lhs, const Container &rhs);
+
+    Container *find(uint16_t key);
+    const Container *find(uint16_t key) const;
+
+    std::vector<Container> containers_; ///< Sorted by key, never empty.
+};
+
+#endif // ROARING_BITMAP_H
@@ -0,0 +1,174 @@
+//!
+//! @file search_segment.hpp
+//! @brief Definition of the SearchSegment immutable inverted index segment
+//!
+
+#ifndef SEARCH_SEGMENT_H
+#define SEARCH_SEGMENT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "library_system/memory_tracker.hpp"
+
+/**
+ * @brief Immutable inverted index over a set of catalog documents.
+ *
+ * Terms are kept sorted in a single character pool and every term owns a
+ * contiguous, ascending run of document ids in one postings array, so a
+ * segment is a handful of flat allocations regardless of its size.
+ *
+ * The arrays either live on the heap, counted by an optional MemoryTracker,
+ * or in a read-only mapping of a spill file, in which case the kernel may
+ * page them out under memory pressure.
+ */
+class SearchSegment
+{
+public:
+    /**
+     * @brief Identifier of a document (the catalog position of a book).
+     */
+    typedef uint32_t DocId;
+
+    /**
+     * @brief A term occurring in a document.
+     */
+    typedef std::pair<std::string, DocId> Posting;
+
+    /**
+     * @brief Build a segment from term occurrences.
+     * @param postings The occurrences; they are sorted and deduplicated here.
+     * @param documentCount The number of documents the occurrences belong to.
+     * @param tracker Counts the heap memory of the segment; may be null.
+     * @return The new segment.
+     */
+    static std::shared_ptr<const SearchSegment> build(std::vector<Posting> postings, std::size_t documentCount,
+                                                      MemoryTracker *tracker = 0);
+
+    /**
+     * @brief Build a segment from term occurrences partitioned by term, e.g. by term hash.
+     *
+     * Every term must occur in one partition only. The partitions are
+     * sorted and copied into the segment concurrently, one thread each;
+     * only their term dictionaries are merged on the calling thread.
+     * @param partitions The occurrences, consumed; they are sorted and deduplicated here.
+     * @param documentCount The number of documents the occurrences belong to.
+     * @param tracker Counts the heap memory of the segment; may be null.
+     * @return The new segment, equal to build() of all occurrences.
+     */
+    static std::shared_ptr<const SearchSegment> buildPartitioned(std::vector<std::vector<Posting> > &partitions,
+                                                                 std::size_t documentCount,
+                                                                 MemoryTracker *tracker = 0);
+
+    /**
+     * @brief Merge several segments into one.
+     * @param segments The segments to merge.
+     * @param tracker Counts the heap memory of the merged segment; may be null.
+     * @return A segment holding the union of their postings.
+     */
+    static std::shared_ptr<const SearchSegment> merge(
+        const std::vector<std::shared_ptr<const SearchSegment> > &segments, MemoryTracker *tracker = 0);
+
+    /**
+     * @brief Destructor to release the arrays or the mapping.
+     */
+    ~SearchSegment();
+
+    /**
+     * @brief Write the segment to a file and map it back read-only.
+     *
+     * The file is unlinked once mapped, so it disappears with the last
+     * reference to the returned segment.
+     * @param path The path of the spill file.
+     * @return An equivalent segment backed by the mapping, or a null pointer if the file could not be written.
+     */
+    std::shared_ptr<const SearchSegment> spill(const std::string &path) const;
+
+    /**
+     * @brief Find the documents containing all the given terms.
+     * @param terms The normalized query terms.
+     * @param matches Receives the matching document ids in ascending order.
+     */
+    void match(const std::vector<std::string> &terms, std::vector<DocId> &matches) const;
+
+    /**
+     * @brief Get the posting list of a term.
+     * @param term The normalized term.
+     * @param count Receives the number of documents containing the term.
+     * @return The ascending document ids, or a null pointer if the term is absent.
+     */
+    const DocId *postings(const std::string &term, std::size_t &count) const;
+
+    /**
+     * @brief Get the number of documents indexed by the segment.
+     * @return The number of documents.
+     */
+    std::size_t documentCount() const;
+
+    /**
+     * @brief Get the number of distinct terms in the segment.
+     * @return The number of terms.
+     */
+    std::size_t termCount() const;
+
+    /**
+     * @brief Check whether the segment is backed by a spill file mapping.
+     * @return True if the arrays are mapped.
+     */
+    bool mapped() const;
+
+    /**
+     * @brief Get the heap memory used by the segment.
+     * @return The size in bytes, 0 for a mapped segment.
+     */
+    std::size_t memoryUsage() const;
+
+    /**
+     * @brief Get the size of the spill file mapping.
+     * @return The size in bytes, 0 for a heap segment.
+     */
+    std::size_t mappedBytes() const;
+
+    /**
+     * @brief Get when the segment was last searched.
+     * @return A millisecond tick of the last posting list lookup; 0 if never searched.
+     */
+    uint64_t lastUsed() const;
+
+private:
+    explicit SearchSegment(MemoryTracker *tracker);
+    SearchSegment(const SearchSegment &);
+    SearchSegment &operator=(const SearchSegment &);
+
+    template <typename T>
+    struct Array
+    {
+        typedef std::vector<T, TrackingAllocator<T> > Type;
+    };
+
+    void attach();
+
+    Array<char>::Type termPool_;            ///< Sorted terms, concatenated.
+    Array<uint32_t>::Type termOffsets_;     ///< Start of every term in termPool_, plus the end.
+    Array<uint32_t>::Type postingOffsets_;  ///< Start of every term in postings_, plus the end.
+    Array<DocId>::Type postings_;
+    std::size_t documentCount_;
+
+    // Views of the heap arrays above or of the mapping.
+    const char *terms_;
+    const uint32_t *termStarts_;
+    const uint32_t *postingStarts_;
+    const DocId *docs_;
+    std::size_t termCount_;
+
+    void *mapping_;
+    std::size_t mappingSize_;
+    mutable std::atomic<uint64_t> lastUsed_;
+};
+
+#endif // SEARCH_SEGMENT_H
@@ -0,0 +1,166 @@
+//!
+//! @file sharded_library.hpp
+//! @brief Definition of the hash-partitioned, shard-per-core LibrarySystem
+//!
+
+#ifndef SHARDED_LIBRARY_H
+#define SHARDED_LIBRARY_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "library_system/isbn.hpp"
+#include "library_system/library_system.hpp"
+#include "library_system/spsc_ring.hpp"
+
+/**
+ * @brief Catalog partitioned by ISBN hash over shards that each own one thread.
+ *
+ * Every shard is a LibrarySystem constructed and only ever touched by its
+ * worker thread, which is pinned to a core, so its memory is allocated
+ * node-local and no catalog state is shared between shards. The worker
+ * also runs the shard's segment merges whenever its rings are empty, so no
+ * unpinned maintenance thread competes with the shards. Callers hand
+ * requests to a shard through one of its single-producer rings: every
+ * caller thread has a ring of its own in each shard, leased with one flag
+ * no other thread touches, so callers only meet when there are more of them
+ * than rings. Mutations go to the owning shard, searches are scattered to
+ * all shards and their ranked top-k lists merged. Interned strings (StringPool::global()) are the one
+ * structure still shared by all shards.
+ */
+class ShardedLibrary
+{
+public:
+    /**
+     * @brief Constructor to start the shard threads.
+     * @param shardCount The number of shards, at least 1; typically one per core.
+     * @param pinThreads Whether to pin shard i to core i modulo the core count.
+     */
+    explicit ShardedLibrary(std::size_t shardCount, bool pinThreads = true);
+
+    /**
+     * @brief Destructor completing queued requests, then stopping the shard threads.
+     */
+    ~ShardedLibrary();
+
+    /**
+     * @brief Add a book to the shard owning its ISBN.
+     * @param title The title of the book.
+     * @param author The author of the book.
+     * @param isbn The ISBN of the book.
+     * @return The result of LibrarySystem::addBook(); false for invalid ISBNs.
+     */
+    bool addBook(const std::string &title, const std::string &author, const std::string &isbn);
+
+    /**
+     * @brief Borrow a book from the shard owning its ISBN.
+     * @param isbn The ISBN of the book to borrow.
+     * @param userId The ID of the user borrowing the book.
+     * @return The result of LibrarySystem::borrowBook(); false for invalid ISBNs.
+     */
+    bool borrowBook(const std::string &isbn, int userId);
+
+    /**
+     * @brief Return a book to the shard owning its ISBN.
+     * @param isbn The ISBN of the book to return.
+     * @param userId The ID of the user returning the book.
+     * @return The result of LibrarySystem::returnBook(); false for invalid ISBNs.
+     */
+    bool returnBook(const std::string &isbn, int userId);
+
+    /**
+     * @brief Search all shards and merge their ranked results.
+     * @param keyword The keyword to search for in book titles and authors.
+     * @param k The maximum number of results.
+     * @return Up to k matching books, ordered by LibrarySystem::ranksBefore().
+     */
+    std::vector<LibrarySystem::SearchHit> searchBooks(const std::string &keyword, std::size_t k);
+
+    /**
+     * @brief Get the number of shards.
+     * @return The number of shards.
+     */
+    std::size_t shardCount() const;
+
+    /**
+     * @brief Get the shard owning an ISBN.
+     * @param key The parsed ISBN key.
+     * @return The shard index.
+     */
+    std::size_t shardOf(IsbnKey key) const;
+
+private:
+    enum Operation
+    {
+        OP_ADD,
+        OP_BORROW,
+        OP_RETURN,
+        OP_SEARCH
+    };
+
+    struct Completion
+    {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t remaining;
+    };
+
+    struct Request
+    {
+        Operation operation;
+        std::string title;  ///< Title, or the keyword of a search.
+        std::string author;
+        std::string isbn;
+        int userId;
+        std::size_t k;
+        bool result;
+        std::vector<LibrarySystem::SearchHit> hits;
+        Completion *completion;
+    };
+
+    struct Producer
+    {
+        Producer();
+
+        std::atomic<bool> claimed; ///< Set while a caller pushes, making it the ring's single producer.
+        SpscRing<Request *> ring;
+    };
+
+    struct Shard
+    {
+        Shard();
+
+        std::vector<std::unique_ptr<Producer> > producers; ///< kProducerRings rings.
+        std::size_t nextRing;     ///< Where the worker looks first, for fairness.
+        std::mutex sleepMutex;
+        std::condition_variable wakeup;
+        std::atomic<bool> sleeping;
+        std::thread worker;
+    };
+
+    ShardedLibrary(const ShardedLibrary &);
+    ShardedLibrary &operator=(const ShardedLibrary &);
+
+    bool route(Request &request);
+    void submit(std::size_t shard, Request *request);
+    static bool pop(Shard &shard, Request *&request);
+    static bool pending(const Shard &shard);
+    static void wait(Completion &completion);
+    void run(std::size_t index, bool pin);
+    static void apply(LibrarySystem &library, Request &request);
+
+    static const std::size_t kRingCapacity;
+    static const std::size_t kProducerRings;
+    static const unsigned kSpinsBeforeSleep;
+
+    std::vector<Shard *> shards_;
+    std::atomic<bool> stopping_;
+};
+
+#endif // SHARDED_LIBRARY_H
@@ -0,0 +1,157 @@
+//!
+//! @file shared_memory_lookup.hpp
+//! @brief Definition of the shared-memory transport for same-host catalog lookups
+//!
+
+#ifndef SHARED_MEMORY_LOOKUP_H
+#define SHARED_MEMORY_LOOKUP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "library_system/library_system.hpp"
+
+/**
+ * @brief Server answering searches and ISBN lookups of same-host clients through shared memory.
+ *
+ * A Unix domain socket is only used to set a client up: the server
+ * creates a memfd region holding a request ring and a response ring,
+ * passes its descriptor over the socket, and from then on both sides
+ * exchange messages through the rings. Each ring is a single-producer,
+ * single-consumer byte stream, so messages of any size pass through it in
+ * pieces.
+ *
+ * A side waiting for data or space spins for a while, then sleeps on a
+ * futex in the region. The other side only enters the kernel to wake it
+ * when it is asleep, so under load a lookup makes no system call at all.
+ * Each client gets a worker thread on the server; the client's socket is
+ * kept open so that either side notices when the other goes away.
+ *
+ * Messages are in host byte order since both ends share a machine:
+ * requests are u32 operation, u32 payload size, payload; responses are
+ * u32 status, then the operation's results (see the client methods).
+ */
+class SharedMemoryLookupServer
+{
+public:
+    /**
+     * @brief Default size in bytes of each ring of a client region.
+     */
+    static const std::size_t kDefaultRingBytes = 64 * 1024;
+
+    /**
+     * @brief Constructor to start accepting clients.
+     * @param library The catalog to serve, which must outlive this object.
+     * @param socketPath The path of the Unix domain socket; an existing file is replaced.
+     * @param ringBytes The size of each ring, rounded up to a power of two of at least 4096.
+     */
+    SharedMemoryLookupServer(LibrarySystem &library, const std::string &socketPath,
+                             std::size_t ringBytes = kDefaultRingBytes);
+
+    /**
+     * @brief Destructor disconnecting all clients and removing the socket file.
+     */
+    ~SharedMemoryLookupServer();
+
+    /**
+     * @brief Check whether the socket could be created.
+     * @return True if clients can connect.
+     */
+    bool listening() const;
+
+    /**
+     * @brief Get the number of connected clients.
+     * @return The number of clients.
+     */
+    std::size_t clientCount() const;
+
+private:
+    struct Client
+    {
+        int fd;
+        std::atomic<bool> connected;
+        std::thread worker;
+    };
+
+    SharedMemoryLookupServer(const SharedMemoryLookupServer &);
+    SharedMemoryLookupServer &operator=(const SharedMemoryLookupServer &);
+
+    void accept();
+    void serve(Client *client);
+
+    LibrarySystem &library_;
+    std::string socketPath_;
+    std::size_t ringBytes_;
+    int listenFd_;
+    std::atomic<bool> stopping_;
+
+    mutable std::mutex clientsMutex_; ///< Guards clients_.
+    std::vector<std::unique_ptr<Client> > clients_;
+    std::thread acceptor_;
+};
+
+/**
+ * @brief Client of a SharedMemoryLookupServer on the same host.
+ *
+ * Calls from several threads are serialized on one pair of rings; threads
+ * that look up a lot should each have their own client.
+ */
+class SharedMemoryLookupClient
+{
+public:
+    /**
+     * @brief Constructor to connect to a server and map its region.
+     * @param socketPath The path of the server's Unix domain socket.
+     */
+    explicit SharedMemoryLookupClient(const std::string &socketPath);
+
+    /**
+     * @brief Destructor unmapping the region and disconnecting.
+     */
+    ~SharedMemoryLookupClient();
+
+    /**
+     * @brief Check whether the client is connected to its server.
+     * @return False if connecting failed or the server went away.
+     */
+    bool connected() const;
+
+    /**
+     * @brief Search the served catalog, see LibrarySystem::searchBooks().
+     * @param keyword The keyword to search for in book titles and authors.
+     * @return The matching titles; empty if there are none or the server is gone.
+     */
+    std::vector<std::string> searchBooks(const std::string &keyword);
+
+    /**
+     * @brief Look a book up by ISBN, see LibrarySystem::findBook().
+     * @param isbn The ISBN-10 or ISBN-13 of the book.
+     * @param book Receives the title and loan count of the book.
+     * @return True if the book is in the catalog, false if not or the server is gone.
+     */
+    bool findBook(const std::string &isbn, LibrarySystem::SearchHit &book);
+
+private:
+    SharedMemoryLookupClient(const SharedMemoryLookupClient &);
+    SharedMemoryLookupClient &operator=(const SharedMemoryLookupClient &);
+
+    bool send(uint32_t operation, const std::string &payload);
+    bool receive(void *data, std::size_t size);
+    bool receive(std::string &text);
+    bool alive() const;
+
+    int fd_;
+    void *region_;
+    std::size_t regionBytes_;
+    std::size_t ringBytes_;
+    std::atomic<bool> connected_;
+    std::mutex callMutex_; ///< Serializes calls on the rings.
+};
+
+#endif // SHARED_MEMORY_LOOKUP_H
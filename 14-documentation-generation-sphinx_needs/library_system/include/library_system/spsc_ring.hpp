@@ -0,0 +1,110 @@
+//!
+//! @file spsc_ring.hpp
+//! @brief Definition of the single-producer, single-consumer ring buffer
+//!
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free queue between exactly one producer and one consumer thread.
+ *
+ * The capacity is rounded up to a power of two. Head and tail live on
+ * separate cache lines, and each side caches the other side's index so that
+ * it only touches the shared line when the ring looks full or empty.
+ * @tparam T The element type; must be default-constructible and copyable.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+    /**
+     * @brief Constructor to allocate the ring.
+     * @param capacity The minimum number of elements the ring can hold.
+     */
+    explicit SpscRing(std::size_t capacity)
+        : head_(0), cachedTail_(0), tail_(0), cachedHead_(0)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    /**
+     * @brief Append an element; producer thread only.
+     * @param value The element.
+     * @return False if the ring is full.
+     */
+    bool push(const T &value)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ > mask_)
+        {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ > mask_)
+            {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest element; consumer thread only.
+     * @param value Receives the element.
+     * @return False if the ring is empty.
+     */
+    bool pop(T &value)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_)
+        {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_)
+            {
+                return false;
+            }
+        }
+        value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Check whether the ring is empty; exact only on the consumer thread.
+     * @return True if no element is queued.
+     */
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static const std::size_t kCacheLine = 64;
+
+    SpscRing(const SpscRing &);
+    SpscRing &operator=(const SpscRing &);
+
+    std::vector<T> slots_;
+    std::size_t mask_;
+    // Padding instead of alignas: over-aligned new needs C++17.
+    char padding0_[kCacheLine];
+    std::atomic<std::size_t> head_; // Consumer-owned.
+    std::size_t cachedTail_;
+    char padding1_[kCacheLine];
+    std::atomic<std::size_t> tail_; // Producer-owned.
+    std::size_t cachedHead_;
+    char padding2_[kCacheLine];
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,143 @@
+//!
+//! @file string_pool.hpp
+//! @brief Definition of the StringPool concurrent string interning arena
+//!
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Concurrent interning pool for low-cardinality strings.
+ *
+ * Every distinct string is stored once, in arena blocks owned by the pool,
+ * and identified by a dense 32-bit id. Equal strings always get the same id,
+ * so comparing interned strings is an integer comparison. Interned bytes
+ * never move or die before the pool, so views stay valid for its lifetime.
+ * The pool is split into independently locked shards; reading an id's text
+ * takes no lock.
+ */
+class StringPool
+{
+public:
+    /**
+     * @brief Identifier of an interned string.
+     */
+    typedef uint32_t Id;
+
+    /**
+     * @brief Non-owning view of an interned string.
+     */
+    struct View
+    {
+        const char *data; ///< First character, not null-terminated.
+        uint32_t size;    ///< Number of characters.
+
+        /**
+         * @brief Copy the viewed characters into a string.
+         * @return The string.
+         */
+        std::string str() const;
+    };
+
+    /**
+     * @brief Get the process-wide pool shared by catalogs and requirements.
+     * @return The global pool.
+     */
+    static StringPool &global();
+
+    /**
+     * @brief Constructor to initialize an empty pool.
+     */
+    StringPool();
+
+    /**
+     * @brief Destructor releasing the arena.
+     */
+    ~StringPool();
+
+    /**
+     * @brief Intern a string.
+     * @param text The string to intern.
+     * @return The id of the string, the same for every equal string.
+     */
+    Id intern(const std::string &text);
+
+    /**
+     * @brief Look up a string without interning it.
+     * @param text The string to look for.
+     * @param id Receives the id if the string is interned.
+     * @return True if the string is interned.
+     */
+    bool find(const std::string &text, Id &id) const;
+
+    /**
+     * @brief Get a view of an interned string.
+     * @param id The id returned by intern().
+     * @return The view, valid for the lifetime of the pool.
+     */
+    View view(Id id) const;
+
+    /**
+     * @brief Copy an interned string.
+     * @param id The id returned by intern().
+     * @return The string.
+     */
+    std::string str(Id id) const;
+
+    /**
+     * @brief Get the number of distinct interned strings.
+     * @return The number of ids handed out.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Get the number of heap bytes held by the pool.
+     * @return The approximate memory footprint in bytes.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    StringPool(const StringPool &);
+    StringPool &operator=(const StringPool &);
+
+    struct Entry
+    {
+        const char *data;
+        uint32_t size;
+        uint32_t hash;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::vector<Id> slots; ///< Open-addressing table of ids, kEmptySlot if unused.
+        std::size_t used;
+        std::vector<std::unique_ptr<char[]> > blocks;
+        std::size_t blockUsed;
+        std::size_t arenaBytes;
+    };
+
+    static const std::size_t kShardCount = 16;
+    static const std::size_t kEntriesPerChunk = 4096;
+    static const std::size_t kMaxChunks = 1 << 14;
+
+    const Entry &entry(Id id) const;
+    const char *store(Shard &shard, const std::string &text);
+    bool probe(const Shard &shard, const std::string &text, uint32_t hash, std::size_t &slot) const;
+    void grow(Shard &shard);
+
+    Shard shards_[kShardCount];
+    std::atomic<uint32_t> nextId_;
+    std::mutex chunksMutex_;
+    std::atomic<Entry *> *chunks_; ///< Lazily allocated chunks of kEntriesPerChunk entries.
+};
+
+#endif // STRING_POOL_H
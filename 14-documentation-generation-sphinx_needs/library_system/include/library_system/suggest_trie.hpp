@@ -0,0 +1,134 @@
+//!
+//! @file suggest_trie.hpp
+//! @brief Definition of the SuggestTrie prefix completion index
+//!
+
+#ifndef SUGGEST_TRIE_H
+#define SUGGEST_TRIE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Immutable, path-compressed trie answering top-k prefix completions.
+ *
+ * The trie is built once from a set of normalized keys and stored in flat
+ * arrays: nodes, edges (sorted by their first label character) and a shared
+ * label pool. Every node carries the precomputed top-k entries of its subtree
+ * ordered by popularity, so a lookup is a walk along the prefix followed by a
+ * copy of at most kMaxSuggestions strings. Popularity can be raised in place:
+ * only the top-k lists along the entry's path are updated.
+ */
+class SuggestTrie
+{
+public:
+    /**
+     * @brief Maximum number of suggestions precomputed per node.
+     */
+    static const std::size_t kMaxSuggestions = 8;
+
+    /**
+     * @brief Input record of the trie.
+     */
+    struct Entry
+    {
+        std::string key;     ///< Normalized key the prefix is matched against.
+        std::string text;    ///< Display text returned as a suggestion.
+        uint32_t popularity; ///< Ranking weight, higher ranks first.
+    };
+
+    /**
+     * @brief Constructor to initialize an empty trie.
+     */
+    SuggestTrie();
+
+    /**
+     * @brief Rebuild the trie from a set of entries.
+     *
+     * Entries with the same key are merged: their popularity is summed and
+     * the display text of the first one is kept.
+     *
+     * @param entries The entries to index.
+     */
+    void build(std::vector<Entry> entries);
+
+    /**
+     * @brief Get the most popular completions of a normalized prefix.
+     * @param prefix The normalized prefix.
+     * @param k The maximum number of suggestions, capped at kMaxSuggestions.
+     * @return Display texts of the matching entries, most popular first.
+     */
+    std::vector<std::string> suggest(const std::string &prefix, std::size_t k) const;
+
+    /**
+     * @brief Get the most popular entries completing a normalized prefix.
+     * @param prefix The normalized prefix.
+     * @param k The maximum number of entries, capped at kMaxSuggestions.
+     * @return The matching entries with their display text and popularity, most
+     *         popular first; keys are left empty.
+     */
+    std::vector<Entry> top(const std::string &prefix, std::size_t k) const;
+
+    /**
+     * @brief Look an entry up by its exact key.
+     * @param key The normalized key.
+     * @param entry Receives the display text and popularity of the entry.
+     * @return True if the key is in the trie.
+     */
+    bool find(const std::string &key, Entry &entry) const;
+
+    /**
+     * @brief Raise the popularity of an entry and reorder the top-k lists on its path.
+     * @param key The normalized key of the entry.
+     * @param delta The popularity to add.
+     * @return True if the key is in the trie.
+     */
+    bool addPopularity(const std::string &key, uint32_t delta);
+
+    /**
+     * @brief Get the number of nodes in the trie.
+     * @return The number of nodes.
+     */
+    std::size_t nodeCount() const;
+
+    /**
+     * @brief Get the number of heap bytes held by the trie arrays.
+     * @return The approximate memory footprint in bytes.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    static const uint32_t kNoEntry = ~static_cast<uint32_t>(0);
+
+    struct Node
+    {
+        uint32_t firstEdge; ///< Index of the first outgoing edge.
+        uint32_t edgeCount; ///< Number of outgoing edges.
+        uint32_t firstTop;  ///< Index of the first top-k entry in topEntries_.
+        uint32_t topCount;  ///< Number of top-k entries.
+        uint32_t entry;     ///< Entry whose key ends at this node, or kNoEntry.
+    };
+
+    struct Edge
+    {
+        uint32_t labelOffset; ///< Offset of the edge label in labels_.
+        uint32_t labelLength; ///< Length of the edge label.
+        uint32_t target;      ///< Index of the child node.
+    };
+
+    uint32_t buildNode(std::size_t begin, std::size_t end, std::size_t depth);
+    bool walk(const std::string &prefix, uint32_t &node, bool &exact, std::vector<uint32_t> *path) const;
+    bool betterEntry(uint32_t lhs, uint32_t rhs) const;
+
+    std::vector<Node> nodes_;
+    std::vector<Edge> edges_;
+    std::string labels_;
+    std::vector<uint32_t> topEntries_;
+    std::vector<std::string> keys_;
+    std::vector<std::string> texts_;
+    std::vector<uint32_t> popularity_;
+};
+
+#endif // SUGGEST_TRIE_H
@@ -0,0 +1,61 @@
+//!
+//! @file text_tokenizer.hpp
+//! @brief Text normalization shared by the library indexes
+//!
+
+#ifndef TEXT_TOKENIZER_H
+#define TEXT_TOKENIZER_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Enum selecting the implementation of normalizeText().
+ */
+enum TextKernel
+{
+    TEXT_KERNEL_SCALAR, ///< One character at a time; handles all input.
+    TEXT_KERNEL_SSE2,   ///< 16 ASCII bytes at a time, scalar for other UTF-8.
+    TEXT_KERNEL_AVX2    ///< 32 ASCII bytes at a time, scalar for other UTF-8.
+};
+
+/**
+ * @brief Get the fastest kernel the running CPU supports.
+ * @return The kernel normalizeText() uses by default.
+ */
+TextKernel bestTextKernel();
+
+/**
+ * @brief Normalize free text for indexing and lookups.
+ *
+ * Letters are folded to lower case, every other character that is not a
+ * digit becomes a separator, runs of separators collapse into a single
+ * space and leading/trailing separators are dropped.
+ *
+ * Beyond ASCII, UTF-8 upper case letters of the Latin-1, Latin Extended-A,
+ * Greek and Cyrillic blocks are folded, and Latin-1 punctuation and symbols,
+ * general punctuation (dashes, typographic quotes, special spaces) and the
+ * ideographic space are separators. Other characters and invalid UTF-8
+ * bytes are kept unchanged, so the result is never longer than the input.
+ *
+ * @param text The text to normalize.
+ * @return The normalized text.
+ */
+std::string normalizeText(const std::string &text);
+
+/**
+ * @brief Normalize free text with a given kernel, e.g. to compare kernels.
+ * @param text The text to normalize.
+ * @param kernel The kernel; kernels the CPU lacks fall back to bestTextKernel().
+ * @return The normalized text, identical for every kernel.
+ */
+std::string normalizeText(const std::string &text, TextKernel kernel);
+
+/**
+ * @brief Split free text into normalized tokens.
+ * @param text The text to tokenize.
+ * @return The tokens of the normalized text, in order of appearance.
+ */
+std::vector<std::string> tokenizeText(const std::string &text);
+
+#endif // TEXT_TOKENIZER_H
@@ -0,0 +1,142 @@
+//!
+//! @file traceability_graph.hpp
+//! @brief Definition of the TraceabilityGraph requirement-to-test link graph
+//!
+
+#ifndef TRACEABILITY_GRAPH_H
+#define TRACEABILITY_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "library_system/string_pool.hpp"
+
+/**
+ * @brief Enum representing the kind of a traceability node.
+ */
+enum TraceKind
+{
+    TRACE_REQUIREMENT,   ///< A requirement.
+    TRACE_SPECIFICATION, ///< A specification refining requirements.
+    TRACE_TEST_CASE      ///< A test case verifying requirements or specifications.
+};
+
+/**
+ * @brief Link graph between requirements, specifications and test cases.
+ *
+ * Links point from the traced item to the item tracing it (requirement to
+ * specification, specification or requirement to test case). After build()
+ * the links are stored as compressed sparse row arrays in both directions,
+ * and transitive queries run level by level over bitsets of node ids, so a
+ * query touches each node and link at most once. Nodes added after the last
+ * build() take part in queries but have no links yet.
+ */
+class TraceabilityGraph
+{
+public:
+    /**
+     * @brief Dense identifier of a node.
+     */
+    typedef uint32_t NodeId;
+
+    /**
+     * @brief Add a node, or find it if its key is already present.
+     * @param kind The kind of the node.
+     * @param key The need id, e.g. "REQ_001".
+     * @return The id of the node.
+     */
+    NodeId addNode(TraceKind kind, const std::string &key);
+
+    /**
+     * @brief Link a traced node to a node tracing it; takes effect on the next build().
+     *
+     * Links to or from ids that were not returned by addNode() are ignored.
+     *
+     * @param from The traced node, e.g. a requirement.
+     * @param to The tracing node, e.g. a test case.
+     */
+    void addLink(NodeId from, NodeId to);
+
+    /**
+     * @brief Rebuild the adjacency arrays from all links added so far.
+     */
+    void build();
+
+    /**
+     * @brief Look up a node by key.
+     * @param key The need id.
+     * @param node Receives the node id if present.
+     * @return True if the node exists.
+     */
+    bool find(const std::string &key, NodeId &node) const;
+
+    /**
+     * @brief Get the number of nodes.
+     * @return The number of nodes.
+     */
+    std::size_t nodeCount() const;
+
+    /**
+     * @brief Get the number of distinct links in the built graph.
+     * @return The number of links.
+     */
+    std::size_t linkCount() const;
+
+    /**
+     * @brief Get the kind of a node.
+     * @param node The node.
+     * @return The kind of the node.
+     */
+    TraceKind kind(NodeId node) const;
+
+    /**
+     * @brief Get the key of a node.
+     * @param node The node.
+     * @return The need id of the node.
+     */
+    std::string key(NodeId node) const;
+
+    /**
+     * @brief Find the requirements not transitively verified by any test case.
+     * @return The uncovered requirement nodes in ascending order.
+     */
+    std::vector<NodeId> uncoveredRequirements() const;
+
+    /**
+     * @brief Find the requirements transitively verified by any of the given test cases.
+     * @param failingTests The test case nodes, e.g. those failing in the last run; unknown ids are skipped.
+     * @return The affected requirement nodes in ascending order.
+     */
+    std::vector<NodeId> affectedRequirements(const std::vector<NodeId> &failingTests) const;
+
+    /**
+     * @brief Find the test cases transitively verifying a node.
+     * @param node The requirement or specification.
+     * @return The test case nodes in ascending order; empty if the node does not exist.
+     */
+    std::vector<NodeId> verifyingTests(NodeId node) const;
+
+private:
+    typedef std::vector<uint64_t> Bitset;
+
+    void reach(Bitset &frontier, const std::vector<uint32_t> &offsets, const std::vector<NodeId> &targets,
+               Bitset &visited) const;
+    std::vector<NodeId> select(const Bitset &nodes, TraceKind kind, bool complement) const;
+
+    std::vector<uint8_t> kinds_;
+    Bitset kindMasks_[TRACE_TEST_CASE + 1]; ///< Nodes of each kind.
+    std::vector<StringPool::Id> keys_;
+    std::unordered_map<StringPool::Id, NodeId> nodesByKey_;
+    std::vector<std::pair<NodeId, NodeId> > links_; ///< Links added since construction.
+
+    std::vector<uint32_t> forwardOffsets_; ///< Node i links to forwardTargets_[forwardOffsets_[i], forwardOffsets_[i + 1]).
+    std::vector<NodeId> forwardTargets_;
+    std::vector<uint32_t> reverseOffsets_; ///< Node i is linked from reverseTargets_[reverseOffsets_[i], ...).
+    std::vector<NodeId> reverseTargets_;
+};
+
+#endif // TRACEABILITY_GRAPH_H
@@ -0,0 +1,146 @@
+//!
+//! @file blocked_bloom_filter.cpp
+//! @brief Implementation of the BlockedBloomFilter cache-line blocked membership filter
+//!
+
+#include "library_system/blocked_bloom_filter.hpp"
+
+#include "library_system/isbn.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// ThreadSanitizer cannot tell that the vector loads only race with atomic
+// bit-setting, so sanitized builds probe with atomic scalar loads.
+#if defined(__SSE2__) && defined(__GNUC__) && !defined(__SANITIZE_THREAD__)
+#include <immintrin.h>
+#define BLOOM_FILTER_AVX2 1
+#endif
+
+namespace {
+
+const std::size_t kWordsPerBlock = 8;
+
+// Odd multipliers deriving one bit position per word from the low half of the hash.
+const uint32_t kSalts[kWordsPerBlock] = {0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+                                         0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u};
+
+uint64_t bitMask(uint64_t hash, std::size_t word) {
+    return uint64_t(1) << ((static_cast<uint32_t>(hash) * kSalts[word]) >> 26);
+}
+
+#if defined(BLOOM_FILTER_AVX2)
+__attribute__((target("avx2"))) bool probeAvx2(const uint64_t* block, uint64_t hash) {
+    const __m256i salts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kSalts));
+    const __m256i bits =
+        _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(hash)), salts), 26);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i lowMasks = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+    const __m256i highMasks = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+    const __m256i* words = reinterpret_cast<const __m256i*>(block);
+    return _mm256_testc_si256(_mm256_load_si256(words), lowMasks) &&
+           _mm256_testc_si256(_mm256_load_si256(words + 1), highMasks);
+}
+#endif
+
+} // namespace
+
+const std::size_t BlockedBloomFilter::kBlockBytes;
+
+BloomProbe bestBloomProbe() {
+#if defined(BLOOM_FILTER_AVX2)
+    static const BloomProbe best = (__builtin_cpu_init(), __builtin_cpu_supports("avx2")) ? BLOOM_PROBE_AVX2
+                                                                                          : BLOOM_PROBE_SCALAR;
+    return best;
+#else
+    return BLOOM_PROBE_SCALAR;
+#endif
+}
+
+BlockedBloomFilter::BlockedBloomFilter(std::size_t capacity, double falsePositiveRate)
+    : capacity_(std::max<std::size_t>(capacity, 1)),
+      falsePositiveRate_(std::min(std::max(falsePositiveRate, 1e-9), 0.5)),
+      blockCount_(1),
+      words_(0) {
+    // The rate grows with the keys per block: bisect for the highest load meeting the target.
+    double low = 1e-3;
+    double high = 512;
+    for (int i = 0; i < 50; ++i) {
+        const double middle = (low + high) / 2;
+        if (expectedFalsePositiveRate(middle) <= falsePositiveRate_) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    blockCount_ = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(capacity_ / low)));
+
+    const std::size_t words = blockCount_ * kWordsPerBlock;
+    storage_.reset(new uint64_t[words + kWordsPerBlock - 1]());
+    const uintptr_t address = reinterpret_cast<uintptr_t>(storage_.get());
+    words_ = storage_.get() + ((kBlockBytes - address % kBlockBytes) % kBlockBytes) / sizeof(uint64_t);
+}
+
+void BlockedBloomFilter::add(uint64_t key) {
+    const uint64_t hash = mixIsbnKey(key);
+    uint64_t* words = const_cast<uint64_t*>(block(hash));
+    for (std::size_t w = 0; w < kWordsPerBlock; ++w) {
+        const uint64_t mask = bitMask(hash, w);
+        if ((__atomic_load_n(&words[w], __ATOMIC_RELAXED) & mask) == 0) {
+            __atomic_fetch_or(&words[w], mask, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+bool BlockedBloomFilter::mayContain(uint64_t key) const {
+    return mayContain(key, bestBloomProbe());
+}
+
+bool BlockedBloomFilter::mayContain(uint64_t key, BloomProbe probe) const {
+    const uint64_t hash = mixIsbnKey(key);
+    const uint64_t* words = block(hash);
+#if defined(BLOOM_FILTER_AVX2)
+    if (probe == BLOOM_PROBE_AVX2 && bestBloomProbe() == BLOOM_PROBE_AVX2) {
+        return probeAvx2(words, hash);
+    }
+#else
+    (void)probe;
+#endif
+    for (std::size_t w = 0; w < kWordsPerBlock; ++w) {
+        const uint64_t mask = bitMask(hash, w);
+        if ((__atomic_load_n(&words[w], __ATOMIC_RELAXED) & mask) != mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t BlockedBloomFilter::capacity() const {
+    return capacity_;
+}
+
+double BlockedBloomFilter::falsePositiveRate() const {
+    return falsePositiveRate_;
+}
+
+std::size_t BlockedBloomFilter::memoryUsage() const {
+    return sizeof(*this) + (blockCount_ * kWordsPerBlock + kWordsPerBlock - 1) * sizeof(uint64_t);
+}
+
+double BlockedBloomFilter::expectedFalsePositiveRate(double keysPerBlock) {
+    // Block loads are Poisson distributed; a block holding j keys has each
+    // word's probed bit set with probability 1 - (63/64)^j.
+    const std::size_t last = static_cast<std::size_t>(keysPerBlock + 12 * std::sqrt(keysPerBlock) + 30);
+    double probability = std::exp(-keysPerBlock);
+    double rate = 0;
+    for (std::size_t j = 0; j <= last; ++j) {
+        rate += probability * std::pow(1 - std::pow(63.0 / 64.0, static_cast<double>(j)), 8.0);
+        probability *= keysPerBlock / (j + 1);
+    }
+    return rate;
+}
+
+const uint64_t* BlockedBloomFilter::block(uint64_t hash) const {
+    // The high half of the hash picks the block, the low half the bits.
+    return words_ + ((hash >> 32) * blockCount_ >> 32) * kWordsPerBlock;
+}
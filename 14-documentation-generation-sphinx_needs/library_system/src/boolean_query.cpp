@@ -0,0 +1,535 @@
+//!
+//! @file boolean_query.cpp
+//! @brief Implementation of the BooleanQuery parser and posting-list plan
+//!
+
+#include "library_system/boolean_query.hpp"
+
+#include "library_system/text_tokenizer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+namespace {
+
+typedef SearchSegment::DocId DocId;
+
+const DocId kEnd = std::numeric_limits<DocId>::max();
+
+std::string describeCost(std::size_t cost) {
+    return "[" + std::to_string(cost) + "]";
+}
+
+} // namespace
+
+/**
+ * @brief Recursive descent parser producing the query tree.
+ */
+class BooleanQuery::Parser {
+public:
+    explicit Parser(const std::string& text)
+        : position_(0) {
+        // Parentheses are tokens of their own; everything else splits on white
+        // space outside double quotes. Quotes stay in the word, where the
+        // tokenizer drops them, so a quoted "AND" is a term, not an operator.
+        std::string word;
+        bool quoted = false;
+        for (std::size_t i = 0; i <= text.size(); ++i) {
+            const char c = i < text.size() ? text[i] : ' ';
+            if (c == '"') {
+                quoted = !quoted;
+            }
+            if (i < text.size() && (quoted || c == '"')) {
+                word.push_back(c);
+            } else if (c == '(' || c == ')' || std::isspace(static_cast<unsigned char>(c))) {
+                if (!word.empty()) {
+                    tokens_.push_back(word);
+                    word.clear();
+                }
+                if (c == '(' || c == ')') {
+                    tokens_.push_back(std::string(1, c));
+                }
+            } else {
+                word.push_back(c);
+            }
+        }
+    }
+
+    bool parse(Node& root, std::string& error) {
+        if (tokens_.empty()) {
+            error = "empty query";
+            return false;
+        }
+        if (!parseOr(root) || !expectEnd() || !validate(root, false)) {
+            error = error_;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool parseOr(Node& node) {
+        return parseList(node, Node::OR);
+    }
+
+    bool parseAnd(Node& node) {
+        return parseList(node, Node::AND);
+    }
+
+    // Operands of one operator, flattening nested groups of the same operator.
+    bool parseList(Node& node, Node::Kind kind) {
+        std::vector<Node> operands(1);
+        if (!(kind == Node::OR ? parseAnd(operands[0]) : parseUnary(operands[0]))) {
+            return false;
+        }
+        for (;;) {
+            if (kind == Node::OR) {
+                if (!accept("OR")) {
+                    break;
+                }
+            } else if (atEnd() || peek(")") || peek("OR")) {
+                break;
+            } else {
+                accept("AND");
+            }
+            operands.push_back(Node());
+            if (!(kind == Node::OR ? parseAnd(operands.back()) : parseUnary(operands.back()))) {
+                return false;
+            }
+        }
+        if (operands.size() == 1) {
+            node = operands[0];
+            return true;
+        }
+        node.kind = kind;
+        node.negated = false;
+        node.children.clear();
+        for (std::size_t i = 0; i < operands.size(); ++i) {
+            if (operands[i].kind == kind && !operands[i].negated) {
+                node.children.insert(node.children.end(), operands[i].children.begin(), operands[i].children.end());
+            } else {
+                node.children.push_back(operands[i]);
+            }
+        }
+        return true;
+    }
+
+    bool parseUnary(Node& node) {
+        if (atEnd()) {
+            return fail("expected a term at the end of the query");
+        }
+        if (accept("NOT")) {
+            if (!parseUnary(node)) {
+                return false;
+            }
+            node.negated = !node.negated;
+            return true;
+        }
+        if (accept("(")) {
+            if (!parseOr(node)) {
+                return false;
+            }
+            return accept(")") || fail("missing ')'");
+        }
+        const std::string& word = tokens_[position_];
+        if (word == ")" || word == "AND" || word == "OR") {
+            return fail("unexpected '" + word + "'");
+        }
+        ++position_;
+
+        // "title:" and "author:" restrict a word to one field; other colons are text.
+        std::string field;
+        std::string text = word;
+        const std::string::size_type colon = word.find(':');
+        if (colon != std::string::npos && (word.compare(0, colon, "title") == 0 || word.compare(0, colon, "author") == 0)) {
+            field = word.substr(0, colon);
+            text = word.substr(colon + 1);
+        }
+        const std::vector<std::string> terms = tokenizeText(text);
+        if (terms.empty()) {
+            return fail("no searchable text in '" + word + "'");
+        }
+
+        Node term;
+        term.kind = Node::TERM;
+        term.negated = false;
+        node.kind = Node::AND;
+        node.negated = false;
+        node.children.clear();
+        for (std::size_t i = 0; i < terms.size(); ++i) {
+            term.term = field.empty() ? terms[i] : fieldTerm(field, terms[i]);
+            node.children.push_back(term);
+        }
+        if (node.children.size() == 1) {
+            node = term;
+        }
+        return true;
+    }
+
+    // NOT may only narrow a conjunction that has a positive operand.
+    bool validate(const Node& node, bool negationAllowed) {
+        if (node.negated && !negationAllowed) {
+            return fail("NOT must narrow another term, e.g. 'gatsby NOT tender'");
+        }
+        if (node.kind == Node::TERM) {
+            return true;
+        }
+        bool positive = false;
+        for (std::size_t i = 0; i < node.children.size(); ++i) {
+            if (!validate(node.children[i], node.kind == Node::AND)) {
+                return false;
+            }
+            positive = positive || !node.children[i].negated;
+        }
+        return positive || fail("NOT must narrow another term, e.g. 'gatsby NOT tender'");
+    }
+
+    bool expectEnd() {
+        return atEnd() || fail("unexpected '" + tokens_[position_] + "'");
+    }
+
+    bool atEnd() const {
+        return position_ == tokens_.size();
+    }
+
+    bool peek(const char* token) const {
+        return !atEnd() && tokens_[position_] == token;
+    }
+
+    bool accept(const char* token) {
+        if (!peek(token)) {
+            return false;
+        }
+        ++position_;
+        return true;
+    }
+
+    bool fail(const std::string& message) {
+        error_ = message;
+        return false;
+    }
+
+    std::vector<std::string> tokens_;
+    std::size_t position_;
+    std::string error_;
+};
+
+/**
+ * @brief Lazy iterator over the ascending documents matching a plan node.
+ */
+class BooleanQuery::Cursor {
+public:
+    virtual ~Cursor() {}
+
+    // The current document, kEnd once exhausted.
+    virtual DocId doc() const = 0;
+
+    // Move past the current document.
+    virtual void next() = 0;
+
+    // Move to the first document at or after target; never moves backwards.
+    virtual void advance(DocId target) = 0;
+
+    // Upper bound of the number of documents produced.
+    virtual std::size_t cost() const = 0;
+
+    virtual std::string describe() const = 0;
+};
+
+/**
+ * @brief Cursor over one posting list, skipping ahead by galloping search.
+ */
+class BooleanQuery::TermCursor : public BooleanQuery::Cursor {
+public:
+    TermCursor(const std::string& term, const DocId* list, std::size_t count)
+        : term_(term), list_(list), count_(count), position_(0) {}
+
+    DocId doc() const {
+        return position_ < count_ ? list_[position_] : kEnd;
+    }
+
+    void next() {
+        ++position_;
+    }
+
+    void advance(DocId target) {
+        if (position_ >= count_ || list_[position_] >= target) {
+            return;
+        }
+        // Probe 1, 2, 4, ... entries ahead, then binary search the last step.
+        std::size_t step = 1;
+        while (position_ + step < count_ && list_[position_ + step] < target) {
+            step *= 2;
+        }
+        const DocId* first = list_ + position_ + step / 2;
+        const DocId* last = list_ + std::min(count_, position_ + step);
+        position_ = std::lower_bound(first, last, target) - list_;
+    }
+
+    std::size_t cost() const {
+        return count_;
+    }
+
+    std::string describe() const {
+        return term_ + describeCost(count_);
+    }
+
+private:
+    std::string term_;
+    const DocId* list_;
+    std::size_t count_;
+    std::size_t position_;
+};
+
+/**
+ * @brief Intersection of required cursors minus excluded ones.
+ */
+class BooleanQuery::AndCursor : public BooleanQuery::Cursor {
+public:
+    AndCursor(std::vector<std::unique_ptr<Cursor> > required,
+              std::vector<std::unique_ptr<Cursor> > excluded)
+        : required_(std::move(required)), excluded_(std::move(excluded)) {
+        std::stable_sort(required_.begin(), required_.end(), cheaper);
+        std::stable_sort(excluded_.begin(), excluded_.end(), cheaper);
+        settle();
+    }
+
+    DocId doc() const {
+        return required_[0]->doc();
+    }
+
+    void next() {
+        required_[0]->next();
+        settle();
+    }
+
+    void advance(DocId target) {
+        required_[0]->advance(target);
+        settle();
+    }
+
+    std::size_t cost() const {
+        return required_[0]->cost();
+    }
+
+    std::string describe() const {
+        std::string text = "AND(";
+        for (std::size_t i = 0; i < required_.size(); ++i) {
+            text += (i == 0 ? "" : ", ") + required_[i]->describe();
+        }
+        for (std::size_t i = 0; i < excluded_.size(); ++i) {
+            text += ", NOT " + excluded_[i]->describe();
+        }
+        return text + ")" + describeCost(cost());
+    }
+
+private:
+    static bool cheaper(const std::unique_ptr<Cursor>& lhs, const std::unique_ptr<Cursor>& rhs) {
+        return lhs->cost() < rhs->cost();
+    }
+
+    // Leapfrog until all required cursors agree on a document no excluded cursor has.
+    void settle() {
+        for (;;) {
+            const DocId candidate = required_[0]->doc();
+            if (candidate == kEnd) {
+                return;
+            }
+            DocId ahead = candidate;
+            for (std::size_t i = 1; i < required_.size() && ahead == candidate; ++i) {
+                required_[i]->advance(candidate);
+                ahead = required_[i]->doc();
+            }
+            if (ahead != candidate) {
+                required_[0]->advance(ahead);
+                continue;
+            }
+            bool excluded = false;
+            for (std::size_t i = 0; i < excluded_.size() && !excluded; ++i) {
+                excluded_[i]->advance(candidate);
+                excluded = excluded_[i]->doc() == candidate;
+            }
+            if (!excluded) {
+                return;
+            }
+            required_[0]->next();
+        }
+    }
+
+    std::vector<std::unique_ptr<Cursor> > required_; ///< Cheapest first; drives the leapfrog.
+    std::vector<std::unique_ptr<Cursor> > excluded_;
+};
+
+/**
+ * @brief Union of cursors.
+ */
+class BooleanQuery::OrCursor : public BooleanQuery::Cursor {
+public:
+    explicit OrCursor(std::vector<std::unique_ptr<Cursor> > children)
+        : children_(std::move(children)), doc_(kEnd) {
+        update();
+    }
+
+    DocId doc() const {
+        return doc_;
+    }
+
+    void next() {
+        for (std::size_t i = 0; i < children_.size(); ++i) {
+            if (children_[i]->doc() == doc_) {
+                children_[i]->next();
+            }
+        }
+        update();
+    }
+
+    void advance(DocId target) {
+        if (doc_ >= target) {
+            return;
+        }
+        for (std::size_t i = 0; i < children_.size(); ++i) {
+            children_[i]->advance(target);
+        }
+        update();
+    }
+
+    std::size_t cost() const {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < children_.size(); ++i) {
+            total += children_[i]->cost();
+        }
+        return total;
+    }
+
+    std::string describe() const {
+        std::string text = "OR(";
+        for (std::size_t i = 0; i < children_.size(); ++i) {
+            text += (i == 0 ? "" : ", ") + children_[i]->describe();
+        }
+        return text + ")" + describeCost(cost());
+    }
+
+private:
+    void update() {
+        doc_ = kEnd;
+        for (std::size_t i = 0; i < children_.size(); ++i) {
+            doc_ = std::min(doc_, children_[i]->doc());
+        }
+    }
+
+    std::vector<std::unique_ptr<Cursor> > children_;
+    DocId doc_;
+};
+
+BooleanQuery::BooleanQuery(const std::string& text) {
+    root_.kind = Node::TERM;
+    root_.negated = false;
+    Parser(text).parse(root_, error_);
+}
+
+std::string BooleanQuery::fieldTerm(const std::string& field, const std::string& term) {
+    return field + ":" + term;
+}
+
+bool BooleanQuery::valid() const {
+    return error_.empty();
+}
+
+const std::string& BooleanQuery::error() const {
+    return error_;
+}
+
+std::string BooleanQuery::str() const {
+    return valid() ? str(root_) : std::string();
+}
+
+std::vector<std::string> BooleanQuery::terms() const {
+    std::vector<std::string> terms;
+    if (valid()) {
+        collectTerms(root_, terms);
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    return terms;
+}
+
+std::string BooleanQuery::explain(const SearchSegment& segment) const {
+    return valid() ? compile(root_, segment)->describe() : std::string();
+}
+
+void BooleanQuery::match(const SearchSegment& segment, std::vector<SearchSegment::DocId>& matches) const {
+    matches.clear();
+    if (!valid()) {
+        return;
+    }
+    std::unique_ptr<Cursor> plan = compile(root_, segment);
+    for (DocId doc = plan->doc(); doc != kEnd; doc = plan->doc()) {
+        matches.push_back(doc);
+        plan->next();
+    }
+}
+
+bool BooleanQuery::matches(const std::vector<std::string>& terms) const {
+    return valid() && matches(root_, terms);
+}
+
+std::unique_ptr<BooleanQuery::Cursor> BooleanQuery::compile(const Node& node, const SearchSegment& segment) {
+    if (node.kind == Node::TERM) {
+        std::size_t count = 0;
+        const DocId* list = segment.postings(node.term, count);
+        return std::unique_ptr<Cursor>(new TermCursor(node.term, list, count));
+    }
+
+    std::vector<std::unique_ptr<Cursor> > positive;
+    std::vector<std::unique_ptr<Cursor> > negative;
+    for (std::size_t i = 0; i < node.children.size(); ++i) {
+        std::unique_ptr<Cursor> child = compile(node.children[i], segment);
+        if (node.children[i].negated) {
+            negative.push_back(std::move(child));
+        } else {
+            positive.push_back(std::move(child));
+        }
+    }
+    if (node.kind == Node::AND) {
+        return std::unique_ptr<Cursor>(new AndCursor(std::move(positive), std::move(negative)));
+    }
+    return std::unique_ptr<Cursor>(new OrCursor(std::move(positive)));
+}
+
+bool BooleanQuery::matches(const Node& node, const std::vector<std::string>& terms) {
+    bool matched = false;
+    if (node.kind == Node::TERM) {
+        matched = std::binary_search(terms.begin(), terms.end(), node.term);
+    } else {
+        matched = node.kind == Node::AND;
+        for (std::size_t i = 0; i < node.children.size() && matched == (node.kind == Node::AND); ++i) {
+            matched = matches(node.children[i], terms);
+        }
+    }
+    return matched != node.negated;
+}
+
+void BooleanQuery::collectTerms(const Node& node, std::vector<std::string>& terms) {
+    if (node.kind == Node::TERM) {
+        terms.push_back(node.term);
+    }
+    for (std::size_t i = 0; i < node.children.size(); ++i) {
+        collectTerms(node.children[i], terms);
+    }
+}
+
+std::string BooleanQuery::str(const Node& node) {
+    std::string text = node.negated ? "NOT " : "";
+    if (node.kind == Node::TERM) {
+        return text + node.term;
+    }
+    text += "(";
+    for (std::size_t i = 0; i < node.children.size(); ++i) {
+        if (i != 0) {
+            text += node.kind == Node::AND ? " AND " : " OR ";
+        }
+        text += str(node.children[i]);
+    }
+    return text + ")";
+}
@@ -0,0 +1,391 @@
+//!
+//! @file compressed_text_store.cpp
+//! @brief Implementation of the CompressedTextStore shared-dictionary text store
+//!
+
+#include "library_system/compressed_text_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+// Compressed texts are a series of sequences: a varint literal count, the
+// literals, then, unless the text is complete, a varint (match length -
+// kMinMatch) and a varint distance. The distance counts back from the current
+// output position through the output and then into the end of the dictionary.
+const std::size_t kMinMatch = 4;
+const int kHashBits = 12;
+const std::size_t kMaxDictionary = 64 * 1024;
+
+// The trainer scores segments of kSegmentLength bytes, taken every
+// kSegmentStride bytes of the samples, by the k-mers of kKmerLength they cover.
+const std::size_t kKmerLength = 8;
+const std::size_t kSegmentLength = 64;
+const std::size_t kSegmentStride = 16;
+const std::size_t kMaxTrainingBytes = 1 << 20;
+
+// Replaced texts leave dead bytes behind; below this many, compacting them
+// away is not worth copying the store.
+const std::size_t kMinDeadBytes = 4096;
+
+uint32_t hash4(const char* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+uint64_t kmer(const char* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+std::size_t matchLength(const char* a, const char* b, std::size_t limit) {
+    std::size_t length = 0;
+    while (length < limit && a[length] == b[length]) {
+        ++length;
+    }
+    return length;
+}
+
+void putVarint(std::vector<char>& out, std::size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+std::size_t getVarint(const char*& in) {
+    std::size_t value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = static_cast<unsigned char>(*in++);
+        value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+/**
+ * @brief Candidate dictionary segment of a training sample.
+ */
+struct Segment
+{
+    uint64_t score;
+    uint32_t sample;
+    uint32_t offset;
+    uint32_t length;
+
+    bool operator<(const Segment& other) const {
+        return score < other.score;
+    }
+};
+
+uint64_t scoreSegment(const std::string& sample, const Segment& segment,
+                      const std::unordered_map<uint64_t, uint32_t>& frequency, uint32_t minFrequency) {
+    std::unordered_set<uint64_t> seen;
+    uint64_t score = 0;
+    for (std::size_t i = segment.offset; i + kKmerLength <= segment.offset + segment.length; ++i) {
+        const uint64_t key = kmer(sample.data() + i);
+        if (seen.insert(key).second) {
+            std::unordered_map<uint64_t, uint32_t>::const_iterator it = frequency.find(key);
+            // Rare k-mers (ids, numbers) never pay for their dictionary bytes.
+            if (it != frequency.end() && it->second >= minFrequency) {
+                score += it->second - 1;
+            }
+        }
+    }
+    return score;
+}
+
+} // namespace
+
+const std::size_t CompressedTextStore::kTrainingSamples;
+const std::size_t CompressedTextStore::kDictionaryCapacity;
+
+CompressedTextStore::CompressedTextStore(std::size_t dictionaryCapacity)
+    : dictionaryCapacity_(std::min(dictionaryCapacity, kMaxDictionary)), trained_(false), deadBytes_(0),
+      rawBytes_(0), tableGeneration_(0) {}
+
+void CompressedTextStore::train(const std::vector<std::string>& samples) {
+    // Count in how many samples each k-mer occurs.
+    std::unordered_map<uint64_t, uint32_t> frequency;
+    std::size_t used = 0;
+    std::size_t sampleCount = 0;
+    for (; sampleCount < samples.size() && used < kMaxTrainingBytes; ++sampleCount) {
+        const std::string& sample = samples[sampleCount];
+        used += sample.size();
+        std::unordered_set<uint64_t> seen;
+        for (std::size_t i = 0; i + kKmerLength <= sample.size(); ++i) {
+            const uint64_t key = kmer(sample.data() + i);
+            if (seen.insert(key).second) {
+                ++frequency[key];
+            }
+        }
+    }
+
+    const uint32_t minFrequency = static_cast<uint32_t>(std::max<std::size_t>(2, sampleCount / 64));
+    std::priority_queue<Segment> candidates;
+    for (std::size_t s = 0; s < sampleCount; ++s) {
+        const std::string& sample = samples[s];
+        for (std::size_t offset = 0; offset + kKmerLength <= sample.size(); offset += kSegmentStride) {
+            Segment segment = {0, static_cast<uint32_t>(s), static_cast<uint32_t>(offset),
+                               static_cast<uint32_t>(std::min(kSegmentLength, sample.size() - offset))};
+            segment.score = scoreSegment(sample, segment, frequency, minFrequency);
+            if (segment.score > 0) {
+                candidates.push(segment);
+            }
+        }
+    }
+
+    // Lazy greedy selection: scores only drop as k-mers get covered, so a
+    // popped segment whose refreshed score still beats the next one is best.
+    std::vector<Segment> chosen;
+    std::size_t dictionarySize = 0;
+    while (!candidates.empty() && dictionarySize < dictionaryCapacity_) {
+        Segment segment = candidates.top();
+        candidates.pop();
+        const std::string& sample = samples[segment.sample];
+        segment.score = scoreSegment(sample, segment, frequency, minFrequency);
+        if (segment.score == 0) {
+            continue;
+        }
+        if (!candidates.empty() && segment.score < candidates.top().score) {
+            candidates.push(segment);
+            continue;
+        }
+        segment.length = static_cast<uint32_t>(std::min<std::size_t>(segment.length, dictionaryCapacity_ - dictionarySize));
+        for (std::size_t i = segment.offset; i + kKmerLength <= segment.offset + segment.length; ++i) {
+            frequency.erase(kmer(sample.data() + i));
+        }
+        chosen.push_back(segment);
+        dictionarySize += segment.length;
+    }
+
+    std::vector<std::string> texts;
+    texts.reserve(slots_.size());
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        texts.push_back(str(static_cast<Id>(i)));
+    }
+
+    // The best segments go last, where match distances are shortest.
+    dictionary_.clear();
+    dictionary_.reserve(dictionarySize);
+    for (std::vector<Segment>::reverse_iterator it = chosen.rbegin(); it != chosen.rend(); ++it) {
+        dictionary_.append(samples[it->sample], it->offset, it->length);
+    }
+    indexDictionary();
+    trained_ = true;
+
+    data_.clear();
+    deadBytes_ = 0;
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        encode(texts[i], slots_[i]);
+    }
+    data_.shrink_to_fit();
+}
+
+CompressedTextStore::Id CompressedTextStore::append(const std::string& text) {
+    Slot slot;
+    encode(text, slot);
+    slots_.push_back(slot);
+    rawBytes_ += text.size();
+
+    if (!trained_ && slots_.size() == kTrainingSamples) {
+        std::vector<std::string> samples;
+        samples.reserve(slots_.size());
+        for (std::size_t i = 0; i < slots_.size(); ++i) {
+            samples.push_back(str(static_cast<Id>(i)));
+        }
+        train(samples);
+    }
+    return static_cast<Id>(slots_.size() - 1);
+}
+
+void CompressedTextStore::replace(Id id, const std::string& text) {
+    Slot& slot = slots_[id];
+    const Slot old = slot;
+    rawBytes_ -= old.textLength;
+    encode(text, slot);
+    rawBytes_ += text.size();
+
+    if (slot.size <= old.size) {
+        // The new encoding fits: move it over the old bytes and drop the tail.
+        std::copy(data_.begin() + slot.offset, data_.end(), data_.begin() + old.offset);
+        data_.resize(slot.offset);
+        slot.offset = old.offset;
+        deadBytes_ += old.size - slot.size;
+    } else {
+        deadBytes_ += old.size;
+    }
+    if (deadBytes_ >= kMinDeadBytes && 2 * deadBytes_ >= data_.size()) {
+        compact();
+    }
+}
+
+std::size_t CompressedTextStore::length(Id id) const {
+    return slots_[id].textLength;
+}
+
+std::size_t CompressedTextStore::read(Id id, char* buffer, std::size_t capacity) const {
+    const Slot& slot = slots_[id];
+    const std::size_t textLength = slot.textLength;
+    if (textLength > capacity) {
+        return textLength;
+    }
+    const char* in = data_.data() + slot.offset;
+    if (!trained_) {
+        std::memcpy(buffer, in, textLength);
+        return textLength;
+    }
+
+    const std::size_t dictionarySize = dictionary_.size();
+    std::size_t position = 0;
+    while (position < textLength) {
+        const std::size_t literals = getVarint(in);
+        std::memcpy(buffer + position, in, literals);
+        in += literals;
+        position += literals;
+        if (position == textLength) {
+            break;
+        }
+        const std::size_t length = getVarint(in) + kMinMatch;
+        const std::size_t distance = getVarint(in);
+        const std::size_t from = dictionarySize + position - distance;
+        if (distance <= position && distance >= length) {
+            std::memcpy(buffer + position, buffer + position - distance, length);
+        } else if (from + length <= dictionarySize) {
+            std::memcpy(buffer + position, dictionary_.data() + from, length);
+        } else {
+            // Byte-wise copy: the match overlaps the bytes it produces or
+            // runs from the end of the dictionary into the output.
+            for (std::size_t i = 0; i < length; ++i) {
+                const std::size_t source = from + i;
+                buffer[position + i] = source < dictionarySize ? dictionary_[source] : buffer[source - dictionarySize];
+            }
+        }
+        position += length;
+    }
+    return textLength;
+}
+
+std::string CompressedTextStore::str(Id id) const {
+    std::string text(slots_[id].textLength, '\0');
+    if (!text.empty()) {
+        read(id, &text[0], text.size());
+    }
+    return text;
+}
+
+std::size_t CompressedTextStore::size() const {
+    return slots_.size();
+}
+
+bool CompressedTextStore::trained() const {
+    return trained_;
+}
+
+std::size_t CompressedTextStore::rawBytes() const {
+    return rawBytes_;
+}
+
+std::size_t CompressedTextStore::memoryUsage() const {
+    return data_.capacity() + slots_.capacity() * sizeof(Slot) + dictionary_.capacity() +
+           dictionaryTable_.capacity() * sizeof(int32_t) + table_.capacity() * sizeof(MatchEntry);
+}
+
+void CompressedTextStore::encode(const std::string& text, Slot& slot) {
+    slot.offset = static_cast<uint32_t>(data_.size());
+    slot.textLength = static_cast<uint32_t>(text.size());
+    if (!trained_) {
+        data_.insert(data_.end(), text.begin(), text.end());
+        slot.size = static_cast<uint32_t>(text.size());
+        return;
+    }
+
+    const char* input = text.data();
+    const std::size_t inputSize = text.size();
+    const std::size_t dictionarySize = dictionary_.size();
+    // The match table is reused across texts: an entry only counts if it was
+    // written in this text's generation, so nothing needs clearing per text.
+    if (table_.empty() || ++tableGeneration_ == 0) {
+        const MatchEntry empty = {0, -1};
+        table_.assign(std::size_t(1) << kHashBits, empty);
+        tableGeneration_ = 1;
+    }
+    std::size_t anchor = 0;
+    std::size_t position = 0;
+    while (position + kMinMatch <= inputSize) {
+        const uint32_t hash = hash4(input + position);
+        const std::size_t limit = inputSize - position;
+        std::size_t bestLength = 0;
+        std::size_t bestDistance = 0;
+
+        const int32_t previous = table_[hash].generation == tableGeneration_ ? table_[hash].position : -1;
+        if (previous >= 0) {
+            const std::size_t length = matchLength(input + previous, input + position, limit);
+            if (length >= kMinMatch) {
+                bestLength = length;
+                bestDistance = position - previous;
+            }
+        }
+        const int32_t reference = dictionaryTable_.empty() ? -1 : dictionaryTable_[hash];
+        if (reference >= 0) {
+            const std::size_t length =
+                matchLength(dictionary_.data() + reference, input + position, std::min(limit, dictionarySize - reference));
+            if (length > bestLength && length >= kMinMatch) {
+                bestLength = length;
+                bestDistance = position + dictionarySize - reference;
+            }
+        }
+        const MatchEntry entry = {tableGeneration_, static_cast<int32_t>(position)};
+        table_[hash] = entry;
+
+        if (bestLength == 0) {
+            ++position;
+            continue;
+        }
+        putVarint(data_, position - anchor);
+        data_.insert(data_.end(), input + anchor, input + position);
+        putVarint(data_, bestLength - kMinMatch);
+        putVarint(data_, bestDistance);
+        for (std::size_t i = position + 1; i < position + bestLength && i + kMinMatch <= inputSize; ++i) {
+            const MatchEntry next = {tableGeneration_, static_cast<int32_t>(i)};
+            table_[hash4(input + i)] = next;
+        }
+        position += bestLength;
+        anchor = position;
+    }
+    if (anchor < inputSize) {
+        putVarint(data_, inputSize - anchor);
+        data_.insert(data_.end(), input + anchor, input + inputSize);
+    }
+    slot.size = static_cast<uint32_t>(data_.size() - slot.offset);
+}
+
+void CompressedTextStore::indexDictionary() {
+    dictionaryTable_.assign(std::size_t(1) << kHashBits, -1);
+    for (std::size_t i = 0; i + kMinMatch <= dictionary_.size(); ++i) {
+        dictionaryTable_[hash4(dictionary_.data() + i)] = static_cast<int32_t>(i);
+    }
+}
+
+void CompressedTextStore::compact() {
+    std::vector<char> data;
+    data.reserve(data_.size() - deadBytes_);
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        Slot& slot = slots_[i];
+        const std::vector<char>::const_iterator first = data_.begin() + slot.offset;
+        slot.offset = static_cast<uint32_t>(data.size());
+        data.insert(data.end(), first, first + slot.size);
+    }
+    data_.swap(data);
+    deadBytes_ = 0;
+}
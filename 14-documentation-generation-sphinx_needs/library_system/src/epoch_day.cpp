@@ -0,0 +1,76 @@
+//!
+//! @file epoch_day.cpp
+//! @brief Implementation of calendar date conversions
+//!
+
+#include "library_system/epoch_day.hpp"
+
+#include <cstdio>
+
+namespace {
+
+// Proleptic Gregorian calendar arithmetic on eras of 400 years, see
+// http://howardhinnant.github.io/date_algorithms.html
+int daysFromCivil(int year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int>(dayOfEra) - 719468;
+}
+
+bool isLeapYear(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+unsigned daysInMonth(int year, unsigned month) {
+    static const unsigned kDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return (month == 2 && isLeapYear(year)) ? 29 : kDays[month - 1];
+}
+
+bool parseDigits(const std::string& text, std::string::size_type begin, std::string::size_type count, int& value) {
+    value = 0;
+    for (std::string::size_type i = begin; i < begin + count; ++i) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+} // namespace
+
+int parseEpochDay(const std::string& date) {
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    if (date.size() != 10 || date[4] != '-' || date[7] != '-' || !parseDigits(date, 0, 4, year) ||
+        !parseDigits(date, 5, 2, month) || !parseDigits(date, 8, 2, day)) {
+        return kInvalidEpochDay;
+    }
+    if (month < 1 || month > 12 || day < 1 || static_cast<unsigned>(day) > daysInMonth(year, month)) {
+        return kInvalidEpochDay;
+    }
+    return daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day));
+}
+
+std::string formatEpochDay(int day) {
+    if (day == kInvalidEpochDay) {
+        return std::string();
+    }
+    const int shifted = day + 719468;
+    const int era = (shifted >= 0 ? shifted : shifted - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(shifted - era * 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+    const unsigned dayOfMonth = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    const unsigned month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    const int year = static_cast<int>(yearOfEra) + era * 400 + (month <= 2);
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", year, month, dayOfMonth);
+    return buffer;
+}
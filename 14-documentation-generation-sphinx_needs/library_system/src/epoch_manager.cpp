@@ -0,0 +1,110 @@
+//!
+//! @file epoch_manager.cpp
+//! @brief Implementation of the EpochManager epoch-based memory reclamation
+//!
+
+#include "library_system/epoch_manager.hpp"
+
+#include <functional>
+#include <thread>
+
+namespace {
+
+// Slot states besides a pinned epoch: free, and claimed by a reader that has
+// not published its epoch yet (it cannot hold any pointer at that point).
+const uint64_t kFreeSlot = 0;
+const uint64_t kClaimedSlot = ~static_cast<uint64_t>(0);
+
+} // namespace
+
+const std::size_t EpochManager::kMaxReaders;
+
+EpochManager::Guard::Guard(EpochManager& manager)
+    : manager_(manager), slot_(manager.pin()) {}
+
+EpochManager::Guard::~Guard() {
+    manager_.unpin(slot_);
+}
+
+EpochManager::EpochManager()
+    : globalEpoch_(1) {
+    for (std::size_t i = 0; i < kMaxReaders; ++i) {
+        slots_[i].store(kFreeSlot);
+    }
+}
+
+EpochManager::~EpochManager() {
+    for (std::size_t i = 0; i < retired_.size(); ++i) {
+        retired_[i].second();
+    }
+}
+
+std::size_t EpochManager::pin() {
+    // Start probing at a per-thread position to spread readers over slots.
+    std::size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % kMaxReaders;
+    for (;;) {
+        uint64_t expected = kFreeSlot;
+        if (slots_[slot].compare_exchange_strong(expected, kClaimedSlot)) {
+            break;
+        }
+        slot = (slot + 1) % kMaxReaders;
+        if (slot == 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Publish the epoch, then confirm no writer advanced it meanwhile: a
+    // reader pinned at epoch e only loads pointers published before e ended.
+    for (;;) {
+        const uint64_t epoch = globalEpoch_.load();
+        slots_[slot].store(epoch);
+        if (globalEpoch_.load() == epoch) {
+            return slot;
+        }
+    }
+}
+
+void EpochManager::unpin(std::size_t slot) {
+    slots_[slot].store(kFreeSlot);
+}
+
+void EpochManager::retire(std::function<void()> deleter) {
+    std::lock_guard<std::mutex> lock(retiredMutex_);
+    const uint64_t epoch = globalEpoch_.fetch_add(1);
+    retired_.push_back(std::make_pair(epoch, deleter));
+}
+
+std::size_t EpochManager::reclaim() {
+    std::vector<std::function<void()> > ready;
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex_);
+        uint64_t oldestPinned = globalEpoch_.load();
+        for (std::size_t i = 0; i < kMaxReaders; ++i) {
+            const uint64_t epoch = slots_[i].load();
+            if (epoch != kFreeSlot && epoch != kClaimedSlot && epoch < oldestPinned) {
+                oldestPinned = epoch;
+            }
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < retired_.size(); ++i) {
+            if (retired_[i].first < oldestPinned) {
+                ready.push_back(retired_[i].second);
+            } else {
+                retired_[kept++] = retired_[i];
+            }
+        }
+        retired_.resize(kept);
+    }
+
+    // Run the deleters outside the lock; they may be arbitrarily expensive.
+    for (std::size_t i = 0; i < ready.size(); ++i) {
+        ready[i]();
+    }
+    return ready.size();
+}
+
+std::size_t EpochManager::pendingCount() const {
+    std::lock_guard<std::mutex> lock(retiredMutex_);
+    return retired_.size();
+}
@@ -0,0 +1,419 @@
+//!
+//! @file flat_format.cpp
+//! @brief Implementation of the flat, offset-based binary record format
+//!
+
+#include "library_system/flat_format.hpp"
+
+#include <cstring>
+
+namespace {
+
+const char kMagic[4] = {'L', 'S', 'F', 'B'};
+const std::size_t kHeaderSize = 16;
+const std::size_t kRecordHeaderSize = 4;
+
+// Payload type of every known field, indexed by field. Fields past the end
+// of these tables were added by a newer schema and are only bounds-checked.
+const char kBookTypes[BOOK_FIELD_COUNT] = {'s', 's', 'u', 'i'};
+const char kRequirementTypes[REQUIREMENT_FIELD_COUNT] = {'i', 's', 's', 'i', 'i', 'i', 's', 's'};
+const char kMutationTypes[MUTATION_FIELD_COUNT] = {'u', 'i', 'u', 'i', 's', 's'};
+
+template <typename T>
+T load(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+template <typename T>
+void store(std::vector<char>& buffer, std::size_t offset, T value) {
+    std::memcpy(&buffer[offset], &value, sizeof(value));
+}
+
+template <typename T>
+void append(std::vector<char>& buffer, T value) {
+    buffer.resize(buffer.size() + sizeof(value));
+    store(buffer, buffer.size() - sizeof(value), value);
+}
+
+} // namespace
+
+std::string FlatString::str() const {
+    return std::string(data, size);
+}
+
+// Implementation of FlatWriter class methods
+
+const std::size_t FlatWriter::kStreamFlushBytes;
+
+FlatWriter::FlatWriter(FlatRecordKind kind, uint16_t schemaVersion)
+    : kind_(kind), schemaVersion_(schemaVersion), recordStart_(0), fieldCount_(0), file_(0), streamCount_(0),
+      flushedBytes_(0), streamFailed_(false) {}
+
+void FlatWriter::beginRecord(uint16_t fieldCount) {
+    align();
+    recordStart_ = records_.size();
+    fieldCount_ = fieldCount;
+    append<uint16_t>(records_, fieldCount);
+    append<uint16_t>(records_, 0);
+    records_.resize(records_.size() + fieldCount * sizeof(uint32_t), 0);
+}
+
+void FlatWriter::setInt32(uint16_t field, int32_t value) {
+    if (!setField(field)) {
+        return;
+    }
+    append(records_, value);
+}
+
+void FlatWriter::setUint64(uint16_t field, uint64_t value) {
+    if (!setField(field)) {
+        return;
+    }
+    append(records_, value);
+}
+
+void FlatWriter::setString(uint16_t field, const std::string& text) {
+    if (!setField(field)) {
+        return;
+    }
+    append(records_, static_cast<uint32_t>(text.size()));
+    records_.insert(records_.end(), text.begin(), text.end());
+}
+
+void FlatWriter::endRecord() {
+    recordOffsets_.push_back(static_cast<uint32_t>(flushedBytes_ + recordStart_));
+    if (file_ != 0 && records_.size() >= kStreamFlushBytes) {
+        flush();
+    }
+}
+
+void FlatWriter::addBook(const std::string& title, const std::string& author, IsbnKey isbn, uint32_t loans) {
+    beginRecord(BOOK_FIELD_COUNT);
+    setString(BOOK_TITLE, title);
+    setString(BOOK_AUTHOR, author);
+    setUint64(BOOK_ISBN, isbn);
+    setInt32(BOOK_LOANS, static_cast<int32_t>(loans));
+    endRecord();
+}
+
+void FlatWriter::addRequirement(const Requirement& requirement) {
+    beginRecord(REQUIREMENT_FIELD_COUNT);
+    setInt32(REQUIREMENT_ID, requirement.getID());
+    setString(REQUIREMENT_TITLE, requirement.getTitle());
+    setString(REQUIREMENT_DESCRIPTION, requirement.getDescription());
+    setInt32(REQUIREMENT_PRIORITY, requirement.getPriority());
+    setInt32(REQUIREMENT_STATUS, requirement.getStatus());
+    setInt32(REQUIREMENT_TEST_CASES, requirement.getTestCases());
+    setString(REQUIREMENT_OWNER, requirement.getOwner());
+    setString(REQUIREMENT_CREATED_DATE, requirement.getCreatedDate());
+    endRecord();
+}
+
+void FlatWriter::addMutation(uint64_t sequence, const MutationRecord& record) {
+    beginRecord(MUTATION_FIELD_COUNT);
+    setUint64(MUTATION_SEQUENCE, sequence);
+    setInt32(MUTATION_TYPE, record.type);
+    setUint64(MUTATION_ISBN, record.isbn);
+    setInt32(MUTATION_VALUE, record.value);
+    if (record.type == MUTATION_ADD_BOOK) {
+        setString(MUTATION_TITLE, record.title);
+        setString(MUTATION_AUTHOR, record.author);
+    }
+    endRecord();
+}
+
+std::size_t FlatWriter::size() const {
+    return recordOffsets_.size();
+}
+
+void FlatWriter::finish(std::vector<char>& buffer) const {
+    const std::size_t start = recordsStart(recordOffsets_.size());
+    buffer.assign(start, 0);
+    std::memcpy(&buffer[0], kMagic, sizeof(kMagic));
+    store<uint16_t>(buffer, 4, schemaVersion_);
+    store<uint16_t>(buffer, 6, static_cast<uint16_t>(kind_));
+    store<uint32_t>(buffer, 8, static_cast<uint32_t>(recordOffsets_.size()));
+    for (std::size_t i = 0; i < recordOffsets_.size(); ++i) {
+        store<uint32_t>(buffer, kHeaderSize + i * sizeof(uint32_t), static_cast<uint32_t>(start + recordOffsets_[i]));
+    }
+    buffer.insert(buffer.end(), records_.begin(), records_.end());
+}
+
+bool FlatWriter::streamTo(std::FILE* file, std::size_t count) {
+    file_ = file;
+    streamCount_ = count;
+    recordOffsets_.reserve(count);
+    const std::vector<char> reserved(recordsStart(count), 0);
+    streamFailed_ = std::fwrite(reserved.data(), 1, reserved.size(), file) != reserved.size();
+    return !streamFailed_;
+}
+
+bool FlatWriter::finish(std::FILE* file) {
+    if (file != file_ || !flush() || recordOffsets_.size() != streamCount_) {
+        return false;
+    }
+    // flush() emptied records_, so this assembles just the header and offset table.
+    std::vector<char> buffer;
+    finish(buffer);
+    return std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() &&
+           std::fseek(file, 0, SEEK_END) == 0;
+}
+
+bool FlatWriter::flush() {
+    // Flushed blocks stay multiples of 4, so records remain aligned in the file.
+    align();
+    if (!streamFailed_ && !records_.empty()) {
+        streamFailed_ = std::fwrite(records_.data(), 1, records_.size(), file_) != records_.size();
+    }
+    flushedBytes_ += records_.size();
+    records_.clear();
+    return !streamFailed_;
+}
+
+std::size_t FlatWriter::recordsStart(std::size_t count) const {
+    // Keep the records 4-byte aligned relative to the buffer start.
+    return (kHeaderSize + count * sizeof(uint32_t) + 3) & ~std::size_t(3);
+}
+
+void FlatWriter::align() {
+    records_.resize((records_.size() + 3) & ~std::size_t(3), 0);
+}
+
+bool FlatWriter::setField(uint16_t field) {
+    if (field >= fieldCount_) {
+        return false;
+    }
+    align();
+    store<uint32_t>(records_, recordStart_ + kRecordHeaderSize + field * sizeof(uint32_t),
+                    static_cast<uint32_t>(records_.size() - recordStart_));
+    return true;
+}
+
+// Implementation of FlatRecord class methods
+
+FlatRecord::FlatRecord(const char* record) : record_(record) {}
+
+bool FlatRecord::has(uint16_t field) const {
+    return fieldOffset(field) != 0;
+}
+
+int32_t FlatRecord::int32(uint16_t field, int32_t fallback) const {
+    const uint32_t offset = fieldOffset(field);
+    return offset == 0 ? fallback : load<int32_t>(record_ + offset);
+}
+
+uint64_t FlatRecord::uint64(uint16_t field, uint64_t fallback) const {
+    const uint32_t offset = fieldOffset(field);
+    return offset == 0 ? fallback : load<uint64_t>(record_ + offset);
+}
+
+FlatString FlatRecord::string(uint16_t field) const {
+    const uint32_t offset = fieldOffset(field);
+    FlatString text = {"", 0};
+    if (offset != 0) {
+        text.size = load<uint32_t>(record_ + offset);
+        text.data = record_ + offset + sizeof(uint32_t);
+    }
+    return text;
+}
+
+uint32_t FlatRecord::fieldOffset(uint16_t field) const {
+    // Records of an older schema simply have fewer fields.
+    if (field >= load<uint16_t>(record_)) {
+        return 0;
+    }
+    return load<uint32_t>(record_ + kRecordHeaderSize + field * sizeof(uint32_t));
+}
+
+// Implementation of BookView and RequirementView class methods
+
+BookView::BookView(const char* record) : FlatRecord(record) {}
+
+FlatString BookView::title() const {
+    return string(BOOK_TITLE);
+}
+
+FlatString BookView::author() const {
+    return string(BOOK_AUTHOR);
+}
+
+IsbnKey BookView::isbn() const {
+    return uint64(BOOK_ISBN, kInvalidIsbn);
+}
+
+uint32_t BookView::loans() const {
+    return static_cast<uint32_t>(int32(BOOK_LOANS));
+}
+
+RequirementView::RequirementView(const char* record) : FlatRecord(record) {}
+
+int RequirementView::id() const {
+    return int32(REQUIREMENT_ID);
+}
+
+FlatString RequirementView::title() const {
+    return string(REQUIREMENT_TITLE);
+}
+
+FlatString RequirementView::description() const {
+    return string(REQUIREMENT_DESCRIPTION);
+}
+
+int RequirementView::priority() const {
+    return int32(REQUIREMENT_PRIORITY);
+}
+
+RequirementStatus RequirementView::status() const {
+    const int32_t status = int32(REQUIREMENT_STATUS, OPEN);
+    return status >= OPEN && status <= CLOSED ? static_cast<RequirementStatus>(status) : OPEN;
+}
+
+int RequirementView::testCases() const {
+    return int32(REQUIREMENT_TEST_CASES);
+}
+
+FlatString RequirementView::owner() const {
+    return string(REQUIREMENT_OWNER);
+}
+
+FlatString RequirementView::createdDate() const {
+    return string(REQUIREMENT_CREATED_DATE);
+}
+
+Requirement RequirementView::toRequirement() const {
+    return Requirement(id(), title().str(), description().str(), priority(), status(), testCases(),
+                       owner().str(), createdDate().str());
+}
+
+MutationView::MutationView(const char* record) : FlatRecord(record) {}
+
+uint64_t MutationView::sequence() const {
+    return uint64(MUTATION_SEQUENCE);
+}
+
+bool MutationView::toMutation(MutationRecord& record) const {
+    const int32_t type = int32(MUTATION_TYPE);
+    const IsbnKey isbn = uint64(MUTATION_ISBN, kInvalidIsbn);
+    // Keys from untrusted buffers must round-trip like parsed ones.
+    if (type < MUTATION_ADD_BOOK || type > MUTATION_RETURN || isbn == kInvalidIsbn ||
+        parseIsbn(formatIsbn(isbn)) != isbn) {
+        return false;
+    }
+    record.type = static_cast<MutationType>(type);
+    record.isbn = isbn;
+    record.value = int32(MUTATION_VALUE);
+    record.title = string(MUTATION_TITLE).str();
+    record.author = string(MUTATION_AUTHOR).str();
+    return true;
+}
+
+// Implementation of FlatReader class methods
+
+FlatReader::FlatReader(const char* data, std::size_t size) : data_(data), size_(size), valid_(false) {
+    valid_ = validate();
+}
+
+bool FlatReader::valid() const {
+    return valid_;
+}
+
+FlatRecordKind FlatReader::kind() const {
+    return size_ < kHeaderSize ? FLAT_BOOK : static_cast<FlatRecordKind>(load<uint16_t>(data_ + 6));
+}
+
+uint16_t FlatReader::schemaVersion() const {
+    return size_ < kHeaderSize ? 0 : load<uint16_t>(data_ + 4);
+}
+
+std::size_t FlatReader::size() const {
+    return valid_ ? load<uint32_t>(data_ + 8) : 0;
+}
+
+BookView FlatReader::book(std::size_t index) const {
+    return BookView(record(index));
+}
+
+RequirementView FlatReader::requirement(std::size_t index) const {
+    return RequirementView(record(index));
+}
+
+MutationView FlatReader::mutation(std::size_t index) const {
+    return MutationView(record(index));
+}
+
+bool FlatReader::validate() const {
+    if (size_ < kHeaderSize || size_ > UINT32_MAX || std::memcmp(data_, kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+    const uint16_t kind = load<uint16_t>(data_ + 6);
+    if (kind != FLAT_BOOK && kind != FLAT_REQUIREMENT && kind != FLAT_MUTATION) {
+        return false;
+    }
+    const std::size_t count = load<uint32_t>(data_ + 8);
+    if (count > (size_ - kHeaderSize) / sizeof(uint32_t)) {
+        return false;
+    }
+    uint32_t previous = static_cast<uint32_t>(kHeaderSize + count * sizeof(uint32_t));
+    for (std::size_t i = 0; i <= count; ++i) {
+        const uint32_t begin =
+            i < count ? load<uint32_t>(data_ + kHeaderSize + i * sizeof(uint32_t)) : static_cast<uint32_t>(size_);
+        if (begin < previous || (i < count && begin % 4 != 0)) {
+            return false;
+        }
+        if (i > 0 && !validateRecord(previous, begin)) {
+            return false;
+        }
+        previous = begin;
+    }
+    return true;
+}
+
+bool FlatReader::validateRecord(uint32_t begin, uint32_t end) const {
+    const std::size_t length = end - begin;
+    if (length < kRecordHeaderSize) {
+        return false;
+    }
+    const char* record = data_ + begin;
+    const std::size_t fieldCount = load<uint16_t>(record);
+    const std::size_t tableEnd = kRecordHeaderSize + fieldCount * sizeof(uint32_t);
+    if (tableEnd > length) {
+        return false;
+    }
+
+    const char* types = kRequirementTypes;
+    std::size_t knownFields = REQUIREMENT_FIELD_COUNT;
+    if (kind() == FLAT_BOOK) {
+        types = kBookTypes;
+        knownFields = BOOK_FIELD_COUNT;
+    } else if (kind() == FLAT_MUTATION) {
+        types = kMutationTypes;
+        knownFields = MUTATION_FIELD_COUNT;
+    }
+    for (std::size_t field = 0; field < fieldCount; ++field) {
+        const std::size_t offset = load<uint32_t>(record + kRecordHeaderSize + field * sizeof(uint32_t));
+        if (offset == 0) {
+            continue;
+        }
+        if (offset < tableEnd || offset >= length) {
+            return false;
+        }
+        if (field >= knownFields) {
+            continue;
+        }
+        const char type = types[field];
+        const std::size_t available = length - offset;
+        if (type == 'u' ? available < sizeof(uint64_t) : available < sizeof(uint32_t)) {
+            return false;
+        }
+        if (type == 's' && load<uint32_t>(record + offset) > available - sizeof(uint32_t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* FlatReader::record(std::size_t index) const {
+    return data_ + load<uint32_t>(data_ + kHeaderSize + index * sizeof(uint32_t));
+}
@@ -0,0 +1,153 @@
+//!
+//! @file isbn.cpp
+//! @brief Implementation of ISBN parsing and validation
+//!
+
+#include "library_system/isbn.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// The digits are right-aligned in a 16 byte block padded with '0', so the
+// block read as a decimal number is the ISBN itself and one kernel handles
+// both ISBN lengths. Padding positions have a zero checksum weight.
+const std::size_t kBlockSize = 16;
+
+const int16_t kIsbn13Weights[kBlockSize] = {0, 0, 0, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1};
+const int16_t kIsbn10Weights[kBlockSize] = {0, 0, 0, 0, 0, 0, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+
+const uint64_t kIsbn978Prefix = 9780000000000ULL;
+
+/**
+ * @brief Validate a block of digit characters.
+ * @param block The 16 character block.
+ * @param weights The checksum weight of every position.
+ * @param value Receives the block read as a decimal number.
+ * @param checksum Receives the weighted digit sum.
+ * @return True if every character of the block is a decimal digit.
+ */
+bool parseDigitBlock(const char *block, const int16_t *weights, uint64_t &value, uint32_t &checksum) {
+#if defined(__SSE2__)
+    const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+    const __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+
+    // Bytes outside '0'..'9' wrap to values above 9 in unsigned arithmetic.
+    const __m128i inRange = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    if (_mm_movemask_epi8(inRange) != 0xFFFF) {
+        return false;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low = _mm_unpacklo_epi8(digits, zero);
+    const __m128i high = _mm_unpackhi_epi8(digits, zero);
+
+    // Weighted checksum: 16-bit multiply-add into four 32-bit partial sums.
+    const __m128i lowWeights = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights));
+    const __m128i highWeights = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + 8));
+    const __m128i sums = _mm_add_epi32(_mm_madd_epi16(low, lowWeights), _mm_madd_epi16(high, highWeights));
+
+    // Value: combine digit pairs, then pairs of pairs into four 4-digit groups.
+    const __m128i tens = _mm_set_epi16(1, 10, 1, 10, 1, 10, 1, 10);
+    const __m128i hundreds = _mm_set_epi16(1, 100, 1, 100, 1, 100, 1, 100);
+    const __m128i pairs = _mm_packs_epi32(_mm_madd_epi16(low, tens), _mm_madd_epi16(high, tens));
+    const __m128i groups = _mm_madd_epi16(pairs, hundreds);
+
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), sums);
+    checksum = static_cast<uint32_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), groups);
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value = value * 10000 + static_cast<uint64_t>(lanes[i]);
+    }
+    return true;
+#else
+    value = 0;
+    checksum = 0;
+    for (std::size_t i = 0; i < kBlockSize; ++i) {
+        const unsigned digit = static_cast<unsigned char>(block[i]) - static_cast<unsigned>('0');
+        if (digit > 9) {
+            return false;
+        }
+        value = value * 10 + digit;
+        checksum += digit * static_cast<uint32_t>(weights[i]);
+    }
+    return true;
+#endif
+}
+
+} // namespace
+
+IsbnKey parseIsbn(const std::string& isbn) {
+    // Strip separators into the tail of the block; at most 13 digits fit.
+    char digits[kBlockSize];
+    std::size_t count = 0;
+    for (std::string::size_type i = 0; i < isbn.size(); ++i) {
+        const char c = isbn[i];
+        if (c == '-' || c == ' ') {
+            continue;
+        }
+        if (count == 13) {
+            return kInvalidIsbn;
+        }
+        digits[count++] = c;
+    }
+    if (count != 10 && count != 13) {
+        return kInvalidIsbn;
+    }
+
+    // An ISBN-10 check digit of 10 is written as 'X'.
+    uint32_t checkExtra = 0;
+    if (count == 10 && (digits[9] == 'X' || digits[9] == 'x')) {
+        digits[9] = '0';
+        checkExtra = 10;
+    }
+
+    char block[kBlockSize];
+    const std::size_t padding = kBlockSize - count;
+    for (std::size_t i = 0; i < padding; ++i) {
+        block[i] = '0';
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        block[padding + i] = digits[i];
+    }
+
+    uint64_t value = 0;
+    uint32_t checksum = 0;
+    if (count == 13) {
+        if (!parseDigitBlock(block, kIsbn13Weights, value, checksum) || checksum % 10 != 0) {
+            return kInvalidIsbn;
+        }
+        return value;
+    }
+
+    if (!parseDigitBlock(block, kIsbn10Weights, value, checksum) || (checksum + checkExtra) % 11 != 0) {
+        return kInvalidIsbn;
+    }
+
+    // Convert to ISBN-13: prefix 978, keep the nine payload digits and
+    // recompute the check digit with the ISBN-13 weights.
+    uint64_t payload = (value / 10) % 1000000000ULL;
+    uint32_t sum = 9 * 1 + 7 * 3 + 8 * 1;
+    uint64_t rest = payload;
+    for (int position = 11; position >= 3; --position) {
+        sum += static_cast<uint32_t>(rest % 10) * (position % 2 == 0 ? 1 : 3);
+        rest /= 10;
+    }
+    return kIsbn978Prefix + payload * 10 + (10 - sum % 10) % 10;
+}
+
+std::string formatIsbn(IsbnKey key) {
+    if (key == kInvalidIsbn) {
+        return std::string();
+    }
+    std::string digits(13, '0');
+    for (int i = 12; i >= 0 && key != 0; --i) {
+        digits[i] = static_cast<char>('0' + key % 10);
+        key /= 10;
+    }
+    return digits;
+}
@@ -0,0 +1,120 @@
+//!
+//! @file isbn_hash_index.cpp
+//! @brief Implementation of the IsbnHashIndex insert-only, lock-free readable hash table
+//!
+
+#include "library_system/isbn_hash_index.hpp"
+
+#include <algorithm>
+
+namespace {
+
+const std::size_t kMinSlots = 8;
+
+} // namespace
+
+IsbnHashIndex::IsbnHashIndex(std::size_t capacity, MemoryTracker* tracker) : size_(0), tracker_(tracker) {
+    std::size_t slots = kMinSlots;
+    while (slots < 2 * capacity) {
+        slots *= 2;
+    }
+    mask_ = slots - 1;
+    slots_.reset(new Slot[slots]);
+    for (std::size_t i = 0; i < slots; ++i) {
+        slots_[i].key.store(kInvalidIsbn, std::memory_order_relaxed);
+        slots_[i].position.store(0, std::memory_order_relaxed);
+    }
+    if (tracker_ != 0) {
+        tracker_->allocated(memoryUsage());
+    }
+}
+
+IsbnHashIndex::~IsbnHashIndex() {
+    if (tracker_ != 0) {
+        tracker_->released(memoryUsage());
+    }
+}
+
+bool IsbnHashIndex::find(IsbnKey key, std::size_t& position) const {
+    for (std::size_t i = slotOf(key);; i = (i + 1) & mask_) {
+        // Acquire pairs with the release in insert(), so the position is visible.
+        const IsbnKey stored = slots_[i].key.load(std::memory_order_acquire);
+        if (stored == key) {
+            position = slots_[i].position.load(std::memory_order_relaxed);
+            return true;
+        }
+        if (stored == kInvalidIsbn) {
+            return false;
+        }
+    }
+}
+
+bool IsbnHashIndex::insert(IsbnKey key, std::size_t position) {
+    if (size_ >= capacity()) {
+        return false;
+    }
+    std::size_t i = slotOf(key);
+    for (;; i = (i + 1) & mask_) {
+        const IsbnKey stored = slots_[i].key.load(std::memory_order_relaxed);
+        if (stored == key) {
+            return false;
+        }
+        if (stored == kInvalidIsbn) {
+            break;
+        }
+    }
+    slots_[i].position.store(position, std::memory_order_relaxed);
+    slots_[i].key.store(key, std::memory_order_release);
+    ++size_;
+    return true;
+}
+
+void IsbnHashIndex::setPosition(IsbnKey key, std::size_t position) {
+    for (std::size_t i = slotOf(key);; i = (i + 1) & mask_) {
+        const IsbnKey stored = slots_[i].key.load(std::memory_order_relaxed);
+        if (stored == key) {
+            slots_[i].position.store(position, std::memory_order_relaxed);
+            return;
+        }
+        if (stored == kInvalidIsbn) {
+            return;
+        }
+    }
+}
+
+std::shared_ptr<IsbnHashIndex> IsbnHashIndex::grown(std::size_t capacity) const {
+    std::shared_ptr<IsbnHashIndex> copy = std::make_shared<IsbnHashIndex>(std::max(capacity, size_), tracker_);
+    for (std::size_t i = 0; i <= mask_; ++i) {
+        const IsbnKey key = slots_[i].key.load(std::memory_order_relaxed);
+        if (key != kInvalidIsbn) {
+            copy->insert(key, slots_[i].position.load(std::memory_order_relaxed));
+        }
+    }
+    return copy;
+}
+
+void IsbnHashIndex::keys(std::vector<IsbnKey>& keys) const {
+    keys.reserve(keys.size() + size_);
+    for (std::size_t i = 0; i <= mask_; ++i) {
+        const IsbnKey key = slots_[i].key.load(std::memory_order_relaxed);
+        if (key != kInvalidIsbn) {
+            keys.push_back(key);
+        }
+    }
+}
+
+std::size_t IsbnHashIndex::size() const {
+    return size_;
+}
+
+std::size_t IsbnHashIndex::capacity() const {
+    return (mask_ + 1) / 2;
+}
+
+std::size_t IsbnHashIndex::memoryUsage() const {
+    return (mask_ + 1) * sizeof(Slot);
+}
+
+std::size_t IsbnHashIndex::slotOf(IsbnKey key) const {
+    return static_cast<std::size_t>(mixIsbnKey(key)) & mask_;
+}
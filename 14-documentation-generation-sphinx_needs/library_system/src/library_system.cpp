@@ -3,13 +3,55 @@
 //! @brief Implementation of Requirement class methods
 //!
 
-#include "library_system.h"
+#include "library_system/library_system.hpp"
+
+#include "library_system/boolean_query.hpp"
+#include "library_system/flat_format.hpp"
+#include "library_system/parallel_for.hpp"
+#include "library_system/text_tokenizer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Position of an imported ISBN until its book is placed; lookups skip it like any position past bookCount.
+const std::size_t kPendingPosition = ~static_cast<std::size_t>(0);
+
+// Most popular first, then by key, like the trie's own top-k lists.
+bool suggestsBefore(const SuggestTrie::Entry& a, const SuggestTrie::Entry& b) {
+    return a.popularity != b.popularity ? a.popularity > b.popularity : a.key < b.key;
+}
+
+bool keyBefore(const SuggestTrie::Entry& a, const SuggestTrie::Entry& b) {
+    return a.key < b.key;
+}
+
+// Make a rename in the directory of a path durable.
+bool syncDirectoryOf(const std::string& path) {
+    const std::string::size_type slash = path.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : path.substr(0, std::max<std::size_t>(slash, 1));
+    const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    const bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+} // namespace
 
 Requirement::Requirement(int id, const std::string& title, const std::string& description,
                          int priority, RequirementStatus status, int testCases,
                          const std::string& owner, const std::string& createdDate)
     : id_(id), title_(title), description_(description), priority_(priority),
-      status_(status), testCases_(testCases), owner_(owner), createdDate_(createdDate) {}
+      status_(status), testCases_(testCases), ownerId_(StringPool::global().intern(owner)), createdDate_(createdDate),
+      createdDay_(parseEpochDay(createdDate)) {}
 
 int Requirement::getID() const {
     return id_;
@@ -36,40 +78,1149 @@ int Requirement::getTestCases() const {
 }
 
 std::string Requirement::getOwner() const {
-    return owner_;
+    return StringPool::global().str(ownerId_);
+}
+
+StringPool::Id Requirement::getOwnerId() const {
+    return ownerId_;
 }
 
 std::string Requirement::getCreatedDate() const {
     return createdDate_;
 }
 
+int Requirement::getCreatedDay() const {
+    return createdDay_;
+}
+
 // Implementation of LibrarySystem class methods
 
-LibrarySystem::LibrarySystem() {
+const std::size_t LibrarySystem::kChunkSize;
+const std::size_t LibrarySystem::kPageSize;
+const std::size_t LibrarySystem::kSealThreshold;
+const std::size_t LibrarySystem::kMergeFactor;
+const std::size_t LibrarySystem::kIsbnPartitions;
+const std::size_t LibrarySystem::kImportSliceSize;
+const std::size_t LibrarySystem::kIsbnFilterCapacity;
+const std::size_t LibrarySystem::kSuggestTailSize;
+const double LibrarySystem::kDefaultIsbnFilterRate = 0.01;
+
+/**
+ * @brief Records of one importCatalog() worker, in buffer order.
+ */
+struct LibrarySystem::ImportSlice {
+    std::vector<Book> books;
+    std::vector<unsigned> loans;
+    std::vector<std::vector<uint32_t> > byWorker; ///< Books whose ISBN partition each worker owns.
+    std::vector<char> accepted;                  ///< Whether each book's ISBN was new to the index.
+    std::size_t first;                           ///< Catalog position of the first accepted book.
+};
+
+LibrarySystem::LibrarySystem(bool backgroundMaintenance)
+    : current_(0), isbnFilterRate_(kDefaultIsbnFilterRate), nextListener_(1), catalogBytes_(0),
+      memoryBudget_(0), budgetCheck_(false), spillCount_(0), stopMerging_(false), maintenanceIdle_(false), suggestBooks_(0),
+      suggestEnabled_(false), suggestRebuild_(false),
+      filterLookups_(0), filterRejections_(0), filterFalsePositives_(0) {
     // Initialize the library system as needed.
+    std::shared_ptr<IsbnIndexList> indexes = std::make_shared<IsbnIndexList>();
+    std::shared_ptr<IsbnFilterList> filters = std::make_shared<IsbnFilterList>();
+    for (std::size_t p = 0; p < kIsbnPartitions; ++p) {
+        indexes->push_back(std::make_shared<IsbnHashIndex>(0, &indexTracker_));
+        filters->push_back(buildIsbnFilter(*indexes->back()));
+    }
+    CatalogVersion* empty = new CatalogVersion();
+    empty->books = std::make_shared<BookDirectory>();
+    empty->loans = std::make_shared<LoanDirectory>();
+    empty->chunkCount = 0;
+    empty->bookCount = 0;
+    empty->generation = 0;
+    empty->sealedCount = 0;
+    empty->isbnFilters = filters;
+    empty->isbnIndex = indexes;
+    current_.store(empty);
+    if (backgroundMaintenance) {
+        mergeThread_ = std::thread(&LibrarySystem::mergeSegments, this);
+    }
 }
 
 LibrarySystem::~LibrarySystem() {
-    // Clean up resources.
+    // Clean up resources. Retired versions are released by epochs_.
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        stopMerging_ = true;
+    }
+    mergeCondition_.notify_one();
+    if (mergeThread_.joinable()) {
+        mergeThread_.join();
+    }
+    delete current_.load();
 }
 
 bool LibrarySystem::addBook(const std::string& title, const std::string& author, const std::string& isbn) {
     // Implementation for adding a book.
-    return true; // Placeholder return value.
+    const IsbnKey key = parseIsbn(isbn);
+    if (key == kInvalidIsbn) {
+        return false;
+    }
+    return insertBook(title, author, key, 0);
+}
+
+LibrarySystem::Book LibrarySystem::makeBook(const std::string& title, const std::string& author, IsbnKey key) {
+    const std::vector<std::string> titleTerms = tokenizeText(title);
+    const std::vector<std::string> authorTerms = tokenizeText(author);
+    Book book = {title, StringPool::global().intern(author), key, titleTerms};
+    book.terms.reserve(2 * (titleTerms.size() + authorTerms.size()));
+    book.terms.insert(book.terms.end(), authorTerms.begin(), authorTerms.end());
+    for (std::size_t i = 0; i < titleTerms.size(); ++i) {
+        book.terms.push_back(BooleanQuery::fieldTerm("title", titleTerms[i]));
+    }
+    for (std::size_t i = 0; i < authorTerms.size(); ++i) {
+        book.terms.push_back(BooleanQuery::fieldTerm("author", authorTerms[i]));
+    }
+    std::sort(book.terms.begin(), book.terms.end());
+    book.terms.erase(std::unique(book.terms.begin(), book.terms.end()), book.terms.end());
+    return book;
+}
+
+std::size_t LibrarySystem::isbnPartition(IsbnKey key) {
+    // The top bits of a Fibonacci hash; ISBN keys are dense in their low digits.
+    return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> 58) % kIsbnPartitions;
+}
+
+bool LibrarySystem::findIsbn(const CatalogVersion& version, IsbnKey key, std::size_t& position) {
+    // Keys inserted for books this version does not contain yet are skipped.
+    return (*version.isbnIndex)[isbnPartition(key)]->find(key, position) && position < version.bookCount;
+}
+
+std::shared_ptr<BlockedBloomFilter> LibrarySystem::buildIsbnFilter(const IsbnHashIndex& index) const {
+    // Twice the current keys, so a growing partition is rebuilt a logarithmic number of times.
+    std::vector<IsbnKey> keys;
+    index.keys(keys);
+    std::shared_ptr<BlockedBloomFilter> filter = std::make_shared<BlockedBloomFilter>(
+        std::max(kIsbnFilterCapacity, 2 * keys.size()), isbnFilterRate_);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        filter->add(keys[i]);
+    }
+    return filter;
+}
+
+bool LibrarySystem::mayHaveIsbn(IsbnKey key) {
+    filterLookups_.fetch_add(1, std::memory_order_relaxed);
+    EpochManager::Guard guard(epochs_);
+    if ((*current_.load()->isbnFilters)[isbnPartition(key)]->mayContain(key)) {
+        return true;
+    }
+    filterRejections_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool LibrarySystem::insertBook(const std::string& title, const std::string& author, IsbnKey key, unsigned loans) {
+    const Book book = makeBook(title, author, key);
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        const CatalogVersion* current = current_.load();
+        std::size_t existing = 0;
+        if (findIsbn(*current, key, existing)) {
+            return false;
+        }
+
+        CatalogVersion* next = new CatalogVersion(*current);
+        const std::size_t index = next->bookCount;
+        if (index % kChunkSize == 0) {
+            appendChunk(*next);
+        }
+        // Both chunks have room reserved, so appending never moves elements
+        // that readers of older versions may be looking at.
+        bookChunk(*next, index / kChunkSize).push_back(book);
+        loanChunk(*next, index / kChunkSize).push_back(loans);
+        catalogBytes_ += heapBytes(book.title) + heapBytes(book.terms);
+        ++next->bookCount;
+        generation = ++next->generation;
+        if (next->bookCount - next->sealedCount >= kSealThreshold) {
+            sealTail(*next);
+        }
+
+        // Readers of the current version skip the new key, its position is past their books.
+        const std::size_t partition = isbnPartition(key);
+        std::shared_ptr<IsbnHashIndex> table = (*next->isbnIndex)[partition];
+        if (table->size() >= table->capacity()) {
+            std::shared_ptr<IsbnIndexList> indexes = std::make_shared<IsbnIndexList>(*next->isbnIndex);
+            table = table->grown(2 * table->capacity());
+            (*indexes)[partition] = table;
+            next->isbnIndex = indexes;
+        }
+        table->insert(key, index);
+        if (table->size() > (*next->isbnFilters)[partition]->capacity()) {
+            std::shared_ptr<IsbnFilterList> filters = std::make_shared<IsbnFilterList>(*next->isbnFilters);
+            (*filters)[partition] = buildIsbnFilter(*table);
+            next->isbnFilters = filters;
+        } else {
+            (*next->isbnFilters)[partition]->add(key);
+        }
+        publish(next);
+        updateSuggestTail(*next);
+        if (!listeners_.empty()) {
+            MutationRecord record = {MUTATION_ADD_BOOK, key, static_cast<int32_t>(loans), title, author};
+            notifyListeners(record);
+        }
+    }
+
+    std::shared_ptr<QueryCache> cache = std::atomic_load(&queryCache_);
+    if (cache) {
+        cache->invalidate(book.terms, generation);
+    }
+    return true;
 }
 
 bool LibrarySystem::borrowBook(const std::string& isbn, int userId) {
     // Implementation for borrowing a book.
-    return true; // Placeholder return value.
+    const IsbnKey key = parseIsbn(isbn);
+    if (key == kInvalidIsbn || !mayHaveIsbn(key)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    std::size_t position = 0;
+    if (!findIsbn(*current_.load(), key, position)) {
+        filterFalsePositives_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // Copy on write: only the loan chunk holding this book, its page and the directory are duplicated.
+    const std::size_t chunk = position / kChunkSize;
+    CatalogVersion* next = new CatalogVersion(*current_.load());
+    const LoanChunk& previous = loanChunk(*next, chunk);
+    std::shared_ptr<LoanChunk> loans = std::make_shared<LoanChunk>();
+    loans->reserve(kChunkSize);
+    loans->assign(previous.begin(), previous.end());
+    ++(*loans)[position % kChunkSize];
+    setLoanChunk(*next, chunk, loans);
+    ++next->generation;
+    publish(next);
+    raiseSuggestion(bookAt(*next, position), position);
+    MutationRecord record = {MUTATION_BORROW, key, userId, std::string(), std::string()};
+    notifyListeners(record);
+    return true;
 }
 
 bool LibrarySystem::returnBook(const std::string& isbn, int userId) {
     // Implementation for returning a book.
-    return true; // Placeholder return value.
+    const IsbnKey key = parseIsbn(isbn);
+    if (key == kInvalidIsbn || !mayHaveIsbn(key)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    std::size_t position = 0;
+    if (!findIsbn(*current_.load(), key, position)) {
+        filterFalsePositives_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    MutationRecord record = {MUTATION_RETURN, key, userId, std::string(), std::string()};
+    notifyListeners(record);
+    return true;
+}
+
+bool LibrarySystem::findBook(const std::string& isbn, SearchHit& book) {
+    const IsbnKey key = parseIsbn(isbn);
+    if (key == kInvalidIsbn || !mayHaveIsbn(key)) {
+        return false;
+    }
+
+    EpochManager::Guard guard(epochs_);
+    const CatalogVersion& version = *current_.load();
+    std::size_t position = 0;
+    if (!findIsbn(version, key, position)) {
+        filterFalsePositives_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    book.title = bookAt(version, position).title;
+    book.loans = loansAt(version, position);
+    return true;
 }
 
 std::vector<std::string> LibrarySystem::searchBooks(const std::string& keyword) {
     // Implementation for searching books.
-    std::vector<std::string> results; // Placeholder results.
+    std::vector<std::string> results;
+    std::vector<std::string> terms = tokenizeText(keyword);
+    if (terms.empty()) {
+        return results;
+    }
+
+    const std::string key = QueryCache::makeKey(terms);
+    std::shared_ptr<QueryCache> cache = std::atomic_load(&queryCache_);
+    if (cache && cache->lookup(key, results)) {
+        return results;
+    }
+
+    EpochManager::Guard guard(epochs_);
+    const CatalogVersion& version = *current_.load();
+    std::vector<SearchSegment::DocId> matches;
+    matchBooks(version, terms, matches);
+
+    results.reserve(matches.size());
+    for (std::size_t i = 0; i < matches.size(); ++i) {
+        results.push_back(bookAt(version, matches[i]).title);
+    }
+
+    if (cache) {
+        cacheResults(*cache, key, terms, results, version.generation);
+    }
+    return results;
+}
+
+std::vector<std::string> LibrarySystem::searchBooks(const BooleanQuery& query) {
+    std::vector<std::string> results;
+    if (!query.valid()) {
+        return results;
+    }
+
+    // Canonical queries of several terms never look like the sorted term lists
+    // keying plain searches; a single term keys like its plain search and shares its results.
+    const std::string key = query.str();
+    std::shared_ptr<QueryCache> cache = std::atomic_load(&queryCache_);
+    if (cache && cache->lookup(key, results)) {
+        return results;
+    }
+
+    EpochManager::Guard guard(epochs_);
+    const CatalogVersion& version = *current_.load();
+    std::vector<SearchSegment::DocId> matches;
+    std::vector<SearchSegment::DocId> segmentMatches;
+    for (std::size_t s = 0; s < version.segments.size(); ++s) {
+        query.match(*version.segments[s], segmentMatches);
+        matches.insert(matches.end(), segmentMatches.begin(), segmentMatches.end());
+    }
+    std::sort(matches.begin(), matches.end());
+    for (std::size_t i = version.sealedCount; i < version.bookCount; ++i) {
+        if (query.matches(bookAt(version, i).terms)) {
+            matches.push_back(static_cast<SearchSegment::DocId>(i));
+        }
+    }
+
+    results.reserve(matches.size());
+    for (std::size_t i = 0; i < matches.size(); ++i) {
+        results.push_back(bookAt(version, matches[i]).title);
+    }
+    if (cache) {
+        // Any book sharing a term with the query, even a negated one, may change its results.
+        cacheResults(*cache, key, query.terms(), results, version.generation);
+    }
     return results;
 }
+
+void LibrarySystem::cacheResults(QueryCache& cache, const std::string& key, const std::vector<std::string>& terms,
+                                 const std::vector<std::string>& results, uint64_t generation) {
+    cache.insert(key, terms, results, generation);
+    // The cache alone must not outgrow the budget between two enforcements.
+    const std::size_t budget = memoryBudget_.load();
+    if (budget != 0 && cache.memoryUsage() > budget) {
+        cache.trim(budget);
+    }
+}
+
+std::vector<LibrarySystem::SearchHit> LibrarySystem::searchTopBooks(const std::string& keyword, std::size_t k) {
+    std::vector<SearchHit> hits;
+    std::vector<std::string> terms = tokenizeText(keyword);
+    if (terms.empty() || k == 0) {
+        return hits;
+    }
+
+    EpochManager::Guard guard(epochs_);
+    const CatalogVersion& version = *current_.load();
+    std::vector<SearchSegment::DocId> matches;
+    matchBooks(version, terms, matches);
+
+    hits.reserve(matches.size());
+    for (std::size_t i = 0; i < matches.size(); ++i) {
+        SearchHit hit = {bookAt(version, matches[i]).title, loansAt(version, matches[i])};
+        hits.push_back(hit);
+    }
+    if (hits.size() > k) {
+        std::partial_sort(hits.begin(), hits.begin() + k, hits.end(), ranksBefore);
+        hits.resize(k);
+    } else {
+        std::sort(hits.begin(), hits.end(), ranksBefore);
+    }
+    return hits;
+}
+
+void LibrarySystem::enableQueryCache(std::size_t capacity) {
+    std::shared_ptr<QueryCache> cache;
+    if (capacity != 0) {
+        cache = std::make_shared<QueryCache>(capacity);
+    }
+    std::atomic_store(&queryCache_, cache);
+}
+
+QueryCache::Stats LibrarySystem::queryCacheStats() const {
+    std::shared_ptr<QueryCache> cache = std::atomic_load(&queryCache_);
+    if (!cache) {
+        QueryCache::Stats empty = {0, 0, 0, 0};
+        return empty;
+    }
+    return cache->stats();
+}
+
+std::size_t LibrarySystem::indexSegmentCount() {
+    EpochManager::Guard guard(epochs_);
+    return current_.load()->segments.size();
+}
+
+std::vector<std::string> LibrarySystem::suggest(const std::string& prefix, std::size_t k) {
+    // A trailing separator means the last word is complete ("the " must not
+    // complete to "theory"), so keep it after normalization.
+    std::string key = normalizeText(prefix);
+    if (!key.empty() && normalizeText(prefix.substr(prefix.size() - 1)).empty()) {
+        key.push_back(' ');
+    }
+
+    k = std::min(k, SuggestTrie::kMaxSuggestions);
+    std::unique_lock<std::mutex> lock(suggestMutex_);
+    if (!suggestEnabled_) {
+        lock.unlock();
+        rebuildSuggestTrie(true);
+        lock.lock();
+    }
+
+    // The trie's top k and every tail match can make the final top k; a tail
+    // title or author may also be in the trie, so their popularities add up.
+    std::vector<SuggestTrie::Entry> candidates = suggestTrie_.top(key, k);
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i].key = normalizeText(candidates[i].text);
+    }
+    std::vector<SuggestTrie::Entry> matches;
+    for (std::size_t i = 0; i < suggestTail_.size(); ++i) {
+        if (suggestTail_[i].key.compare(0, key.size(), key) == 0) {
+            matches.push_back(suggestTail_[i]);
+        }
+    }
+    std::stable_sort(matches.begin(), matches.end(), keyBefore);
+    for (std::size_t i = 0; i < matches.size();) {
+        SuggestTrie::Entry match = matches[i];
+        for (++i; i < matches.size() && matches[i].key == match.key; ++i) {
+            match.popularity += matches[i].popularity;
+        }
+        std::size_t c = 0;
+        while (c < candidates.size() && candidates[c].key != match.key) {
+            ++c;
+        }
+        if (c < candidates.size()) {
+            candidates[c].popularity += match.popularity;
+            continue;
+        }
+        SuggestTrie::Entry known;
+        if (suggestTrie_.find(match.key, known)) {
+            match.text = known.text;
+            match.popularity += known.popularity;
+        }
+        candidates.push_back(match);
+    }
+    lock.unlock();
+
+    std::sort(candidates.begin(), candidates.end(), suggestsBefore);
+    std::vector<std::string> suggestions;
+    for (std::size_t i = 0; i < candidates.size() && i < k; ++i) {
+        suggestions.push_back(candidates[i].text);
+    }
+    return suggestions;
+}
+
+void LibrarySystem::exportCatalog(std::vector<char>& buffer) {
+    FlatWriter writer(FLAT_BOOK);
+    {
+        EpochManager::Guard guard(epochs_);
+        const CatalogVersion& version = *current_.load();
+        for (std::size_t i = 0; i < version.bookCount; ++i) {
+            const Book& book = bookAt(version, i);
+            writer.addBook(book.title, StringPool::global().str(book.author), book.isbn, loansAt(version, i));
+        }
+    }
+    writer.finish(buffer);
+}
+
+std::future<bool> LibrarySystem::snapshot(const std::string& path) {
+    // Copying the version only copies directory pointers; the epoch pin is released right away.
+    std::shared_ptr<CatalogVersion> view = std::make_shared<CatalogVersion>();
+    {
+        EpochManager::Guard guard(epochs_);
+        *view = *current_.load();
+    }
+    view->segments.clear();
+    return std::async(std::launch::async, [view, path]() { return writeSnapshot(*view, path); });
+}
+
+bool LibrarySystem::writeSnapshot(const CatalogVersion& view, const std::string& path) {
+    const std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == 0) {
+        return false;
+    }
+    FlatWriter writer(FLAT_BOOK);
+    bool written = writer.streamTo(file, view.bookCount);
+    for (std::size_t i = 0; written && i < view.bookCount; ++i) {
+        const Book& book = bookAt(view, i);
+        writer.addBook(book.title, StringPool::global().str(book.author), book.isbn, loansAt(view, i));
+    }
+    written = written && writer.finish(file);
+    // The data must be on disk before the rename can expose it.
+    written = written && std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return syncDirectoryOf(path);
+}
+
+std::size_t LibrarySystem::importCatalog(const char* data, std::size_t size, std::size_t threads) {
+    FlatReader reader(data, size);
+    if (!reader.valid() || reader.kind() != FLAT_BOOK || reader.size() == 0) {
+        return 0;
+    }
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = std::min(std::min(threads, kIsbnPartitions), (reader.size() + kImportSliceSize - 1) / kImportSliceSize);
+
+    // Parse and tokenize contiguous slices of the buffer before taking the lock.
+    std::vector<ImportSlice> slices(threads);
+    parallelFor(threads, [&reader, &slices, threads](std::size_t w) {
+        ImportSlice& slice = slices[w];
+        slice.byWorker.resize(threads);
+        const std::size_t end = reader.size() * (w + 1) / threads;
+        for (std::size_t i = reader.size() * w / threads; i < end; ++i) {
+            const BookView view = reader.book(i);
+            const IsbnKey key = view.isbn();
+            // Keys from untrusted buffers must round-trip like parsed ones.
+            if (key == kInvalidIsbn || parseIsbn(formatIsbn(key)) != key) {
+                continue;
+            }
+            slice.byWorker[isbnPartition(key) % threads].push_back(static_cast<uint32_t>(slice.books.size()));
+            slice.books.push_back(makeBook(view.title().str(), view.author().str(), key));
+            slice.loans.push_back(view.loans());
+        }
+        slice.accepted.assign(slice.books.size(), 0);
+    });
+
+    std::unique_lock<std::mutex> lock(writeMutex_);
+
+    // Every worker owns the ISBN index partitions congruent to its index and
+    // visits the slices in buffer order, so the first copy of an ISBN wins.
+    // It grows the tables of its partitions up front, inserts the keys with
+    // a pending position that lookups skip, and updates the filters of its
+    // partitions, rebuilding outgrown ones.
+    std::shared_ptr<IsbnIndexList> indexes = std::make_shared<IsbnIndexList>(*current_.load()->isbnIndex);
+    std::shared_ptr<IsbnFilterList> filters = std::make_shared<IsbnFilterList>(*current_.load()->isbnFilters);
+    parallelFor(threads, [this, &slices, &indexes, &filters, threads](std::size_t w) {
+        std::vector<std::size_t> incoming(kIsbnPartitions, 0);
+        for (std::size_t s = 0; s < slices.size(); ++s) {
+            for (std::size_t i = 0; i < slices[s].byWorker[w].size(); ++i) {
+                ++incoming[isbnPartition(slices[s].books[slices[s].byWorker[w][i]].isbn)];
+            }
+        }
+        for (std::size_t p = w; p < kIsbnPartitions; p += threads) {
+            const IsbnHashIndex& table = *(*indexes)[p];
+            if (table.size() + incoming[p] > table.capacity()) {
+                (*indexes)[p] = table.grown(table.size() + incoming[p]);
+            }
+        }
+        for (std::size_t s = 0; s < slices.size(); ++s) {
+            ImportSlice& slice = slices[s];
+            for (std::size_t i = 0; i < slice.byWorker[w].size(); ++i) {
+                const uint32_t b = slice.byWorker[w][i];
+                const IsbnKey key = slice.books[b].isbn;
+                const std::size_t partition = isbnPartition(key);
+                if ((*indexes)[partition]->insert(key, kPendingPosition)) {
+                    slice.accepted[b] = 1;
+                    if ((*indexes)[partition]->size() <= (*filters)[partition]->capacity()) {
+                        (*filters)[partition]->add(key);
+                    }
+                }
+            }
+        }
+        for (std::size_t p = w; p < kIsbnPartitions; p += threads) {
+            if ((*indexes)[p]->size() > (*filters)[p]->capacity()) {
+                (*filters)[p] = buildIsbnFilter(*(*indexes)[p]);
+            }
+        }
+    });
+    parallelFor(threads, [&slices](std::size_t s) {
+        ImportSlice& slice = slices[s];
+        std::size_t kept = 0;
+        for (std::size_t b = 0; b < slice.books.size(); ++b) {
+            if (!slice.accepted[b]) {
+                continue;
+            }
+            if (kept != b) {
+                slice.books[kept] = std::move(slice.books[b]);
+                slice.loans[kept] = slice.loans[b];
+            }
+            ++kept;
+        }
+        slice.books.resize(kept);
+        slice.loans.resize(kept);
+    });
+
+    std::size_t added = 0;
+    for (std::size_t s = 0; s < slices.size(); ++s) {
+        added += slices[s].books.size();
+    }
+    if (added == 0) {
+        return 0;
+    }
+
+    // The new books get a segment of their own, so the unsealed tail is sealed first.
+    CatalogVersion* next = new CatalogVersion(*current_.load());
+    next->isbnFilters = filters;
+    next->isbnIndex = indexes;
+    if (next->sealedCount < next->bookCount) {
+        sealTail(*next);
+    }
+    const std::size_t first = next->bookCount;
+    std::size_t position = first;
+    for (std::size_t s = 0; s < slices.size(); ++s) {
+        slices[s].first = position;
+        position += slices[s].books.size();
+    }
+    const std::size_t firstChunk = first / kChunkSize;
+    while (next->chunkCount * kChunkSize < first + added) {
+        appendChunk(*next);
+    }
+
+    // Every worker fills its own range of chunks, records the catalog
+    // positions in the ISBN index and radix-partitions the term occurrences
+    // by term hash, one partition per worker.
+    const std::size_t chunkCount = next->chunkCount - firstChunk;
+    std::vector<std::vector<std::vector<SearchSegment::Posting> > > emitted(threads);
+    CatalogVersion& version = *next;
+    const IsbnIndexList& tables = *indexes;
+    parallelFor(threads, [this, &slices, &emitted, &version, &tables, threads, first, added, firstChunk,
+                          chunkCount](std::size_t w) {
+        std::vector<std::vector<SearchSegment::Posting> >& postings = emitted[w];
+        postings.resize(threads);
+        std::hash<std::string> hash;
+        std::size_t bytes = 0;
+        std::size_t s = 0;
+        const std::size_t chunkEnd = firstChunk + chunkCount * (w + 1) / threads;
+        for (std::size_t c = firstChunk + chunkCount * w / threads; c < chunkEnd; ++c) {
+            const std::size_t end = std::min((c + 1) * kChunkSize, first + added);
+            for (std::size_t g = std::max(c * kChunkSize, first); g < end; ++g) {
+                while (g >= slices[s].first + slices[s].books.size()) {
+                    ++s;
+                }
+                ImportSlice& slice = slices[s];
+                const std::size_t b = g - slice.first;
+                tables[isbnPartition(slice.books[b].isbn)]->setPosition(slice.books[b].isbn, g);
+                bookChunk(version, c).push_back(std::move(slice.books[b]));
+                loanChunk(version, c).push_back(slice.loans[b]);
+                const Book& book = bookChunk(version, c).back();
+                bytes += heapBytes(book.title) + heapBytes(book.terms);
+                for (std::size_t t = 0; t < book.terms.size(); ++t) {
+                    postings[hash(book.terms[t]) % threads].push_back(
+                        SearchSegment::Posting(book.terms[t], static_cast<SearchSegment::DocId>(g)));
+                }
+            }
+        }
+        catalogBytes_ += bytes;
+    });
+    std::vector<std::vector<SearchSegment::Posting> > partitions(threads);
+    parallelFor(threads, [&emitted, &partitions](std::size_t p) {
+        for (std::size_t w = 0; w < emitted.size(); ++w) {
+            partitions[p].insert(partitions[p].end(), std::make_move_iterator(emitted[w][p].begin()),
+                                 std::make_move_iterator(emitted[w][p].end()));
+            std::vector<SearchSegment::Posting>().swap(emitted[w][p]);
+        }
+    });
+    next->segments.push_back(SearchSegment::buildPartitioned(partitions, added, &postingsTracker_));
+    next->bookCount = first + added;
+    next->sealedCount = next->bookCount;
+    const uint64_t generation = ++next->generation;
+    budgetCheck_ = memoryBudget_.load() != 0;
+    mergeCondition_.notify_one();
+    publish(next);
+    updateSuggestTail(version);
+
+    for (std::size_t g = first; g < first + added && !listeners_.empty(); ++g) {
+        const Book& book = bookAt(version, g);
+        MutationRecord record = {MUTATION_ADD_BOOK, book.isbn, static_cast<int32_t>(loansAt(version, g)), book.title,
+                                 StringPool::global().str(book.author)};
+        notifyListeners(record);
+    }
+    lock.unlock();
+
+    std::shared_ptr<QueryCache> cache = std::atomic_load(&queryCache_);
+    if (cache) {
+        cache->invalidateAll(generation);
+    }
+    return added;
+}
+
+std::size_t LibrarySystem::addMutationListener(const MutationListener& listener) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    const CatalogVersion& version = *current_.load();
+    for (std::size_t i = 0; i < version.bookCount; ++i) {
+        const Book& book = bookAt(version, i);
+        MutationRecord record = {MUTATION_ADD_BOOK, book.isbn, static_cast<int32_t>(loansAt(version, i)), book.title,
+                                 StringPool::global().str(book.author)};
+        listener(record);
+    }
+    listeners_.push_back(std::make_pair(nextListener_, listener));
+    return nextListener_++;
+}
+
+void LibrarySystem::removeMutationListener(std::size_t handle) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    for (std::size_t i = 0; i < listeners_.size(); ++i) {
+        if (listeners_[i].first == handle) {
+            listeners_.erase(listeners_.begin() + i);
+            return;
+        }
+    }
+}
+
+bool LibrarySystem::applyMutation(const MutationRecord& record) {
+    switch (record.type) {
+    case MUTATION_ADD_BOOK:
+        return insertBook(record.title, record.author, record.isbn, static_cast<unsigned>(record.value));
+    case MUTATION_BORROW:
+        return borrowBook(formatIsbn(record.isbn), record.value);
+    case MUTATION_RETURN:
+        return returnBook(formatIsbn(record.isbn), record.value);
+    }
+    return false;
+}
+
+bool LibrarySystem::ranksBefore(const SearchHit& a, const SearchHit& b) {
+    return a.loans != b.loans ? a.loans > b.loans : a.title < b.title;
+}
+
+void LibrarySystem::matchBooks(const CatalogVersion& version, const std::vector<std::string>& terms,
+                               std::vector<SearchSegment::DocId>& matches) const {
+    // Fan out over the sealed segments, then scan the unsealed tail.
+    std::vector<SearchSegment::DocId> segmentMatches;
+    for (std::size_t s = 0; s < version.segments.size(); ++s) {
+        version.segments[s]->match(terms, segmentMatches);
+        matches.insert(matches.end(), segmentMatches.begin(), segmentMatches.end());
+    }
+    std::sort(matches.begin(), matches.end());
+    for (std::size_t i = version.sealedCount; i < version.bookCount; ++i) {
+        const Book& book = bookAt(version, i);
+        bool matched = true;
+        for (std::size_t t = 0; t < terms.size() && matched; ++t) {
+            matched = std::binary_search(book.terms.begin(), book.terms.end(), terms[t]);
+        }
+        if (matched) {
+            matches.push_back(static_cast<SearchSegment::DocId>(i));
+        }
+    }
+}
+
+std::size_t LibrarySystem::MemoryUsage::total() const {
+    return catalog + isbnIndex + isbnFilters + postings + suggestTrie + queryCache;
+}
+
+LibrarySystem::MemoryUsage LibrarySystem::memoryUsage() {
+    MemoryUsage usage = {catalogBytes_.load(), indexTracker_.bytes(), 0, postingsTracker_.bytes(), 0, 0, 0};
+    {
+        EpochManager::Guard guard(epochs_);
+        const CatalogVersion& version = *current_.load();
+        for (std::size_t i = 0; i < version.segments.size(); ++i) {
+            usage.mappedPostings += version.segments[i]->mappedBytes();
+        }
+        for (std::size_t p = 0; p < version.isbnFilters->size(); ++p) {
+            usage.isbnFilters += (*version.isbnFilters)[p]->memoryUsage();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(suggestMutex_);
+        usage.suggestTrie = suggestTrie_.memoryUsage();
+    }
+    std::shared_ptr<QueryCache> cache = std::atomic_load(&queryCache_);
+    if (cache) {
+        usage.queryCache = cache->memoryUsage();
+    }
+    return usage;
+}
+
+void LibrarySystem::setMemoryBudget(std::size_t bytes, const std::string& spillDirectory) {
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        memoryBudget_ = bytes;
+        spillDirectory_ = spillDirectory;
+        budgetCheck_ = bytes != 0;
+    }
+    mergeCondition_.notify_one();
+}
+
+double LibrarySystem::IsbnFilterStats::falsePositiveRate() const {
+    const uint64_t absent = rejected + falsePositives;
+    return absent == 0 ? 0 : static_cast<double>(falsePositives) / absent;
+}
+
+LibrarySystem::IsbnFilterStats LibrarySystem::isbnFilterStats() {
+    IsbnFilterStats stats = {filterLookups_.load(), filterRejections_.load(), filterFalsePositives_.load(), 0};
+    EpochManager::Guard guard(epochs_);
+    stats.targetRate = (*current_.load()->isbnFilters)[0]->falsePositiveRate();
+    return stats;
+}
+
+void LibrarySystem::setIsbnFilterFalsePositiveRate(double rate) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    isbnFilterRate_ = rate;
+    const CatalogVersion& current = *current_.load();
+    std::shared_ptr<IsbnFilterList> filters = std::make_shared<IsbnFilterList>();
+    for (std::size_t p = 0; p < kIsbnPartitions; ++p) {
+        filters->push_back(buildIsbnFilter(*(*current.isbnIndex)[p]));
+    }
+    CatalogVersion* next = new CatalogVersion(current);
+    next->isbnFilters = filters;
+    publish(next);
+    filterLookups_ = 0;
+    filterRejections_ = 0;
+    filterFalsePositives_ = 0;
+}
+
+void LibrarySystem::notifyListeners(const MutationRecord& record) const {
+    for (std::size_t i = 0; i < listeners_.size(); ++i) {
+        listeners_[i].second(record);
+    }
+}
+
+const LibrarySystem::Book& LibrarySystem::bookAt(const CatalogVersion& version, std::size_t index) {
+    return bookChunk(version, index / kChunkSize).data()[index % kChunkSize];
+}
+
+unsigned LibrarySystem::loansAt(const CatalogVersion& version, std::size_t index) {
+    return loanChunk(version, index / kChunkSize).data()[index % kChunkSize];
+}
+
+LibrarySystem::BookChunk& LibrarySystem::bookChunk(const CatalogVersion& version, std::size_t chunk) {
+    return *(*(*version.books)[chunk / kPageSize])[chunk % kPageSize];
+}
+
+LibrarySystem::LoanChunk& LibrarySystem::loanChunk(const CatalogVersion& version, std::size_t chunk) {
+    return *(*(*version.loans)[chunk / kPageSize])[chunk % kPageSize];
+}
+
+void LibrarySystem::setLoanChunk(CatalogVersion& version, std::size_t chunk, const std::shared_ptr<LoanChunk>& loans) {
+    // The copied page keeps room for kPageSize chunks, so appendChunk() can fill it in place.
+    std::shared_ptr<LoanPage> page = std::make_shared<LoanPage>();
+    page->reserve(kPageSize);
+    const LoanPage& previous = *(*version.loans)[chunk / kPageSize];
+    page->assign(previous.begin(), previous.end());
+    (*page)[chunk % kPageSize] = loans;
+    std::shared_ptr<LoanDirectory> directory = std::make_shared<LoanDirectory>(*version.loans);
+    (*directory)[chunk / kPageSize] = page;
+    version.loans = directory;
+}
+
+void LibrarySystem::appendChunk(CatalogVersion& next) {
+    // A new page copies the directory; otherwise the chunk is appended to the
+    // last page in place, past what older versions read.
+    if (next.chunkCount % kPageSize == 0) {
+        std::shared_ptr<BookDirectory> books = std::make_shared<BookDirectory>(*next.books);
+        books->push_back(std::make_shared<BookPage>());
+        books->back()->reserve(kPageSize);
+        next.books = books;
+        std::shared_ptr<LoanDirectory> loans = std::make_shared<LoanDirectory>(*next.loans);
+        loans->push_back(std::make_shared<LoanPage>());
+        loans->back()->reserve(kPageSize);
+        next.loans = loans;
+        catalogBytes_ += 2 * kPageSize * sizeof(std::shared_ptr<BookChunk>);
+    }
+    std::shared_ptr<BookChunk> books = std::make_shared<BookChunk>();
+    books->reserve(kChunkSize);
+    next.books->back()->push_back(books);
+    std::shared_ptr<LoanChunk> loans = std::make_shared<LoanChunk>();
+    loans->reserve(kChunkSize);
+    next.loans->back()->push_back(loans);
+    ++next.chunkCount;
+    catalogBytes_ += kChunkSize * (sizeof(Book) + sizeof(unsigned));
+}
+
+void LibrarySystem::publish(CatalogVersion* next) {
+    const CatalogVersion* previous = current_.exchange(next);
+    epochs_.retire([previous]() { delete previous; });
+    epochs_.reclaim();
+}
+
+void LibrarySystem::sealTail(CatalogVersion& next) {
+    std::vector<SearchSegment::Posting> postings;
+    for (std::size_t i = next.sealedCount; i < next.bookCount; ++i) {
+        const Book& book = bookAt(next, i);
+        for (std::size_t t = 0; t < book.terms.size(); ++t) {
+            postings.push_back(SearchSegment::Posting(book.terms[t], static_cast<SearchSegment::DocId>(i)));
+        }
+    }
+    next.segments.push_back(SearchSegment::build(postings, next.bookCount - next.sealedCount, &postingsTracker_));
+    next.sealedCount = next.bookCount;
+    budgetCheck_ = memoryBudget_.load() != 0;
+    mergeCondition_.notify_one();
+}
+
+bool LibrarySystem::pickMerge(const SegmentList& segments, SegmentList& picked) {
+    // Tiered policy: a segment of n sealed tails is in tier floor(log_k(n));
+    // kMergeFactor segments of one tier are merged into the next tier.
+    std::vector<SegmentList> tiers;
+    for (std::size_t s = 0; s < segments.size(); ++s) {
+        std::size_t tier = 0;
+        for (std::size_t n = segments[s]->documentCount() / kSealThreshold; n >= kMergeFactor; n /= kMergeFactor) {
+            ++tier;
+        }
+        if (tier >= tiers.size()) {
+            tiers.resize(tier + 1);
+        }
+        tiers[tier].push_back(segments[s]);
+        if (tiers[tier].size() == kMergeFactor) {
+            picked = tiers[tier];
+            return true;
+        }
+    }
+    picked.clear();
+    return false;
+}
+
+void LibrarySystem::mergeSegments() {
+    std::unique_lock<std::mutex> lock(writeMutex_);
+    while (!stopMerging_) {
+        if (!maintain(lock)) {
+            maintenanceIdle_ = true;
+            idleCondition_.notify_all();
+            mergeCondition_.wait(lock);
+            maintenanceIdle_ = false;
+        }
+    }
+}
+
+bool LibrarySystem::runMaintenance() {
+    if (mergeThread_.joinable()) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(writeMutex_);
+    return maintain(lock);
+}
+
+void LibrarySystem::waitForMaintenance() {
+    if (!mergeThread_.joinable()) {
+        while (runMaintenance()) {
+        }
+        return;
+    }
+    std::unique_lock<std::mutex> lock(writeMutex_);
+    SegmentList inputs;
+    while (!maintenanceIdle_ || budgetCheck_ || suggestRebuild_ || pickMerge(current_.load()->segments, inputs)) {
+        idleCondition_.wait(lock);
+    }
+}
+
+bool LibrarySystem::maintain(std::unique_lock<std::mutex>& lock) {
+    if (budgetCheck_) {
+        budgetCheck_ = false;
+        lock.unlock();
+        enforceBudget();
+        lock.lock();
+        return true;
+    }
+    if (suggestRebuild_) {
+        suggestRebuild_ = false;
+        lock.unlock();
+        rebuildSuggestTrie(false);
+        lock.lock();
+        return true;
+    }
+    SegmentList inputs;
+    if (!pickMerge(current_.load()->segments, inputs)) {
+        return false;
+    }
+
+    // Merging is the expensive part and runs without blocking writers.
+    lock.unlock();
+    std::shared_ptr<const SearchSegment> merged = SearchSegment::merge(inputs, &postingsTracker_);
+    lock.lock();
+
+    // Only one thread maintains the catalog, so all inputs are still present.
+    CatalogVersion* next = new CatalogVersion(*current_.load());
+    SegmentList::iterator position = std::find(next->segments.begin(), next->segments.end(), inputs[0]);
+    *position = merged;
+    for (std::size_t i = 1; i < inputs.size(); ++i) {
+        next->segments.erase(std::find(next->segments.begin(), next->segments.end(), inputs[i]));
+    }
+    publish(next);
+    budgetCheck_ = memoryBudget_.load() != 0;
+    return true;
+}
+
+void LibrarySystem::enforceBudget() {
+    const std::size_t budget = memoryBudget_.load();
+    MemoryUsage usage = memoryUsage();
+    if (budget == 0 || usage.total() <= budget) {
+        return;
+    }
+
+    // Cheapest to rebuild first: cached results, then the suggestion trie.
+    std::shared_ptr<QueryCache> cache = std::atomic_load(&queryCache_);
+    if (cache) {
+        const std::size_t others = usage.total() - usage.queryCache;
+        cache->trim(budget > others ? budget - others : 0);
+        usage = memoryUsage();
+        if (usage.total() <= budget) {
+            return;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(suggestMutex_);
+        suggestTrie_ = SuggestTrie();
+        std::vector<SuggestTrie::Entry>().swap(suggestTail_);
+        suggestBooks_ = 0;
+        suggestEnabled_ = false;
+    }
+    usage = memoryUsage();
+    if (usage.total() <= budget) {
+        return;
+    }
+
+    // Then the segments that were searched least recently.
+    SegmentList candidates;
+    {
+        EpochManager::Guard guard(epochs_);
+        const SegmentList& segments = current_.load()->segments;
+        for (std::size_t i = 0; i < segments.size(); ++i) {
+            if (!segments[i]->mapped()) {
+                candidates.push_back(segments[i]);
+            }
+        }
+    }
+    std::vector<std::pair<uint64_t, std::size_t> > order;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        order.push_back(std::make_pair(candidates[i]->lastUsed(), i));
+    }
+    std::sort(order.begin(), order.end());
+
+    std::string directory;
+    uint64_t serial = 0;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        directory = spillDirectory_;
+        serial = spillCount_;
+        spillCount_ += order.size();
+    }
+    std::vector<std::pair<std::shared_ptr<const SearchSegment>, std::shared_ptr<const SearchSegment> > > spilled;
+    std::size_t excess = usage.total() - budget;
+    for (std::size_t i = 0; i < order.size() && excess > 0; ++i) {
+        const std::shared_ptr<const SearchSegment>& segment = candidates[order[i].second];
+        char name[64];
+        std::snprintf(name, sizeof(name), "/segment-%ld-%p-%llu.spill", static_cast<long>(getpid()),
+                      static_cast<void*>(this), static_cast<unsigned long long>(serial + i));
+        std::shared_ptr<const SearchSegment> mapped = segment->spill(directory + name);
+        if (!mapped) {
+            break;
+        }
+        spilled.push_back(std::make_pair(segment, mapped));
+        excess -= std::min(excess, segment->memoryUsage());
+    }
+    if (spilled.empty()) {
+        return;
+    }
+
+    // Only one thread maintains the catalog, so all spilled ones are still present.
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    CatalogVersion* next = new CatalogVersion(*current_.load());
+    for (std::size_t i = 0; i < spilled.size(); ++i) {
+        *std::find(next->segments.begin(), next->segments.end(), spilled[i].first) = spilled[i].second;
+    }
+    publish(next);
+}
+
+void LibrarySystem::rebuildSuggestTrie(bool enable) {
+    std::lock_guard<std::mutex> build(suggestBuildMutex_);
+    CatalogVersion view;
+    {
+        // suggest() builds a missing trie and the merge thread refreshes an
+        // existing one; either may find that the work was done or dropped.
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::lock_guard<std::mutex> suggestLock(suggestMutex_);
+        if (suggestEnabled_ == enable) {
+            return;
+        }
+        view = *current_.load();
+    }
+
+    // The copied version keeps its chunks alive, so no lock is held while building.
+    std::vector<SuggestTrie::Entry> entries;
+    entries.reserve(view.bookCount * 2);
+    for (std::size_t i = 0; i < view.bookCount; ++i) {
+        addSuggestEntries(bookAt(view, i), loansAt(view, i), entries);
+    }
+    SuggestTrie trie;
+    trie.build(entries);
+    std::vector<SuggestTrie::Entry>().swap(entries);
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    const CatalogVersion& current = *current_.load();
+    // Borrows since the copy replaced the loan chunks and pages they changed.
+    for (std::size_t p = 0; p < view.loans->size(); ++p) {
+        if ((*view.loans)[p] == (*current.loans)[p]) {
+            continue;
+        }
+        for (std::size_t c = p * kPageSize; c < std::min(view.chunkCount, (p + 1) * kPageSize); ++c) {
+            if ((*(*view.loans)[p])[c % kPageSize] == (*(*current.loans)[p])[c % kPageSize]) {
+                continue;
+            }
+            for (std::size_t i = c * kChunkSize; i < std::min(view.bookCount, (c + 1) * kChunkSize); ++i) {
+                const unsigned delta = loansAt(current, i) - loansAt(view, i);
+                if (delta != 0) {
+                    const Book& book = bookAt(view, i);
+                    trie.addPopularity(normalizeText(book.title), delta);
+                    trie.addPopularity(normalizeText(StringPool::global().str(book.author)), delta);
+                }
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> suggestLock(suggestMutex_);
+        std::swap(suggestTrie_, trie);
+        suggestBooks_ = view.bookCount;
+        suggestTail_.clear();
+        suggestEnabled_ = true;
+    }
+    suggestRebuild_ = false;
+    updateSuggestTail(current);
+}
+
+void LibrarySystem::updateSuggestTail(const CatalogVersion& version) {
+    std::lock_guard<std::mutex> lock(suggestMutex_);
+    if (!suggestEnabled_) {
+        return;
+    }
+    const std::size_t end = std::min(version.bookCount, suggestBooks_ + kSuggestTailSize);
+    for (std::size_t i = suggestBooks_ + suggestTail_.size() / 2; i < end; ++i) {
+        addSuggestEntries(bookAt(version, i), loansAt(version, i), suggestTail_);
+    }
+    if (version.bookCount - suggestBooks_ >= kSuggestTailSize / 2 && !suggestRebuild_) {
+        suggestRebuild_ = true;
+        mergeCondition_.notify_one();
+    }
+}
+
+void LibrarySystem::raiseSuggestion(const Book& book, std::size_t index) {
+    std::lock_guard<std::mutex> lock(suggestMutex_);
+    if (!suggestEnabled_) {
+        return;
+    }
+    if (index < suggestBooks_) {
+        suggestTrie_.addPopularity(normalizeText(book.title), 1);
+        suggestTrie_.addPopularity(normalizeText(StringPool::global().str(book.author)), 1);
+    } else if ((index - suggestBooks_) * 2 < suggestTail_.size()) {
+        ++suggestTail_[(index - suggestBooks_) * 2].popularity;
+        ++suggestTail_[(index - suggestBooks_) * 2 + 1].popularity;
+    }
+}
+
+void LibrarySystem::addSuggestEntries(const Book& book, unsigned loans, std::vector<SuggestTrie::Entry>& entries) {
+    SuggestTrie::Entry title = {normalizeText(book.title), book.title, loans};
+    const std::string authorName = StringPool::global().str(book.author);
+    SuggestTrie::Entry author = {normalizeText(authorName), authorName, loans};
+    entries.push_back(title);
+    entries.push_back(author);
+}
@@ -0,0 +1,429 @@
+//!
+//! @file loan_event_store.cpp
+//! @brief Implementation of the append-only, columnar borrow/return event store
+//!
+
+#include "library_system/loan_event_store.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+// Events decoded per batch; the decoded columns of a batch stay in L1.
+const std::size_t kBatch = 1024;
+// User ID ranges up to this size are counted in a dense array.
+const std::size_t kMaxDenseUsers = std::size_t(1) << 22;
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t getVarint(const uint8_t*& in) {
+    uint64_t value = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        const uint8_t byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+unsigned bitWidth(uint64_t maxValue) {
+    return maxValue == 0 ? 0 : 64 - __builtin_clzll(maxValue);
+}
+
+void pack(const std::vector<uint32_t>& values, unsigned bits, std::vector<uint64_t>& words) {
+    words.assign((values.size() * bits + 63) / 64, 0);
+    for (std::size_t i = 0; i < values.size() && bits > 0; ++i) {
+        const std::size_t bit = i * bits;
+        const unsigned shift = bit & 63;
+        words[bit >> 6] |= static_cast<uint64_t>(values[i]) << shift;
+        if (shift + bits > 64) {
+            words[(bit >> 6) + 1] |= static_cast<uint64_t>(values[i]) >> (64 - shift);
+        }
+    }
+}
+
+void unpack(const std::vector<uint64_t>& words, unsigned bits, std::size_t begin, std::size_t count, uint32_t* out) {
+    if (bits == 0) {
+        std::fill(out, out + count, 0u);
+        return;
+    }
+    const uint64_t mask = (static_cast<uint64_t>(1) << bits) - 1;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t bit = (begin + i) * bits;
+        const unsigned shift = bit & 63;
+        uint64_t value = words[bit >> 6] >> shift;
+        if (shift + bits > 64) {
+            value |= words[(bit >> 6) + 1] << (64 - shift);
+        }
+        out[i] = static_cast<uint32_t>(value & mask);
+    }
+}
+
+bool matches(const LoanEvent& event, int64_t from, int64_t to, LoanEventFilter filter) {
+    return event.timestamp >= from && event.timestamp < to &&
+           (filter == LOAN_EVENTS_ALL || event.returned == (filter == LOAN_EVENTS_RETURNS));
+}
+
+bool bookCountsBefore(const LoanEventStore::BookCount& a, const LoanEventStore::BookCount& b) {
+    return a.count != b.count ? a.count > b.count : a.isbn < b.isbn;
+}
+
+bool userCountsBefore(const LoanEventStore::UserCount& a, const LoanEventStore::UserCount& b) {
+    return a.count != b.count ? a.count > b.count : a.userId < b.userId;
+}
+
+template <typename Count, typename Less>
+void sortAndLimit(std::vector<Count>& counts, std::size_t limit, Less less) {
+    if (limit != 0 && counts.size() > limit) {
+        std::partial_sort(counts.begin(), counts.begin() + limit, counts.end(), less);
+        counts.resize(limit);
+    } else {
+        std::sort(counts.begin(), counts.end(), less);
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Immutable, column-compressed block of events.
+ */
+struct LoanEventStore::Chunk
+{
+    std::size_t count;
+    int64_t minTimestamp;
+    int64_t maxTimestamp;
+    std::vector<uint8_t> timestamps;   ///< Zigzag varint delta-of-deltas.
+    std::vector<uint8_t> dictionary;   ///< Sorted distinct ISBN keys as varint deltas.
+    std::size_t dictionarySize;
+    unsigned isbnBits;
+    std::vector<uint64_t> isbnCodes;   ///< Bit-packed dictionary codes.
+    int32_t minUser;
+    unsigned userBits;
+    std::vector<uint64_t> userOffsets; ///< Bit-packed userId - minUser.
+    std::vector<uint64_t> returned;    ///< One bit per event, set for returns.
+
+    /**
+     * @brief Compute the selection vector of every batch and pass it on.
+     * @param from The start of the time window, inclusive.
+     * @param to The end of the time window, exclusive.
+     * @param filter The kind of events to select.
+     * @param visit Called with (selected, begin, count) per batch; selected[i] is 0 or 1.
+     */
+    template <typename Visitor>
+    void scan(int64_t from, int64_t to, LoanEventFilter filter, Visitor visit) const {
+        if (maxTimestamp < from || minTimestamp >= to) {
+            return;
+        }
+        // Timestamps are only decoded for chunks straddling the window.
+        const bool inside = from <= minTimestamp && maxTimestamp < to;
+        const uint8_t* cursor = timestamps.data();
+        int64_t previous = 0;
+        int64_t delta = 0;
+        uint8_t selected[kBatch];
+        for (std::size_t begin = 0; begin < count; begin += kBatch) {
+            const std::size_t n = std::min(kBatch, count - begin);
+            if (inside) {
+                std::fill(selected, selected + n, 1);
+            } else {
+                for (std::size_t i = 0; i < n; ++i) {
+                    delta += unzigzag(getVarint(cursor));
+                    previous += delta;
+                    selected[i] = static_cast<uint8_t>((previous >= from) & (previous < to));
+                }
+            }
+            if (filter != LOAN_EVENTS_ALL) {
+                const uint64_t want = filter == LOAN_EVENTS_RETURNS ? 1 : 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    const std::size_t event = begin + i;
+                    selected[i] &= static_cast<uint8_t>(((returned[event >> 6] >> (event & 63)) & 1) == want);
+                }
+            }
+            visit(selected, begin, n);
+        }
+    }
+
+    /**
+     * @brief Decode the ISBN dictionary.
+     * @param keys Receives the ISBN key of every code.
+     */
+    void decodeDictionary(std::vector<IsbnKey>& keys) const {
+        keys.resize(dictionarySize);
+        const uint8_t* cursor = dictionary.data();
+        IsbnKey key = 0;
+        for (std::size_t i = 0; i < dictionarySize; ++i) {
+            key += getVarint(cursor);
+            keys[i] = key;
+        }
+    }
+
+    /**
+     * @brief Get the memory used by the chunk.
+     * @return The size in bytes.
+     */
+    std::size_t memoryUsage() const {
+        return sizeof(*this) + timestamps.capacity() + dictionary.capacity() +
+               (isbnCodes.capacity() + userOffsets.capacity() + returned.capacity()) * sizeof(uint64_t);
+    }
+};
+
+// Implementation of LoanEventStore class methods
+
+const std::size_t LoanEventStore::kChunkEvents;
+
+LoanEventStore::LoanEventStore() {
+    open_.reserve(kChunkEvents);
+}
+
+LoanEventStore::~LoanEventStore() {}
+
+void LoanEventStore::append(const LoanEvent& event) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_.push_back(event);
+    if (open_.size() == kChunkEvents) {
+        chunks_.push_back(std::shared_ptr<const Chunk>(seal(open_)));
+        open_.clear();
+    }
+}
+
+bool LoanEventStore::record(const MutationRecord& record, int64_t timestamp) {
+    if (record.type != MUTATION_BORROW && record.type != MUTATION_RETURN) {
+        return false;
+    }
+    LoanEvent event = {timestamp, record.isbn, record.value, record.type == MUTATION_RETURN};
+    append(event);
+    return true;
+}
+
+std::vector<LoanEventStore::BookCount> LoanEventStore::countByBook(int64_t from, int64_t to, LoanEventFilter filter,
+                                                                   std::size_t limit) const {
+    ChunkList chunks;
+    std::vector<LoanEvent> open;
+    snapshot(chunks, open);
+
+    std::unordered_map<IsbnKey, uint64_t> totals;
+    std::vector<uint64_t> counts;
+    std::vector<IsbnKey> keys;
+    uint32_t codes[kBatch];
+    for (std::size_t c = 0; c < chunks.size(); ++c) {
+        const Chunk& chunk = *chunks[c];
+        // Count by dictionary code; the keys are only decoded once per chunk.
+        counts.assign(chunk.dictionarySize, 0);
+        chunk.scan(from, to, filter, [&](const uint8_t* selected, std::size_t begin, std::size_t n) {
+            unpack(chunk.isbnCodes, chunk.isbnBits, begin, n, codes);
+            for (std::size_t i = 0; i < n; ++i) {
+                counts[codes[i]] += selected[i];
+            }
+        });
+        if (std::count(counts.begin(), counts.end(), 0) == static_cast<std::ptrdiff_t>(counts.size())) {
+            continue;
+        }
+        chunk.decodeDictionary(keys);
+        for (std::size_t code = 0; code < counts.size(); ++code) {
+            if (counts[code] != 0) {
+                totals[keys[code]] += counts[code];
+            }
+        }
+    }
+    for (std::size_t i = 0; i < open.size(); ++i) {
+        if (matches(open[i], from, to, filter)) {
+            ++totals[open[i].isbn];
+        }
+    }
+
+    std::vector<BookCount> result;
+    result.reserve(totals.size());
+    for (std::unordered_map<IsbnKey, uint64_t>::const_iterator it = totals.begin(); it != totals.end(); ++it) {
+        BookCount count = {it->first, it->second};
+        result.push_back(count);
+    }
+    sortAndLimit(result, limit, bookCountsBefore);
+    return result;
+}
+
+std::vector<LoanEventStore::UserCount> LoanEventStore::countByUser(int64_t from, int64_t to, LoanEventFilter filter,
+                                                                   std::size_t limit) const {
+    ChunkList chunks;
+    std::vector<LoanEvent> open;
+    snapshot(chunks, open);
+
+    // Count into one dense array over all chunks when the user IDs are close together.
+    int64_t low = INT32_MAX;
+    int64_t high = INT32_MIN;
+    for (std::size_t c = 0; c < chunks.size(); ++c) {
+        low = std::min<int64_t>(low, chunks[c]->minUser);
+        high = std::max<int64_t>(high, chunks[c]->minUser + (static_cast<int64_t>(1) << chunks[c]->userBits) - 1);
+    }
+    for (std::size_t i = 0; i < open.size(); ++i) {
+        low = std::min<int64_t>(low, open[i].userId);
+        high = std::max<int64_t>(high, open[i].userId);
+    }
+    const bool dense = high >= low && high - low < static_cast<int64_t>(kMaxDenseUsers);
+    std::vector<uint64_t> counts(dense ? static_cast<std::size_t>(high - low + 1) : 0, 0);
+    std::unordered_map<int32_t, uint64_t> totals;
+
+    uint32_t offsets[kBatch];
+    for (std::size_t c = 0; c < chunks.size(); ++c) {
+        const Chunk& chunk = *chunks[c];
+        uint64_t* base = dense ? &counts[static_cast<std::size_t>(chunk.minUser - low)] : 0;
+        chunk.scan(from, to, filter, [&](const uint8_t* selected, std::size_t begin, std::size_t n) {
+            unpack(chunk.userOffsets, chunk.userBits, begin, n, offsets);
+            if (dense) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    base[offsets[i]] += selected[i];
+                }
+                return;
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                if (selected[i]) {
+                    ++totals[static_cast<int32_t>(chunk.minUser + static_cast<int64_t>(offsets[i]))];
+                }
+            }
+        });
+    }
+    for (std::size_t i = 0; i < open.size(); ++i) {
+        if (matches(open[i], from, to, filter)) {
+            if (dense) {
+                ++counts[static_cast<std::size_t>(open[i].userId - low)];
+            } else {
+                ++totals[open[i].userId];
+            }
+        }
+    }
+
+    std::vector<UserCount> result;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != 0) {
+            UserCount count = {static_cast<int32_t>(low + static_cast<int64_t>(i)), counts[i]};
+            result.push_back(count);
+        }
+    }
+    for (std::unordered_map<int32_t, uint64_t>::const_iterator it = totals.begin(); it != totals.end(); ++it) {
+        UserCount count = {it->first, it->second};
+        result.push_back(count);
+    }
+    sortAndLimit(result, limit, userCountsBefore);
+    return result;
+}
+
+uint64_t LoanEventStore::count(int64_t from, int64_t to, LoanEventFilter filter) const {
+    ChunkList chunks;
+    std::vector<LoanEvent> open;
+    snapshot(chunks, open);
+
+    uint64_t total = 0;
+    for (std::size_t c = 0; c < chunks.size(); ++c) {
+        chunks[c]->scan(from, to, filter, [&total](const uint8_t* selected, std::size_t, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) {
+                total += selected[i];
+            }
+        });
+    }
+    for (std::size_t i = 0; i < open.size(); ++i) {
+        total += matches(open[i], from, to, filter) ? 1 : 0;
+    }
+    return total;
+}
+
+std::size_t LoanEventStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size() * kChunkEvents + open_.size();
+}
+
+std::size_t LoanEventStore::chunkCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size();
+}
+
+std::size_t LoanEventStore::rawBytes() const {
+    return size() * sizeof(LoanEvent);
+}
+
+std::size_t LoanEventStore::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t bytes = open_.capacity() * sizeof(LoanEvent);
+    for (std::size_t c = 0; c < chunks_.size(); ++c) {
+        bytes += chunks_[c]->memoryUsage();
+    }
+    return bytes;
+}
+
+void LoanEventStore::snapshot(ChunkList& chunks, std::vector<LoanEvent>& open) const {
+    // Sealed chunks are immutable, so only the row buffer is copied.
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunks = chunks_;
+    open = open_;
+}
+
+LoanEventStore::Chunk* LoanEventStore::seal(const std::vector<LoanEvent>& events) {
+    Chunk* chunk = new Chunk();
+    chunk->count = events.size();
+    chunk->minTimestamp = events[0].timestamp;
+    chunk->maxTimestamp = events[0].timestamp;
+    chunk->minUser = events[0].userId;
+    int32_t maxUser = events[0].userId;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        chunk->minTimestamp = std::min(chunk->minTimestamp, events[i].timestamp);
+        chunk->maxTimestamp = std::max(chunk->maxTimestamp, events[i].timestamp);
+        chunk->minUser = std::min(chunk->minUser, events[i].userId);
+        maxUser = std::max(maxUser, events[i].userId);
+    }
+
+    // Evenly spaced timestamps encode as runs of zero bytes.
+    int64_t previous = 0;
+    int64_t delta = 0;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        const int64_t next = static_cast<int64_t>(static_cast<uint64_t>(events[i].timestamp) - previous);
+        putVarint(chunk->timestamps, zigzag(static_cast<int64_t>(static_cast<uint64_t>(next) - delta)));
+        delta = next;
+        previous = events[i].timestamp;
+    }
+    chunk->timestamps.shrink_to_fit();
+
+    std::vector<IsbnKey> keys(events.size());
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        keys[i] = events[i].isbn;
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    IsbnKey previousKey = 0;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        putVarint(chunk->dictionary, keys[i] - previousKey);
+        previousKey = keys[i];
+    }
+    chunk->dictionary.shrink_to_fit();
+    chunk->dictionarySize = keys.size();
+    chunk->isbnBits = bitWidth(keys.size() - 1);
+    std::vector<uint32_t> values(events.size());
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        values[i] = static_cast<uint32_t>(std::lower_bound(keys.begin(), keys.end(), events[i].isbn) - keys.begin());
+    }
+    pack(values, chunk->isbnBits, chunk->isbnCodes);
+
+    chunk->userBits = bitWidth(static_cast<uint64_t>(static_cast<int64_t>(maxUser) - chunk->minUser));
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        values[i] = static_cast<uint32_t>(static_cast<int64_t>(events[i].userId) - chunk->minUser);
+    }
+    pack(values, chunk->userBits, chunk->userOffsets);
+
+    chunk->returned.assign((events.size() + 63) / 64, 0);
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        chunk->returned[i >> 6] |= static_cast<uint64_t>(events[i].returned) << (i & 63);
+    }
+    return chunk;
+}
@@ -0,0 +1,41 @@
+//!
+//! @file memory_tracker.cpp
+//! @brief Implementation of the MemoryTracker byte counter and the heapBytes() helpers
+//!
+
+#include "library_system/memory_tracker.hpp"
+
+MemoryTracker::MemoryTracker()
+    : bytes_(0), peak_(0) {}
+
+void MemoryTracker::allocated(std::size_t bytes) {
+    const std::size_t now = bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    std::size_t peak = peak_.load(std::memory_order_relaxed);
+    while (now > peak && !peak_.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryTracker::released(std::size_t bytes) {
+    bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+std::size_t MemoryTracker::bytes() const {
+    return bytes_.load(std::memory_order_relaxed);
+}
+
+std::size_t MemoryTracker::peakBytes() const {
+    return peak_.load(std::memory_order_relaxed);
+}
+
+std::size_t heapBytes(const std::string& text) {
+    // Short strings are stored inline.
+    return text.capacity() > 15 ? text.capacity() + 1 : 0;
+}
+
+std::size_t heapBytes(const std::vector<std::string>& texts) {
+    std::size_t bytes = texts.capacity() * sizeof(std::string);
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        bytes += heapBytes(texts[i]);
+    }
+    return bytes;
+}
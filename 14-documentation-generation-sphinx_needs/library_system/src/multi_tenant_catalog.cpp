@@ -0,0 +1,363 @@
+//!
+//! @file multi_tenant_catalog.cpp
+//! @brief Implementation of the MultiTenantCatalog shared-index catalog of many tenants
+//!
+
+#include "library_system/multi_tenant_catalog.hpp"
+
+#include "library_system/flat_format.hpp"
+#include "library_system/text_tokenizer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace {
+
+bool readFile(const std::string& path, std::vector<char>& data) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == 0) {
+        return false;
+    }
+    bool read = std::fseek(file, 0, SEEK_END) == 0;
+    const long size = read ? std::ftell(file) : -1;
+    read = size >= 0 && std::fseek(file, 0, SEEK_SET) == 0;
+    if (read) {
+        data.resize(static_cast<std::size_t>(size));
+        read = std::fread(data.data(), 1, data.size(), file) == data.size();
+    }
+    std::fclose(file);
+    return read;
+}
+
+// Tenant texts are stored as a 32-bit length followed by the characters.
+uint32_t storeText(std::string& arena, const std::string& text) {
+    const uint32_t offset = static_cast<uint32_t>(arena.size());
+    const uint32_t size = static_cast<uint32_t>(text.size());
+    arena.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    arena.append(text);
+    return offset;
+}
+
+std::string loadText(const std::string& arena, uint32_t offset) {
+    uint32_t size;
+    std::memcpy(&size, arena.data() + offset, sizeof(size));
+    return arena.substr(offset + sizeof(size), size);
+}
+
+bool byCardinality(const RoaringBitmap* a, const RoaringBitmap* b) {
+    return a->cardinality() < b->cardinality();
+}
+
+} // namespace
+
+MultiTenantCatalog::Tenant::Tenant()
+    : isbns(new IsbnIndex(IsbnIndex::allocator_type(&indexTracker))), postingEntries(0), bookCount(0),
+      lastUsed(Clock::now()) {}
+
+MultiTenantCatalog::MultiTenantCatalog(const std::string& spillDirectory)
+    : spillDirectory_(spillDirectory), spillCount_(0), docCount_(0),
+      termIds_(TermIndex::allocator_type(&termTracker_)) {}
+
+MultiTenantCatalog::~MultiTenantCatalog() {
+    for (std::size_t i = 0; i < tenants_.size(); ++i) {
+        if (!tenants_[i]->spillPath.empty()) {
+            std::remove(tenants_[i]->spillPath.c_str());
+        }
+    }
+}
+
+bool MultiTenantCatalog::addBook(const std::string& tenant, const std::string& title, const std::string& author,
+                                 const std::string& isbn) {
+    const IsbnKey key = parseIsbn(isbn);
+    if (key == kInvalidIsbn) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Tenant& owner = useTenant(tenant);
+    if (!owner.spillPath.empty() || owner.isbns->count(key) != 0) {
+        return false;
+    }
+    insert(tenantIndex_[tenant], allocateDoc(), title, author, key, 0);
+    return true;
+}
+
+bool MultiTenantCatalog::borrowBook(const std::string& tenant, const std::string& isbn) {
+    const IsbnKey key = parseIsbn(isbn);
+    std::lock_guard<std::mutex> lock(mutex_);
+    Tenant* owner = findTenant(tenant);
+    if (key == kInvalidIsbn || owner == 0 || !load(*owner)) {
+        return false;
+    }
+    owner->lastUsed = Clock::now();
+    IsbnIndex::const_iterator it = owner->isbns->find(key);
+    if (it == owner->isbns->end()) {
+        return false;
+    }
+    ++doc(it->second).loans;
+    return true;
+}
+
+unsigned MultiTenantCatalog::loans(const std::string& tenant, const std::string& isbn) {
+    const IsbnKey key = parseIsbn(isbn);
+    std::lock_guard<std::mutex> lock(mutex_);
+    Tenant* owner = findTenant(tenant);
+    if (key == kInvalidIsbn || owner == 0 || !load(*owner)) {
+        return 0;
+    }
+    owner->lastUsed = Clock::now();
+    IsbnIndex::const_iterator it = owner->isbns->find(key);
+    return it == owner->isbns->end() ? 0 : doc(it->second).loans;
+}
+
+std::vector<std::string> MultiTenantCatalog::searchBooks(const std::string& tenant, const std::string& keyword) {
+    std::vector<std::string> results;
+    const std::vector<std::string> terms = tokenizeText(keyword);
+    std::lock_guard<std::mutex> lock(mutex_);
+    Tenant* owner = findTenant(tenant);
+    if (terms.empty() || owner == 0 || !load(*owner)) {
+        return results;
+    }
+    owner->lastUsed = Clock::now();
+
+    // The tenant bitmap is just one more operand: intersect smallest first.
+    std::vector<const RoaringBitmap*> operands(1, &owner->docs);
+    for (std::size_t i = 0; i < terms.size(); ++i) {
+        TermIndex::const_iterator term = termIds_.find(terms[i]);
+        if (term == termIds_.end()) {
+            return results;
+        }
+        operands.push_back(&postings_[term->second]);
+    }
+    std::sort(operands.begin(), operands.end(), byCardinality);
+    RoaringBitmap matches = *operands[0] & *operands[1];
+    for (std::size_t i = 2; i < operands.size() && !matches.empty(); ++i) {
+        matches = matches & *operands[i];
+    }
+
+    const std::vector<uint32_t> ids = matches.toVector();
+    results.reserve(ids.size());
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        results.push_back(loadText(owner->texts, doc(ids[i]).title));
+    }
+    return results;
+}
+
+std::size_t MultiTenantCatalog::bookCount(const std::string& tenant) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Tenant* owner = findTenant(tenant);
+    return owner == 0 ? 0 : owner->bookCount;
+}
+
+std::size_t MultiTenantCatalog::tenantCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tenants_.size();
+}
+
+bool MultiTenantCatalog::resident(const std::string& tenant) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Tenant* owner = findTenant(tenant);
+    return owner != 0 && owner->spillPath.empty();
+}
+
+bool MultiTenantCatalog::evictTenant(const std::string& tenant) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Tenant* owner = findTenant(tenant);
+    return owner != 0 && owner->spillPath.empty() && evict(*owner);
+}
+
+std::size_t MultiTenantCatalog::evictIdleTenants(Clock::duration idle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Clock::time_point now = Clock::now();
+    std::size_t evicted = 0;
+    for (std::size_t i = 0; i < tenants_.size(); ++i) {
+        Tenant& tenant = *tenants_[i];
+        if (tenant.spillPath.empty() && now - tenant.lastUsed >= idle && evict(tenant)) {
+            ++evicted;
+        }
+    }
+    return evicted;
+}
+
+std::size_t MultiTenantCatalog::tenantMemoryUsage(const std::string& tenant) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Tenant* owner = findTenant(tenant);
+    if (owner == 0 || !owner->spillPath.empty()) {
+        return 0;
+    }
+    // Posting entries are mostly 16-bit array container slots.
+    return owner->bookCount * sizeof(Doc) + owner->texts.capacity() + owner->indexTracker.bytes() +
+           owner->docs.memoryUsage() + owner->postingEntries * sizeof(uint16_t);
+}
+
+std::size_t MultiTenantCatalog::sharedMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t bytes = docChunks_.capacity() * sizeof(docChunks_[0]) +
+                        docChunks_.size() * kDocsPerChunk * sizeof(Doc) + freeDocs_.capacity() * sizeof(DocId) +
+                        termTracker_.bytes() + postings_.capacity() * sizeof(RoaringBitmap) +
+                        freeTerms_.capacity() * sizeof(uint32_t);
+    for (std::size_t i = 0; i < postings_.size(); ++i) {
+        bytes += postings_[i].memoryUsage();
+    }
+    return bytes;
+}
+
+std::vector<std::string> MultiTenantCatalog::documentTerms(const std::string& title, const std::string& author) {
+    std::vector<std::string> terms = tokenizeText(title + " " + author);
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    return terms;
+}
+
+MultiTenantCatalog::Tenant* MultiTenantCatalog::findTenant(const std::string& name) const {
+    std::unordered_map<std::string, uint32_t>::const_iterator it = tenantIndex_.find(name);
+    return it == tenantIndex_.end() ? 0 : tenants_[it->second].get();
+}
+
+MultiTenantCatalog::Tenant& MultiTenantCatalog::useTenant(const std::string& name) {
+    Tenant* tenant = findTenant(name);
+    if (tenant == 0) {
+        tenantIndex_[name] = static_cast<uint32_t>(tenants_.size());
+        tenants_.push_back(std::unique_ptr<Tenant>(new Tenant()));
+        tenant = tenants_.back().get();
+        tenant->name = name;
+    }
+    load(*tenant);
+    tenant->lastUsed = Clock::now();
+    return *tenant;
+}
+
+bool MultiTenantCatalog::load(Tenant& tenant) {
+    if (tenant.spillPath.empty()) {
+        return true;
+    }
+    std::vector<char> data;
+    if (!readFile(tenant.spillPath, data)) {
+        return false;
+    }
+    FlatReader reader(data.data(), data.size());
+    if (!reader.valid() || reader.kind() != FLAT_BOOK) {
+        return false;
+    }
+    const std::string path = tenant.spillPath;
+    tenant.spillPath.clear();
+    tenant.bookCount = 0;
+    // Reused ids come back in any order; sorting them keeps the tenant's books in their old order.
+    std::vector<DocId> ids(reader.size());
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = allocateDoc();
+    }
+    std::sort(ids.begin(), ids.end());
+    const uint32_t index = tenantIndex_[tenant.name];
+    for (std::size_t i = 0; i < reader.size(); ++i) {
+        const BookView book = reader.book(i);
+        insert(index, ids[i], book.title().str(), book.author().str(), book.isbn(), book.loans());
+    }
+    std::remove(path.c_str());
+    return true;
+}
+
+bool MultiTenantCatalog::evict(Tenant& tenant) {
+    char name[96];
+    std::snprintf(name, sizeof(name), "/tenant-%ld-%p-%llu.flat", static_cast<long>(getpid()),
+                  static_cast<const void*>(this), static_cast<unsigned long long>(spillCount_++));
+    const std::string path = spillDirectory_ + name;
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == 0) {
+        return false;
+    }
+
+    const std::vector<uint32_t> ids = tenant.docs.toVector();
+    FlatWriter writer(FLAT_BOOK);
+    bool written = writer.streamTo(file, ids.size());
+    for (std::size_t i = 0; written && i < ids.size(); ++i) {
+        const Doc& book = doc(ids[i]);
+        writer.addBook(loadText(tenant.texts, book.title), loadText(tenant.texts, book.author), book.isbn,
+                       book.loans);
+    }
+    written = written && writer.finish(file);
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::remove(path.c_str());
+        return false;
+    }
+
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        unindex(tenant, ids[i]);
+    }
+    tenant.docs = RoaringBitmap();
+    std::string().swap(tenant.texts);
+    tenant.isbns.reset(new IsbnIndex(IsbnIndex::allocator_type(&tenant.indexTracker)));
+    tenant.postingEntries = 0;
+    tenant.spillPath = path;
+    return true;
+}
+
+MultiTenantCatalog::Doc& MultiTenantCatalog::doc(DocId id) const {
+    return docChunks_[id / kDocsPerChunk][id % kDocsPerChunk];
+}
+
+MultiTenantCatalog::DocId MultiTenantCatalog::allocateDoc() {
+    if (!freeDocs_.empty()) {
+        const DocId id = freeDocs_.back();
+        freeDocs_.pop_back();
+        return id;
+    }
+    if (docCount_ % kDocsPerChunk == 0) {
+        docChunks_.push_back(std::unique_ptr<Doc[]>(new Doc[kDocsPerChunk]));
+    }
+    return docCount_++;
+}
+
+void MultiTenantCatalog::insert(uint32_t tenantIndex, DocId id, const std::string& title, const std::string& author,
+                                IsbnKey isbn, uint32_t loans) {
+    Tenant& tenant = *tenants_[tenantIndex];
+    const uint32_t titleOffset = storeText(tenant.texts, title);
+    const Doc record = {tenantIndex, titleOffset, storeText(tenant.texts, author), isbn, loans};
+    doc(id) = record;
+
+    const std::vector<std::string> terms = documentTerms(title, author);
+    for (std::size_t i = 0; i < terms.size(); ++i) {
+        TermIndex::iterator term = termIds_.find(terms[i]);
+        if (term == termIds_.end()) {
+            uint32_t termId = static_cast<uint32_t>(postings_.size());
+            if (freeTerms_.empty()) {
+                postings_.push_back(RoaringBitmap());
+            } else {
+                termId = freeTerms_.back();
+                freeTerms_.pop_back();
+            }
+            term = termIds_.insert(std::make_pair(terms[i], termId)).first;
+        }
+        postings_[term->second].add(id);
+    }
+    tenant.postingEntries += terms.size();
+    tenant.docs.add(id);
+    (*tenant.isbns)[isbn] = id;
+    ++tenant.bookCount;
+}
+
+void MultiTenantCatalog::unindex(Tenant& tenant, DocId id) {
+    Doc& record = doc(id);
+    const std::vector<std::string> terms =
+        documentTerms(loadText(tenant.texts, record.title), loadText(tenant.texts, record.author));
+    for (std::size_t i = 0; i < terms.size(); ++i) {
+        TermIndex::iterator term = termIds_.find(terms[i]);
+        if (term == termIds_.end()) {
+            continue;
+        }
+        RoaringBitmap& posting = postings_[term->second];
+        posting.remove(id);
+        // A term no resident book contains leaves the dictionary.
+        if (posting.empty()) {
+            posting = RoaringBitmap();
+            freeTerms_.push_back(term->second);
+            termIds_.erase(term);
+        }
+    }
+    tenant.postingEntries -= terms.size();
+    record.tenant = kNoTenant;
+    freeDocs_.push_back(id);
+}
@@ -0,0 +1,176 @@
+//!
+//! @file query_cache.cpp
+//! @brief Implementation of the QueryCache search result cache
+//!
+
+#include "library_system/query_cache.hpp"
+
+#include "library_system/memory_tracker.hpp"
+
+#include <algorithm>
+#include <functional>
+
+QueryCache::QueryCache(std::size_t capacity, std::size_t shardCount)
+    : shardCapacity_(0), hits_(0), misses_(0), invalidations_(0), evictions_(0), bytes_(0) {
+    if (shardCount == 0) {
+        shardCount = 1;
+    }
+    shardCapacity_ = (capacity + shardCount - 1) / shardCount;
+    for (std::size_t i = 0; i < shardCount; ++i) {
+        std::unique_ptr<Shard> shard(new Shard());
+        shard->invalidatedGeneration = 0;
+        shards_.push_back(std::move(shard));
+    }
+}
+
+std::string QueryCache::makeKey(std::vector<std::string> terms) {
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    std::string key;
+    for (std::size_t i = 0; i < terms.size(); ++i) {
+        if (i != 0) {
+            key.push_back(' ');
+        }
+        key += terms[i];
+    }
+    return key;
+}
+
+bool QueryCache::lookup(const std::string& key, std::vector<std::string>& results) {
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+        ++misses_;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    results = it->second->results;
+    ++hits_;
+    return true;
+}
+
+void QueryCache::insert(const std::string& key, const std::vector<std::string>& terms,
+                        const std::vector<std::string>& results, uint64_t generation) {
+    if (shardCapacity_ == 0) {
+        return;
+    }
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // A book added while the search ran may be missing from the results.
+    if (generation < shard.invalidatedGeneration) {
+        return;
+    }
+
+    std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+        erase(shard, it->second);
+    }
+    while (shard.entries.size() >= shardCapacity_) {
+        erase(shard, --shard.lru.end());
+        ++evictions_;
+    }
+
+    Entry entry = {key, terms, results, generation, 0};
+    entry.bytes = entryBytes(entry);
+    bytes_ += entry.bytes;
+    shard.lru.push_front(entry);
+    shard.entries[key] = shard.lru.begin();
+    for (std::size_t i = 0; i < terms.size(); ++i) {
+        shard.termKeys[terms[i]].insert(key);
+    }
+}
+
+void QueryCache::invalidate(const std::vector<std::string>& terms, uint64_t generation) {
+    for (std::size_t s = 0; s < shards_.size(); ++s) {
+        Shard& shard = *shards_[s];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.invalidatedGeneration = std::max(shard.invalidatedGeneration, generation);
+
+        for (std::size_t t = 0; t < terms.size(); ++t) {
+            std::unordered_map<std::string, std::unordered_set<std::string> >::iterator term =
+                shard.termKeys.find(terms[t]);
+            if (term == shard.termKeys.end()) {
+                continue;
+            }
+            // erase() edits termKeys, so detach the affected keys first.
+            std::vector<std::string> keys(term->second.begin(), term->second.end());
+            for (std::size_t k = 0; k < keys.size(); ++k) {
+                std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it = shard.entries.find(keys[k]);
+                if (it != shard.entries.end()) {
+                    erase(shard, it->second);
+                    ++invalidations_;
+                }
+            }
+        }
+    }
+}
+
+void QueryCache::invalidateAll(uint64_t generation) {
+    for (std::size_t s = 0; s < shards_.size(); ++s) {
+        Shard& shard = *shards_[s];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.invalidatedGeneration = std::max(shard.invalidatedGeneration, generation);
+        invalidations_ += shard.entries.size();
+        while (!shard.lru.empty()) {
+            erase(shard, shard.lru.begin());
+        }
+    }
+}
+
+QueryCache::Stats QueryCache::stats() const {
+    Stats stats = {hits_.load(), misses_.load(), invalidations_.load(), evictions_.load()};
+    return stats;
+}
+
+std::size_t QueryCache::memoryUsage() const {
+    return bytes_.load();
+}
+
+void QueryCache::trim(std::size_t maxBytes) {
+    // Take the oldest entry of every shard in turn, so no shard is emptied first.
+    bool evicted = true;
+    while (bytes_.load() > maxBytes && evicted) {
+        evicted = false;
+        for (std::size_t s = 0; s < shards_.size() && bytes_.load() > maxBytes; ++s) {
+            Shard& shard = *shards_[s];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.lru.empty()) {
+                erase(shard, --shard.lru.end());
+                ++evictions_;
+                evicted = true;
+            }
+        }
+    }
+}
+
+QueryCache::Shard& QueryCache::shardFor(const std::string& key) {
+    return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+void QueryCache::erase(Shard& shard, std::list<Entry>::iterator entry) {
+    for (std::size_t i = 0; i < entry->terms.size(); ++i) {
+        std::unordered_map<std::string, std::unordered_set<std::string> >::iterator term =
+            shard.termKeys.find(entry->terms[i]);
+        if (term != shard.termKeys.end()) {
+            term->second.erase(entry->key);
+            if (term->second.empty()) {
+                shard.termKeys.erase(term);
+            }
+        }
+    }
+    bytes_ -= entry->bytes;
+    shard.entries.erase(entry->key);
+    shard.lru.erase(entry);
+}
+
+std::size_t QueryCache::entryBytes(const Entry& entry) {
+    // The list node, the key copy and iterator in entries, and one key copy per term in termKeys.
+    const std::size_t node = 2 * sizeof(void*);
+    const std::size_t keyBytes = sizeof(std::string) + heapBytes(entry.key);
+    return node + sizeof(Entry) + heapBytes(entry.key) + heapBytes(entry.terms) + heapBytes(entry.results) +
+           node + keyBytes + sizeof(std::list<Entry>::iterator) + entry.terms.size() * (node + keyBytes);
+}
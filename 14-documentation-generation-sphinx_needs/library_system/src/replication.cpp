@@ -0,0 +1,388 @@
+//!
+//! @file replication.cpp
+//! @brief Implementation of leader/follower log-shipping replication of a LibrarySystem
+//!
+
+#include "library_system/replication.hpp"
+
+#include "library_system/flat_format.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const std::size_t kFrameHeaderSize = sizeof(uint32_t) + sizeof(uint64_t);
+const uint32_t kMaxFrameSize = 64u << 20;
+
+bool makeAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        // MSG_NOSIGNAL: a vanished peer is an error return, not SIGPIPE.
+        const ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool readAll(int fd, char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t received = ::recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+} // namespace
+
+// Implementation of ReplicationLeader class methods
+
+const std::size_t ReplicationLeader::kMaxBatchRecords;
+
+ReplicationLeader::ReplicationLeader(LibrarySystem& library, const std::string& socketPath)
+    : library_(library), socketPath_(socketPath), listenFd_(-1), listener_(0), stopping_(false) {
+    sockaddr_un address;
+    if (!makeAddress(socketPath, address)) {
+        return;
+    }
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) {
+        return;
+    }
+    ::unlink(socketPath.c_str());
+    if (::bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenFd_, 16) != 0) {
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return;
+    }
+
+    listener_ = library_.addMutationListener([this](const MutationRecord& record) { append(record); });
+    acceptor_ = std::thread(&ReplicationLeader::accept, this);
+}
+
+ReplicationLeader::~ReplicationLeader() {
+    if (listenFd_ < 0) {
+        return;
+    }
+    library_.removeMutationListener(listener_);
+    {
+        std::lock_guard<std::mutex> lock(logMutex_);
+        stopping_ = true;
+    }
+    logCondition_.notify_all();
+
+    // Shutting the sockets down wakes the threads blocked in accept() and recv().
+    ::shutdown(listenFd_, SHUT_RDWR);
+    acceptor_.join();
+    ::close(listenFd_);
+    ::unlink(socketPath_.c_str());
+    for (std::size_t i = 0; i < followers_.size(); ++i) {
+        ::shutdown(followers_[i]->fd, SHUT_RDWR);
+        followers_[i]->sender.join();
+        followers_[i]->acknowledger.join();
+        ::close(followers_[i]->fd);
+    }
+}
+
+bool ReplicationLeader::listening() const {
+    return listenFd_ >= 0;
+}
+
+uint64_t ReplicationLeader::lastSequence() const {
+    std::lock_guard<std::mutex> lock(logMutex_);
+    return log_.size();
+}
+
+std::size_t ReplicationLeader::followerCount() const {
+    std::lock_guard<std::mutex> lock(logMutex_);
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < followers_.size(); ++i) {
+        count += followers_[i]->connected.load() ? 1 : 0;
+    }
+    return count;
+}
+
+uint64_t ReplicationLeader::lag() const {
+    std::lock_guard<std::mutex> lock(logMutex_);
+    uint64_t lag = 0;
+    for (std::size_t i = 0; i < followers_.size(); ++i) {
+        if (followers_[i]->connected.load()) {
+            lag = std::max<uint64_t>(lag, log_.size() - followers_[i]->acknowledged.load());
+        }
+    }
+    return lag;
+}
+
+void ReplicationLeader::append(const MutationRecord& record) {
+    // Called with the catalog's write lock held, so the log is in commit order.
+    {
+        std::lock_guard<std::mutex> lock(logMutex_);
+        log_.push_back(record);
+    }
+    logCondition_.notify_all();
+}
+
+void ReplicationLeader::accept() {
+    for (;;) {
+        const int fd = ::accept4(listenFd_, 0, 0, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(logMutex_);
+        if (stopping_) {
+            ::close(fd);
+            return;
+        }
+        // Reap followers that went away; their threads hold no locks any more.
+        for (std::size_t i = 0; i < followers_.size();) {
+            if (followers_[i]->running.load() == 0) {
+                followers_[i]->sender.join();
+                followers_[i]->acknowledger.join();
+                ::close(followers_[i]->fd);
+                followers_[i].swap(followers_.back());
+                followers_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        followers_.push_back(std::unique_ptr<Follower>(new Follower()));
+        Follower* follower = followers_.back().get();
+        follower->fd = fd;
+        follower->acknowledged.store(0);
+        follower->connected.store(true);
+        follower->running.store(2);
+        follower->sender = std::thread(&ReplicationLeader::send, this, follower);
+        follower->acknowledger = std::thread(&ReplicationLeader::receiveAcknowledgements, this, follower);
+    }
+}
+
+void ReplicationLeader::send(Follower* follower) {
+    std::vector<MutationRecord> batch;
+    std::vector<char> buffer;
+    std::size_t position = 0;
+    for (;;) {
+        uint64_t newest = 0;
+        {
+            std::unique_lock<std::mutex> lock(logMutex_);
+            logCondition_.wait(lock, [this, follower, position]() {
+                return stopping_ || !follower->connected.load() || log_.size() > position;
+            });
+            if (stopping_ || !follower->connected.load()) {
+                break;
+            }
+            const std::size_t end = std::min(log_.size(), position + kMaxBatchRecords);
+            batch.assign(log_.begin() + position, log_.begin() + end);
+            newest = log_.size();
+        }
+
+        // Encode outside the lock, so catalog writers appending to the log never wait for a follower.
+        FlatWriter writer(FLAT_MUTATION);
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            writer.addMutation(position + i + 1, batch[i]);
+        }
+        writer.finish(buffer);
+        char header[kFrameHeaderSize];
+        const uint32_t size = static_cast<uint32_t>(buffer.size());
+        std::memcpy(header, &size, sizeof(size));
+        std::memcpy(header + sizeof(size), &newest, sizeof(newest));
+        if (!writeAll(follower->fd, header, sizeof(header)) || !writeAll(follower->fd, buffer.data(), buffer.size())) {
+            // Wakes the acknowledger, which may be blocked reading.
+            follower->connected.store(false);
+            ::shutdown(follower->fd, SHUT_RDWR);
+            break;
+        }
+        position += batch.size();
+    }
+    follower->running.fetch_sub(1);
+}
+
+void ReplicationLeader::receiveAcknowledgements(Follower* follower) {
+    uint64_t applied = 0;
+    while (readAll(follower->fd, reinterpret_cast<char*>(&applied), sizeof(applied))) {
+        follower->acknowledged.store(applied);
+    }
+    // Under the lock, so the sender cannot miss the wakeup between its check and its wait.
+    {
+        std::lock_guard<std::mutex> lock(logMutex_);
+        follower->connected.store(false);
+    }
+    logCondition_.notify_all();
+    follower->running.fetch_sub(1);
+}
+
+// Implementation of ReplicationFollower class methods
+
+const std::size_t ReplicationFollower::kPipelineDepth;
+
+ReplicationFollower::ReplicationFollower(const std::string& socketPath)
+    : fd_(-1), connected_(false), leaderSequence_(0), receiving_(false), applied_(0) {
+    sockaddr_un address;
+    if (!makeAddress(socketPath, address)) {
+        return;
+    }
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        return;
+    }
+    if (::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        return;
+    }
+
+    connected_.store(true);
+    receiving_ = true;
+    receiver_ = std::thread(&ReplicationFollower::receive, this);
+    applier_ = std::thread(&ReplicationFollower::apply, this);
+}
+
+ReplicationFollower::~ReplicationFollower() {
+    if (fd_ < 0) {
+        return;
+    }
+    ::shutdown(fd_, SHUT_RDWR);
+    receiver_.join();
+    applier_.join();
+    ::close(fd_);
+}
+
+bool ReplicationFollower::connected() const {
+    return connected_.load();
+}
+
+std::vector<std::string> ReplicationFollower::searchBooks(const std::string& keyword) {
+    return library_.searchBooks(keyword);
+}
+
+std::vector<LibrarySystem::SearchHit> ReplicationFollower::searchTopBooks(const std::string& keyword, std::size_t k) {
+    return library_.searchTopBooks(keyword, k);
+}
+
+uint64_t ReplicationFollower::appliedSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return applied_;
+}
+
+uint64_t ReplicationFollower::lag() const {
+    const uint64_t leader = leaderSequence_.load();
+    const uint64_t applied = appliedSequence();
+    return leader > applied ? leader - applied : 0;
+}
+
+bool ReplicationFollower::waitForSequence(uint64_t sequence, unsigned timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return appliedCondition_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                      [this, sequence]() { return applied_ >= sequence; });
+}
+
+void ReplicationFollower::receive() {
+    char header[kFrameHeaderSize];
+    for (;;) {
+        uint32_t size = 0;
+        uint64_t newest = 0;
+        if (!readAll(fd_, header, sizeof(header))) {
+            break;
+        }
+        std::memcpy(&size, header, sizeof(size));
+        std::memcpy(&newest, header + sizeof(size), sizeof(newest));
+        if (size > kMaxFrameSize) {
+            break;
+        }
+        std::vector<char> buffer(size);
+        if (!readAll(fd_, buffer.data(), buffer.size())) {
+            break;
+        }
+        leaderSequence_.store(newest);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        pendingCondition_.wait(lock, [this]() { return pending_.size() < kPipelineDepth; });
+        pending_.push_back(std::vector<char>());
+        pending_.back().swap(buffer);
+        pendingCondition_.notify_all();
+    }
+
+    connected_.store(false);
+    std::lock_guard<std::mutex> lock(mutex_);
+    receiving_ = false;
+    pendingCondition_.notify_all();
+}
+
+void ReplicationFollower::apply() {
+    std::vector<char> buffer;
+    bool broken = false;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            pendingCondition_.wait(lock, [this]() { return !pending_.empty() || !receiving_; });
+            if (pending_.empty()) {
+                return;
+            }
+            buffer.swap(pending_.front());
+            pending_.pop_front();
+            pendingCondition_.notify_all();
+        }
+
+        if (broken) {
+            continue;
+        }
+
+        // The receiver keeps reading the next batches while this one is applied.
+        FlatReader reader(buffer.data(), buffer.size());
+        MutationRecord record;
+        bool valid = reader.valid() && reader.kind() == FLAT_MUTATION && reader.size() > 0;
+        for (std::size_t i = 0; valid && i < reader.size(); ++i) {
+            valid = reader.mutation(i).toMutation(record);
+            if (valid) {
+                library_.applyMutation(record);
+            }
+        }
+        if (!valid) {
+            // A corrupt batch leaves the replica behind for good; drop the connection.
+            broken = true;
+            ::shutdown(fd_, SHUT_RDWR);
+            continue;
+        }
+
+        uint64_t applied = reader.mutation(reader.size() - 1).sequence();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            applied_ = applied;
+        }
+        appliedCondition_.notify_all();
+        writeAll(fd_, reinterpret_cast<const char*>(&applied), sizeof(applied));
+    }
+}
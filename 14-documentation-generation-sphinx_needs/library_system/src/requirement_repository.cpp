@@ -0,0 +1,194 @@
+//!
+//! @file requirement_repository.cpp
+//! @brief Implementation of the RequirementRepository indexed requirement store
+//!
+
+#include "library_system/requirement_repository.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+const int RequirementRepository::kPriorityBuckets;
+const std::size_t RequirementRepository::kMinDateBatch;
+
+bool RequirementRepository::insert(const Requirement& requirement) {
+    if (rowsById_.count(requirement.getID()) != 0) {
+        return false;
+    }
+    const RequirementTable::Row row = table_.append(requirement);
+    rowsById_[requirement.getID()] = row;
+    indexRow(row);
+    return true;
+}
+
+bool RequirementRepository::update(const Requirement& requirement) {
+    std::unordered_map<int, RequirementTable::Row>::const_iterator it = rowsById_.find(requirement.getID());
+    if (it == rowsById_.end()) {
+        return false;
+    }
+    unindexRow(it->second);
+    table_.update(it->second, requirement);
+    indexRow(it->second);
+    return true;
+}
+
+std::size_t RequirementRepository::size() const {
+    return table_.size();
+}
+
+const RoaringBitmap& RequirementRepository::withStatus(RequirementStatus status) const {
+    return statusIndex_[status];
+}
+
+RoaringBitmap RequirementRepository::ownedBy(const std::string& owner) const {
+    uint32_t code = 0;
+    if (!table_.ownerCode(owner, code) || code >= ownerIndex_.size()) {
+        return RoaringBitmap();
+    }
+    return ownerIndex_[code];
+}
+
+RoaringBitmap RequirementRepository::withPriority(int minPriority, int maxPriority) const {
+    RoaringBitmap rows;
+    if (minPriority > maxPriority) {
+        return rows;
+    }
+    const int first = priorityBucket(minPriority);
+    const int last = priorityBucket(maxPriority);
+    for (int bucket = first; bucket <= last; ++bucket) {
+        // The edge buckets also hold clamped priorities outside [0, kPriorityBuckets).
+        const int low = bucket == 0 ? std::numeric_limits<int>::min() : bucket;
+        const int high = bucket == kPriorityBuckets - 1 ? std::numeric_limits<int>::max() : bucket;
+        if (minPriority <= low && high <= maxPriority) {
+            rows = rows | priorityIndex_[bucket];
+            continue;
+        }
+        std::vector<uint32_t> filtered;
+        const std::vector<uint32_t> candidates = priorityIndex_[bucket].toVector();
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            const int priority = table_.priority(candidates[i]);
+            if (priority >= minPriority && priority <= maxPriority) {
+                filtered.push_back(candidates[i]);
+            }
+        }
+        rows = rows | RoaringBitmap::fromSorted(filtered);
+    }
+    return rows;
+}
+
+RoaringBitmap RequirementRepository::createdBetween(const std::string& from, const std::string& to) const {
+    const int fromDay = parseEpochDay(from);
+    const int toDay = parseEpochDay(to);
+    if (fromDay == kInvalidEpochDay || toDay == kInvalidEpochDay) {
+        return RoaringBitmap();
+    }
+    return createdBetween(fromDay, toDay);
+}
+
+RoaringBitmap RequirementRepository::createdBetween(int fromDay, int toDay) const {
+    if (fromDay > toDay) {
+        return RoaringBitmap();
+    }
+    mergeDateChanges();
+    const std::vector<DateEntry>& index = dateIndex_;
+    std::vector<DateEntry>::const_iterator first = std::lower_bound(index.begin(), index.end(), DateEntry(fromDay, 0));
+    std::vector<DateEntry>::const_iterator last =
+        std::upper_bound(first, index.end(), DateEntry(toDay, std::numeric_limits<RequirementTable::Row>::max()));
+    std::vector<uint32_t> rows;
+    rows.reserve(last - first);
+    for (; first != last; ++first) {
+        rows.push_back(first->second);
+    }
+    // Rows created in day order are already sorted; only a mixed slice pays for the sort.
+    if (!std::is_sorted(rows.begin(), rows.end())) {
+        std::sort(rows.begin(), rows.end());
+    }
+    return RoaringBitmap::fromSorted(rows);
+}
+
+std::vector<Requirement> RequirementRepository::fetch(const RoaringBitmap& rows) const {
+    const std::vector<uint32_t> values = rows.toVector();
+    std::vector<Requirement> requirements;
+    requirements.reserve(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        requirements.push_back(table_.at(values[i]));
+    }
+    return requirements;
+}
+
+const RequirementTable& RequirementRepository::table() const {
+    return table_;
+}
+
+int RequirementRepository::priorityBucket(int priority) {
+    return std::min(std::max(priority, 0), kPriorityBuckets - 1);
+}
+
+void RequirementRepository::indexRow(RequirementTable::Row row) {
+    statusIndex_[table_.status(row)].add(row);
+    priorityIndex_[priorityBucket(table_.priority(row))].add(row);
+
+    const uint32_t owner = table_.owner(row);
+    if (owner >= ownerIndex_.size()) {
+        ownerIndex_.resize(owner + 1);
+    }
+    ownerIndex_[owner].add(row);
+
+    // Requirements mostly arrive in creation order, making this an append.
+    const int day = table_.createdDay(row);
+    if (day == kInvalidEpochDay) {
+        return;
+    }
+    const DateEntry entry(day, row);
+    if (dateIndex_.empty() || !(entry < dateIndex_.back())) {
+        dateIndex_.push_back(entry);
+        return;
+    }
+    dateAdds_.push_back(entry);
+    maybeMergeDateChanges();
+}
+
+void RequirementRepository::unindexRow(RequirementTable::Row row) {
+    statusIndex_[table_.status(row)].remove(row);
+    priorityIndex_[priorityBucket(table_.priority(row))].remove(row);
+    ownerIndex_[table_.owner(row)].remove(row);
+
+    const int day = table_.createdDay(row);
+    if (day == kInvalidEpochDay) {
+        return;
+    }
+    const DateEntry entry(day, row);
+    if (dateAdds_.empty() && dateRemovals_.empty() && !dateIndex_.empty() && dateIndex_.back() == entry) {
+        dateIndex_.pop_back();
+        return;
+    }
+    dateRemovals_.push_back(entry);
+    maybeMergeDateChanges();
+}
+
+void RequirementRepository::mergeDateChanges() const {
+    if (dateAdds_.empty() && dateRemovals_.empty()) {
+        return;
+    }
+    // Every removal matches exactly one entry of the index or of the additions, so the
+    // merged multiset minus the removals is the new index.
+    std::sort(dateAdds_.begin(), dateAdds_.end());
+    std::sort(dateRemovals_.begin(), dateRemovals_.end());
+    std::vector<DateEntry> merged;
+    merged.reserve(dateIndex_.size() + dateAdds_.size());
+    std::merge(dateIndex_.begin(), dateIndex_.end(), dateAdds_.begin(), dateAdds_.end(), std::back_inserter(merged));
+    dateIndex_.clear();
+    std::set_difference(merged.begin(), merged.end(), dateRemovals_.begin(), dateRemovals_.end(),
+                        std::back_inserter(dateIndex_));
+    dateAdds_.clear();
+    dateRemovals_.clear();
+}
+
+void RequirementRepository::maybeMergeDateChanges() {
+    // Merging once the buffer reaches a fraction of the index keeps maintenance amortized O(log n).
+    const std::size_t pending = dateAdds_.size() + dateRemovals_.size();
+    if (pending >= std::max(kMinDateBatch, dateIndex_.size() / 8)) {
+        mergeDateChanges();
+    }
+}
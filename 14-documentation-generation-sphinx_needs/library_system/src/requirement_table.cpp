@@ -0,0 +1,223 @@
+//!
+//! @file requirement_table.cpp
+//! @brief Implementation of the RequirementTable columnar requirement store
+//!
+
+#include "library_system/requirement_table.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#if defined(__SSE2__)
+// Kernels process blocks of 16 rows: one vector of uint8 statuses and four
+// vectors of int32 priorities/test cases.
+const std::size_t kBlockRows = 16;
+
+/**
+ * @brief Compute the match mask of a block of 16 rows.
+ * @return Bit i is set when row (first + i) has the status and priority.
+ */
+unsigned blockMask(const uint8_t *statuses, const int32_t *priorities, __m128i status, __m128i minPriority) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(statuses));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, status)));
+    if (mask == 0) {
+        return 0;
+    }
+
+    // priority >= min is !(min > priority); one bit per 32-bit lane.
+    unsigned below = 0;
+    for (int q = 0; q < 4; ++q) {
+        const __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(priorities + 4 * q));
+        below |= static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(minPriority, lanes)))) << (4 * q);
+    }
+    return mask & ~below & 0xFFFFu;
+}
+#endif
+
+} // namespace
+
+RequirementTable::Row RequirementTable::append(const Requirement& requirement) {
+    const Row row = static_cast<Row>(ids_.size());
+    ids_.push_back(requirement.getID());
+    priorities_.push_back(requirement.getPriority());
+    statuses_.push_back(static_cast<uint8_t>(requirement.getStatus()));
+    testCases_.push_back(requirement.getTestCases());
+    owners_.push_back(encodeOwner(requirement.getOwnerId()));
+    titles_.push_back(requirement.getTitle());
+    descriptions_.append(requirement.getDescription());
+    createdDates_.push_back(requirement.getCreatedDate());
+    createdDays_.push_back(requirement.getCreatedDay());
+    return row;
+}
+
+void RequirementTable::update(Row row, const Requirement& requirement) {
+    ids_[row] = requirement.getID();
+    priorities_[row] = requirement.getPriority();
+    statuses_[row] = static_cast<uint8_t>(requirement.getStatus());
+    testCases_[row] = requirement.getTestCases();
+    owners_[row] = encodeOwner(requirement.getOwnerId());
+    titles_[row] = requirement.getTitle();
+    descriptions_.replace(row, requirement.getDescription());
+    createdDates_[row] = requirement.getCreatedDate();
+    createdDays_[row] = requirement.getCreatedDay();
+}
+
+std::size_t RequirementTable::size() const {
+    return ids_.size();
+}
+
+Requirement RequirementTable::at(Row row) const {
+    return Requirement(ids_[row], titles_[row], descriptions_.str(row), priorities_[row],
+                       static_cast<RequirementStatus>(statuses_[row]), testCases_[row],
+                       StringPool::global().str(ownerIds_[owners_[row]]), createdDates_[row]);
+}
+
+int RequirementTable::id(Row row) const {
+    return ids_[row];
+}
+
+int RequirementTable::priority(Row row) const {
+    return priorities_[row];
+}
+
+RequirementStatus RequirementTable::status(Row row) const {
+    return static_cast<RequirementStatus>(statuses_[row]);
+}
+
+std::size_t RequirementTable::description(Row row, char* buffer, std::size_t capacity) const {
+    return descriptions_.read(row, buffer, capacity);
+}
+
+int RequirementTable::createdDay(Row row) const {
+    return createdDays_[row];
+}
+
+uint32_t RequirementTable::owner(Row row) const {
+    return owners_[row];
+}
+
+void RequirementTable::filter(RequirementStatus status, int minPriority, std::vector<Row>& rows) const {
+    rows.clear();
+    const std::size_t count = size();
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i wantedStatus = _mm_set1_epi8(static_cast<char>(status));
+    const __m128i wantedPriority = _mm_set1_epi32(minPriority);
+    for (; i + kBlockRows <= count; i += kBlockRows) {
+        unsigned mask = blockMask(&statuses_[i], &priorities_[i], wantedStatus, wantedPriority);
+        while (mask != 0) {
+            rows.push_back(static_cast<Row>(i + __builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        if (statuses_[i] == status && priorities_[i] >= minPriority) {
+            rows.push_back(static_cast<Row>(i));
+        }
+    }
+}
+
+int64_t RequirementTable::sumTestCases(RequirementStatus status, int minPriority) const {
+    const std::size_t count = size();
+    std::size_t i = 0;
+    int64_t total = 0;
+
+#if defined(__SSE2__)
+    const __m128i wantedStatus = _mm_set1_epi8(static_cast<char>(status));
+    const __m128i wantedPriority = _mm_set1_epi32(minPriority);
+    __m128i sums = _mm_setzero_si128(); // Two int64 lanes.
+    for (; i + kBlockRows <= count; i += kBlockRows) {
+        const unsigned mask = blockMask(&statuses_[i], &priorities_[i], wantedStatus, wantedPriority);
+        if (mask == 0) {
+            continue;
+        }
+        for (int q = 0; q < 4; ++q) {
+            // Expand four mask bits into four all-ones/all-zero 32-bit lanes.
+            const unsigned bits = (mask >> (4 * q)) & 0xFu;
+            const __m128i laneMask = _mm_cmpeq_epi32(
+                _mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), _mm_set_epi32(8, 4, 2, 1)),
+                _mm_set_epi32(8, 4, 2, 1));
+            const __m128i values = _mm_and_si128(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(&testCases_[i + 4 * q])), laneMask);
+
+            // Sign-extend to 64 bits before accumulating so sums cannot overflow.
+            const __m128i sign = _mm_srai_epi32(values, 31);
+            sums = _mm_add_epi64(sums, _mm_unpacklo_epi32(values, sign));
+            sums = _mm_add_epi64(sums, _mm_unpackhi_epi32(values, sign));
+        }
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), sums);
+    total = lanes[0] + lanes[1];
+#endif
+
+    for (; i < count; ++i) {
+        if (statuses_[i] == status && priorities_[i] >= minPriority) {
+            total += testCases_[i];
+        }
+    }
+    return total;
+}
+
+std::vector<int64_t> RequirementTable::sumTestCasesByOwner() const {
+    // Group-by over a dense dictionary code is a scatter-add, which SSE2 has
+    // no instruction for; four interleaved accumulator sets instead keep
+    // consecutive rows of the same owner from serializing on one counter.
+    const std::size_t owners = ownerIds_.size();
+    std::vector<int64_t> partial(owners * 4, 0);
+    const std::size_t count = size();
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        partial[owners_[i] * 4 + 0] += testCases_[i];
+        partial[owners_[i + 1] * 4 + 1] += testCases_[i + 1];
+        partial[owners_[i + 2] * 4 + 2] += testCases_[i + 2];
+        partial[owners_[i + 3] * 4 + 3] += testCases_[i + 3];
+    }
+    for (; i < count; ++i) {
+        partial[owners_[i] * 4] += testCases_[i];
+    }
+
+    std::vector<int64_t> totals(owners, 0);
+    for (std::size_t owner = 0; owner < owners; ++owner) {
+        totals[owner] = partial[owner * 4] + partial[owner * 4 + 1] + partial[owner * 4 + 2] + partial[owner * 4 + 3];
+    }
+    return totals;
+}
+
+std::size_t RequirementTable::ownerCount() const {
+    return ownerIds_.size();
+}
+
+StringPool::View RequirementTable::ownerName(uint32_t code) const {
+    return StringPool::global().view(ownerIds_[code]);
+}
+
+bool RequirementTable::ownerCode(const std::string& owner, uint32_t& code) const {
+    StringPool::Id id = 0;
+    if (!StringPool::global().find(owner, id)) {
+        return false;
+    }
+    std::unordered_map<StringPool::Id, uint32_t>::const_iterator it = ownerCodes_.find(id);
+    if (it == ownerCodes_.end()) {
+        return false;
+    }
+    code = it->second;
+    return true;
+}
+
+uint32_t RequirementTable::encodeOwner(StringPool::Id owner) {
+    std::unordered_map<StringPool::Id, uint32_t>::const_iterator it = ownerCodes_.find(owner);
+    if (it != ownerCodes_.end()) {
+        return it->second;
+    }
+    const uint32_t code = static_cast<uint32_t>(ownerIds_.size());
+    ownerIds_.push_back(owner);
+    ownerCodes_[owner] = code;
+    return code;
+}
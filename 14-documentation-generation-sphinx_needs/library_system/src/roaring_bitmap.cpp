@@ -0,0 +1,352 @@
+//!
+//! @file roaring_bitmap.cpp
+//! @brief Implementation of the RoaringBitmap compressed integer set
+//!
+
+#include "library_system/roaring_bitmap.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+const std::size_t kBitmapWords = 65536 / 64;
+
+inline unsigned popcount(uint64_t word) {
+    return static_cast<unsigned>(__builtin_popcountll(word));
+}
+
+} // namespace
+
+const std::size_t RoaringBitmap::kArrayLimit;
+
+RoaringBitmap RoaringBitmap::fromSorted(const std::vector<uint32_t>& values) {
+    RoaringBitmap bitmap;
+    for (std::size_t i = 0; i < values.size();) {
+        bitmap.containers_.push_back(Container());
+        Container& container = bitmap.containers_.back();
+        container.key = static_cast<uint16_t>(values[i] >> 16);
+        for (; i < values.size() && (values[i] >> 16) == container.key; ++i) {
+            const uint16_t low = static_cast<uint16_t>(values[i] & 0xFFFF);
+            if (container.array.empty() || container.array.back() != low) {
+                container.array.push_back(low);
+            }
+        }
+        container.cardinality = static_cast<uint32_t>(container.array.size());
+        normalize(container);
+    }
+    return bitmap;
+}
+
+void RoaringBitmap::add(uint32_t value) {
+    const uint16_t key = static_cast<uint16_t>(value >> 16);
+    const uint16_t low = static_cast<uint16_t>(value & 0xFFFF);
+
+    Container* container = find(key);
+    if (container == 0) {
+        Container created;
+        created.key = key;
+        created.cardinality = 0;
+        std::vector<Container>::iterator position = containers_.begin();
+        while (position != containers_.end() && position->key < key) {
+            ++position;
+        }
+        container = &*containers_.insert(position, created);
+    }
+
+    if (container->isBitmap()) {
+        uint64_t& word = container->words[low / 64];
+        const uint64_t bit = uint64_t(1) << (low % 64);
+        if ((word & bit) == 0) {
+            word |= bit;
+            ++container->cardinality;
+        }
+        return;
+    }
+
+    std::vector<uint16_t>::iterator it = std::lower_bound(container->array.begin(), container->array.end(), low);
+    if (it != container->array.end() && *it == low) {
+        return;
+    }
+    container->array.insert(it, low);
+    ++container->cardinality;
+    if (container->cardinality > kArrayLimit) {
+        toBitmap(*container);
+    }
+}
+
+void RoaringBitmap::remove(uint32_t value) {
+    const uint16_t key = static_cast<uint16_t>(value >> 16);
+    const uint16_t low = static_cast<uint16_t>(value & 0xFFFF);
+    Container* container = find(key);
+    if (container == 0 || !containerContains(*container, low)) {
+        return;
+    }
+
+    if (container->isBitmap()) {
+        container->words[low / 64] &= ~(uint64_t(1) << (low % 64));
+    } else {
+        container->array.erase(std::lower_bound(container->array.begin(), container->array.end(), low));
+    }
+    --container->cardinality;
+    normalize(*container);
+    if (container->cardinality == 0) {
+        containers_.erase(containers_.begin() + (container - containers_.data()));
+    }
+}
+
+bool RoaringBitmap::contains(uint32_t value) const {
+    const Container* container = find(static_cast<uint16_t>(value >> 16));
+    return container != 0 && containerContains(*container, static_cast<uint16_t>(value & 0xFFFF));
+}
+
+std::size_t RoaringBitmap::cardinality() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < containers_.size(); ++i) {
+        total += containers_[i].cardinality;
+    }
+    return total;
+}
+
+bool RoaringBitmap::empty() const {
+    return containers_.empty();
+}
+
+RoaringBitmap RoaringBitmap::operator&(const RoaringBitmap& other) const {
+    RoaringBitmap result;
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < containers_.size() && j < other.containers_.size()) {
+        if (containers_[i].key < other.containers_[j].key) {
+            ++i;
+        } else if (containers_[i].key > other.containers_[j].key) {
+            ++j;
+        } else {
+            Container container = intersect(containers_[i++], other.containers_[j++]);
+            if (container.cardinality != 0) {
+                result.containers_.push_back(container);
+            }
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::operator|(const RoaringBitmap& other) const {
+    RoaringBitmap result;
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < containers_.size() || j < other.containers_.size()) {
+        if (j == other.containers_.size() || (i < containers_.size() && containers_[i].key < other.containers_[j].key)) {
+            result.containers_.push_back(containers_[i++]);
+        } else if (i == containers_.size() || containers_[i].key > other.containers_[j].key) {
+            result.containers_.push_back(other.containers_[j++]);
+        } else {
+            result.containers_.push_back(unite(containers_[i++], other.containers_[j++]));
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::andNot(const RoaringBitmap& other) const {
+    RoaringBitmap result;
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < containers_.size(); ++i) {
+        while (j < other.containers_.size() && other.containers_[j].key < containers_[i].key) {
+            ++j;
+        }
+        if (j == other.containers_.size() || other.containers_[j].key != containers_[i].key) {
+            result.containers_.push_back(containers_[i]);
+            continue;
+        }
+        Container container = subtract(containers_[i], other.containers_[j]);
+        if (container.cardinality != 0) {
+            result.containers_.push_back(container);
+        }
+    }
+    return result;
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap& other) const {
+    return toVector() == other.toVector();
+}
+
+std::vector<uint32_t> RoaringBitmap::toVector() const {
+    std::vector<uint32_t> values;
+    values.reserve(cardinality());
+    for (std::size_t i = 0; i < containers_.size(); ++i) {
+        const Container& container = containers_[i];
+        const uint32_t high = static_cast<uint32_t>(container.key) << 16;
+        if (!container.isBitmap()) {
+            for (std::size_t k = 0; k < container.array.size(); ++k) {
+                values.push_back(high | container.array[k]);
+            }
+            continue;
+        }
+        for (std::size_t w = 0; w < kBitmapWords; ++w) {
+            uint64_t word = container.words[w];
+            while (word != 0) {
+                values.push_back(high | static_cast<uint32_t>(w * 64 + __builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        }
+    }
+    return values;
+}
+
+std::size_t RoaringBitmap::memoryUsage() const {
+    std::size_t bytes = containers_.capacity() * sizeof(Container);
+    for (std::size_t i = 0; i < containers_.size(); ++i) {
+        bytes += containers_[i].array.capacity() * sizeof(uint16_t) + containers_[i].words.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+void RoaringBitmap::toBitmap(Container& container) {
+    if (container.isBitmap()) {
+        return;
+    }
+    container.words.assign(kBitmapWords, 0);
+    for (std::size_t k = 0; k < container.array.size(); ++k) {
+        container.words[container.array[k] / 64] |= uint64_t(1) << (container.array[k] % 64);
+    }
+    std::vector<uint16_t>().swap(container.array);
+}
+
+void RoaringBitmap::normalize(Container& container) {
+    if (container.isBitmap() && container.cardinality <= kArrayLimit) {
+        std::vector<uint16_t> array;
+        array.reserve(container.cardinality);
+        for (std::size_t w = 0; w < kBitmapWords; ++w) {
+            uint64_t word = container.words[w];
+            while (word != 0) {
+                array.push_back(static_cast<uint16_t>(w * 64 + __builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        }
+        container.array.swap(array);
+        std::vector<uint64_t>().swap(container.words);
+    } else if (!container.isBitmap() && container.cardinality > kArrayLimit) {
+        toBitmap(container);
+    }
+}
+
+bool RoaringBitmap::containerContains(const Container& container, uint16_t low) {
+    if (container.isBitmap()) {
+        return (container.words[low / 64] >> (low % 64)) & 1;
+    }
+    return std::binary_search(container.array.begin(), container.array.end(), low);
+}
+
+RoaringBitmap::Container RoaringBitmap::intersect(const Container& lhs, const Container& rhs) {
+    Container result;
+    result.key = lhs.key;
+    if (lhs.isBitmap() && rhs.isBitmap()) {
+        result.words.resize(kBitmapWords);
+        uint32_t cardinality = 0;
+        for (std::size_t w = 0; w < kBitmapWords; ++w) {
+            result.words[w] = lhs.words[w] & rhs.words[w];
+            cardinality += popcount(result.words[w]);
+        }
+        result.cardinality = cardinality;
+        normalize(result);
+        return result;
+    }
+    if (!lhs.isBitmap() && !rhs.isBitmap()) {
+        std::set_intersection(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(),
+                              std::back_inserter(result.array));
+    } else {
+        // Probe the bitmap with every element of the array.
+        const Container& array = lhs.isBitmap() ? rhs : lhs;
+        const Container& bitmap = lhs.isBitmap() ? lhs : rhs;
+        for (std::size_t k = 0; k < array.array.size(); ++k) {
+            if (containerContains(bitmap, array.array[k])) {
+                result.array.push_back(array.array[k]);
+            }
+        }
+    }
+    result.cardinality = static_cast<uint32_t>(result.array.size());
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::unite(const Container& lhs, const Container& rhs) {
+    Container result;
+    result.key = lhs.key;
+    if (!lhs.isBitmap() && !rhs.isBitmap()) {
+        std::set_union(lhs.array.begin(), lhs.array.end(), rhs.array.begin(), rhs.array.end(),
+                       std::back_inserter(result.array));
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+        normalize(result);
+        return result;
+    }
+
+    result = lhs.isBitmap() ? lhs : rhs;
+    const Container& other = lhs.isBitmap() ? rhs : lhs;
+    if (other.isBitmap()) {
+        for (std::size_t w = 0; w < kBitmapWords; ++w) {
+            result.words[w] |= other.words[w];
+        }
+    } else {
+        for (std::size_t k = 0; k < other.array.size(); ++k) {
+            result.words[other.array[k] / 64] |= uint64_t(1) << (other.array[k] % 64);
+        }
+    }
+    uint32_t cardinality = 0;
+    for (std::size_t w = 0; w < kBitmapWords; ++w) {
+        cardinality += popcount(result.words[w]);
+    }
+    result.cardinality = cardinality;
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::subtract(const Container& lhs, const Container& rhs) {
+    Container result;
+    result.key = lhs.key;
+    if (!lhs.isBitmap()) {
+        for (std::size_t k = 0; k < lhs.array.size(); ++k) {
+            if (!containerContains(rhs, lhs.array[k])) {
+                result.array.push_back(lhs.array[k]);
+            }
+        }
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+        return result;
+    }
+
+    result.words = lhs.words;
+    if (rhs.isBitmap()) {
+        for (std::size_t w = 0; w < kBitmapWords; ++w) {
+            result.words[w] &= ~rhs.words[w];
+        }
+    } else {
+        for (std::size_t k = 0; k < rhs.array.size(); ++k) {
+            result.words[rhs.array[k] / 64] &= ~(uint64_t(1) << (rhs.array[k] % 64));
+        }
+    }
+    uint32_t cardinality = 0;
+    for (std::size_t w = 0; w < kBitmapWords; ++w) {
+        cardinality += popcount(result.words[w]);
+    }
+    result.cardinality = cardinality;
+    normalize(result);
+    return result;
+}
+
+RoaringBitmap::Container* RoaringBitmap::find(uint16_t key) {
+    return const_cast<Container*>(static_cast<const RoaringBitmap*>(this)->find(key));
+}
+
+const RoaringBitmap::Container* RoaringBitmap::find(uint16_t key) const {
+    std::size_t low = 0;
+    std::size_t high = containers_.size();
+    while (low < high) {
+        const std::size_t middle = low + (high - low) / 2;
+        if (containers_[middle].key == key) {
+            return &containers_[middle];
+        }
+        if (containers_[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,491 @@
+//!
+//! @file search_segment.cpp
+//! @brief Implementation of the SearchSegment immutable inverted index segment
+//!
+
+#include "library_system/search_segment.hpp"
+
+#include "library_system/parallel_for.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief Fixed header of a spill file, followed by the term offsets, the
+ * posting offsets, the postings and the term pool.
+ */
+struct SpillHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t documentCount;
+    uint64_t termCount;
+    uint64_t termBytes;
+    uint64_t postingCount;
+};
+
+const char kSpillMagic[4] = {'L', 'S', 'S', 'G'};
+const uint32_t kSpillVersion = 1;
+
+// Spilling only tells segments searched long ago from recent ones, so a
+// coarse clock does; 0 is left for segments never searched.
+uint64_t useTick() {
+    const std::chrono::steady_clock::duration now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count()) + 1;
+}
+
+/**
+ * @brief A term and its ascending document ids.
+ */
+typedef std::pair<std::string, std::vector<SearchSegment::DocId> > TermPostings;
+
+bool termBefore(const TermPostings& a, const TermPostings& b) {
+    return a.first < b.first;
+}
+
+/**
+ * @brief Orders sorted dictionaries by their next unmerged term, smallest on top of a heap.
+ */
+struct LaterTerm {
+    const std::vector<std::vector<TermPostings> >* dictionaries;
+    const std::vector<std::size_t>* cursors;
+
+    bool operator()(std::size_t a, std::size_t b) const {
+        return (*dictionaries)[b][(*cursors)[b]].first < (*dictionaries)[a][(*cursors)[a]].first;
+    }
+};
+
+/**
+ * @brief Position of a merge in the sorted term dictionary of one segment.
+ */
+struct TermCursor {
+    const char* terms;
+    const uint32_t* termStarts;
+    const uint32_t* postingStarts;
+    const SearchSegment::DocId* docs;
+    std::size_t term;
+    std::size_t termCount;
+
+    const char* termData() const {
+        return terms + termStarts[term];
+    }
+
+    std::size_t termSize() const {
+        return termStarts[term + 1] - termStarts[term];
+    }
+
+    const SearchSegment::DocId* firstDoc() const {
+        return docs + postingStarts[term];
+    }
+
+    const SearchSegment::DocId* lastDoc() const {
+        return docs + postingStarts[term + 1];
+    }
+};
+
+int compareTerms(const TermCursor& a, const TermCursor& b) {
+    const int order = std::memcmp(a.termData(), b.termData(), std::min(a.termSize(), b.termSize()));
+    if (order != 0) {
+        return order;
+    }
+    return a.termSize() < b.termSize() ? -1 : (a.termSize() > b.termSize() ? 1 : 0);
+}
+
+/**
+ * @brief Orders cursors by their current term, then by segment, smallest on top of a heap.
+ */
+struct LaterCursor {
+    const std::vector<TermCursor>* cursors;
+
+    bool operator()(std::size_t a, std::size_t b) const {
+        const int order = compareTerms((*cursors)[b], (*cursors)[a]);
+        return order < 0 || (order == 0 && b < a);
+    }
+};
+
+/**
+ * @brief Walk the union of sorted term dictionaries in term order.
+ * @param cursors One cursor per dictionary, at its first term.
+ * @param visit Called with the cursors positioned on each distinct term, in segment order.
+ */
+template <typename Visit>
+void mergeDictionaries(std::vector<TermCursor> cursors, Visit visit) {
+    std::vector<std::size_t> heap;
+    for (std::size_t i = 0; i < cursors.size(); ++i) {
+        if (cursors[i].termCount > 0) {
+            heap.push_back(i);
+        }
+    }
+    const LaterCursor later = {&cursors};
+    std::make_heap(heap.begin(), heap.end(), later);
+    std::vector<std::size_t> group;
+    while (!heap.empty()) {
+        group.clear();
+        do {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            group.push_back(heap.back());
+            heap.pop_back();
+        } while (!heap.empty() && compareTerms(cursors[heap.front()], cursors[group[0]]) == 0);
+        visit(cursors, group);
+        for (std::size_t i = 0; i < group.size(); ++i) {
+            if (++cursors[group[i]].term < cursors[group[i]].termCount) {
+                heap.push_back(group[i]);
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+    }
+}
+
+template <typename T>
+std::size_t capacityBytes(const std::vector<T, TrackingAllocator<T> >& array) {
+    return array.capacity() * sizeof(T);
+}
+
+} // namespace
+
+SearchSegment::SearchSegment(MemoryTracker* tracker)
+    : termPool_(TrackingAllocator<char>(tracker)),
+      termOffsets_(TrackingAllocator<uint32_t>(tracker)),
+      postingOffsets_(TrackingAllocator<uint32_t>(tracker)),
+      postings_(TrackingAllocator<DocId>(tracker)),
+      documentCount_(0),
+      terms_(0),
+      termStarts_(0),
+      postingStarts_(0),
+      docs_(0),
+      termCount_(0),
+      mapping_(0),
+      mappingSize_(0),
+      lastUsed_(0) {}
+
+SearchSegment::~SearchSegment() {
+    if (mapping_ != 0) {
+        munmap(mapping_, mappingSize_);
+    }
+}
+
+void SearchSegment::attach() {
+    terms_ = termPool_.data();
+    termStarts_ = termOffsets_.data();
+    postingStarts_ = postingOffsets_.data();
+    docs_ = postings_.data();
+    termCount_ = termOffsets_.size() - 1;
+}
+
+std::shared_ptr<const SearchSegment> SearchSegment::build(std::vector<Posting> postings, std::size_t documentCount,
+                                                          MemoryTracker* tracker) {
+    std::sort(postings.begin(), postings.end());
+    postings.erase(std::unique(postings.begin(), postings.end()), postings.end());
+
+    std::size_t termCount = 0;
+    std::size_t termBytes = 0;
+    for (std::size_t i = 0; i < postings.size(); ++i) {
+        if (i == 0 || postings[i].first != postings[i - 1].first) {
+            ++termCount;
+            termBytes += postings[i].first.size();
+        }
+    }
+
+    std::shared_ptr<SearchSegment> segment(new SearchSegment(tracker));
+    segment->documentCount_ = documentCount;
+    segment->termPool_.reserve(termBytes);
+    segment->termOffsets_.reserve(termCount + 1);
+    segment->postingOffsets_.reserve(termCount + 1);
+    segment->postings_.reserve(postings.size());
+    for (std::size_t i = 0; i < postings.size(); ++i) {
+        if (i == 0 || postings[i].first != postings[i - 1].first) {
+            segment->termOffsets_.push_back(static_cast<uint32_t>(segment->termPool_.size()));
+            segment->postingOffsets_.push_back(static_cast<uint32_t>(segment->postings_.size()));
+            segment->termPool_.insert(segment->termPool_.end(), postings[i].first.begin(), postings[i].first.end());
+        }
+        segment->postings_.push_back(postings[i].second);
+    }
+    segment->termOffsets_.push_back(static_cast<uint32_t>(segment->termPool_.size()));
+    segment->postingOffsets_.push_back(static_cast<uint32_t>(segment->postings_.size()));
+    segment->attach();
+    return segment;
+}
+
+std::shared_ptr<const SearchSegment> SearchSegment::buildPartitioned(
+    std::vector<std::vector<Posting> >& partitions, std::size_t documentCount, MemoryTracker* tracker) {
+    // Group every partition by term with a hash table, so that only its
+    // distinct terms are sorted; postings usually arrive in document order.
+    const std::size_t count = partitions.size();
+    std::vector<std::vector<TermPostings> > dictionaries(count);
+    parallelFor(count, [&partitions, &dictionaries](std::size_t p) {
+        std::unordered_map<std::string, std::vector<DocId> > lists;
+        for (std::size_t i = 0; i < partitions[p].size(); ++i) {
+            lists[partitions[p][i].first].push_back(partitions[p][i].second);
+        }
+        std::vector<Posting>().swap(partitions[p]);
+
+        std::vector<TermPostings>& dictionary = dictionaries[p];
+        dictionary.resize(lists.size());
+        std::size_t t = 0;
+        for (std::unordered_map<std::string, std::vector<DocId> >::iterator it = lists.begin(); it != lists.end();
+             ++it, ++t) {
+            std::vector<DocId>& docs = dictionary[t].second;
+            dictionary[t].first = it->first;
+            docs.swap(it->second);
+            if (!std::is_sorted(docs.begin(), docs.end())) {
+                std::sort(docs.begin(), docs.end());
+            }
+            docs.erase(std::unique(docs.begin(), docs.end()), docs.end());
+        }
+        std::sort(dictionary.begin(), dictionary.end(), termBefore);
+    });
+
+    // Merge the sorted dictionaries to place every term, leaving the postings where they are.
+    std::size_t termCount = 0;
+    std::vector<std::size_t> cursors(count, 0);
+    std::vector<std::size_t> heap;
+    for (std::size_t p = 0; p < count; ++p) {
+        termCount += dictionaries[p].size();
+        if (!dictionaries[p].empty()) {
+            heap.push_back(p);
+        }
+    }
+    const LaterTerm later = {&dictionaries, &cursors};
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    std::shared_ptr<SearchSegment> segment(new SearchSegment(tracker));
+    segment->documentCount_ = documentCount;
+    segment->termOffsets_.resize(termCount + 1);
+    segment->postingOffsets_.resize(termCount + 1);
+    std::vector<std::vector<uint32_t> > placement(count);
+    uint32_t termBytes = 0;
+    uint32_t postingCount = 0;
+    for (std::size_t t = 0; t < termCount; ++t) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        const std::size_t p = heap.back();
+        const TermPostings& term = dictionaries[p][cursors[p]];
+        placement[p].push_back(static_cast<uint32_t>(t));
+        segment->termOffsets_[t] = termBytes;
+        segment->postingOffsets_[t] = postingCount;
+        termBytes += static_cast<uint32_t>(term.first.size());
+        postingCount += static_cast<uint32_t>(term.second.size());
+        if (++cursors[p] < dictionaries[p].size()) {
+            std::push_heap(heap.begin(), heap.end(), later);
+        } else {
+            heap.pop_back();
+        }
+    }
+    segment->termOffsets_[termCount] = termBytes;
+    segment->postingOffsets_[termCount] = postingCount;
+    segment->termPool_.resize(termBytes);
+    segment->postings_.resize(postingCount);
+
+    // Every partition copies its own terms and postings into their places.
+    SearchSegment& target = *segment;
+    parallelFor(count, [&dictionaries, &placement, &target](std::size_t p) {
+        for (std::size_t local = 0; local < placement[p].size(); ++local) {
+            const uint32_t t = placement[p][local];
+            const TermPostings& term = dictionaries[p][local];
+            std::copy(term.first.begin(), term.first.end(), target.termPool_.begin() + target.termOffsets_[t]);
+            std::copy(term.second.begin(), term.second.end(), target.postings_.begin() + target.postingOffsets_[t]);
+        }
+        std::vector<TermPostings>().swap(dictionaries[p]);
+    });
+    segment->attach();
+    return segment;
+}
+
+std::shared_ptr<const SearchSegment> SearchSegment::merge(
+    const std::vector<std::shared_ptr<const SearchSegment> >& segments, MemoryTracker* tracker) {
+    // The dictionaries and runs are sorted already: merge them term by term
+    // straight into the output arrays, sized by a first pass over the terms.
+    std::vector<TermCursor> cursors;
+    std::size_t documentCount = 0;
+    std::size_t postingCount = 0;
+    for (std::size_t s = 0; s < segments.size(); ++s) {
+        const SearchSegment& segment = *segments[s];
+        const TermCursor cursor = {segment.terms_, segment.termStarts_, segment.postingStarts_, segment.docs_, 0,
+                                   segment.termCount_};
+        cursors.push_back(cursor);
+        documentCount += segment.documentCount_;
+        postingCount += segment.postingStarts_[segment.termCount_];
+    }
+
+    std::size_t termCount = 0;
+    std::size_t termBytes = 0;
+    mergeDictionaries(cursors, [&termCount, &termBytes](const std::vector<TermCursor>& terms,
+                                                        const std::vector<std::size_t>& group) {
+        ++termCount;
+        termBytes += terms[group[0]].termSize();
+    });
+
+    std::shared_ptr<SearchSegment> segment(new SearchSegment(tracker));
+    segment->documentCount_ = documentCount;
+    segment->termPool_.reserve(termBytes);
+    segment->termOffsets_.reserve(termCount + 1);
+    segment->postingOffsets_.reserve(termCount + 1);
+    segment->postings_.reserve(postingCount);
+    SearchSegment& target = *segment;
+    mergeDictionaries(cursors, [&target](const std::vector<TermCursor>& terms, const std::vector<std::size_t>& group) {
+        const TermCursor& term = terms[group[0]];
+        target.termOffsets_.push_back(static_cast<uint32_t>(target.termPool_.size()));
+        target.postingOffsets_.push_back(static_cast<uint32_t>(target.postings_.size()));
+        target.termPool_.insert(target.termPool_.end(), term.termData(), term.termData() + term.termSize());
+
+        // Segments usually cover consecutive documents, so their runs just concatenate.
+        const std::size_t start = target.postings_.size();
+        for (std::size_t i = 0; i < group.size(); ++i) {
+            const TermCursor& run = terms[group[i]];
+            if (run.firstDoc() == run.lastDoc()) {
+                continue;
+            }
+            const std::size_t middle = target.postings_.size();
+            const bool ordered = middle == start || *run.firstDoc() > target.postings_.back();
+            target.postings_.insert(target.postings_.end(), run.firstDoc(), run.lastDoc());
+            if (!ordered) {
+                std::inplace_merge(target.postings_.begin() + start, target.postings_.begin() + middle,
+                                   target.postings_.end());
+                target.postings_.erase(std::unique(target.postings_.begin() + start, target.postings_.end()),
+                                       target.postings_.end());
+            }
+        }
+    });
+    segment->termOffsets_.push_back(static_cast<uint32_t>(segment->termPool_.size()));
+    segment->postingOffsets_.push_back(static_cast<uint32_t>(segment->postings_.size()));
+    segment->attach();
+    return segment;
+}
+
+std::shared_ptr<const SearchSegment> SearchSegment::spill(const std::string& path) const {
+    SpillHeader header;
+    std::memcpy(header.magic, kSpillMagic, sizeof(kSpillMagic));
+    header.version = kSpillVersion;
+    header.documentCount = documentCount_;
+    header.termCount = termCount_;
+    header.termBytes = termStarts_[termCount_];
+    header.postingCount = postingStarts_[termCount_];
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == 0) {
+        return std::shared_ptr<const SearchSegment>();
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(termStarts_, sizeof(uint32_t), termCount_ + 1, file) == termCount_ + 1 &&
+                   std::fwrite(postingStarts_, sizeof(uint32_t), termCount_ + 1, file) == termCount_ + 1 &&
+                   std::fwrite(docs_, sizeof(DocId), header.postingCount, file) == header.postingCount &&
+                   std::fwrite(terms_, 1, header.termBytes, file) == header.termBytes;
+    written = std::fclose(file) == 0 && written;
+
+    const int fd = written ? open(path.c_str(), O_RDONLY) : -1;
+    std::remove(path.c_str());
+    if (fd < 0) {
+        return std::shared_ptr<const SearchSegment>();
+    }
+    const std::size_t size = sizeof(header) + 2 * (termCount_ + 1) * sizeof(uint32_t) +
+                             header.postingCount * sizeof(DocId) + header.termBytes;
+    void* mapping = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return std::shared_ptr<const SearchSegment>();
+    }
+
+    std::shared_ptr<SearchSegment> segment(new SearchSegment(0));
+    segment->mapping_ = mapping;
+    segment->mappingSize_ = size;
+    segment->documentCount_ = documentCount_;
+    segment->termCount_ = termCount_;
+    const char* data = static_cast<const char*>(mapping) + sizeof(header);
+    segment->termStarts_ = reinterpret_cast<const uint32_t*>(data);
+    segment->postingStarts_ = segment->termStarts_ + termCount_ + 1;
+    segment->docs_ = segment->postingStarts_ + termCount_ + 1;
+    segment->terms_ = reinterpret_cast<const char*>(segment->docs_ + header.postingCount);
+    segment->lastUsed_.store(lastUsed(), std::memory_order_relaxed);
+    return segment;
+}
+
+void SearchSegment::match(const std::vector<std::string>& terms, std::vector<DocId>& matches) const {
+    matches.clear();
+    if (terms.empty()) {
+        return;
+    }
+
+    // Intersect starting from the shortest posting list.
+    std::vector<std::pair<std::size_t, const DocId*> > lists;
+    for (std::size_t i = 0; i < terms.size(); ++i) {
+        std::size_t count = 0;
+        const DocId* list = postings(terms[i], count);
+        if (list == 0) {
+            return;
+        }
+        lists.push_back(std::make_pair(count, list));
+    }
+    std::sort(lists.begin(), lists.end());
+
+    matches.assign(lists[0].second, lists[0].second + lists[0].first);
+    std::vector<DocId> next;
+    for (std::size_t i = 1; i < lists.size() && !matches.empty(); ++i) {
+        next.clear();
+        std::set_intersection(matches.begin(), matches.end(), lists[i].second, lists[i].second + lists[i].first,
+                              std::back_inserter(next));
+        matches.swap(next);
+    }
+}
+
+const SearchSegment::DocId* SearchSegment::postings(const std::string& term, std::size_t& count) const {
+    // Readers of a hot segment only write its stamp once per tick.
+    const uint64_t tick = useTick();
+    if (lastUsed_.load(std::memory_order_relaxed) != tick) {
+        lastUsed_.store(tick, std::memory_order_relaxed);
+    }
+    count = 0;
+    std::size_t low = 0;
+    std::size_t high = termCount_;
+    while (low < high) {
+        const std::size_t middle = low + (high - low) / 2;
+        const std::size_t length = termStarts_[middle + 1] - termStarts_[middle];
+        int order = std::memcmp(terms_ + termStarts_[middle], term.data(), std::min(length, term.size()));
+        if (order == 0) {
+            order = length < term.size() ? -1 : (length > term.size() ? 1 : 0);
+        }
+        if (order == 0) {
+            count = postingStarts_[middle + 1] - postingStarts_[middle];
+            return docs_ + postingStarts_[middle];
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return 0;
+}
+
+std::size_t SearchSegment::documentCount() const {
+    return documentCount_;
+}
+
+std::size_t SearchSegment::termCount() const {
+    return termCount_;
+}
+
+bool SearchSegment::mapped() const {
+    return mapping_ != 0;
+}
+
+std::size_t SearchSegment::memoryUsage() const {
+    return sizeof(*this) + capacityBytes(termPool_) + capacityBytes(termOffsets_) + capacityBytes(postingOffsets_) +
+           capacityBytes(postings_);
+}
+
+std::size_t SearchSegment::mappedBytes() const {
+    return mappingSize_;
+}
+
+uint64_t SearchSegment::lastUsed() const {
+    return lastUsed_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,276 @@
+//!
+//! @file sharded_library.cpp
+//! @brief Implementation of the hash-partitioned, shard-per-core LibrarySystem
+//!
+
+#include "library_system/sharded_library.hpp"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+std::atomic<std::size_t> nextCaller(0);
+
+// Consecutive caller threads prefer consecutive rings.
+std::size_t callerSlot() {
+    static thread_local const std::size_t slot = nextCaller.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+} // namespace
+
+// A caller has at most one request in flight per shard, so rings stay short.
+const std::size_t ShardedLibrary::kRingCapacity = 64;
+const std::size_t ShardedLibrary::kProducerRings = 16;
+const unsigned ShardedLibrary::kSpinsBeforeSleep = 2000;
+
+ShardedLibrary::Producer::Producer()
+    : claimed(false), ring(kRingCapacity) {}
+
+ShardedLibrary::Shard::Shard()
+    : nextRing(0), sleeping(false) {
+    for (std::size_t i = 0; i < kProducerRings; ++i) {
+        producers.push_back(std::unique_ptr<Producer>(new Producer()));
+    }
+}
+
+ShardedLibrary::ShardedLibrary(std::size_t shardCount, bool pinThreads)
+    : stopping_(false) {
+    shardCount = std::max<std::size_t>(shardCount, 1);
+    for (std::size_t i = 0; i < shardCount; ++i) {
+        shards_.push_back(new Shard());
+    }
+    for (std::size_t i = 0; i < shardCount; ++i) {
+        shards_[i]->worker = std::thread(&ShardedLibrary::run, this, i, pinThreads);
+    }
+}
+
+ShardedLibrary::~ShardedLibrary() {
+    stopping_.store(true);
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+        {
+            std::lock_guard<std::mutex> lock(shards_[i]->sleepMutex);
+        }
+        shards_[i]->wakeup.notify_one();
+        shards_[i]->worker.join();
+        delete shards_[i];
+    }
+}
+
+bool ShardedLibrary::addBook(const std::string& title, const std::string& author, const std::string& isbn) {
+    Request request;
+    request.operation = OP_ADD;
+    request.title = title;
+    request.author = author;
+    request.isbn = isbn;
+    return route(request);
+}
+
+bool ShardedLibrary::borrowBook(const std::string& isbn, int userId) {
+    Request request;
+    request.operation = OP_BORROW;
+    request.isbn = isbn;
+    request.userId = userId;
+    return route(request);
+}
+
+bool ShardedLibrary::returnBook(const std::string& isbn, int userId) {
+    Request request;
+    request.operation = OP_RETURN;
+    request.isbn = isbn;
+    request.userId = userId;
+    return route(request);
+}
+
+std::vector<LibrarySystem::SearchHit> ShardedLibrary::searchBooks(const std::string& keyword, std::size_t k) {
+    std::vector<LibrarySystem::SearchHit> merged;
+    if (k == 0) {
+        return merged;
+    }
+
+    // Scatter: every shard computes its own top k.
+    Completion completion;
+    completion.remaining = shards_.size();
+    std::vector<Request> requests(shards_.size());
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+        requests[i].operation = OP_SEARCH;
+        requests[i].title = keyword;
+        requests[i].k = k;
+        requests[i].completion = &completion;
+        submit(i, &requests[i]);
+    }
+    wait(completion);
+
+    // Gather: k-way merge of the sorted per-shard lists.
+    std::vector<std::size_t> positions(requests.size(), 0);
+    while (merged.size() < k) {
+        std::size_t best = requests.size();
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            if (positions[i] < requests[i].hits.size() &&
+                (best == requests.size() ||
+                 LibrarySystem::ranksBefore(requests[i].hits[positions[i]], requests[best].hits[positions[best]]))) {
+                best = i;
+            }
+        }
+        if (best == requests.size()) {
+            break;
+        }
+        merged.push_back(requests[best].hits[positions[best]++]);
+    }
+    return merged;
+}
+
+std::size_t ShardedLibrary::shardCount() const {
+    return shards_.size();
+}
+
+std::size_t ShardedLibrary::shardOf(IsbnKey key) const {
+    // ISBNs of one publisher are nearly consecutive; mix before reducing.
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return static_cast<std::size_t>(key % shards_.size());
+}
+
+bool ShardedLibrary::route(Request& request) {
+    const IsbnKey key = parseIsbn(request.isbn);
+    if (key == kInvalidIsbn) {
+        return false;
+    }
+    Completion completion;
+    completion.remaining = 1;
+    request.completion = &completion;
+    submit(shardOf(key), &request);
+    wait(completion);
+    return request.result;
+}
+
+void ShardedLibrary::submit(std::size_t index, Request* request) {
+    Shard& shard = *shards_[index];
+    // Lease the caller's own ring, or the next free one if another caller holds it.
+    // Acquire and release hand the ring's producer side from one caller to the next.
+    const std::size_t preferred = callerSlot();
+    for (std::size_t attempt = 0;; ++attempt) {
+        Producer& producer = *shard.producers[(preferred + attempt) % kProducerRings];
+        if (producer.claimed.load(std::memory_order_relaxed) ||
+            producer.claimed.exchange(true, std::memory_order_acquire)) {
+            if ((attempt + 1) % kProducerRings == 0) {
+                std::this_thread::yield();
+            }
+            continue;
+        }
+        while (!producer.ring.push(request)) {
+            std::this_thread::yield();
+        }
+        producer.claimed.store(false, std::memory_order_release);
+        break;
+    }
+    // Pairs with the fence in run(): either the worker sees the request or we see it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (shard.sleeping.load(std::memory_order_relaxed)) {
+        {
+            std::lock_guard<std::mutex> lock(shard.sleepMutex);
+        }
+        shard.wakeup.notify_one();
+    }
+}
+
+bool ShardedLibrary::pop(Shard& shard, Request*& request) {
+    for (std::size_t i = 0; i < kProducerRings; ++i) {
+        const std::size_t ring = (shard.nextRing + i) % kProducerRings;
+        if (shard.producers[ring]->ring.pop(request)) {
+            shard.nextRing = (ring + 1) % kProducerRings;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ShardedLibrary::pending(const Shard& shard) {
+    for (std::size_t i = 0; i < kProducerRings; ++i) {
+        if (!shard.producers[i]->ring.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShardedLibrary::wait(Completion& completion) {
+    std::unique_lock<std::mutex> lock(completion.mutex);
+    completion.done.wait(lock, [&completion]() { return completion.remaining == 0; });
+}
+
+void ShardedLibrary::run(std::size_t index, bool pin) {
+#if defined(__linux__)
+    if (pin) {
+        const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(index % cores, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+#else
+    (void)pin;
+#endif
+
+    // Constructed on the pinned thread, so first-touch places it on this core's node,
+    // and maintained by it too: merges run here when the rings are empty.
+    LibrarySystem library(false);
+    Shard& shard = *shards_[index];
+    Request* request = 0;
+    unsigned idle = 0;
+    for (;;) {
+        if (pop(shard, request)) {
+            apply(library, *request);
+            idle = 0;
+            continue;
+        }
+        if (stopping_.load()) {
+            return;
+        }
+        if (library.runMaintenance()) {
+            idle = 0;
+            continue;
+        }
+        if (++idle < kSpinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(shard.sleepMutex);
+        shard.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        shard.wakeup.wait(lock, [this, &shard]() { return pending(shard) || stopping_.load(); });
+        shard.sleeping.store(false, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+void ShardedLibrary::apply(LibrarySystem& library, Request& request) {
+    switch (request.operation) {
+    case OP_ADD:
+        request.result = library.addBook(request.title, request.author, request.isbn);
+        break;
+    case OP_BORROW:
+        request.result = library.borrowBook(request.isbn, request.userId);
+        break;
+    case OP_RETURN:
+        request.result = library.returnBook(request.isbn, request.userId);
+        break;
+    case OP_SEARCH:
+        request.hits = library.searchTopBooks(request.title, request.k);
+        request.result = true;
+        break;
+    }
+
+    Completion& completion = *request.completion;
+    std::lock_guard<std::mutex> lock(completion.mutex);
+    if (--completion.remaining == 0) {
+        completion.done.notify_one();
+    }
+}
@@ -0,0 +1,578 @@
+//!
+//! @file shared_memory_lookup.cpp
+//! @brief Implementation of the shared-memory transport for same-host catalog lookups
+//!
+
+#include "library_system/shared_memory_lookup.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+const std::size_t kCacheLine = 64;
+const uint32_t kRegionMagic = 0x4C42534Du; // "LBSM"
+const uint32_t kRegionVersion = 1;
+const std::size_t kMinRingBytes = 4096;
+const std::size_t kMaxRingBytes = std::size_t(1) << 30;
+const uint32_t kMaxRequestBytes = 64 * 1024;
+const uint32_t kMaxTextBytes = 16u << 20;
+const uint32_t kMaxSearchResults = 16u << 20;
+const int kSpinIterations = 2000;
+const int kSleepMs = 50; // Bounds how long a side takes to notice that its peer is gone.
+
+enum Operation {
+    OPERATION_SEARCH = 1,
+    OPERATION_FIND_BOOK = 2
+};
+
+/**
+ * @brief Futex word bumped by one side to wake the other.
+ */
+struct SharedEvent {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> sleepers;
+};
+
+/**
+ * @brief Control block of a single-producer, single-consumer byte ring.
+ */
+struct SharedRing {
+    std::atomic<uint64_t> head; // Consumer-owned.
+    char padding0[kCacheLine - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> tail; // Producer-owned.
+    char padding1[kCacheLine - sizeof(std::atomic<uint64_t>)];
+    SharedEvent readable; // Bumped when the tail moves.
+    SharedEvent writable; // Bumped when the head moves.
+    char padding2[kCacheLine - 2 * sizeof(SharedEvent)];
+};
+
+/**
+ * @brief Start of a client region, followed by the request and response ring data.
+ */
+struct SharedRegion {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t ringBytes;
+    std::atomic<uint32_t> closed; // Set by the server when it stops serving the region.
+    char padding[kCacheLine - 2 * sizeof(uint32_t) - sizeof(uint64_t) - sizeof(std::atomic<uint32_t>)];
+    SharedRing requests;
+    SharedRing responses;
+};
+
+static_assert(sizeof(SharedRegion) % kCacheLine == 0, "ring data must start on a cache line");
+
+std::size_t regionBytes(std::size_t ringBytes) {
+    return sizeof(SharedRegion) + 2 * ringBytes;
+}
+
+void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Not FUTEX_PRIVATE: the word is shared with another process.
+long futexWait(std::atomic<uint32_t>& word, uint32_t expected, int timeoutMs) {
+    timespec timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+    return ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, 0, 0);
+}
+
+void futexWake(std::atomic<uint32_t>& word) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, 0, 0, 0);
+}
+
+void notify(SharedEvent& event) {
+    event.sequence.fetch_add(1);
+    if (event.sleepers.load() != 0) {
+        futexWake(event.sequence);
+    }
+}
+
+// On a single core the peer cannot make progress while we spin.
+int spinIterations() {
+    static const int iterations = std::thread::hardware_concurrency() > 1 ? kSpinIterations : 0;
+    return iterations;
+}
+
+// Spins, then sleeps on the event until ready() holds; gives up once alive() fails.
+template <typename Ready, typename Alive>
+bool waitFor(SharedEvent& event, Ready ready, Alive alive) {
+    for (int i = spinIterations(); i > 0; --i) {
+        if (ready()) {
+            return true;
+        }
+        cpuRelax();
+    }
+    for (;;) {
+        // Sleepers are registered before the final check, and notify() bumps
+        // the sequence before looking for sleepers, so no wakeup is lost.
+        const uint32_t sequence = event.sequence.load();
+        event.sleepers.fetch_add(1);
+        if (ready()) {
+            event.sleepers.fetch_sub(1);
+            return true;
+        }
+        futexWait(event.sequence, sequence, kSleepMs);
+        event.sleepers.fetch_sub(1);
+        if (ready()) {
+            return true;
+        }
+        if (!alive()) {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief One side's view of a byte ring: the producer writes, the consumer reads.
+ */
+class RingStream {
+public:
+    RingStream(SharedRing& ring, char* data, std::size_t capacity)
+        : ring_(ring), data_(data), capacity_(capacity) {}
+
+    template <typename Alive>
+    bool write(const char* data, std::size_t size, Alive alive) {
+        while (size > 0) {
+            const uint64_t tail = ring_.tail.load(std::memory_order_relaxed);
+            uint64_t head = 0;
+            if (!waitFor(ring_.writable, [this, tail, &head]() {
+                    head = ring_.head.load();
+                    return tail - head < capacity_;
+                }, alive)) {
+                return false;
+            }
+            const std::size_t chunk = std::min<std::size_t>(size, capacity_ - (tail - head));
+            const std::size_t offset = static_cast<std::size_t>(tail & (capacity_ - 1));
+            const std::size_t first = std::min(chunk, capacity_ - offset);
+            std::memcpy(data_ + offset, data, first);
+            std::memcpy(data_, data + first, chunk - first);
+            ring_.tail.store(tail + chunk);
+            notify(ring_.readable);
+            data += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+    template <typename Alive>
+    bool read(char* data, std::size_t size, Alive alive) {
+        while (size > 0) {
+            const uint64_t head = ring_.head.load(std::memory_order_relaxed);
+            uint64_t tail = 0;
+            if (!waitFor(ring_.readable, [this, head, &tail]() {
+                    tail = ring_.tail.load();
+                    return tail != head;
+                }, alive)) {
+                return false;
+            }
+            // The peer owns the tail, so a corrupt one must not take the copy out of the ring.
+            const std::size_t chunk = std::min<std::size_t>(std::min<uint64_t>(size, tail - head), capacity_);
+            const std::size_t offset = static_cast<std::size_t>(head & (capacity_ - 1));
+            const std::size_t first = std::min(chunk, capacity_ - offset);
+            std::memcpy(data, data_ + offset, first);
+            std::memcpy(data + first, data_, chunk - first);
+            ring_.head.store(head + chunk);
+            notify(ring_.writable);
+            data += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+private:
+    SharedRing& ring_;
+    char* data_;
+    std::size_t capacity_;
+};
+
+// The ring size is passed in rather than read from the region, which the peer can write.
+RingStream requestStream(SharedRegion& region, std::size_t ringBytes) {
+    return RingStream(region.requests, reinterpret_cast<char*>(&region + 1), ringBytes);
+}
+
+RingStream responseStream(SharedRegion& region, std::size_t ringBytes) {
+    return RingStream(region.responses, reinterpret_cast<char*>(&region + 1) + ringBytes, ringBytes);
+}
+
+void appendU32(std::string& buffer, uint32_t value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendText(std::string& buffer, const std::string& text) {
+    appendU32(buffer, static_cast<uint32_t>(text.size()));
+    buffer += text;
+}
+
+// The server never writes to the socket after setup, so readable means closed.
+bool peerConnected(int fd) {
+    pollfd descriptor = {fd, POLLIN, 0};
+    if (::poll(&descriptor, 1, 0) < 0) {
+        return errno == EINTR;
+    }
+    if ((descriptor.revents & (POLLHUP | POLLERR | POLLNVAL)) != 0) {
+        return false;
+    }
+    char byte = 0;
+    return (descriptor.revents & POLLIN) == 0 || ::recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) > 0;
+}
+
+bool makeAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool sendDescriptor(int socket, int fd, uint64_t ringBytes) {
+    char control[CMSG_SPACE(sizeof(int))];
+    std::memset(control, 0, sizeof(control));
+    iovec data = {&ringBytes, sizeof(ringBytes)};
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(header), &fd, sizeof(fd));
+    return ::sendmsg(socket, &message, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(ringBytes));
+}
+
+bool receiveDescriptor(int socket, int& fd, uint64_t& ringBytes) {
+    char control[CMSG_SPACE(sizeof(int))];
+    iovec data = {&ringBytes, sizeof(ringBytes)};
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t received = 0;
+    do {
+        received = ::recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+    const cmsghdr* header = received == static_cast<ssize_t>(sizeof(ringBytes)) ? CMSG_FIRSTHDR(&message) : 0;
+    if (header == 0 || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS ||
+        header->cmsg_len != CMSG_LEN(sizeof(int))) {
+        return false;
+    }
+    std::memcpy(&fd, CMSG_DATA(header), sizeof(fd));
+    return true;
+}
+
+} // namespace
+
+// Implementation of SharedMemoryLookupServer class methods
+
+const std::size_t SharedMemoryLookupServer::kDefaultRingBytes;
+
+SharedMemoryLookupServer::SharedMemoryLookupServer(LibrarySystem& library, const std::string& socketPath,
+                                                   std::size_t ringBytes)
+    : library_(library), socketPath_(socketPath), ringBytes_(kMinRingBytes), listenFd_(-1), stopping_(false) {
+    while (ringBytes_ < std::min(ringBytes, kMaxRingBytes)) {
+        ringBytes_ <<= 1;
+    }
+    sockaddr_un address;
+    if (!makeAddress(socketPath, address)) {
+        return;
+    }
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) {
+        return;
+    }
+    ::unlink(socketPath.c_str());
+    if (::bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenFd_, 16) != 0) {
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return;
+    }
+    acceptor_ = std::thread(&SharedMemoryLookupServer::accept, this);
+}
+
+SharedMemoryLookupServer::~SharedMemoryLookupServer() {
+    if (listenFd_ < 0) {
+        return;
+    }
+    // Workers notice within kSleepMs and close their regions, which wakes their clients.
+    stopping_.store(true);
+    ::shutdown(listenFd_, SHUT_RDWR);
+    acceptor_.join();
+    ::close(listenFd_);
+    ::unlink(socketPath_.c_str());
+    for (std::size_t i = 0; i < clients_.size(); ++i) {
+        clients_[i]->worker.join();
+    }
+}
+
+bool SharedMemoryLookupServer::listening() const {
+    return listenFd_ >= 0;
+}
+
+std::size_t SharedMemoryLookupServer::clientCount() const {
+    std::lock_guard<std::mutex> lock(clientsMutex_);
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < clients_.size(); ++i) {
+        count += clients_[i]->connected.load() ? 1 : 0;
+    }
+    return count;
+}
+
+void SharedMemoryLookupServer::accept() {
+    for (;;) {
+        const int fd = ::accept4(listenFd_, 0, 0, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        if (stopping_.load()) {
+            ::close(fd);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(clientsMutex_);
+        // Reap the workers of clients that went away.
+        for (std::size_t i = 0; i < clients_.size();) {
+            if (!clients_[i]->connected.load()) {
+                clients_[i]->worker.join();
+                clients_[i].swap(clients_.back());
+                clients_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        clients_.push_back(std::unique_ptr<Client>(new Client()));
+        Client* client = clients_.back().get();
+        client->fd = fd;
+        client->connected.store(true);
+        client->worker = std::thread(&SharedMemoryLookupServer::serve, this, client);
+    }
+}
+
+void SharedMemoryLookupServer::serve(Client* client) {
+    const std::size_t bytes = regionBytes(ringBytes_);
+    void* mapping = MAP_FAILED;
+    const int memory = ::memfd_create("library-lookup", MFD_CLOEXEC);
+    if (memory >= 0 && ::ftruncate(memory, static_cast<off_t>(bytes)) == 0) {
+        mapping = ::mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+    }
+    SharedRegion* region = 0;
+    if (mapping != MAP_FAILED) {
+        region = new (mapping) SharedRegion();
+        region->magic = kRegionMagic;
+        region->version = kRegionVersion;
+        region->ringBytes = ringBytes_;
+        if (!sendDescriptor(client->fd, memory, ringBytes_)) {
+            region = 0;
+        }
+    }
+    if (memory >= 0) {
+        ::close(memory); // The mappings keep the memory alive.
+    }
+
+    if (region != 0) {
+        const int fd = client->fd;
+        const std::atomic<bool>& stopping = stopping_;
+        const auto alive = [fd, &stopping]() { return !stopping.load() && peerConnected(fd); };
+        RingStream requests = requestStream(*region, ringBytes_);
+        RingStream responses = responseStream(*region, ringBytes_);
+        std::string payload;
+        std::string response;
+        for (;;) {
+            uint32_t header[2];
+            if (!requests.read(reinterpret_cast<char*>(header), sizeof(header), alive) ||
+                header[1] > kMaxRequestBytes) {
+                break;
+            }
+            payload.resize(header[1]);
+            if (!requests.read(&payload[0], payload.size(), alive)) {
+                break;
+            }
+
+            response.clear();
+            if (header[0] == OPERATION_SEARCH) {
+                const std::vector<std::string> titles = library_.searchBooks(payload);
+                appendU32(response, 1);
+                appendU32(response, static_cast<uint32_t>(titles.size()));
+                for (std::size_t i = 0; i < titles.size(); ++i) {
+                    appendText(response, titles[i]);
+                }
+            } else if (header[0] == OPERATION_FIND_BOOK) {
+                LibrarySystem::SearchHit book;
+                const bool found = library_.findBook(payload, book);
+                appendU32(response, found ? 1 : 0);
+                if (found) {
+                    appendU32(response, book.loans);
+                    appendText(response, book.title);
+                }
+            } else {
+                break;
+            }
+            if (!responses.write(response.data(), response.size(), alive)) {
+                break;
+            }
+        }
+
+        // Wake the client if it waits on either ring, so it sees the region closed.
+        region->closed.store(1);
+        notify(region->requests.writable);
+        notify(region->responses.readable);
+    }
+    if (mapping != MAP_FAILED) {
+        ::munmap(mapping, bytes);
+    }
+    ::close(client->fd);
+    client->connected.store(false);
+}
+
+// Implementation of SharedMemoryLookupClient class methods
+
+SharedMemoryLookupClient::SharedMemoryLookupClient(const std::string& socketPath)
+    : fd_(-1), region_(0), regionBytes_(0), ringBytes_(0), connected_(false) {
+    sockaddr_un address;
+    if (!makeAddress(socketPath, address)) {
+        return;
+    }
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        return;
+    }
+    int memory = -1;
+    uint64_t ringBytes = 0;
+    if (::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        !receiveDescriptor(fd_, memory, ringBytes)) {
+        return;
+    }
+    // Only trust sizes a server could have produced.
+    if (ringBytes >= kMinRingBytes && ringBytes <= kMaxRingBytes && (ringBytes & (ringBytes - 1)) == 0) {
+        void* mapping = ::mmap(0, regionBytes(ringBytes), PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+        if (mapping != MAP_FAILED) {
+            region_ = mapping;
+            regionBytes_ = regionBytes(ringBytes);
+            ringBytes_ = static_cast<std::size_t>(ringBytes);
+        }
+    }
+    ::close(memory);
+    if (region_ == 0) {
+        return;
+    }
+    const SharedRegion* region = static_cast<const SharedRegion*>(region_);
+    connected_.store(region->magic == kRegionMagic && region->version == kRegionVersion &&
+                     region->ringBytes == ringBytes);
+}
+
+SharedMemoryLookupClient::~SharedMemoryLookupClient() {
+    if (region_ != 0) {
+        ::munmap(region_, regionBytes_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool SharedMemoryLookupClient::connected() const {
+    return connected_.load();
+}
+
+std::vector<std::string> SharedMemoryLookupClient::searchBooks(const std::string& keyword) {
+    std::lock_guard<std::mutex> lock(callMutex_);
+    std::vector<std::string> titles;
+    uint32_t status = 0;
+    uint32_t count = 0;
+    if (!send(OPERATION_SEARCH, keyword) || !receive(&status, sizeof(status)) || !receive(&count, sizeof(count))) {
+        return titles;
+    }
+    // Searches always succeed; anything else means the stream is corrupt.
+    if (status != 1 || count > kMaxSearchResults) {
+        connected_.store(false);
+        return titles;
+    }
+    // Every title takes at least its length word in the ring, so only reserve
+    // what one ring could hold; the rest grows as titles actually arrive.
+    titles.reserve(std::min<std::size_t>(count, ringBytes_ / sizeof(uint32_t)));
+    std::string title;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!receive(title)) {
+            return std::vector<std::string>();
+        }
+        titles.push_back(title);
+    }
+    return titles;
+}
+
+bool SharedMemoryLookupClient::findBook(const std::string& isbn, LibrarySystem::SearchHit& book) {
+    std::lock_guard<std::mutex> lock(callMutex_);
+    uint32_t status = 0;
+    if (!send(OPERATION_FIND_BOOK, isbn) || !receive(&status, sizeof(status)) || status == 0) {
+        return false;
+    }
+    uint32_t loans = 0;
+    if (!receive(&loans, sizeof(loans)) || !receive(book.title)) {
+        return false;
+    }
+    book.loans = loans;
+    return true;
+}
+
+bool SharedMemoryLookupClient::send(uint32_t operation, const std::string& payload) {
+    if (!connected_.load() || payload.size() > kMaxRequestBytes) {
+        return false;
+    }
+    std::string request;
+    request.reserve(2 * sizeof(uint32_t) + payload.size());
+    appendU32(request, operation);
+    appendText(request, payload);
+    const SharedMemoryLookupClient* self = this;
+    if (!requestStream(*static_cast<SharedRegion*>(region_), ringBytes_)
+             .write(request.data(), request.size(), [self]() { return self->alive(); })) {
+        connected_.store(false);
+        return false;
+    }
+    return true;
+}
+
+bool SharedMemoryLookupClient::receive(void* data, std::size_t size) {
+    const SharedMemoryLookupClient* self = this;
+    if (!responseStream(*static_cast<SharedRegion*>(region_), ringBytes_)
+             .read(static_cast<char*>(data), size, [self]() { return self->alive(); })) {
+        connected_.store(false);
+        return false;
+    }
+    return true;
+}
+
+bool SharedMemoryLookupClient::receive(std::string& text) {
+    uint32_t size = 0;
+    if (!receive(&size, sizeof(size)) || size > kMaxTextBytes) {
+        connected_.store(false);
+        return false;
+    }
+    text.resize(size);
+    return size == 0 || receive(&text[0], size);
+}
+
+bool SharedMemoryLookupClient::alive() const {
+    return static_cast<const SharedRegion*>(region_)->closed.load() == 0 && peerConnected(fd_);
+}
@@ -0,0 +1,191 @@
+//!
+//! @file string_pool.cpp
+//! @brief Implementation of the StringPool concurrent string interning arena
+//!
+
+#include "library_system/string_pool.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+const StringPool::Id kEmptySlot = ~static_cast<StringPool::Id>(0);
+const std::size_t kBlockSize = 64 * 1024;
+const std::size_t kInitialSlots = 64;
+
+uint32_t hashText(const std::string& text) {
+    // FNV-1a: short keys dominate, so a simple byte-wise hash is enough.
+    uint32_t hash = 2166136261u;
+    for (std::string::size_type i = 0; i < text.size(); ++i) {
+        hash = (hash ^ static_cast<unsigned char>(text[i])) * 16777619u;
+    }
+    return hash;
+}
+
+} // namespace
+
+const std::size_t StringPool::kShardCount;
+const std::size_t StringPool::kEntriesPerChunk;
+const std::size_t StringPool::kMaxChunks;
+
+std::string StringPool::View::str() const {
+    return std::string(data, size);
+}
+
+StringPool& StringPool::global() {
+    static StringPool pool;
+    return pool;
+}
+
+StringPool::StringPool()
+    : nextId_(0), chunks_(new std::atomic<Entry*>[kMaxChunks]) {
+    for (std::size_t i = 0; i < kMaxChunks; ++i) {
+        chunks_[i].store(0);
+    }
+    for (std::size_t i = 0; i < kShardCount; ++i) {
+        shards_[i].slots.assign(kInitialSlots, kEmptySlot);
+        shards_[i].used = 0;
+        shards_[i].blockUsed = kBlockSize;
+        shards_[i].arenaBytes = 0;
+    }
+}
+
+StringPool::~StringPool() {
+    for (std::size_t i = 0; i < kMaxChunks; ++i) {
+        delete[] chunks_[i].load();
+    }
+    delete[] chunks_;
+}
+
+StringPool::Id StringPool::intern(const std::string& text) {
+    const uint32_t hash = hashText(text);
+    Shard& shard = shards_[hash % kShardCount];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    std::size_t slot = 0;
+    if (probe(shard, text, hash, slot)) {
+        return shard.slots[slot];
+    }
+
+    const Id id = nextId_.fetch_add(1);
+    const std::size_t chunk = id / kEntriesPerChunk;
+    if (chunk >= kMaxChunks) {
+        throw std::length_error("StringPool: too many distinct strings");
+    }
+    Entry* entries = chunks_[chunk].load();
+    if (entries == 0) {
+        std::lock_guard<std::mutex> chunksLock(chunksMutex_);
+        entries = chunks_[chunk].load();
+        if (entries == 0) {
+            entries = new Entry[kEntriesPerChunk];
+            chunks_[chunk].store(entries);
+        }
+    }
+    Entry created = {store(shard, text), static_cast<uint32_t>(text.size()), hash};
+    entries[id % kEntriesPerChunk] = created;
+
+    shard.slots[slot] = id;
+    if (++shard.used * 2 > shard.slots.size()) {
+        grow(shard);
+    }
+    return id;
+}
+
+bool StringPool::find(const std::string& text, Id& id) const {
+    const uint32_t hash = hashText(text);
+    const Shard& shard = shards_[hash % kShardCount];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    std::size_t slot = 0;
+    if (!probe(shard, text, hash, slot)) {
+        return false;
+    }
+    id = shard.slots[slot];
+    return true;
+}
+
+StringPool::View StringPool::view(Id id) const {
+    const Entry& stored = entry(id);
+    View view = {stored.data, stored.size};
+    return view;
+}
+
+std::string StringPool::str(Id id) const {
+    const Entry& stored = entry(id);
+    return std::string(stored.data, stored.size);
+}
+
+std::size_t StringPool::size() const {
+    return nextId_.load();
+}
+
+std::size_t StringPool::memoryUsage() const {
+    std::size_t bytes = kMaxChunks * sizeof(std::atomic<Entry*>);
+    bytes += ((nextId_.load() + kEntriesPerChunk - 1) / kEntriesPerChunk) * kEntriesPerChunk * sizeof(Entry);
+    for (std::size_t i = 0; i < kShardCount; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        bytes += shards_[i].slots.capacity() * sizeof(Id) + shards_[i].arenaBytes;
+    }
+    return bytes;
+}
+
+const StringPool::Entry& StringPool::entry(Id id) const {
+    return chunks_[id / kEntriesPerChunk].load()[id % kEntriesPerChunk];
+}
+
+const char* StringPool::store(Shard& shard, const std::string& text) {
+    // Long strings get a block of their own, inserted before the current
+    // block so that the last block always remains the bump target.
+    if (text.size() > kBlockSize / 4) {
+        std::unique_ptr<char[]> block(new char[text.size()]);
+        std::memcpy(block.get(), text.data(), text.size());
+        char* data = block.get();
+        shard.blocks.insert(shard.blocks.empty() ? shard.blocks.end() : shard.blocks.end() - 1, std::move(block));
+        shard.arenaBytes += text.size();
+        return data;
+    }
+    if (shard.blocks.empty() || shard.blockUsed + text.size() > kBlockSize) {
+        shard.blocks.push_back(std::unique_ptr<char[]>(new char[kBlockSize]));
+        shard.arenaBytes += kBlockSize;
+        shard.blockUsed = 0;
+    }
+    char* data = shard.blocks.back().get() + shard.blockUsed;
+    std::memcpy(data, text.data(), text.size());
+    shard.blockUsed += text.size();
+    return data;
+}
+
+bool StringPool::probe(const Shard& shard, const std::string& text, uint32_t hash, std::size_t& slot) const {
+    const std::size_t mask = shard.slots.size() - 1;
+    // The low hash bits select the shard, so probe with the high bits.
+    for (slot = (hash >> 4) & mask;; slot = (slot + 1) & mask) {
+        const Id id = shard.slots[slot];
+        if (id == kEmptySlot) {
+            return false;
+        }
+        const Entry& candidate = entry(id);
+        if (candidate.hash == hash && candidate.size == text.size() &&
+            std::memcmp(candidate.data, text.data(), text.size()) == 0) {
+            return true;
+        }
+    }
+}
+
+void StringPool::grow(Shard& shard) {
+    std::vector<Id> slots(shard.slots.size() * 2, kEmptySlot);
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t i = 0; i < shard.slots.size(); ++i) {
+        const Id id = shard.slots[i];
+        if (id == kEmptySlot) {
+            continue;
+        }
+        std::size_t slot = (entry(id).hash >> 4) & mask;
+        while (slots[slot] != kEmptySlot) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+    }
+    shard.slots.swap(slots);
+}
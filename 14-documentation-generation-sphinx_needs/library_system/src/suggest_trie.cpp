@@ -0,0 +1,257 @@
+//!
+//! @file suggest_trie.cpp
+//! @brief Implementation of the SuggestTrie prefix completion index
+//!
+
+#include "library_system/suggest_trie.hpp"
+
+#include <algorithm>
+
+namespace {
+
+bool entryKeyLess(const SuggestTrie::Entry& lhs, const SuggestTrie::Entry& rhs) {
+    return lhs.key < rhs.key;
+}
+
+} // namespace
+
+const std::size_t SuggestTrie::kMaxSuggestions;
+const uint32_t SuggestTrie::kNoEntry;
+
+SuggestTrie::SuggestTrie() {
+    Node root = {0, 0, 0, 0, kNoEntry};
+    nodes_.push_back(root);
+}
+
+void SuggestTrie::build(std::vector<Entry> entries) {
+    nodes_.clear();
+    edges_.clear();
+    labels_.clear();
+    topEntries_.clear();
+    keys_.clear();
+    texts_.clear();
+    popularity_.clear();
+
+    // Sort by key and merge duplicates so every key maps to exactly one entry.
+    std::stable_sort(entries.begin(), entries.end(), entryKeyLess);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].key.empty()) {
+            continue;
+        }
+        if (!keys_.empty() && keys_.back() == entries[i].key) {
+            popularity_.back() += entries[i].popularity;
+            continue;
+        }
+        keys_.push_back(entries[i].key);
+        texts_.push_back(entries[i].text);
+        popularity_.push_back(entries[i].popularity);
+    }
+
+    buildNode(0, keys_.size(), 0);
+
+    // Keys are only needed while building: edge labels hold the same bytes.
+    std::vector<std::string>().swap(keys_);
+    nodes_.shrink_to_fit();
+    edges_.shrink_to_fit();
+    topEntries_.shrink_to_fit();
+}
+
+uint32_t SuggestTrie::buildNode(std::size_t begin, std::size_t end, std::size_t depth) {
+    const uint32_t index = static_cast<uint32_t>(nodes_.size());
+    Node node = {0, 0, 0, 0, kNoEntry};
+    nodes_.push_back(node);
+
+    // Keys are sorted, so a key that ends exactly at this node comes first.
+    std::vector<uint32_t> candidates;
+    std::size_t first = begin;
+    if (first < end && keys_[first].size() == depth) {
+        nodes_[index].entry = static_cast<uint32_t>(first);
+        candidates.push_back(static_cast<uint32_t>(first));
+        ++first;
+    }
+
+    std::vector<Edge> children;
+    while (first < end) {
+        const char label = keys_[first][depth];
+        std::size_t last = first + 1;
+        while (last < end && keys_[last][depth] == label) {
+            ++last;
+        }
+
+        // Path compression: the edge covers the common prefix of the group.
+        std::size_t common = keys_[first].size();
+        const std::string& lastKey = keys_[last - 1];
+        std::size_t limit = std::min(common, lastKey.size());
+        common = depth + 1;
+        while (common < limit && keys_[first][common] == lastKey[common]) {
+            ++common;
+        }
+
+        Edge edge;
+        edge.labelOffset = static_cast<uint32_t>(labels_.size());
+        edge.labelLength = static_cast<uint32_t>(common - depth);
+        labels_.append(keys_[first], depth, common - depth);
+        edge.target = buildNode(first, last, common);
+        children.push_back(edge);
+
+        const Node& child = nodes_[edge.target];
+        candidates.insert(candidates.end(), topEntries_.begin() + child.firstTop,
+                          topEntries_.begin() + child.firstTop + child.topCount);
+        first = last;
+    }
+
+    // Children are complete, so this node's edges and top-k can be appended.
+    std::size_t topCount = std::min(candidates.size(), kMaxSuggestions);
+    std::partial_sort(candidates.begin(), candidates.begin() + topCount, candidates.end(),
+                      [this](uint32_t lhs, uint32_t rhs) { return betterEntry(lhs, rhs); });
+
+    Node& self = nodes_[index];
+    self.firstEdge = static_cast<uint32_t>(edges_.size());
+    self.edgeCount = static_cast<uint32_t>(children.size());
+    self.firstTop = static_cast<uint32_t>(topEntries_.size());
+    self.topCount = static_cast<uint32_t>(topCount);
+    edges_.insert(edges_.end(), children.begin(), children.end());
+    topEntries_.insert(topEntries_.end(), candidates.begin(), candidates.begin() + topCount);
+    return index;
+}
+
+bool SuggestTrie::betterEntry(uint32_t lhs, uint32_t rhs) const {
+    if (popularity_[lhs] != popularity_[rhs]) {
+        return popularity_[lhs] > popularity_[rhs];
+    }
+    // Entries are stored in key order, so ties are broken alphabetically.
+    return lhs < rhs;
+}
+
+std::vector<std::string> SuggestTrie::suggest(const std::string& prefix, std::size_t k) const {
+    std::vector<std::string> suggestions;
+    uint32_t current = 0;
+    bool exact = false;
+    if (!walk(prefix, current, exact, 0)) {
+        return suggestions;
+    }
+
+    const Node& node = nodes_[current];
+    std::size_t count = std::min<std::size_t>(std::min(k, kMaxSuggestions), node.topCount);
+    suggestions.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        suggestions.push_back(texts_[topEntries_[node.firstTop + i]]);
+    }
+    return suggestions;
+}
+
+std::vector<SuggestTrie::Entry> SuggestTrie::top(const std::string& prefix, std::size_t k) const {
+    std::vector<Entry> entries;
+    uint32_t current = 0;
+    bool exact = false;
+    if (!walk(prefix, current, exact, 0)) {
+        return entries;
+    }
+
+    const Node& node = nodes_[current];
+    std::size_t count = std::min<std::size_t>(std::min(k, kMaxSuggestions), node.topCount);
+    entries.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint32_t entry = topEntries_[node.firstTop + i];
+        Entry top = {std::string(), texts_[entry], popularity_[entry]};
+        entries.push_back(top);
+    }
+    return entries;
+}
+
+bool SuggestTrie::find(const std::string& key, Entry& entry) const {
+    uint32_t current = 0;
+    bool exact = false;
+    if (!walk(key, current, exact, 0) || !exact || nodes_[current].entry == kNoEntry) {
+        return false;
+    }
+    const uint32_t found = nodes_[current].entry;
+    entry.key = key;
+    entry.text = texts_[found];
+    entry.popularity = popularity_[found];
+    return true;
+}
+
+bool SuggestTrie::addPopularity(const std::string& key, uint32_t delta) {
+    std::vector<uint32_t> path;
+    uint32_t current = 0;
+    bool exact = false;
+    if (!walk(key, current, exact, &path) || !exact || nodes_[current].entry == kNoEntry) {
+        return false;
+    }
+    const uint32_t entry = nodes_[current].entry;
+    popularity_[entry] += delta;
+
+    // Only this entry changed, and only upwards: on every node of its path it
+    // either moves up its top-k list or displaces the last one.
+    for (std::size_t i = 0; i < path.size(); ++i) {
+        const Node& node = nodes_[path[i]];
+        uint32_t* top = topEntries_.data() + node.firstTop;
+        std::size_t position = std::find(top, top + node.topCount, entry) - top;
+        if (position == node.topCount) {
+            if (node.topCount < kMaxSuggestions || !betterEntry(entry, top[node.topCount - 1])) {
+                continue;
+            }
+            position = node.topCount - 1;
+            top[position] = entry;
+        }
+        for (; position > 0 && betterEntry(top[position], top[position - 1]); --position) {
+            std::swap(top[position], top[position - 1]);
+        }
+    }
+    return true;
+}
+
+bool SuggestTrie::walk(const std::string& prefix, uint32_t& node, bool& exact, std::vector<uint32_t>* path) const {
+    if (nodes_.empty()) {
+        return false;
+    }
+
+    uint32_t current = 0;
+    std::size_t matched = 0;
+    exact = true;
+    if (path != 0) {
+        path->push_back(current);
+    }
+    while (matched < prefix.size()) {
+        const Node& parent = nodes_[current];
+        const Edge* begin = edges_.data() + parent.firstEdge;
+        const Edge* end = begin + parent.edgeCount;
+        const char wanted = prefix[matched];
+        const Edge* edge = std::lower_bound(begin, end, wanted,
+            [this](const Edge& e, char c) {
+                return static_cast<unsigned char>(labels_[e.labelOffset]) < static_cast<unsigned char>(c);
+            });
+        if (edge == end || labels_[edge->labelOffset] != wanted) {
+            return false;
+        }
+
+        // The prefix may end in the middle of the edge label.
+        std::size_t length = std::min<std::size_t>(edge->labelLength, prefix.size() - matched);
+        if (labels_.compare(edge->labelOffset, length, prefix, matched, length) != 0) {
+            return false;
+        }
+        exact = length == edge->labelLength;
+        matched += length;
+        current = edge->target;
+        if (path != 0) {
+            path->push_back(current);
+        }
+    }
+    node = current;
+    return true;
+}
+
+std::size_t SuggestTrie::nodeCount() const {
+    return nodes_.size();
+}
+
+std::size_t SuggestTrie::memoryUsage() const {
+    std::size_t bytes = nodes_.capacity() * sizeof(Node) + edges_.capacity() * sizeof(Edge) +
+                        labels_.capacity() + topEntries_.capacity() * sizeof(uint32_t) +
+                        texts_.capacity() * sizeof(std::string) + popularity_.capacity() * sizeof(uint32_t);
+    for (std::size_t i = 0; i < texts_.size(); ++i) {
+        bytes += texts_[i].capacity();
+    }
+    return bytes;
+}
@@ -0,0 +1,418 @@
+//!
+//! @file text_tokenizer.cpp
+//! @brief Implementation of text normalization helpers
+//!
+
+#include "library_system/text_tokenizer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define TEXT_TOKENIZER_AVX2 1
+#endif
+#endif
+
+namespace {
+
+// Character classes of the normalizer: separators are dropped, word characters
+// are copied (ASCII upper case letters folded to lower case).
+bool isWordChar(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+char foldCase(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : static_cast<char>(c);
+}
+
+/**
+ * @brief Output cursor of a normalization.
+ *
+ * The first separator after a word becomes a space and later ones of the
+ * same run are dropped; finish() removes a trailing space. Every output byte
+ * thus stands for a distinct input byte already consumed, so the output
+ * never overtakes the input and kernels may store whole blocks ahead of it
+ * into a buffer padded by kPadding bytes.
+ */
+struct Output {
+    char* begin;
+    char* out;
+    bool lastWord; ///< Whether the last consumed character was a word character.
+
+    void separator() {
+        if (lastWord) {
+            *out++ = ' ';
+            lastWord = false;
+        }
+    }
+
+    void word(const char* bytes, std::size_t count) {
+        std::memcpy(out, bytes, count);
+        out += count;
+        lastWord = true;
+    }
+
+    std::size_t finish() {
+        if (out != begin && out[-1] == ' ') {
+            --out;
+        }
+        return static_cast<std::size_t>(out - begin);
+    }
+};
+
+const std::size_t kPadding = 32;
+
+/**
+ * @brief Decode one UTF-8 sequence.
+ * @param p The first byte, at least 0x80.
+ * @param available The number of bytes left in the input.
+ * @param codePoint Receives the decoded code point.
+ * @return The length of the sequence, 0 if it is invalid.
+ */
+std::size_t decodeUtf8(const unsigned char* p, std::size_t available, uint32_t& codePoint) {
+    std::size_t length = 0;
+    uint32_t minimum = 0;
+    if (p[0] >= 0xC2 && p[0] <= 0xDF) {
+        length = 2;
+        codePoint = p[0] & 0x1F;
+        minimum = 0x80;
+    } else if (p[0] >= 0xE0 && p[0] <= 0xEF) {
+        length = 3;
+        codePoint = p[0] & 0x0F;
+        minimum = 0x800;
+    } else if (p[0] >= 0xF0 && p[0] <= 0xF4) {
+        length = 4;
+        codePoint = p[0] & 0x07;
+        minimum = 0x10000;
+    } else {
+        return 0;
+    }
+    if (length > available) {
+        return 0;
+    }
+    for (std::size_t i = 1; i < length; ++i) {
+        if ((p[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+        codePoint = (codePoint << 6) | (p[i] & 0x3F);
+    }
+    if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        return 0;
+    }
+    return length;
+}
+
+bool isSeparatorCodePoint(uint32_t c) {
+    if (c >= 0xA0 && c <= 0xBF) {
+        // Latin-1 punctuation and symbols, except the ordinal indicators,
+        // micro sign, superscripts and fractions, which read as word parts.
+        return c != 0xAA && c != 0xB2 && c != 0xB3 && c != 0xB5 && c != 0xB9 && c != 0xBA && (c < 0xBC || c == 0xBF);
+    }
+    return c == 0xD7 || c == 0xF7 || (c >= 0x2000 && c <= 0x206F) || (c >= 0x3000 && c <= 0x3003) ||
+           c == 0xFEFF;
+}
+
+// Lower case of an upper case letter; every mapping keeps the UTF-8 length.
+uint32_t foldCodePoint(uint32_t c) {
+    if ((c >= 0xC0 && c <= 0xDE && c != 0xD7) || (c >= 0x391 && c <= 0x3A9 && c != 0x3A2) ||
+        (c >= 0x410 && c <= 0x42F)) {
+        return c + 0x20;
+    }
+    if (c >= 0x400 && c <= 0x40F) {
+        return c + 0x50;
+    }
+    if (c == 0x178) {
+        return 0xFF;
+    }
+    // Latin Extended-A alternates upper and lower case, with a phase shift
+    // between U+0139 and U+0148 and again from U+0179.
+    const bool evenUpper = (c >= 0x100 && c <= 0x12F) || (c >= 0x132 && c <= 0x137) || (c >= 0x14A && c <= 0x177);
+    const bool oddUpper = (c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E);
+    if ((evenUpper && c % 2 == 0) || (oddUpper && c % 2 == 1)) {
+        return c + 1;
+    }
+    return c;
+}
+
+std::size_t encodeUtf8(uint32_t c, char* out) {
+    if (c < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (c >> 6));
+        out[1] = static_cast<char>(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (c >> 12));
+        out[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (c & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (c >> 18));
+    out[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (c & 0x3F));
+    return 4;
+}
+
+/**
+ * @brief Normalize the character starting at p.
+ * @return The number of input bytes consumed.
+ */
+std::size_t normalizeChar(Output& output, const unsigned char* p, const unsigned char* end) {
+    if (*p < 0x80) {
+        if (isWordChar(*p)) {
+            const char folded = foldCase(*p);
+            output.word(&folded, 1);
+        } else {
+            output.separator();
+        }
+        return 1;
+    }
+    uint32_t codePoint = 0;
+    const std::size_t length = decodeUtf8(p, static_cast<std::size_t>(end - p), codePoint);
+    if (length == 0) {
+        output.word(reinterpret_cast<const char*>(p), 1);
+        return 1;
+    }
+    if (isSeparatorCodePoint(codePoint)) {
+        output.separator();
+        return length;
+    }
+    char encoded[4];
+    output.word(encoded, encodeUtf8(foldCodePoint(codePoint), encoded));
+    return length;
+}
+
+void normalizeScalar(Output& output, const unsigned char* p, const unsigned char* end) {
+    while (p < end) {
+        p += normalizeChar(output, p, end);
+    }
+}
+
+// Normalize a run of non-ASCII characters, which the vector kernels leave to the scalar path.
+inline const unsigned char* normalizeNonAscii(Output& output, const unsigned char* p, const unsigned char* end) {
+    while (p < end && *p >= 0x80) {
+        p += normalizeChar(output, p, end);
+    }
+    return p;
+}
+
+/**
+ * @brief Keep the word characters of an ASCII block and the first separator of every run.
+ * @param output The output.
+ * @param words Bit i is set if byte i is a word character.
+ * @param width The number of bytes of the block to consume.
+ * @return Bit i is set if byte i is written.
+ */
+inline uint64_t keepMask(const Output& output, uint64_t words, unsigned width) {
+    const uint64_t valid = (static_cast<uint64_t>(1) << width) - 1;
+    return (words | (words << 1) | (output.lastWord ? 1 : 0)) & valid;
+}
+
+/**
+ * @brief Write the kept bytes of a block, branch-free.
+ * @param output The output.
+ * @param values The block with word characters folded and separators turned into spaces.
+ * @param keep The bytes to write, see keepMask().
+ * @param width The number of bytes of the block to consume.
+ */
+inline void compactBlock(Output& output, const char* values, uint64_t keep, unsigned width) {
+    char* out = output.out;
+    for (unsigned i = 0; i < width; ++i) {
+        *out = values[i];
+        out += (keep >> i) & 1;
+    }
+    output.out = out;
+}
+
+#if defined(__SSE2__)
+// Bytes in [low, low + count), compared as signed after shifting the range to -128.
+inline __m128i inRange(__m128i bytes, char low, int count) {
+    const __m128i shifted = _mm_add_epi8(bytes, _mm_set1_epi8(static_cast<char>(0x80 - low)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(0x80 + count)));
+}
+
+void normalizeSse2(Output& output, const unsigned char* p, const unsigned char* end) {
+    const unsigned kWidth = 16;
+    unsigned char tail[kWidth];
+    while (p < end) {
+        // The last block is read from a copy padded with separators.
+        const unsigned available = static_cast<unsigned>(std::min<std::ptrdiff_t>(kWidth, end - p));
+        const unsigned char* block = p;
+        if (available < kWidth) {
+            std::memset(tail, 0, kWidth);
+            std::memcpy(tail, p, available);
+            block = tail;
+        }
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+        const unsigned nonAscii = static_cast<unsigned>(_mm_movemask_epi8(bytes)) | (1u << available);
+        const unsigned width = static_cast<unsigned>(__builtin_ctz(nonAscii));
+
+        const __m128i upper = inRange(bytes, 'A', 26);
+        const __m128i word = _mm_or_si128(_mm_or_si128(upper, inRange(bytes, 'a', 26)), inRange(bytes, '0', 10));
+        const __m128i folded = _mm_add_epi8(bytes, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+        const __m128i values = _mm_or_si128(_mm_and_si128(word, folded), _mm_andnot_si128(word, _mm_set1_epi8(' ')));
+        const uint64_t words = static_cast<unsigned>(_mm_movemask_epi8(word));
+        if (width == kWidth && words == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output.out), values);
+            output.out += kWidth;
+        } else if (width != 0) {
+            char block[kWidth];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(block), values);
+            compactBlock(output, block, keepMask(output, words, width), width);
+        }
+        if (width != 0) {
+            output.lastWord = (words >> (width - 1)) & 1;
+        }
+        p = normalizeNonAscii(output, p + width, end);
+    }
+}
+#endif
+
+#if defined(TEXT_TOKENIZER_AVX2)
+/**
+ * @brief Shuffle indices moving the set bytes of an 8-bit mask to the front.
+ */
+struct CompactTable {
+    uint64_t indices[256];
+    uint8_t counts[256];
+
+    CompactTable() {
+        for (unsigned mask = 0; mask < 256; ++mask) {
+            uint64_t packed = 0;
+            unsigned count = 0;
+            for (unsigned bit = 0; bit < 8; ++bit) {
+                if ((mask >> bit) & 1) {
+                    packed |= static_cast<uint64_t>(bit) << (8 * count++);
+                }
+            }
+            indices[mask] = packed;
+            counts[mask] = static_cast<uint8_t>(count);
+        }
+    }
+};
+
+const CompactTable kCompactTable;
+
+__attribute__((target("avx2"))) inline __m256i inRange256(__m256i bytes, char low, int count) {
+    const __m256i shifted = _mm256_add_epi8(bytes, _mm256_set1_epi8(static_cast<char>(0x80 - low)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(0x80 + count)), shifted);
+}
+
+// Write the kept bytes of 16 values, 8 at a time through a byte shuffle.
+__attribute__((target("avx2"))) inline char* compactHalf(char* out, __m128i values, unsigned keep) {
+    const unsigned low = keep & 0xFF;
+    const unsigned high = keep >> 8;
+    const __m128i shuffle = _mm_set_epi64x(static_cast<long long>(kCompactTable.indices[high] + 0x0808080808080808ULL),
+                                           static_cast<long long>(kCompactTable.indices[low]));
+    const __m128i packed = _mm_shuffle_epi8(values, shuffle);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+    out += kCompactTable.counts[low];
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_unpackhi_epi64(packed, packed));
+    return out + kCompactTable.counts[high];
+}
+
+__attribute__((target("avx2"))) void normalizeAvx2(Output& output, const unsigned char* p, const unsigned char* end) {
+    const unsigned kWidth = 32;
+    unsigned char tail[kWidth];
+    while (p < end) {
+        const unsigned available = static_cast<unsigned>(std::min<std::ptrdiff_t>(kWidth, end - p));
+        const unsigned char* block = p;
+        if (available < kWidth) {
+            std::memset(tail, 0, kWidth);
+            std::memcpy(tail, p, available);
+            block = tail;
+        }
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        const uint64_t nonAscii =
+            static_cast<uint32_t>(_mm256_movemask_epi8(bytes)) | (static_cast<uint64_t>(1) << available);
+        const unsigned width = static_cast<unsigned>(__builtin_ctzll(nonAscii));
+
+        const __m256i upper = inRange256(bytes, 'A', 26);
+        const __m256i word =
+            _mm256_or_si256(_mm256_or_si256(upper, inRange256(bytes, 'a', 26)), inRange256(bytes, '0', 10));
+        const __m256i folded = _mm256_add_epi8(bytes, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+        const __m256i values =
+            _mm256_or_si256(_mm256_and_si256(word, folded), _mm256_andnot_si256(word, _mm256_set1_epi8(' ')));
+        const uint64_t words = static_cast<uint32_t>(_mm256_movemask_epi8(word));
+        if (width == kWidth && words == 0xFFFFFFFFu) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output.out), values);
+            output.out += kWidth;
+        } else if (width != 0) {
+            const uint64_t keep = keepMask(output, words, width);
+            char* out = compactHalf(output.out, _mm256_castsi256_si128(values), keep & 0xFFFF);
+            output.out = compactHalf(out, _mm256_extracti128_si256(values, 1), static_cast<unsigned>(keep >> 16));
+        }
+        if (width != 0) {
+            output.lastWord = (words >> (width - 1)) & 1;
+        }
+        p = normalizeNonAscii(output, p + width, end);
+    }
+}
+#endif
+
+} // namespace
+
+TextKernel bestTextKernel() {
+#if defined(TEXT_TOKENIZER_AVX2)
+    static const TextKernel best = (__builtin_cpu_init(), __builtin_cpu_supports("avx2")) ? TEXT_KERNEL_AVX2
+                                                                                           : TEXT_KERNEL_SSE2;
+    return best;
+#elif defined(__SSE2__)
+    return TEXT_KERNEL_SSE2;
+#else
+    return TEXT_KERNEL_SCALAR;
+#endif
+}
+
+std::string normalizeText(const std::string& text) {
+    return normalizeText(text, bestTextKernel());
+}
+
+std::string normalizeText(const std::string& text, TextKernel kernel) {
+    if (kernel > bestTextKernel()) {
+        kernel = bestTextKernel();
+    }
+
+    std::string normalized(text.size() + kPadding, '\0');
+    Output output = {&normalized[0], &normalized[0], false};
+    const unsigned char* begin = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* end = begin + text.size();
+    switch (kernel) {
+#if defined(TEXT_TOKENIZER_AVX2)
+    case TEXT_KERNEL_AVX2:
+        normalizeAvx2(output, begin, end);
+        break;
+#endif
+#if defined(__SSE2__)
+    case TEXT_KERNEL_SSE2:
+        normalizeSse2(output, begin, end);
+        break;
+#endif
+    default:
+        normalizeScalar(output, begin, end);
+        break;
+    }
+    normalized.resize(output.finish());
+    return normalized;
+}
+
+std::vector<std::string> tokenizeText(const std::string& text) {
+    const std::string normalized = normalizeText(text);
+    std::vector<std::string> tokens;
+
+    std::string::size_type begin = 0;
+    while (begin < normalized.size()) {
+        std::string::size_type end = normalized.find(' ', begin);
+        if (end == std::string::npos) {
+            end = normalized.size();
+        }
+        tokens.push_back(normalized.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return tokens;
+}
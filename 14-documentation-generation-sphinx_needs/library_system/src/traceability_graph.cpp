@@ -0,0 +1,174 @@
+//!
+//! @file traceability_graph.cpp
+//! @brief Implementation of the TraceabilityGraph requirement-to-test link graph
+//!
+
+#include "library_system/traceability_graph.hpp"
+
+#include <algorithm>
+
+namespace {
+
+void setBit(std::vector<uint64_t>& bits, uint32_t index) {
+    bits[index >> 6] |= uint64_t(1) << (index & 63);
+}
+
+bool testBit(const std::vector<uint64_t>& bits, uint32_t index) {
+    return (bits[index >> 6] >> (index & 63)) & 1;
+}
+
+/**
+ * @brief Build one direction of compressed sparse row adjacency by counting sort.
+ */
+void buildRows(const std::vector<std::pair<uint32_t, uint32_t> >& links, std::size_t nodeCount, bool reverse,
+               std::vector<uint32_t>& offsets, std::vector<uint32_t>& targets) {
+    offsets.assign(nodeCount + 1, 0);
+    for (std::size_t i = 0; i < links.size(); ++i) {
+        ++offsets[(reverse ? links[i].second : links[i].first) + 1];
+    }
+    for (std::size_t i = 0; i < nodeCount; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+    targets.resize(links.size());
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < links.size(); ++i) {
+        const uint32_t source = reverse ? links[i].second : links[i].first;
+        targets[next[source]++] = reverse ? links[i].first : links[i].second;
+    }
+}
+
+} // namespace
+
+TraceabilityGraph::NodeId TraceabilityGraph::addNode(TraceKind kind, const std::string& key) {
+    const StringPool::Id keyId = StringPool::global().intern(key);
+    std::unordered_map<StringPool::Id, NodeId>::const_iterator it = nodesByKey_.find(keyId);
+    if (it != nodesByKey_.end()) {
+        return it->second;
+    }
+    const NodeId node = static_cast<NodeId>(kinds_.size());
+    kinds_.push_back(static_cast<uint8_t>(kind));
+    keys_.push_back(keyId);
+    nodesByKey_[keyId] = node;
+    for (int k = TRACE_REQUIREMENT; k <= TRACE_TEST_CASE; ++k) {
+        kindMasks_[k].resize((kinds_.size() + 63) / 64, 0);
+    }
+    setBit(kindMasks_[kind], node);
+    return node;
+}
+
+void TraceabilityGraph::addLink(NodeId from, NodeId to) {
+    if (from >= kinds_.size() || to >= kinds_.size()) {
+        return;
+    }
+    links_.push_back(std::make_pair(from, to));
+}
+
+void TraceabilityGraph::build() {
+    std::sort(links_.begin(), links_.end());
+    links_.erase(std::unique(links_.begin(), links_.end()), links_.end());
+    buildRows(links_, kinds_.size(), false, forwardOffsets_, forwardTargets_);
+    buildRows(links_, kinds_.size(), true, reverseOffsets_, reverseTargets_);
+}
+
+bool TraceabilityGraph::find(const std::string& key, NodeId& node) const {
+    StringPool::Id keyId = 0;
+    if (!StringPool::global().find(key, keyId)) {
+        return false;
+    }
+    std::unordered_map<StringPool::Id, NodeId>::const_iterator it = nodesByKey_.find(keyId);
+    if (it == nodesByKey_.end()) {
+        return false;
+    }
+    node = it->second;
+    return true;
+}
+
+std::size_t TraceabilityGraph::nodeCount() const {
+    return kinds_.size();
+}
+
+std::size_t TraceabilityGraph::linkCount() const {
+    return forwardTargets_.size();
+}
+
+TraceKind TraceabilityGraph::kind(NodeId node) const {
+    return static_cast<TraceKind>(kinds_[node]);
+}
+
+std::string TraceabilityGraph::key(NodeId node) const {
+    return StringPool::global().str(keys_[node]);
+}
+
+std::vector<TraceabilityGraph::NodeId> TraceabilityGraph::uncoveredRequirements() const {
+    Bitset frontier(kindMasks_[TRACE_TEST_CASE]);
+    Bitset covered(frontier.size(), 0);
+    reach(frontier, reverseOffsets_, reverseTargets_, covered);
+    return select(covered, TRACE_REQUIREMENT, true);
+}
+
+std::vector<TraceabilityGraph::NodeId> TraceabilityGraph::affectedRequirements(
+    const std::vector<NodeId>& failingTests) const {
+    Bitset frontier(kindMasks_[TRACE_TEST_CASE].size(), 0);
+    for (std::size_t i = 0; i < failingTests.size(); ++i) {
+        if (failingTests[i] < kinds_.size()) {
+            setBit(frontier, failingTests[i]);
+        }
+    }
+    Bitset affected(frontier.size(), 0);
+    reach(frontier, reverseOffsets_, reverseTargets_, affected);
+    return select(affected, TRACE_REQUIREMENT, false);
+}
+
+std::vector<TraceabilityGraph::NodeId> TraceabilityGraph::verifyingTests(NodeId node) const {
+    if (node >= kinds_.size()) {
+        return std::vector<NodeId>();
+    }
+    Bitset frontier(kindMasks_[TRACE_TEST_CASE].size(), 0);
+    setBit(frontier, node);
+    Bitset verifying(frontier.size(), 0);
+    reach(frontier, forwardOffsets_, forwardTargets_, verifying);
+    return select(verifying, TRACE_TEST_CASE, false);
+}
+
+void TraceabilityGraph::reach(Bitset& frontier, const std::vector<uint32_t>& offsets,
+                              const std::vector<NodeId>& targets, Bitset& visited) const {
+    // Nodes added after the last build() have no row yet.
+    const std::size_t rows = offsets.empty() ? 0 : offsets.size() - 1;
+    Bitset next(frontier.size(), 0);
+    bool pending = true;
+    while (pending) {
+        pending = false;
+        for (std::size_t w = 0; w < frontier.size(); ++w) {
+            visited[w] |= frontier[w];
+        }
+        for (std::size_t w = 0; w < frontier.size(); ++w) {
+            for (uint64_t word = frontier[w]; word != 0; word &= word - 1) {
+                const NodeId node = static_cast<NodeId>(w * 64 + __builtin_ctzll(word));
+                if (node >= rows) {
+                    continue;
+                }
+                for (uint32_t e = offsets[node]; e < offsets[node + 1]; ++e) {
+                    const NodeId target = targets[e];
+                    if (!testBit(visited, target)) {
+                        setBit(next, target);
+                        pending = true;
+                    }
+                }
+            }
+        }
+        frontier.swap(next);
+        std::fill(next.begin(), next.end(), 0);
+    }
+}
+
+std::vector<TraceabilityGraph::NodeId> TraceabilityGraph::select(const Bitset& nodes, TraceKind kind,
+                                                                 bool complement) const {
+    const Bitset& mask = kindMasks_[kind];
+    std::vector<NodeId> selected;
+    for (std::size_t w = 0; w < mask.size(); ++w) {
+        for (uint64_t word = (complement ? ~nodes[w] : nodes[w]) & mask[w]; word != 0; word &= word - 1) {
+            selected.push_back(static_cast<NodeId>(w * 64 + __builtin_ctzll(word)));
+        }
+    }
+    return selected;
+}
@@ -0,0 +1,81 @@
+//!
+//! @file library_system_async_test.cpp
+//! @brief Definition tests cases for the coroutine front end of LibrarySystem
+//!
+
+// The coroutine front end needs C++20; older builds compile this file empty.
+#if __cplusplus >= 202002L
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include "library_system/library_system_async.hpp"
+
+namespace {
+
+/**
+ * @brief Borrow and return a book, as a request handler would.
+ */
+DetachedTask borrowAndReturn(AsyncLibrarySystem &library, std::string isbn, int userId,
+                             std::atomic<int> &borrowed, std::atomic<int> &finished) {
+    // Awaited outside the if: GCC 12 miscompiles co_await in a condition.
+    const bool ok = co_await library.borrowBookAsync(isbn, userId);
+    if (ok) {
+        ++borrowed;
+    }
+    co_await library.returnBookAsync(isbn, userId);
+    ++finished;
+}
+
+} // namespace
+
+/**
+ * @brief Test case for group commits of many in-flight coroutines.
+ */
+TEST(AsyncLibrarySystemTest, GroupCommit) {
+    std::mutex gateMutex;
+    std::condition_variable gateCondition;
+    bool gateOpen = false;
+    std::atomic<int> commits(0);
+
+    LibrarySystem library;
+    ASSERT_TRUE(library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565"));
+    {
+        // Hold the first group at its durability point until every request is in flight.
+        CommitExecutor executor([&](std::size_t) {
+            std::unique_lock<std::mutex> lock(gateMutex);
+            gateCondition.wait(lock, [&]() { return gateOpen; });
+            ++commits;
+        });
+        AsyncLibrarySystem async(library, executor);
+
+        const int kRequests = 2000;
+        std::atomic<int> borrowed(0);
+        std::atomic<int> finished(0);
+        for (int i = 0; i < kRequests; ++i) {
+            borrowAndReturn(async, "9780743273565", i, borrowed, finished);
+        }
+        ASSERT_EQ(finished.load(), 0);
+        {
+            std::lock_guard<std::mutex> lock(gateMutex);
+            gateOpen = true;
+        }
+        gateCondition.notify_all();
+
+        while (finished.load() != kRequests) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(borrowed.load(), kRequests);
+        ASSERT_EQ(async.searchBooks("gatsby").size(), 1u);
+
+        // Both awaits of every request committed, in far fewer groups.
+        while (executor.operationCount() != 2u * kRequests) {
+            std::this_thread::yield();
+        }
+        ASSERT_LT(executor.groupCount(), 10u);
+        ASSERT_EQ(static_cast<std::uint64_t>(commits.load()), executor.groupCount());
+    }
+    ASSERT_EQ(library.suggest("the great", 1), std::vector<std::string>(1, "The Great Gatsby"));
+}
+
+#endif // __cplusplus >= 202002L
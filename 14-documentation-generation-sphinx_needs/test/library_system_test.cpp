@@ -4,7 +4,135 @@
 //!
 
 #include <gtest/gtest.h>
-#include "library_system.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <thread>
+#include <dirent.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "library_system/blocked_bloom_filter.hpp"
+#include "library_system/boolean_query.hpp"
+#include "library_system/flat_format.hpp"
+#include "library_system/isbn_hash_index.hpp"
+#include "library_system/library_system.hpp"
+#include "library_system/loan_event_store.hpp"
+#include "library_system/multi_tenant_catalog.hpp"
+#include "library_system/replication.hpp"
+#include "library_system/sharded_library.hpp"
+#include "library_system/shared_memory_lookup.hpp"
+#include "library_system/string_pool.hpp"
+#include "library_system/text_tokenizer.hpp"
+
+/**
+ * @brief Build a valid ISBN-13 for a serial number.
+ * @param serial The serial number, below 10^9.
+ * @return An ISBN-13 string with a correct check digit.
+ */
+static std::string makeIsbn(int serial) {
+    std::string digits = "978" + std::to_string(1000000000 + serial).substr(1);
+    int sum = 0;
+    for (std::size_t i = 0; i < digits.size(); ++i) {
+        sum += (digits[i] - '0') * (i % 2 == 0 ? 1 : 3);
+    }
+    return digits + static_cast<char>('0' + (10 - sum % 10) % 10);
+}
+
+// Child modes of the multi-process tests, see main().
+static const char* const kFollowerMode = "--replication-follower";
+static const char* const kLookupClientMode = "--lookup-client";
+static const int kReplicatedBooks = 3000;
+static const uint64_t kReplicatedSequence = 1 + kReplicatedBooks + 2;
+static const int kLookupBooks = 2000;
+
+/**
+ * @brief Start this test binary in a child mode.
+ *
+ * The tests' processes run library threads, and a forked copy of such a
+ * process may inherit locks held by threads that do not exist in it, so
+ * children execute a fresh image instead.
+ *
+ * @param args The arguments after the program name.
+ * @param closeFd A descriptor the child must not inherit, or -1.
+ * @return The child's process ID, or -1 on failure.
+ */
+static pid_t spawnChild(const std::vector<std::string>& args, int closeFd) {
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>("/proc/self/exe"));
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        argv.push_back(const_cast<char*>(args[i].c_str()));
+    }
+    argv.push_back(0);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (closeFd >= 0) {
+        posix_spawn_file_actions_addclose(&actions, closeFd);
+    }
+    pid_t child = -1;
+    if (posix_spawn(&child, argv[0], &actions, 0, argv.data(), environ) != 0) {
+        child = -1;
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    return child;
+}
+
+/**
+ * @brief Follower process of ReplicateToFollowerProcess.
+ * @param path The leader's socket path.
+ * @param release Read end of a pipe the leader closes once it saw the acknowledgement.
+ * @return 0 if the follower converged to the leader's catalog.
+ */
+static int runFollower(const std::string& path, int release) {
+    ReplicationFollower follower(path);
+    bool ok = follower.connected() && follower.waitForSequence(kReplicatedSequence, 30000);
+    ok = ok && follower.lag() == 0 && follower.searchBooks("rare author").size() == kReplicatedBooks / 10;
+    std::vector<LibrarySystem::SearchHit> top = follower.searchTopBooks("gatsby", 1);
+    ok = ok && top.size() == 1 && top[0].loans == 1;
+    // Stay connected until the leader has seen the acknowledgement.
+    char byte = 0;
+    ok = ok && read(release, &byte, 1) == 0;
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief Count the open file descriptors of this process.
+ * @return The number of descriptors, including the one reading the count.
+ */
+static std::size_t openFdCount() {
+    DIR* directory = opendir("/proc/self/fd");
+    std::size_t count = 0;
+    while (directory != 0 && readdir(directory) != 0) {
+        ++count;
+    }
+    if (directory != 0) {
+        closedir(directory);
+    }
+    return count;
+}
+
+/**
+ * @brief Client process of SharedMemoryLookups.
+ * @param path The server's socket path.
+ * @return 0 if every answer was right.
+ */
+static int runLookupClient(const std::string& path) {
+    SharedMemoryLookupClient client(path);
+    LibrarySystem::SearchHit book = {"", 0};
+    bool ok = client.connected() && client.findBook(makeIsbn(7), book) && book.title == "Volume 7" &&
+              book.loans == 1;
+    ok = ok && !client.findBook(makeIsbn(kLookupBooks), book) && !client.findBook("Unknown ISBN", book);
+    for (int i = 0; i < 100 && ok; ++i) {
+        ok = client.searchBooks("rare author").size() == kLookupBooks / 10;
+    }
+    ok = ok && client.searchBooks("common author").size() == kLookupBooks - kLookupBooks / 10 && client.connected();
+    return ok ? 0 : 1;
+}
 
 /**
  * @brief Test fixture for the LibrarySystem class.
@@ -44,8 +172,10 @@ TEST_F(LibrarySystemTest, AddBook) {
  */
 TEST_F(LibrarySystemTest, BorrowBook) {
     // Test the borrowBook function
+    library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565");
     bool result = library.borrowBook("978-0743273565", 123); // Assuming user ID 123
     ASSERT_TRUE(result);
+    ASSERT_FALSE(library.borrowBook("978-0684801544", 123)); // Not in the catalog.
     // Add more assertions as needed
 }
 
@@ -54,8 +184,10 @@ TEST_F(LibrarySystemTest, BorrowBook) {
  */
 TEST_F(LibrarySystemTest, ReturnBook) {
     // Test the returnBook function
+    library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565");
     bool result = library.returnBook("978-0743273565", 123); // Assuming user ID 123
     ASSERT_TRUE(result);
+    ASSERT_FALSE(library.returnBook("978-0684801544", 123)); // Not in the catalog.
     // Add more assertions as needed
 }
 
@@ -64,6 +196,7 @@ TEST_F(LibrarySystemTest, ReturnBook) {
  */
 TEST_F(LibrarySystemTest, SearchBooks) {
     // Test the searchBooks function
+    library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565");
     std::vector<std::string> results = library.searchBooks("Great Gatsby");
     // Add assertions to check if the search results are as expected
     ASSERT_EQ(results.size(), 1);
@@ -71,6 +204,1001 @@ TEST_F(LibrarySystemTest, SearchBooks) {
     // Add more assertions as needed
 }
 
+/**
+ * @brief Test case for prefix suggestions over titles and authors.
+ */
+TEST_F(LibrarySystemTest, SuggestByPopularity) {
+    library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565");
+    library.addBook("Tender Is the Night", "F. Scott Fitzgerald", "978-0684801544");
+    library.addBook("The Grapes of Wrath", "John Steinbeck", "978-0143039433");
+    library.borrowBook("978-0143039433", 123);
+
+    std::vector<std::string> results = library.suggest("THE gr", 5);
+    ASSERT_EQ(results.size(), 2);
+    ASSERT_EQ(results[0], "The Grapes of Wrath");
+    ASSERT_EQ(results[1], "The Great Gatsby");
+
+    results = library.suggest("f scott", 5);
+    ASSERT_EQ(results.size(), 1);
+    ASSERT_EQ(results[0], "F. Scott Fitzgerald");
+
+    ASSERT_TRUE(library.suggest("the ", 5).size() == 2);
+    ASSERT_TRUE(library.suggest("moby", 5).empty());
+}
+
+/**
+ * @brief Test case for suggestions following borrows and added books without a rebuild per write.
+ */
+TEST_F(LibrarySystemTest, SuggestionsFollowWrites) {
+    const int kBooks = 1000;
+    for (int i = 0; i < kBooks; ++i) {
+        ASSERT_TRUE(library.addBook("Volume " + std::to_string(i), "Serial Author", makeIsbn(i)));
+    }
+    ASSERT_EQ(library.suggest("volume 99", 1), std::vector<std::string>(1, "Volume 99"));
+
+    // A borrow reorders the trie in place.
+    ASSERT_TRUE(library.borrowBook(makeIsbn(995), 123));
+    ASSERT_EQ(library.suggest("volume 99", 1), std::vector<std::string>(1, "Volume 995"));
+
+    // A new book is suggested from the tail; its author's popularity adds to the trie's.
+    ASSERT_TRUE(library.addBook("Volume 9999", "Serial Author", makeIsbn(kBooks)));
+    ASSERT_TRUE(library.borrowBook(makeIsbn(kBooks), 123));
+    ASSERT_TRUE(library.borrowBook(makeIsbn(kBooks), 123));
+    std::vector<std::string> expected;
+    expected.push_back("Volume 9999");
+    expected.push_back("Volume 995");
+    ASSERT_EQ(library.suggest("volume 99", 2), expected);
+    ASSERT_EQ(library.suggest("serial", 5), std::vector<std::string>(1, "Serial Author"));
+
+    // Books past the tail appear once the background rebuild is installed, with all loans kept.
+    const int last = kBooks + 600;
+    for (int i = kBooks + 1; i <= last; ++i) {
+        ASSERT_TRUE(library.addBook("Sequel " + std::to_string(i), "Other Author", makeIsbn(i)));
+    }
+    const std::string lastTitle = "Sequel " + std::to_string(last);
+    for (int i = 0; i < 500 && library.suggest(lastTitle, 1).empty(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(library.suggest(lastTitle, 1), std::vector<std::string>(1, lastTitle));
+    ASSERT_EQ(library.suggest("volume 99", 2), expected);
+}
+
+/**
+ * @brief Test case for targeted invalidation of the search result cache.
+ */
+TEST_F(LibrarySystemTest, QueryCacheInvalidation) {
+    library.enableQueryCache(16);
+    library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565");
+
+    ASSERT_EQ(library.searchBooks("gatsby").size(), 1);
+    ASSERT_EQ(library.searchBooks("GATSBY!").size(), 1);
+    ASSERT_EQ(library.searchBooks("steinbeck").size(), 0);
+    ASSERT_EQ(library.queryCacheStats().hits, 1);
+    ASSERT_EQ(library.queryCacheStats().misses, 2);
+
+    // Only the "steinbeck" entry shares a term with the new book.
+    library.addBook("The Grapes of Wrath", "John Steinbeck", "978-0143039433");
+    ASSERT_EQ(library.queryCacheStats().invalidations, 1);
+    ASSERT_EQ(library.searchBooks("steinbeck").size(), 1);
+    ASSERT_EQ(library.searchBooks("gatsby").size(), 1);
+    ASSERT_EQ(library.queryCacheStats().hits, 2);
+}
+
+/**
+ * @brief Test case for searches running concurrently with writers.
+ */
+TEST_F(LibrarySystemTest, SearchDuringWrites) {
+    const int kBooks = 500;
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        for (int i = 0; i < kBooks; ++i) {
+            library.addBook("Volume " + std::to_string(i), "Serial Author", makeIsbn(i));
+            library.borrowBook(makeIsbn(i), 123);
+        }
+        done = true;
+    });
+
+    // Every snapshot is consistent: the number of hits never goes down.
+    std::size_t seen = 0;
+    while (!done) {
+        std::size_t hits = library.searchBooks("serial author").size();
+        ASSERT_GE(hits, seen);
+        seen = hits;
+        library.suggest("vol", 3);
+    }
+    writer.join();
+    ASSERT_EQ(library.searchBooks("serial author").size(), kBooks);
+}
+
+/**
+ * @brief Test case for searches fanning out over sealed and merged segments.
+ */
+TEST_F(LibrarySystemTest, SearchAcrossSegments) {
+    const int kBooks = 5000;
+    for (int i = 0; i < kBooks; ++i) {
+        const char* author = (i % 10 == 0) ? "Rare Author" : "Common Author";
+        ASSERT_TRUE(library.addBook("Volume " + std::to_string(i), author, makeIsbn(i)));
+    }
+
+    std::vector<std::string> results = library.searchBooks("rare author");
+    ASSERT_EQ(results.size(), kBooks / 10);
+    ASSERT_EQ(results.front(), "Volume 0");
+    ASSERT_EQ(results.back(), "Volume 4990");
+    ASSERT_EQ(library.searchBooks("volume 4999").size(), 1);
+    ASSERT_EQ(library.searchBooks("author").size(), kBooks);
+
+    // Once merged, every tier holds fewer than kMergeFactor (4) segments:
+    // the 19 sealed tails end up as one segment of 16 and three single tails.
+    library.waitForMaintenance();
+    ASSERT_EQ(library.indexSegmentCount(), 4u);
+}
+
+/**
+ * @brief Test case for merges run by the owner of a catalog without a background thread.
+ */
+TEST(LibrarySystemMaintenanceTest, OwnerRunsMerges) {
+    LibrarySystem library(false);
+    for (int i = 0; i < 5000; ++i) {
+        ASSERT_TRUE(library.addBook("Volume " + std::to_string(i), "Serial Author", makeIsbn(i)));
+    }
+    ASSERT_EQ(library.indexSegmentCount(), 19u);
+
+    // 19 sealed tails merge into one segment of 16 and three single tails.
+    library.waitForMaintenance();
+    ASSERT_EQ(library.indexSegmentCount(), 4u);
+    ASSERT_FALSE(library.runMaintenance());
+    ASSERT_EQ(library.searchBooks("serial author").size(), 5000u);
+    ASSERT_FALSE(LibrarySystem().runMaintenance());
+}
+
+/**
+ * @brief Test case for merging segments with consecutive and overlapping documents.
+ */
+TEST(SearchSegmentTest, MergeMatchesBuild) {
+    const char* const words[] = {"alpha", "beta", "gamma", "delta", "epsilon"};
+    std::vector<std::vector<SearchSegment::Posting> > parts(3);
+    std::vector<SearchSegment::Posting> all;
+    for (SearchSegment::DocId doc = 0; doc < 300; ++doc) {
+        // The last part overlaps the documents of the first two.
+        const std::size_t part = doc % 7 == 0 ? 2 : doc / 150;
+        for (std::size_t w = 0; w < 5; ++w) {
+            if ((doc + w) % (w + 2) == 0) {
+                parts[part].push_back(SearchSegment::Posting(words[w], doc));
+                all.push_back(SearchSegment::Posting(words[w], doc));
+            }
+        }
+        parts[part].push_back(SearchSegment::Posting("doc" + std::to_string(doc % 50), doc));
+        all.push_back(SearchSegment::Posting("doc" + std::to_string(doc % 50), doc));
+    }
+    std::vector<std::shared_ptr<const SearchSegment> > segments;
+    for (std::size_t p = 0; p < parts.size(); ++p) {
+        segments.push_back(SearchSegment::build(parts[p], 100));
+    }
+    segments.push_back(SearchSegment::build(std::vector<SearchSegment::Posting>(), 0));
+
+    const std::shared_ptr<const SearchSegment> merged = SearchSegment::merge(segments);
+    const std::shared_ptr<const SearchSegment> built = SearchSegment::build(all, 300);
+    ASSERT_EQ(merged->documentCount(), 300u);
+    ASSERT_EQ(merged->termCount(), built->termCount());
+    for (std::size_t t = 0; t < 55; ++t) {
+        const std::string term = t < 5 ? words[t] : "doc" + std::to_string(t - 5);
+        std::size_t mergedCount = 0;
+        std::size_t builtCount = 0;
+        const SearchSegment::DocId* mergedDocs = merged->postings(term, mergedCount);
+        const SearchSegment::DocId* builtDocs = built->postings(term, builtCount);
+        ASSERT_EQ(std::vector<SearchSegment::DocId>(mergedDocs, mergedDocs + mergedCount),
+                  std::vector<SearchSegment::DocId>(builtDocs, builtDocs + builtCount));
+    }
+}
+
+/**
+ * @brief Test case for parsing boolean queries and planning them over a segment.
+ */
+TEST(BooleanQueryTest, ParseAndPlan) {
+    BooleanQuery query("author:Fitzgerald AND (gatsby OR paradise) NOT tender");
+    ASSERT_TRUE(query.valid());
+    ASSERT_EQ(query.str(), "(author:fitzgerald AND (gatsby OR paradise) AND NOT tender)");
+    ASSERT_EQ(BooleanQuery("NOT NOT a b (c AND d)").str(), "(a AND b AND c AND d)");
+    ASSERT_EQ(BooleanQuery("title:\"Great Gatsby\"").str(), "(title:great AND title:gatsby)");
+    ASSERT_EQ(BooleanQuery("\"AND (OR)\" \"NOT\"").str(), "(and AND or AND not)");
+
+    const char* invalid[] = {"", "NOT gatsby", "gatsby OR NOT tender", "(gatsby", "gatsby)", "gatsby AND", "OR gatsby",
+                             "gatsby NOT (tender OR NOT night)", "NOT (gatsby AND NOT tender)", "!!"};
+    for (std::size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        ASSERT_FALSE(BooleanQuery(invalid[i]).valid()) << invalid[i];
+        ASSERT_FALSE(BooleanQuery(invalid[i]).error().empty());
+    }
+
+    std::vector<SearchSegment::Posting> postings;
+    for (SearchSegment::DocId doc = 0; doc < 1000; ++doc) {
+        postings.push_back(SearchSegment::Posting("common", doc));
+        if (doc % 10 == 0) {
+            postings.push_back(SearchSegment::Posting("tens", doc));
+        }
+        if (doc % 100 == 0) {
+            postings.push_back(SearchSegment::Posting("hundreds", doc));
+        }
+        if (doc % 3 == 0) {
+            postings.push_back(SearchSegment::Posting("threes", doc));
+        }
+    }
+    std::shared_ptr<const SearchSegment> segment = SearchSegment::build(postings, 1000);
+
+    // The most selective list drives the intersection.
+    BooleanQuery plan("common tens hundreds NOT threes");
+    ASSERT_EQ(plan.explain(*segment), "AND(hundreds[10], tens[100], common[1000], NOT threes[334])[10]");
+    std::vector<SearchSegment::DocId> matches;
+    plan.match(*segment, matches);
+    const SearchSegment::DocId expected[] = {100, 200, 400, 500, 700, 800};
+    ASSERT_EQ(matches, std::vector<SearchSegment::DocId>(expected, expected + 6));
+
+    BooleanQuery either("(hundreds OR threes) NOT tens");
+    either.match(*segment, matches);
+    ASSERT_EQ(matches.size(), 300u);
+    ASSERT_EQ(matches.front(), 3u);
+    BooleanQuery missing("common AND absent");
+    missing.match(*segment, matches);
+    ASSERT_TRUE(matches.empty());
+}
+
+/**
+ * @brief Test case for boolean queries across sealed segments and the unsealed tail.
+ */
+TEST_F(LibrarySystemTest, SearchBooleanQuery) {
+    ASSERT_TRUE(library.addBook("The Great Gatsby", "F. Scott Fitzgerald", makeIsbn(0)));
+    ASSERT_TRUE(library.addBook("This Side of Paradise", "F. Scott Fitzgerald", makeIsbn(1)));
+    ASSERT_TRUE(library.addBook("Tender Is the Night", "F. Scott Fitzgerald", makeIsbn(2)));
+    ASSERT_TRUE(library.addBook("Paradise Lost", "John Milton", makeIsbn(3)));
+    ASSERT_TRUE(library.addBook("Fitzgerald and Gatsby", "Jane Critic", makeIsbn(4)));
+    const char* authors[] = {"Ann Able", "Ben Baker", "Cy Cole"};
+    const int kBooks = 2000;
+    for (int i = 5; i < kBooks; ++i) {
+        const std::string title = std::string(i % 2 == 0 ? "Even" : "Odd") + (i % 5 == 0 ? " Fifth" : "") + " Volume";
+        ASSERT_TRUE(library.addBook(title, authors[i % 3], makeIsbn(i)));
+    }
+    ASSERT_GT(library.indexSegmentCount(), 0u);
+
+    const char* fitzgerald[] = {"The Great Gatsby", "This Side of Paradise"};
+    BooleanQuery query("author:fitzgerald AND (gatsby OR paradise) NOT tender");
+    ASSERT_EQ(library.searchBooks(query), std::vector<std::string>(fitzgerald, fitzgerald + 2));
+    ASSERT_EQ(library.searchBooks(BooleanQuery("title:fitzgerald")).size(), 1u);
+    ASSERT_EQ(library.searchBooks(BooleanQuery("fitzgerald")).size(), 4u);
+
+    // Books on both sides of the sealed/unsealed boundary.
+    std::size_t expected = 0;
+    for (int i = 5; i < kBooks; ++i) {
+        expected += (i % 5 == 0 || i % 3 == 1) && i % 2 == 1 ? 1 : 0;
+    }
+    library.enableQueryCache(16);
+    BooleanQuery mixed("(fifth OR author:baker) AND volume NOT title:even");
+    ASSERT_EQ(library.searchBooks(mixed).size(), expected);
+    ASSERT_EQ(library.searchBooks(mixed).size(), expected);
+    ASSERT_EQ(library.queryCacheStats().hits, 1u);
+    ASSERT_TRUE(library.addBook("Odd Fifth Volume", "Ben Baker", makeIsbn(kBooks)));
+    ASSERT_EQ(library.searchBooks(mixed).size(), expected + 1);
+    ASSERT_TRUE(library.searchBooks(BooleanQuery("NOT volume")).empty());
+}
+
+/**
+ * @brief Test case for normalizing text with every tokenizer kernel.
+ */
+TEST(TextTokenizerTest, KernelsAgree) {
+    ASSERT_EQ(normalizeText("  The GREAT Gatsby!! (1925) "), "the great gatsby 1925");
+    ASSERT_EQ(normalizeText("Caf\xC3\xA9 D\xC3\x89J\xC3\x80\xE2\x80\x94Vu\xC2\xA0\xC2\xBFNo?"), "caf\xC3\xA9 d\xC3\xA9j\xC3\xA0 vu no");
+    ASSERT_EQ(normalizeText("\xCE\x91\xCE\x98\xCE\x97\xCE\x9D\xCE\x91 \xD0\x9C\xD0\x98\xD0\xA0 \xC5\x81\xC3\xB3" "d\xC5\xBA"),
+              "\xCE\xB1\xCE\xB8\xCE\xB7\xCE\xBD\xCE\xB1 \xD0\xBC\xD0\xB8\xD1\x80 \xC5\x82\xC3\xB3" "d\xC5\xBA");
+    ASSERT_EQ(normalizeText("bad\xFF\xC3 bytes\xE2\x80"), "bad\xFF\xC3 bytes\xE2\x80");
+    const std::vector<std::string> tokens = tokenizeText("O'Brien -- A Life");
+    ASSERT_EQ(tokens.size(), 4u);
+    ASSERT_EQ(tokens[1], "brien");
+
+    // Random mixes of ASCII runs, punctuation and multi-byte characters, so
+    // block boundaries fall everywhere.
+    const char* pieces[] = {"Gatsby", " ", "--", "WAR", "and", "x", "\xC3\x89", "\xE2\x80\x99", "\xF0\x9F\x93\x9A",
+                            "\xC2\xA0", "0123456789", "\xFF", "  ...  ", "ABCDEFGHIJKLMNOPQRSTUVWXYZ", "\xD0\x96"};
+    const std::size_t pieceCount = sizeof(pieces) / sizeof(pieces[0]);
+    unsigned seed = 12345;
+    for (int i = 0; i < 2000; ++i) {
+        std::string text;
+        const int length = i % 40;
+        for (int j = 0; j < length; ++j) {
+            seed = seed * 1103515245 + 12345;
+            text += pieces[(seed >> 16) % pieceCount];
+        }
+        const std::string expected = normalizeText(text, TEXT_KERNEL_SCALAR);
+        ASSERT_EQ(normalizeText(text, TEXT_KERNEL_SSE2), expected) << text;
+        ASSERT_EQ(normalizeText(text, TEXT_KERNEL_AVX2), expected) << text;
+    }
+}
+
+/**
+ * @brief Test case for ISBN-10/ISBN-13 parsing into compact keys.
+ */
+TEST(IsbnTest, ParseAndValidate) {
+    ASSERT_EQ(parseIsbn("978-0743273565"), 9780743273565ULL);
+    ASSERT_EQ(parseIsbn("9780743273565"), 9780743273565ULL);
+    ASSERT_EQ(parseIsbn("0-7432-7356-7"), 9780743273565ULL);
+    ASSERT_EQ(parseIsbn("0 8044 2957 X"), 9780804429573ULL);
+    ASSERT_EQ(formatIsbn(parseIsbn("0-7432-7356-7")), "9780743273565");
+
+    ASSERT_EQ(parseIsbn("978-0743273566"), kInvalidIsbn); // Bad checksum.
+    ASSERT_EQ(parseIsbn("0-7432-7356-8"), kInvalidIsbn);  // Bad checksum.
+    ASSERT_EQ(parseIsbn("978-07432735a5"), kInvalidIsbn); // Not a digit.
+    ASSERT_EQ(parseIsbn("Unknown ISBN"), kInvalidIsbn);
+    ASSERT_EQ(parseIsbn(""), kInvalidIsbn);
+}
+
+/**
+ * @brief Test case for inserting into, growing and probing the ISBN hash table.
+ */
+TEST(IsbnHashIndexTest, InsertGrowAndFind) {
+    MemoryTracker tracker;
+    std::shared_ptr<IsbnHashIndex> index = std::make_shared<IsbnHashIndex>(0, &tracker);
+    std::size_t position = 0;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        const IsbnKey key = parseIsbn(makeIsbn(static_cast<int>(i)));
+        if (index->size() == index->capacity()) {
+            ASSERT_FALSE(index->insert(key, i));
+            index = index->grown(2 * index->capacity());
+        }
+        ASSERT_TRUE(index->insert(key, i));
+        ASSERT_FALSE(index->insert(key, i));
+    }
+    ASSERT_EQ(index->size(), 1000u);
+    ASSERT_EQ(tracker.bytes(), index->memoryUsage());
+
+    index->setPosition(parseIsbn(makeIsbn(7)), 70);
+    ASSERT_TRUE(index->find(parseIsbn(makeIsbn(7)), position));
+    ASSERT_EQ(position, 70u);
+    ASSERT_TRUE(index->find(parseIsbn(makeIsbn(999)), position));
+    ASSERT_EQ(position, 999u);
+    ASSERT_FALSE(index->find(parseIsbn(makeIsbn(1000)), position));
+
+    std::vector<IsbnKey> keys;
+    index->keys(keys);
+    ASSERT_EQ(keys.size(), 1000u);
+}
+
+/**
+ * @brief Test case for ISBN lookups running concurrently with writers.
+ */
+TEST_F(LibrarySystemTest, FindBookDuringWrites) {
+    const int kBooks = 3000;
+    std::atomic<int> added(0);
+    std::thread writer([&]() {
+        for (int i = 0; i < kBooks; ++i) {
+            library.addBook("Volume " + std::to_string(i), "Serial Author", makeIsbn(i));
+            library.borrowBook(makeIsbn(i), 123);
+            added = i + 1;
+        }
+    });
+
+    // A book seen once is always found, with at least the loans seen before.
+    LibrarySystem::SearchHit book;
+    for (int i = 0; i < kBooks; i = added.load()) {
+        if (i > 0) {
+            ASSERT_TRUE(library.findBook(makeIsbn(i - 1), book));
+            ASSERT_EQ(book.title, "Volume " + std::to_string(i - 1));
+            ASSERT_TRUE(library.findBook(makeIsbn(i / 2), book));
+            ASSERT_GE(book.loans, 1u);
+        }
+        ASSERT_FALSE(library.findBook(makeIsbn(kBooks + i), book));
+    }
+    writer.join();
+}
+
+/**
+ * @brief Test case for looking books up by either ISBN spelling.
+ */
+TEST_F(LibrarySystemTest, IsbnSpellingsShareKey) {
+    ASSERT_TRUE(library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565"));
+    ASSERT_FALSE(library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "0743273567"));
+    ASSERT_FALSE(library.addBook("Untitled", "Unknown Author", "Unknown ISBN"));
+    ASSERT_FALSE(library.borrowBook("978-0743273566", 123));
+}
+
+/**
+ * @brief Test case for probing a blocked Bloom filter with every probe.
+ */
+TEST(BlockedBloomFilterTest, ProbesAgree) {
+    const uint64_t kKeys = 20000;
+    BlockedBloomFilter filter(kKeys, 0.01);
+    for (uint64_t key = 0; key < kKeys; ++key) {
+        filter.add(9780000000000ULL + 3 * key);
+    }
+    std::size_t falsePositives = 0;
+    for (uint64_t key = 0; key < 3 * kKeys; ++key) {
+        const bool expected = filter.mayContain(9780000000000ULL + key, BLOOM_PROBE_SCALAR);
+        ASSERT_EQ(filter.mayContain(9780000000000ULL + key, BLOOM_PROBE_AVX2), expected) << key;
+        if (key % 3 == 0) {
+            ASSERT_TRUE(expected) << key; // No false negatives.
+        } else if (expected) {
+            ++falsePositives;
+        }
+    }
+    ASSERT_LT(falsePositives, 2 * kKeys / 50); // Twice the target rate.
+    ASSERT_EQ(filter.capacity(), kKeys);
+    ASSERT_GT(filter.memoryUsage(), kKeys); // Around ten bits per key at 1%.
+}
+
+/**
+ * @brief Test case for rejecting unknown ISBNs with the ISBN filters.
+ */
+TEST_F(LibrarySystemTest, IsbnFilterRejectsUnknownIsbns) {
+    const int kBooks = 5000;
+    const int kUnknown = 20000;
+    for (int i = 0; i < kBooks; ++i) {
+        ASSERT_TRUE(library.addBook("Volume " + std::to_string(i), "Serial Author", makeIsbn(2 * i)));
+    }
+    for (int i = 0; i < kBooks; ++i) {
+        ASSERT_TRUE(library.borrowBook(makeIsbn(2 * i), 1));
+    }
+    for (int i = 0; i < kUnknown; ++i) {
+        ASSERT_FALSE(library.borrowBook(makeIsbn(2 * i + 1), 1));
+    }
+    LibrarySystem::IsbnFilterStats stats = library.isbnFilterStats();
+    ASSERT_EQ(stats.lookups, static_cast<uint64_t>(kBooks + kUnknown));
+    ASSERT_EQ(stats.rejected + stats.falsePositives, static_cast<uint64_t>(kUnknown));
+    ASSERT_EQ(stats.targetRate, 0.01);
+    ASSERT_LT(stats.falsePositiveRate(), 0.02);
+    const std::size_t filterBytes = library.memoryUsage().isbnFilters;
+    ASSERT_GT(filterBytes, 0u);
+
+    // A tighter rate takes larger filters and resets the counters.
+    library.setIsbnFilterFalsePositiveRate(0.001);
+    ASSERT_EQ(library.isbnFilterStats().lookups, 0u);
+    for (int i = 0; i < kUnknown; ++i) {
+        ASSERT_FALSE(library.returnBook(makeIsbn(2 * i + 1), 1));
+    }
+    ASSERT_TRUE(library.returnBook(makeIsbn(0), 1));
+    stats = library.isbnFilterStats();
+    ASSERT_EQ(stats.targetRate, 0.001);
+    ASSERT_LT(stats.falsePositiveRate(), 0.003);
+    ASSERT_GT(library.memoryUsage().isbnFilters, filterBytes);
+}
+
+/**
+ * @brief Test case for exporting a catalog and importing it into another one.
+ */
+TEST_F(LibrarySystemTest, ExportImportCatalog) {
+    ASSERT_TRUE(library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565"));
+    ASSERT_TRUE(library.addBook("Tender Is the Night", "F. Scott Fitzgerald", makeIsbn(1)));
+    ASSERT_TRUE(library.borrowBook(makeIsbn(1), 7));
+
+    std::vector<char> buffer;
+    library.exportCatalog(buffer);
+    FlatReader reader(buffer.data(), buffer.size());
+    ASSERT_TRUE(reader.valid());
+    ASSERT_EQ(reader.kind(), FLAT_BOOK);
+    ASSERT_EQ(reader.schemaVersion(), kFlatSchemaVersion);
+    ASSERT_EQ(reader.size(), 2u);
+    ASSERT_EQ(reader.book(1).title().str(), "Tender Is the Night");
+    ASSERT_EQ(reader.book(1).loans(), 1u);
+    ASSERT_EQ(reader.book(0).isbn(), 9780743273565ULL);
+
+    LibrarySystem copy;
+    ASSERT_EQ(copy.importCatalog(buffer.data(), buffer.size()), 2u);
+    ASSERT_EQ(copy.importCatalog(buffer.data(), buffer.size()), 0u);
+    ASSERT_EQ(copy.searchBooks("fitzgerald").size(), 2u);
+    ASSERT_EQ(copy.suggest("tender", 1), std::vector<std::string>(1, "Tender Is the Night"));
+
+    // Truncated buffers are rejected instead of read out of bounds.
+    ASSERT_FALSE(FlatReader(buffer.data(), buffer.size() - 3).valid());
+    ASSERT_EQ(copy.importCatalog(buffer.data(), 8), 0u);
+}
+
+/**
+ * @brief Test case for the parallel bulk load matching one-by-one insertion.
+ */
+TEST_F(LibrarySystemTest, ParallelImportMatchesSerialInsert) {
+    // Duplicate and invalid ISBNs, repeated within the buffer and already in the catalog.
+    const int kBooks = 30000;
+    FlatWriter writer(FLAT_BOOK);
+    for (int i = 0; i < kBooks; ++i) {
+        const std::string title = (i % 1000 == 0 ? "Rare " : "Volume ") + std::to_string(i);
+        const IsbnKey isbn = i % 997 == 0 ? kInvalidIsbn : parseIsbn(makeIsbn(i % 25000));
+        writer.addBook(title, i % 3 == 0 ? "Parallel Author" : "Serial Author", isbn, i % 5);
+    }
+    std::vector<char> buffer;
+    writer.finish(buffer);
+
+    LibrarySystem serial;
+    LibrarySystem parallel;
+    std::size_t notified = 0;
+    parallel.addMutationListener([&notified](const MutationRecord&) { ++notified; });
+    for (int i = 0; i < 300; ++i) {
+        const std::string isbn = makeIsbn(i * 7);
+        ASSERT_TRUE(serial.addBook("Existing " + std::to_string(i), "Old Author", isbn));
+        ASSERT_TRUE(parallel.addBook("Existing " + std::to_string(i), "Old Author", isbn));
+    }
+    parallel.enableQueryCache(10);
+    ASSERT_EQ(parallel.searchBooks("parallel author rare").size(), 0u);
+
+    FlatReader reader(buffer.data(), buffer.size());
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < reader.size(); ++i) {
+        const MutationRecord record = {MUTATION_ADD_BOOK, reader.book(i).isbn(),
+                                       static_cast<int32_t>(reader.book(i).loans()), reader.book(i).title().str(),
+                                       reader.book(i).author().str()};
+        if (record.isbn != kInvalidIsbn && serial.applyMutation(record)) {
+            ++expected;
+        }
+    }
+    notified = 0;
+    ASSERT_EQ(parallel.importCatalog(buffer.data(), buffer.size(), 4), expected);
+    ASSERT_EQ(notified, expected);
+    ASSERT_EQ(parallel.importCatalog(buffer.data(), buffer.size(), 4), 0u);
+
+    std::vector<char> serialExport;
+    std::vector<char> parallelExport;
+    serial.exportCatalog(serialExport);
+    parallel.exportCatalog(parallelExport);
+    ASSERT_EQ(parallelExport, serialExport);
+    const char* const queries[] = {"parallel author rare", "volume 24999", "existing", "serial", "author:old"};
+    for (std::size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); ++q) {
+        ASSERT_EQ(parallel.searchBooks(queries[q]), serial.searchBooks(queries[q])) << queries[q];
+    }
+    ASSERT_FALSE(parallel.searchBooks("parallel author rare").empty());
+    ASSERT_TRUE(parallel.borrowBook(makeIsbn(24999), 1));
+}
+
+/**
+ * @brief Test case for ranked top-k searches.
+ */
+TEST_F(LibrarySystemTest, SearchTopBooks) {
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(library.addBook("Volume " + std::to_string(i), "Common Author", makeIsbn(i)));
+        for (int loan = 0; loan < i % 4; ++loan) {
+            ASSERT_TRUE(library.borrowBook(makeIsbn(i), loan));
+            ASSERT_TRUE(library.returnBook(makeIsbn(i), loan));
+        }
+    }
+
+    std::vector<LibrarySystem::SearchHit> hits = library.searchTopBooks("volume", 3);
+    ASSERT_EQ(hits.size(), 3u);
+    ASSERT_EQ(hits[0].title, "Volume 3");
+    ASSERT_EQ(hits[0].loans, 3u);
+    ASSERT_EQ(hits[1].title, "Volume 7");
+    ASSERT_EQ(hits[2].title, "Volume 2");
+    ASSERT_EQ(library.searchTopBooks("volume", 100).size(), 10u);
+    ASSERT_TRUE(library.searchTopBooks("missing", 3).empty());
+}
+
+/**
+ * @brief Test case for the sharded catalog agreeing with a single LibrarySystem.
+ */
+TEST_F(LibrarySystemTest, ShardedMatchesSingle) {
+    ShardedLibrary sharded(4, false);
+    ASSERT_EQ(sharded.shardCount(), 4u);
+    const int kBooks = 2000;
+    std::vector<std::size_t> perShard(4, 0);
+    for (int i = 0; i < kBooks; ++i) {
+        const std::string title = "Volume " + std::to_string(i);
+        const char* author = (i % 10 == 0) ? "Rare Author" : "Common Author";
+        ASSERT_TRUE(library.addBook(title, author, makeIsbn(i)));
+        ASSERT_TRUE(sharded.addBook(title, author, makeIsbn(i)));
+        ++perShard[sharded.shardOf(parseIsbn(makeIsbn(i)))];
+    }
+    for (std::size_t s = 0; s < perShard.size(); ++s) {
+        ASSERT_GT(perShard[s], kBooks / 8u);
+    }
+    ASSERT_FALSE(sharded.addBook("Duplicate", "Common Author", makeIsbn(5)));
+    ASSERT_FALSE(sharded.addBook("Untitled", "Unknown Author", "Unknown ISBN"));
+    ASSERT_FALSE(sharded.borrowBook("Unknown ISBN", 1));
+
+    // Concurrent borrowers, each with its own books, across all shards; more
+    // of them than each shard has rings, so some share a ring.
+    const int kBorrowers = 20;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kBorrowers; ++t) {
+        threads.push_back(std::thread([&sharded, t]() {
+            for (int i = t; i < 200; i += kBorrowers) {
+                for (int loan = 0; loan < i % 5; ++loan) {
+                    sharded.borrowBook(makeIsbn(i * 10), loan);
+                    sharded.returnBook(makeIsbn(i * 10), loan);
+                }
+            }
+        }));
+    }
+    for (int i = 0; i < 200; ++i) {
+        for (int loan = 0; loan < i % 5; ++loan) {
+            ASSERT_TRUE(library.borrowBook(makeIsbn(i * 10), loan));
+            ASSERT_TRUE(library.returnBook(makeIsbn(i * 10), loan));
+        }
+    }
+    for (std::size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+
+    const char* queries[] = {"rare author", "author", "volume 1999", "missing"};
+    for (std::size_t q = 0; q < 4; ++q) {
+        std::vector<LibrarySystem::SearchHit> expected = library.searchTopBooks(queries[q], 25);
+        std::vector<LibrarySystem::SearchHit> actual = sharded.searchBooks(queries[q], 25);
+        ASSERT_EQ(actual.size(), expected.size());
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQ(actual[i].title, expected[i].title);
+            ASSERT_EQ(actual[i].loans, expected[i].loans);
+        }
+    }
+}
+
+/**
+ * @brief Test case for writing a snapshot while the catalog keeps changing.
+ */
+TEST_F(LibrarySystemTest, SnapshotDuringWrites) {
+    const int kBooks = 20000;
+    for (int i = 0; i < kBooks; ++i) {
+        ASSERT_TRUE(library.addBook("Volume " + std::to_string(i), "Serial Author", makeIsbn(i)));
+    }
+    ASSERT_TRUE(library.borrowBook(makeIsbn(0), 1));
+    ASSERT_TRUE(library.borrowBook(makeIsbn(kBooks - 1), 1)); // On the last catalog page.
+
+    const std::string path = "/tmp/library_snapshot_test_" + std::to_string(getpid()) + ".lsfb";
+    std::future<bool> done = library.snapshot(path);
+    // None of these are part of the snapshot, and none of them wait for it.
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(library.borrowBook(makeIsbn(i), 2));
+        ASSERT_TRUE(library.addBook("Sequel " + std::to_string(i), "Serial Author", makeIsbn(kBooks + i)));
+    }
+    ASSERT_TRUE(done.get());
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    const std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(path.c_str());
+    FlatReader reader(buffer.data(), buffer.size());
+    ASSERT_TRUE(reader.valid());
+    ASSERT_EQ(reader.size(), static_cast<std::size_t>(kBooks));
+    ASSERT_EQ(reader.book(0).loans(), 1u);
+    ASSERT_EQ(reader.book(1).loans(), 0u);
+    ASSERT_EQ(reader.book(kBooks - 1).title().str(), "Volume " + std::to_string(kBooks - 1));
+    ASSERT_EQ(reader.book(kBooks - 1).loans(), 1u);
+
+    LibrarySystem restored;
+    ASSERT_EQ(restored.importCatalog(buffer.data(), buffer.size()), static_cast<std::size_t>(kBooks));
+    ASSERT_EQ(restored.searchBooks("sequel").size(), 0u);
+    ASSERT_FALSE(library.snapshot("/nonexistent-directory/snapshot.lsfb").get());
+}
+
+/**
+ * @brief Test case for replicating a catalog into a follower process.
+ */
+TEST_F(LibrarySystemTest, ReplicateToFollowerProcess) {
+    // Added before the leader starts, so shipped as part of the initial catalog.
+    ASSERT_TRUE(library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565"));
+    const std::string path = "/tmp/library_replication_test_" + std::to_string(getpid()) + ".sock";
+    ReplicationLeader leader(library, path);
+    ASSERT_TRUE(leader.listening());
+    ASSERT_EQ(leader.lastSequence(), 1u);
+
+    // The follower's exit code reports whether it converged.
+    int release[2];
+    ASSERT_EQ(pipe(release), 0);
+    std::vector<std::string> args;
+    args.push_back(kFollowerMode);
+    args.push_back(path);
+    args.push_back(std::to_string(release[0]));
+    const pid_t child = spawnChild(args, release[1]);
+    ASSERT_GT(child, 0);
+    close(release[0]);
+
+    for (int i = 0; i < kReplicatedBooks; ++i) {
+        const char* author = (i % 10 == 0) ? "Rare Author" : "Common Author";
+        ASSERT_TRUE(library.addBook("Volume " + std::to_string(i), author, makeIsbn(i)));
+    }
+    ASSERT_TRUE(library.borrowBook("978-0743273565", 1));
+    ASSERT_TRUE(library.returnBook("978-0743273565", 1));
+    ASSERT_FALSE(library.addBook("Duplicate", "Nobody", makeIsbn(0))); // Not logged.
+    ASSERT_EQ(leader.lastSequence(), kReplicatedSequence);
+
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while ((leader.followerCount() != 1 || leader.lag() != 0) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(leader.followerCount(), 1u);
+    EXPECT_EQ(leader.lag(), 0u);
+    close(release[1]);
+
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+}
+
+/**
+ * @brief Test case for releasing the connections of followers that went away.
+ */
+TEST_F(LibrarySystemTest, ReplicationReapsFollowers) {
+    ASSERT_TRUE(library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565"));
+    const std::string path = "/tmp/library_reap_test_" + std::to_string(getpid()) + ".sock";
+    ReplicationLeader leader(library, path);
+    ASSERT_TRUE(leader.listening());
+
+    std::size_t baseline = 0;
+    for (int round = 0; round < 20; ++round) {
+        {
+            ReplicationFollower follower(path);
+            ASSERT_TRUE(follower.connected());
+            ASSERT_TRUE(follower.waitForSequence(1, 30000));
+        }
+        if (round == 1) {
+            baseline = openFdCount();
+        }
+    }
+    // Each connection is reaped on the next accept; the last ones may still be open.
+    ASSERT_LE(openFdCount(), baseline + 2);
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (leader.followerCount() != 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(leader.followerCount(), 0u);
+}
+
+/**
+ * @brief Test case for searches and ISBN lookups from another process through shared memory.
+ */
+TEST_F(LibrarySystemTest, SharedMemoryLookups) {
+    for (int i = 0; i < kLookupBooks; ++i) {
+        const char* author = (i % 10 == 0) ? "Rare Author" : "Common Author";
+        ASSERT_TRUE(library.addBook("Volume " + std::to_string(i), author, makeIsbn(i)));
+    }
+    ASSERT_TRUE(library.borrowBook(makeIsbn(7), 1));
+    const std::string path = "/tmp/library_lookup_test_" + std::to_string(getpid()) + ".sock";
+    // Small rings, so that large results wrap around them many times.
+    std::unique_ptr<SharedMemoryLookupServer> server(new SharedMemoryLookupServer(library, path, 4096));
+    ASSERT_TRUE(server->listening());
+
+    // The client's exit code reports whether every answer was right.
+    std::vector<std::string> args;
+    args.push_back(kLookupClientMode);
+    args.push_back(path);
+    const pid_t child = spawnChild(args, -1);
+    ASSERT_GT(child, 0);
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+
+    SharedMemoryLookupClient client(path);
+    ASSERT_TRUE(client.connected());
+    ASSERT_EQ(client.searchBooks("volume 1999"), library.searchBooks("volume 1999"));
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (server->clientCount() != 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(server->clientCount(), 1u); // The exited client was noticed.
+
+    // Clients fail fast once the server is gone.
+    server.reset();
+    ASSERT_TRUE(client.searchBooks("volume").empty());
+    ASSERT_FALSE(client.connected());
+}
+
+/**
+ * @brief Test case for group-by queries over compressed loan event chunks.
+ */
+TEST_F(LibrarySystemTest, LoanEventAnalytics) {
+    LoanEventStore store;
+    int64_t now = 1700000000;
+    library.addMutationListener([&store, &now](const MutationRecord& record) { store.record(record, now); });
+    ASSERT_TRUE(library.addBook("The Great Gatsby", "F. Scott Fitzgerald", "978-0743273565"));
+    ASSERT_TRUE(library.borrowBook("978-0743273565", 7));
+    now += 60;
+    ASSERT_TRUE(library.returnBook("978-0743273565", 7));
+    ASSERT_EQ(store.size(), 2u);
+    now += 60;
+
+    // Later users have IDs too wide for dense counting.
+    const int kEvents = 60000;
+    std::vector<LoanEvent> events;
+    for (int i = 0; i < kEvents; ++i) {
+        const int32_t user = i < kEvents / 2 ? i % 1000 : 1000000 * (i % 7) + i % 13;
+        LoanEvent event = {now + i * 30 + i % 7, parseIsbn(makeIsbn((i * 31) % 300)), user, i % 3 == 0};
+        events.push_back(event);
+        store.append(event);
+    }
+    ASSERT_EQ(store.size(), kEvents + 2u);
+    ASSERT_EQ(store.chunkCount(), (kEvents + 2u) / LoanEventStore::kChunkEvents);
+    ASSERT_LT(store.memoryUsage() * 3, store.rawBytes());
+
+    // A window starting and ending inside chunks.
+    const int64_t from = now + 5000 * 30;
+    const int64_t to = now + 47000 * 30;
+    std::map<IsbnKey, uint64_t> books;
+    std::map<int32_t, uint64_t> users;
+    uint64_t borrows = 0;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        if (events[i].timestamp >= from && events[i].timestamp < to && !events[i].returned) {
+            ++books[events[i].isbn];
+            ++users[events[i].userId];
+            ++borrows;
+        }
+    }
+    ASSERT_EQ(store.count(from, to, LOAN_EVENTS_BORROWS), borrows);
+    ASSERT_EQ(store.count(0, INT64_MAX, LOAN_EVENTS_ALL), kEvents + 2u);
+    ASSERT_EQ(store.count(0, INT64_MAX, LOAN_EVENTS_RETURNS), kEvents / 3 + 1u);
+
+    std::vector<LoanEventStore::BookCount> top = store.countByBook(from, to, LOAN_EVENTS_BORROWS, 5);
+    ASSERT_EQ(top.size(), 5u);
+    for (std::size_t i = 0; i < top.size(); ++i) {
+        ASSERT_EQ(top[i].count, books[top[i].isbn]);
+        ASSERT_TRUE(i == 0 || top[i - 1].count >= top[i].count);
+    }
+    ASSERT_EQ(store.countByBook(from, to, LOAN_EVENTS_BORROWS, 0).size(), books.size());
+
+    std::vector<LoanEventStore::UserCount> perUser = store.countByUser(from, to, LOAN_EVENTS_BORROWS, 0);
+    ASSERT_EQ(perUser.size(), users.size());
+    for (std::size_t i = 0; i < perUser.size(); ++i) {
+        ASSERT_EQ(perUser[i].count, users[perUser[i].userId]);
+    }
+
+    std::vector<LoanEventStore::UserCount> gatsby = store.countByUser(0, now, LOAN_EVENTS_ALL, 0);
+    ASSERT_EQ(gatsby.size(), 1u);
+    ASSERT_EQ(gatsby[0].userId, 7);
+    ASSERT_EQ(gatsby[0].count, 2u);
+}
+
+/**
+ * @brief Test case for the memory breakdown and spilling segments over budget.
+ */
+TEST_F(LibrarySystemTest, MemoryBudgetSpillsSegments) {
+    const int kBooks = 3000;
+    for (int i = 0; i < kBooks; ++i) {
+        const char* author = (i % 10 == 0) ? "Rare Author" : "Common Author";
+        ASSERT_TRUE(library.addBook("Volume " + std::to_string(i), author, makeIsbn(i)));
+    }
+    library.enableQueryCache(100);
+    const std::vector<std::string> rare = library.searchBooks("rare author");
+    ASSERT_EQ(library.suggest("volume 1", 1).size(), 1u);
+
+    LibrarySystem::MemoryUsage usage = library.memoryUsage();
+    ASSERT_GT(usage.catalog, 0u);
+    ASSERT_GE(usage.isbnIndex, kBooks * (sizeof(IsbnKey) + sizeof(std::size_t)));
+    ASSERT_GT(usage.postings, 0u);
+    ASSERT_EQ(usage.mappedPostings, 0u);
+    ASSERT_GT(usage.queryCache, 0u);
+    const std::size_t trieBytes = usage.suggestTrie;
+
+    // Nothing fits, so the caches go and every segment is spilled.
+    library.setMemoryBudget(1, "/tmp");
+    for (int i = 0; i < 500 && library.memoryUsage().postings != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    usage = library.memoryUsage();
+    ASSERT_EQ(usage.postings, 0u);
+    ASSERT_GT(usage.mappedPostings, 0u);
+    ASSERT_LT(usage.suggestTrie * 10, trieBytes);
+    ASSERT_EQ(usage.queryCache, 0u);
+    ASSERT_EQ(library.searchBooks("rare author"), rare);
+    ASSERT_EQ(library.searchBooks("volume 2999").size(), 1u);
+    ASSERT_EQ(library.suggest("volume 1", 1).size(), 1u);
+
+    // Boolean queries are held to the budget like plain searches.
+    ASSERT_EQ(library.searchBooks(BooleanQuery("rare OR common")).size(), static_cast<std::size_t>(kBooks));
+    ASSERT_EQ(library.memoryUsage().queryCache, 0u);
+}
+
+/**
+ * @brief Test case for tenants sharing one index without seeing each other's books.
+ */
+TEST(MultiTenantCatalogTest, IsolateAndEvictTenants) {
+    MultiTenantCatalog catalog("/tmp");
+    ASSERT_TRUE(catalog.addBook("north", "The Great Gatsby", "F. Scott Fitzgerald", makeIsbn(1)));
+    ASSERT_TRUE(catalog.addBook("north", "Tender Is the Night", "F. Scott Fitzgerald", makeIsbn(2)));
+    ASSERT_TRUE(catalog.addBook("south", "The Great Gatsby", "F. Scott Fitzgerald", makeIsbn(1)));
+    ASSERT_FALSE(catalog.addBook("south", "Duplicate", "Nobody", makeIsbn(1)));
+    ASSERT_FALSE(catalog.addBook("south", "Invalid", "Nobody", "123"));
+    const int kBigBooks = 2000;
+    for (int i = 0; i < kBigBooks; ++i) {
+        ASSERT_TRUE(catalog.addBook("big", "Volume " + std::to_string(i), "Fitzgerald Estate", makeIsbn(100 + i)));
+    }
+    ASSERT_EQ(catalog.tenantCount(), 3u);
+
+    // Results are restricted to the tenant, however large the shared posting list.
+    ASSERT_EQ(catalog.searchBooks("north", "fitzgerald").size(), 2u);
+    ASSERT_EQ(catalog.searchBooks("south", "fitzgerald"), std::vector<std::string>(1, "The Great Gatsby"));
+    ASSERT_EQ(catalog.searchBooks("big", "fitzgerald").size(), static_cast<std::size_t>(kBigBooks));
+    ASSERT_TRUE(catalog.searchBooks("south", "tender").empty());
+    ASSERT_TRUE(catalog.searchBooks("west", "gatsby").empty());
+    ASSERT_TRUE(catalog.borrowBook("north", makeIsbn(1)));
+    ASSERT_FALSE(catalog.borrowBook("south", makeIsbn(2)));
+    ASSERT_EQ(catalog.loans("north", makeIsbn(1)), 1u);
+    ASSERT_EQ(catalog.loans("south", makeIsbn(1)), 0u);
+
+    // A tenant costs about its own data, a small fraction of the shared index.
+    const std::size_t small = catalog.tenantMemoryUsage("south");
+    const std::size_t big = catalog.tenantMemoryUsage("big");
+    ASSERT_GT(small, 0u);
+    ASSERT_LT(small * 100, big);
+    ASSERT_LT(big, catalog.sharedMemoryUsage());
+
+    // Evicted tenants drop out of the shared index and come back on use.
+    const std::vector<std::string> north = catalog.searchBooks("north", "fitzgerald");
+    const std::size_t shared = catalog.sharedMemoryUsage();
+    ASSERT_TRUE(catalog.evictTenant("big"));
+    ASSERT_FALSE(catalog.evictTenant("big"));
+    ASSERT_FALSE(catalog.resident("big"));
+    ASSERT_EQ(catalog.tenantMemoryUsage("big"), 0u);
+    ASSERT_LT(catalog.sharedMemoryUsage(), shared);
+    ASSERT_EQ(catalog.bookCount("big"), static_cast<std::size_t>(kBigBooks));
+    ASSERT_EQ(catalog.evictIdleTenants(std::chrono::seconds(0)), 2u);
+    ASSERT_EQ(catalog.searchBooks("north", "fitzgerald"), north);
+    ASSERT_EQ(catalog.loans("north", makeIsbn(1)), 1u);
+    ASSERT_EQ(catalog.searchBooks("big", "volume 1999").size(), 1u);
+    ASSERT_TRUE(catalog.resident("big"));
+    ASSERT_FALSE(catalog.resident("south"));
+    ASSERT_EQ(catalog.evictIdleTenants(std::chrono::hours(1)), 0u);
+}
+
+/**
+ * @brief Test case for freeing the texts and terms of evicted tenants.
+ */
+TEST(MultiTenantCatalogTest, EvictionFreesStrings) {
+    MultiTenantCatalog catalog("/tmp");
+    ASSERT_TRUE(catalog.addBook("resident", "The Great Gatsby", "F. Scott Fitzgerald", makeIsbn(1)));
+    const std::size_t baseline = catalog.sharedMemoryUsage();
+
+    // Every round brings books with terms no other tenant has.
+    std::size_t peak = 0;
+    for (int round = 0; round < 20; ++round) {
+        const std::string tenant = "tenant-" + std::to_string(round);
+        for (int i = 0; i < 500; ++i) {
+            const std::string serial = std::to_string(round * 500 + i);
+            ASSERT_TRUE(catalog.addBook(tenant, "Chronicle" + serial + " " + std::string(200, 'x'),
+                                        "Scribe" + serial, makeIsbn(100 + i)));
+        }
+        ASSERT_GT(catalog.tenantMemoryUsage(tenant), 500u * 200u);
+        peak = std::max(peak, catalog.sharedMemoryUsage());
+        ASSERT_TRUE(catalog.evictTenant(tenant));
+        ASSERT_EQ(catalog.tenantMemoryUsage(tenant), 0u);
+    }
+    ASSERT_LT(catalog.sharedMemoryUsage(), peak);
+    ASSERT_LT(catalog.sharedMemoryUsage(), baseline + peak / 2);
+
+    ASSERT_EQ(catalog.searchBooks("tenant-3", "chronicle1501").size(), 1u);
+    ASSERT_TRUE(catalog.searchBooks("tenant-4", "chronicle1501").empty());
+    ASSERT_EQ(catalog.searchBooks("resident", "gatsby"), std::vector<std::string>(1, "The Great Gatsby"));
+}
+
+/**
+ * @brief Test case for interning the same strings from several threads.
+ */
+TEST(StringPoolTest, ConcurrentIntern) {
+    StringPool pool;
+    const int kThreads = 4;
+    const int kStrings = 5000;
+    std::vector<std::vector<StringPool::Id> > ids(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.push_back(std::thread([&pool, &ids, t]() {
+            for (int i = 0; i < kStrings; ++i) {
+                ids[t].push_back(pool.intern("Author " + std::to_string((i * 7 + t) % kStrings)));
+            }
+        }));
+    }
+    for (std::size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+
+    ASSERT_EQ(pool.size(), static_cast<std::size_t>(kStrings));
+    for (int t = 0; t < kThreads; ++t) {
+        for (int i = 0; i < kStrings; ++i) {
+            const std::string expected = "Author " + std::to_string((i * 7 + t) % kStrings);
+            ASSERT_EQ(pool.str(ids[t][i]), expected);
+            StringPool::Id found = 0;
+            ASSERT_TRUE(pool.find(expected, found));
+            ASSERT_EQ(found, ids[t][i]);
+        }
+    }
+    StringPool::Id missing = 0;
+    ASSERT_FALSE(pool.find("Author 5000", missing));
+
+    const std::string longText(40000, 'x');
+    const StringPool::Id longId = pool.intern(longText);
+    ASSERT_EQ(pool.view(longId).size, longText.size());
+    ASSERT_EQ(pool.intern(longText), longId);
+    ASSERT_EQ(pool.view(ids[0][0]).str(), pool.str(ids[0][0]));
+}
+
 /**
  * @brief Entry point for running the tests.
  * @param argc The number of command-line arguments.
@@ -78,6 +1206,12 @@ TEST_F(LibrarySystemTest, SearchBooks) {
  * @return The exit code for the test program.
  */
 int main(int argc, char **argv) {
+    if (argc == 4 && std::string(argv[1]) == kFollowerMode) {
+        return runFollower(argv[2], std::atoi(argv[3]));
+    }
+    if (argc == 3 && std::string(argv[1]) == kLookupClientMode) {
+        return runLookupClient(argv[2]);
+    }
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
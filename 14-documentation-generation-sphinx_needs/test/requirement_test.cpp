@@ -0,0 +1,469 @@
+//!
+//! @file requirement_test.cpp
+//! @brief Definition tests cases for the requirement stores
+//!
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "library_system/compressed_text_store.hpp"
+#include "library_system/flat_format.hpp"
+#include "library_system/requirement_repository.hpp"
+#include "library_system/requirement_table.hpp"
+#include "library_system/traceability_graph.hpp"
+
+/**
+ * @brief Test fixture for the requirement stores.
+ * This fixture fills a table with generated requirements.
+ */
+class RequirementTest : public ::testing::Test {
+protected:
+    /**
+     * @brief Set up resources before each test.
+     */
+    void SetUp() override {
+        const char* owners[] = {"Team A", "Team B", "Team C"};
+        for (int i = 0; i < 1000; ++i) {
+            Requirement requirement(i, "Requirement " + std::to_string(i),
+                                    "The system shall record loan " + std::to_string(i) +
+                                        " and notify the borrower before the due date.", i % 5,
+                                    static_cast<RequirementStatus>(i % 3), i % 7, owners[i % 3 == 0 ? 0 : i % 2 + 1],
+                                    formatEpochDay(parseEpochDay("2024-01-01") + i % 365));
+            requirements.push_back(requirement);
+            table.append(requirement);
+        }
+    }
+
+    std::vector<Requirement> requirements; // Row-oriented reference data
+    RequirementTable table;                // Columnar copy under test
+};
+
+/**
+ * @brief Test case for filtering on status and priority.
+ */
+TEST_F(RequirementTest, FilterMatchesRowScan) {
+    std::vector<RequirementTable::Row> rows;
+    table.filter(OPEN, 3, rows);
+
+    std::vector<RequirementTable::Row> expected;
+    int64_t expectedTestCases = 0;
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        if (requirements[i].getStatus() == OPEN && requirements[i].getPriority() >= 3) {
+            expected.push_back(static_cast<RequirementTable::Row>(i));
+            expectedTestCases += requirements[i].getTestCases();
+        }
+    }
+    ASSERT_EQ(rows, expected);
+    ASSERT_EQ(table.sumTestCases(OPEN, 3), expectedTestCases);
+    ASSERT_EQ(table.at(rows[0]).getID(), requirements[expected[0]].getID());
+}
+
+/**
+ * @brief Test case for aggregating test cases per owner.
+ */
+TEST_F(RequirementTest, SumTestCasesByOwner) {
+    std::vector<int64_t> totals = table.sumTestCasesByOwner();
+    ASSERT_EQ(totals.size(), table.ownerCount());
+
+    int64_t teamB = 0;
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        if (requirements[i].getOwner() == "Team B") {
+            teamB += requirements[i].getTestCases();
+        }
+    }
+    uint32_t code = 0;
+    ASSERT_TRUE(table.ownerCode("Team B", code));
+    ASSERT_EQ(totals[code], teamB);
+    ASSERT_EQ(table.ownerName(code).str(), "Team B");
+    ASSERT_FALSE(table.ownerCode("Team D", code));
+
+    // Owners are interned, so equal owners share an id.
+    ASSERT_EQ(requirements[1].getOwnerId(), requirements[5].getOwnerId());
+    ASSERT_NE(requirements[1].getOwnerId(), requirements[2].getOwnerId());
+}
+
+/**
+ * @brief Test case for reading compressed descriptions back from the table.
+ */
+TEST_F(RequirementTest, DescriptionsRoundTrip) {
+    char buffer[256];
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        const std::string expected = requirements[i].getDescription();
+        const RequirementTable::Row row = static_cast<RequirementTable::Row>(i);
+        ASSERT_EQ(table.description(row, buffer, sizeof(buffer)), expected.size());
+        ASSERT_EQ(std::string(buffer, expected.size()), expected);
+        ASSERT_EQ(table.at(row).getDescription(), expected);
+    }
+    ASSERT_EQ(table.description(0, buffer, 4), requirements[0].getDescription().size());
+}
+
+/**
+ * @brief Test case for shared-dictionary compression before and after training.
+ */
+TEST(CompressedTextStoreTest, CompressesBoilerplate) {
+    CompressedTextStore store;
+    std::vector<std::string> texts;
+    for (int i = 0; i < 2000; ++i) {
+        texts.push_back("As a librarian I want overdue loan " + std::to_string(i * 37) +
+                        " to be flagged so that reminders are sent to the borrower. Priority " +
+                        std::to_string(i % 4) + ". Acceptance: the reminder is sent once per day until the " +
+                        "book is returned, and the librarian can see every reminder in the loan history.");
+        ASSERT_EQ(store.append(texts.back()), static_cast<CompressedTextStore::Id>(i));
+        if (i == 10) {
+            ASSERT_FALSE(store.trained());
+            ASSERT_EQ(store.str(3), texts[3]);
+        }
+    }
+    ASSERT_TRUE(store.trained());
+    store.append("");
+    store.append("Short");
+    store.replace(5, "Replaced text that shares nothing with the corpus.");
+    texts[5] = "Replaced text that shares nothing with the corpus.";
+
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        ASSERT_EQ(store.str(static_cast<CompressedTextStore::Id>(i)), texts[i]);
+    }
+    ASSERT_EQ(store.str(2000), "");
+    ASSERT_EQ(store.str(2001), "Short");
+    ASSERT_LT(store.memoryUsage() * 2, store.rawBytes());
+}
+
+/**
+ * @brief Test case for reclaiming the bytes of replaced texts.
+ */
+TEST(CompressedTextStoreTest, ReplaceReclaimsBytes) {
+    CompressedTextStore store;
+    std::vector<std::string> texts;
+    for (int i = 0; i < 300; ++i) {
+        texts.push_back("Requirement " + std::to_string(i) + ": the catalog lists every copy of a book.");
+        store.append(texts.back());
+    }
+    ASSERT_TRUE(store.trained());
+    const std::size_t before = store.memoryUsage();
+
+    // Texts that grow and shrink in turn never fit in place every time.
+    for (int i = 0; i < 20000; ++i) {
+        const std::size_t id = static_cast<std::size_t>(i) % 7;
+        texts[id] = "Revision " + std::to_string(i) + std::string(i % 2 == 0 ? 150 : 10, 'x') +
+                    std::to_string(i * 7919);
+        store.replace(static_cast<CompressedTextStore::Id>(id), texts[id]);
+    }
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        ASSERT_EQ(store.str(static_cast<CompressedTextStore::Id>(i)), texts[i]);
+    }
+    ASSERT_LT(store.memoryUsage(), before + 32 * 1024);
+}
+
+/**
+ * @brief Test case for reading requirements in place from a flat buffer.
+ */
+TEST_F(RequirementTest, FlatRoundTrip) {
+    FlatWriter writer(FLAT_REQUIREMENT);
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        writer.addRequirement(requirements[i]);
+    }
+    std::vector<char> buffer;
+    writer.finish(buffer);
+
+    FlatReader reader(buffer.data(), buffer.size());
+    ASSERT_TRUE(reader.valid());
+    ASSERT_EQ(reader.size(), requirements.size());
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        const RequirementView view = reader.requirement(i);
+        ASSERT_EQ(view.id(), requirements[i].getID());
+        ASSERT_EQ(view.status(), requirements[i].getStatus());
+        ASSERT_EQ(view.owner().str(), requirements[i].getOwner());
+        ASSERT_EQ(view.toRequirement().getDescription(), requirements[i].getDescription());
+        ASSERT_EQ(view.toRequirement().getCreatedDay(), requirements[i].getCreatedDay());
+    }
+}
+
+/**
+ * @brief Test case for reading records written with an older and a newer schema.
+ */
+TEST(FlatFormatTest, SchemaEvolution) {
+    // An older writer knew only the first three fields; a newer one adds a tenth.
+    FlatWriter writer(FLAT_REQUIREMENT, kFlatSchemaVersion + 1);
+    writer.beginRecord(3);
+    writer.setInt32(REQUIREMENT_ID, 42);
+    writer.setString(REQUIREMENT_TITLE, "Old record");
+    writer.setInt32(REQUIREMENT_PRIORITY, 5); // Past the record's field count.
+    writer.endRecord();
+    writer.beginRecord(REQUIREMENT_FIELD_COUNT + 2);
+    writer.setInt32(REQUIREMENT_ID, 43);
+    writer.setString(REQUIREMENT_FIELD_COUNT + 1, "Field from the future");
+    writer.setInt32(REQUIREMENT_STATUS, CLOSED);
+    writer.endRecord();
+    std::vector<char> buffer;
+    writer.finish(buffer);
+
+    FlatReader reader(buffer.data(), buffer.size());
+    ASSERT_TRUE(reader.valid());
+    ASSERT_EQ(reader.schemaVersion(), kFlatSchemaVersion + 1);
+    ASSERT_EQ(reader.requirement(0).title().str(), "Old record");
+    ASSERT_FALSE(reader.requirement(0).has(REQUIREMENT_PRIORITY));
+    ASSERT_EQ(reader.requirement(0).priority(), 0);
+    ASSERT_EQ(reader.requirement(0).description().str(), "");
+    ASSERT_EQ(reader.requirement(1).id(), 43);
+    ASSERT_EQ(reader.requirement(1).status(), CLOSED);
+
+    // Corrupt a string length so that it runs past the end of the buffer.
+    std::vector<char> corrupt(buffer);
+    const std::string title = "Old record";
+    std::vector<char>::iterator text = std::search(corrupt.begin(), corrupt.end(), title.begin(), title.end());
+    ASSERT_TRUE(text != corrupt.end());
+    *(text - 1) = 0x7F;
+    ASSERT_FALSE(FlatReader(corrupt.data(), corrupt.size()).valid());
+    corrupt = buffer;
+    corrupt[0] = 'X';
+    ASSERT_FALSE(FlatReader(corrupt.data(), corrupt.size()).valid());
+}
+
+/**
+ * @brief Test case for roaring bitmap set operations across container types.
+ */
+TEST(RoaringBitmapTest, SetOperations) {
+    RoaringBitmap dense;
+    RoaringBitmap sparse;
+    for (uint32_t i = 0; i < 20000; ++i) {
+        dense.add(i);          // Bitmap container.
+        if (i % 100 == 0) {
+            sparse.add(i);     // Array container.
+        }
+    }
+    sparse.add(1u << 20);
+
+    ASSERT_EQ(dense.cardinality(), 20000);
+    ASSERT_EQ((dense & sparse).cardinality(), 200);
+    ASSERT_EQ((dense | sparse).cardinality(), 20001);
+    ASSERT_EQ(dense.andNot(sparse).cardinality(), 19800);
+    ASSERT_TRUE(sparse.andNot(dense).contains(1u << 20));
+
+    for (uint32_t i = 0; i < 19000; ++i) {
+        dense.remove(i);
+    }
+    ASSERT_EQ(dense.cardinality(), 1000);
+    ASSERT_EQ(dense.toVector().front(), 19000);
+}
+
+/**
+ * @brief Test case for building a roaring bitmap from sorted values in bulk.
+ */
+TEST(RoaringBitmapTest, FromSorted) {
+    std::vector<uint32_t> values;
+    RoaringBitmap expected;
+    for (uint32_t i = 0; i < 70000; i += (i < 10000 ? 1 : 7)) {
+        values.push_back(i);
+        expected.add(i);
+    }
+    values.push_back(values.back()); // Duplicates are stored once.
+    values.push_back(5u << 20);
+    expected.add(5u << 20);
+
+    RoaringBitmap built = RoaringBitmap::fromSorted(values);
+    ASSERT_TRUE(built == expected);
+    ASSERT_EQ(built.cardinality(), expected.cardinality());
+    ASSERT_TRUE(RoaringBitmap::fromSorted(std::vector<uint32_t>()).empty());
+}
+
+/**
+ * @brief Test case for compound predicates over the secondary indexes.
+ */
+TEST_F(RequirementTest, RepositoryCompoundQuery) {
+    RequirementRepository repository;
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        ASSERT_TRUE(repository.insert(requirements[i]));
+    }
+    ASSERT_FALSE(repository.insert(requirements[0]));
+
+    RoaringBitmap rows = repository.withStatus(IN_PROGRESS) & repository.ownedBy("Team B");
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        expected += requirements[i].getStatus() == IN_PROGRESS && requirements[i].getOwner() == "Team B";
+    }
+    ASSERT_EQ(rows.cardinality(), expected);
+
+    // Moving a requirement updates every index it appears in.
+    Requirement moved(7, "Requirement 7", "Description", 9, CLOSED, 0, "Team D", "2023-06-30");
+    ASSERT_TRUE(repository.update(moved));
+    ASSERT_EQ(repository.ownedBy("Team D").cardinality(), 1);
+    ASSERT_EQ(repository.withPriority(9, 9).cardinality(), 1);
+    ASSERT_EQ(repository.fetch(repository.ownedBy("Team D"))[0].getPriority(), 9);
+    ASSERT_EQ(repository.withPriority(0, 100).cardinality(), requirements.size());
+    ASSERT_EQ((repository.withPriority(3, 4) | repository.withStatus(CLOSED)).cardinality(),
+              repository.withPriority(3, 4).cardinality() + repository.withStatus(CLOSED).andNot(repository.withPriority(3, 4)).cardinality());
+}
+
+/**
+ * @brief Test case for parsing and formatting calendar dates.
+ */
+TEST(EpochDayTest, ParseAndFormat) {
+    ASSERT_EQ(parseEpochDay("1970-01-01"), 0);
+    ASSERT_EQ(parseEpochDay("2000-03-01"), 11017);
+    ASSERT_EQ(parseEpochDay("1969-12-31"), -1);
+    ASSERT_EQ(formatEpochDay(parseEpochDay("2024-02-29")), "2024-02-29");
+    ASSERT_EQ(parseEpochDay("2023-02-29"), kInvalidEpochDay);
+    ASSERT_EQ(parseEpochDay("2024-13-01"), kInvalidEpochDay);
+    ASSERT_EQ(parseEpochDay("yesterday"), kInvalidEpochDay);
+}
+
+/**
+ * @brief Test case for creation date range queries.
+ */
+TEST_F(RequirementTest, RepositoryCreatedBetween) {
+    RequirementRepository repository;
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        repository.insert(requirements[i]);
+    }
+
+    // January 2024 is days 0..30 of the generated cycle of 365 days.
+    RoaringBitmap january = repository.createdBetween("2024-01-01", "2024-01-31");
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < requirements.size(); ++i) {
+        expected += requirements[i].getCreatedDate().compare(0, 7, "2024-01") == 0;
+    }
+    ASSERT_EQ(january.cardinality(), expected);
+    ASSERT_TRUE(january.contains(30));
+    ASSERT_FALSE(january.contains(31));
+
+    Requirement moved(30, "Requirement 30", "Description", 1, OPEN, 0, "Team A", "2025-01-01");
+    ASSERT_TRUE(repository.update(moved));
+    ASSERT_FALSE(repository.createdBetween("2024-01-01", "2024-01-31").contains(30));
+    ASSERT_TRUE(repository.createdBetween("2025-01-01", "2025-01-01").contains(30));
+    ASSERT_TRUE(repository.createdBetween("2024-01-01", "not a date").empty());
+}
+
+/**
+ * @brief Test case for date queries after out-of-order inserts and repeated updates.
+ */
+TEST(RequirementRepositoryTest, CreatedBetweenBatchesChanges) {
+    RequirementRepository repository;
+    std::vector<int> days;
+    for (int id = 0; id < 2000; ++id) {
+        // Descending creation days force every insert past the append path.
+        const int day = parseEpochDay("2024-01-01") + (2000 - id) % 97;
+        repository.insert(Requirement(id, "Requirement", "Description", 1, OPEN, 0, "Team A", formatEpochDay(day)));
+        days.push_back(day);
+    }
+    for (int round = 0; round < 3; ++round) {
+        for (int id = round; id < 2000; id += 7) {
+            days[id] = parseEpochDay("2024-01-01") + (id * 31 + round) % 97;
+            ASSERT_TRUE(repository.update(
+                Requirement(id, "Requirement", "Description", 1, OPEN, 0, "Team A", formatEpochDay(days[id]))));
+        }
+        const int from = parseEpochDay("2024-01-01") + 10 * round;
+        const int to = from + 40;
+        std::vector<uint32_t> expected;
+        for (int id = 0; id < 2000; ++id) {
+            if (days[id] >= from && days[id] <= to) {
+                expected.push_back(static_cast<uint32_t>(id));
+            }
+        }
+        ASSERT_EQ(repository.createdBetween(from, to).toVector(), expected);
+    }
+}
+
+/**
+ * @brief Test case for coverage and impact queries on a small traceability graph.
+ */
+TEST(TraceabilityGraphTest, CoverageAndImpact) {
+    TraceabilityGraph graph;
+    const TraceabilityGraph::NodeId borrow = graph.addNode(TRACE_REQUIREMENT, "REQ_BORROW");
+    const TraceabilityGraph::NodeId search = graph.addNode(TRACE_REQUIREMENT, "REQ_SEARCH");
+    const TraceabilityGraph::NodeId report = graph.addNode(TRACE_REQUIREMENT, "REQ_REPORT");
+    const TraceabilityGraph::NodeId loans = graph.addNode(TRACE_SPECIFICATION, "SPEC_LOANS");
+    const TraceabilityGraph::NodeId borrowTest = graph.addNode(TRACE_TEST_CASE, "TEST_BORROW");
+    const TraceabilityGraph::NodeId searchTest = graph.addNode(TRACE_TEST_CASE, "TEST_SEARCH");
+    ASSERT_EQ(graph.addNode(TRACE_REQUIREMENT, "REQ_SEARCH"), search);
+
+    graph.addLink(borrow, loans);
+    graph.addLink(loans, borrowTest);
+    graph.addLink(search, searchTest);
+    graph.addLink(search, searchTest);
+    graph.build();
+    ASSERT_EQ(graph.linkCount(), 3u);
+
+    ASSERT_EQ(graph.uncoveredRequirements(), std::vector<TraceabilityGraph::NodeId>(1, report));
+    ASSERT_EQ(graph.affectedRequirements(std::vector<TraceabilityGraph::NodeId>(1, borrowTest)),
+              std::vector<TraceabilityGraph::NodeId>(1, borrow));
+    ASSERT_EQ(graph.verifyingTests(borrow), std::vector<TraceabilityGraph::NodeId>(1, borrowTest));
+
+    // Nodes added after build() are queryable but unlinked until the next build().
+    const TraceabilityGraph::NodeId audit = graph.addNode(TRACE_REQUIREMENT, "REQ_AUDIT");
+    ASSERT_EQ(graph.uncoveredRequirements().size(), 2u);
+    graph.addLink(audit, searchTest);
+    graph.build();
+    ASSERT_EQ(graph.affectedRequirements(std::vector<TraceabilityGraph::NodeId>(1, searchTest)).size(), 2u);
+
+    TraceabilityGraph::NodeId found = 0;
+    ASSERT_TRUE(graph.find("SPEC_LOANS", found));
+    ASSERT_EQ(found, loans);
+    ASSERT_EQ(graph.key(found), "SPEC_LOANS");
+    ASSERT_EQ(graph.kind(found), TRACE_SPECIFICATION);
+    ASSERT_FALSE(graph.find("SPEC_MISSING", found));
+}
+
+/**
+ * @brief Test case for queries and links naming nodes that do not exist.
+ */
+TEST(TraceabilityGraphTest, UnknownNodes) {
+    TraceabilityGraph graph;
+    const TraceabilityGraph::NodeId borrow = graph.addNode(TRACE_REQUIREMENT, "REQ_BORROW");
+    const TraceabilityGraph::NodeId borrowTest = graph.addNode(TRACE_TEST_CASE, "TEST_BORROW");
+    graph.addLink(borrow, borrowTest);
+    graph.addLink(borrow, 2);
+    graph.addLink(100000, borrowTest);
+    graph.build();
+    ASSERT_EQ(graph.linkCount(), 1u);
+
+    std::vector<TraceabilityGraph::NodeId> failingTests;
+    failingTests.push_back(2);
+    failingTests.push_back(borrowTest);
+    failingTests.push_back(100000);
+    ASSERT_EQ(graph.affectedRequirements(failingTests), std::vector<TraceabilityGraph::NodeId>(1, borrow));
+    ASSERT_TRUE(graph.affectedRequirements(std::vector<TraceabilityGraph::NodeId>(1, 64)).empty());
+    ASSERT_TRUE(graph.verifyingTests(2).empty());
+    ASSERT_TRUE(graph.verifyingTests(100000).empty());
+}
+
+/**
+ * @brief Test case for coverage queries over a graph with 100k nodes.
+ */
+TEST(TraceabilityGraphTest, LargeGraph) {
+    // Requirement i is refined by specification i / 4, which every fifth
+    // test case verifies; requirements with i % 10 == 9 are never refined.
+    const int kRequirements = 40000;
+    const int kSpecifications = kRequirements / 4;
+    const int kTests = 50000;
+    TraceabilityGraph graph;
+    std::vector<TraceabilityGraph::NodeId> requirements;
+    std::vector<TraceabilityGraph::NodeId> specifications;
+    std::vector<TraceabilityGraph::NodeId> tests;
+    for (int i = 0; i < kRequirements; ++i) {
+        requirements.push_back(graph.addNode(TRACE_REQUIREMENT, "REQ_" + std::to_string(i)));
+    }
+    for (int i = 0; i < kSpecifications; ++i) {
+        specifications.push_back(graph.addNode(TRACE_SPECIFICATION, "SPEC_" + std::to_string(i)));
+    }
+    for (int i = 0; i < kTests; ++i) {
+        tests.push_back(graph.addNode(TRACE_TEST_CASE, "TEST_" + std::to_string(i)));
+        graph.addLink(specifications[i % kSpecifications], tests.back());
+    }
+    for (int i = 0; i < kRequirements; ++i) {
+        if (i % 10 != 9) {
+            graph.addLink(requirements[i], specifications[i / 4]);
+        }
+    }
+    graph.build();
+    ASSERT_EQ(graph.nodeCount(), static_cast<std::size_t>(kRequirements + kSpecifications + kTests));
+
+    const std::vector<TraceabilityGraph::NodeId> uncovered = graph.uncoveredRequirements();
+    ASSERT_EQ(uncovered.size(), static_cast<std::size_t>(kRequirements / 10));
+    ASSERT_EQ(graph.key(uncovered.front()), "REQ_9");
+
+    // Test 3 verifies specification 3, which refines requirements 12 to 15.
+    const std::vector<TraceabilityGraph::NodeId> affected =
+        graph.affectedRequirements(std::vector<TraceabilityGraph::NodeId>(1, tests[3]));
+    ASSERT_EQ(affected.size(), 4u);
+    ASSERT_EQ(affected.front(), requirements[12]);
+    ASSERT_EQ(graph.verifyingTests(requirements[12]).size(), static_cast<std::size_t>(kTests / kSpecifications));
+}